@@ -0,0 +1,202 @@
+#include "stdafx.h"
+#include "DataTool.h"
+#include "BmdAnimation.h"
+#include "BmdSkin.h"
+
+#define ANIMATION_POSE_PER_ACTION 4
+
+struct BMD_ANIMATION_SAMPLE
+{
+	float Rotation[4];
+	BMD_VECTOR Position;
+};
+
+static void SampleSource(CBmdModel* lpModel, DWORD action, float frame, std::vector<BMD_ANIMATION_SAMPLE>& sample)
+{
+	// Reference path, slerps the float keys straight out of the model file
+	DWORD KeyCount = lpModel->GetAction(action)->KeyCount;
+
+	DWORD key1 = ((DWORD)frame) % KeyCount;
+
+	DWORD key2 = (key1 + 1) % KeyCount;
+
+	float t = frame - floor(frame);
+
+	for (DWORD n = 0; n < lpModel->GetBoneCount(); n++)
+	{
+		BMD_ANIMATION_SAMPLE* lpSample = &sample[n];
+
+		BMD_BONE_KEY* lpKey = lpModel->GetBoneKey(n, action);
+
+		if (lpKey == 0)
+		{
+			memset(lpSample, 0, sizeof(BMD_ANIMATION_SAMPLE));
+			lpSample->Rotation[3] = 1.0f;
+			continue;
+		}
+
+		float q1[4], q2[4];
+
+		AngleQuaternion(lpKey->Rotation.Get(key1), q1);
+
+		AngleQuaternion(lpKey->Rotation.Get(key2), q2);
+
+		QuaternionSlerp(q1, q2, t, lpSample->Rotation);
+
+		const BMD_VECTOR* p1 = lpKey->Position.Get(key1);
+
+		const BMD_VECTOR* p2 = lpKey->Position.Get(key2);
+
+		lpSample->Position.X = p1->X + ((p2->X - p1->X) * t);
+		lpSample->Position.Y = p1->Y + ((p2->Y - p1->Y) * t);
+		lpSample->Position.Z = p1->Z + ((p2->Z - p1->Z) * t);
+	}
+}
+
+int CommandAnimation(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printf("Usage: DataTool anim <directory> [runs]\n");
+		return 1;
+	}
+
+	int runs = ((argc >= 2) ? atoi(argv[1]) : 5);
+
+	if (runs <= 0)
+	{
+		runs = 1;
+	}
+
+	std::vector<std::string> list;
+
+	ScanFiles(argv[0], ".bmd", list);
+
+	DWORD ModelCount = 0;
+
+	DWORD BudgetCount = 0;
+
+	QWORD SourceSize = 0;
+
+	QWORD DataSize = 0;
+
+	QWORD SampleCount = 0;
+
+	float RotationError = 0.0f;
+
+	float PositionError = 0.0f;
+
+	float SampleRotationError = 0.0f;
+
+	float SamplePositionError = 0.0f;
+
+	double SourceTime = 0;
+
+	double StoreTime = 0;
+
+	CBmdModel model;
+
+	CBmdAnimation animation;
+
+	std::vector<BMD_ANIMATION_SAMPLE> sample;
+
+	for (size_t n = 0; n < list.size(); n++)
+	{
+		if (model.Open((char*)list[n].c_str()) == 0 || model.GetBoneCount() == 0 || model.GetActionCount() == 0)
+		{
+			continue;
+		}
+
+		ModelCount++;
+
+		if (animation.Build(&model) == 0)
+		{
+			BudgetCount++;
+
+			printf("over budget: %s rotation %f position %f\n", list[n].c_str(), animation.GetRotationError(), animation.GetPositionError());
+		}
+
+		SourceSize += animation.GetSourceSize();
+
+		DataSize += animation.GetDataSize();
+
+		RotationError = ((animation.GetRotationError() > RotationError) ? animation.GetRotationError() : RotationError);
+
+		PositionError = ((animation.GetPositionError() > PositionError) ? animation.GetPositionError() : PositionError);
+
+		sample.resize(model.GetBoneCount());
+
+		for (DWORD action = 0; action < model.GetActionCount(); action++)
+		{
+			DWORD KeyCount = model.GetAction(action)->KeyCount;
+
+			if (KeyCount == 0)
+			{
+				continue;
+			}
+
+			for (DWORD pose = 0; pose < ANIMATION_POSE_PER_ACTION; pose++)
+			{
+				float frame = ((float)(KeyCount * pose) / ANIMATION_POSE_PER_ACTION) + 0.37f;
+
+				double start = GetTimeMs();
+
+				for (int i = 0; i < runs; i++)
+				{
+					SampleSource(&model, action, frame, sample);
+				}
+
+				SourceTime += GetTimeMs() - start;
+
+				start = GetTimeMs();
+
+				for (int i = 0; i < runs; i++)
+				{
+					animation.Sample(action, frame);
+				}
+
+				StoreTime += GetTimeMs() - start;
+
+				SampleCount += (QWORD)model.GetBoneCount() * runs;
+
+				for (DWORD b = 0; b < model.GetBoneCount(); b++)
+				{
+					float q[4];
+
+					BMD_VECTOR position;
+
+					animation.GetRotation(b, q);
+
+					animation.GetPosition(b, &position);
+
+					float* r = sample[b].Rotation;
+
+					float angle = CBmdAnimation::GetRotationDelta(q, r);
+
+					SampleRotationError = ((angle > SampleRotationError) ? angle : SampleRotationError);
+
+					float error[3] = { fabs(position.X - sample[b].Position.X), fabs(position.Y - sample[b].Position.Y), fabs(position.Z - sample[b].Position.Z) };
+
+					for (int i = 0; i < 3; i++)
+					{
+						SamplePositionError = ((error[i] > SamplePositionError) ? error[i] : SamplePositionError);
+					}
+				}
+			}
+		}
+	}
+
+	printf("models: %d, over budget: %d (rotation %g rad, position %g)\n", ModelCount, BudgetCount, BMD_ANIMATION_ROTATION_ERROR, BMD_ANIMATION_POSITION_ERROR);
+
+	printf("keys: max rotation error %g rad, max position error %g\n", RotationError, PositionError);
+
+	printf("samples: max rotation error %g rad, max position error %g\n", SampleRotationError, SamplePositionError);
+
+	printf("memory: source %llu bytes, quantized %llu bytes (%.1f%%)\n", SourceSize, DataSize, ((SourceSize > 0) ? ((DataSize * 100.0) / SourceSize) : 0.0));
+
+	printf("source slerp: %.2f ms (%.1f M bones/s)\n", SourceTime, ((SampleCount / 1000000.0) / (SourceTime / 1000.0)));
+
+	printf("store sample: %.2f ms (%.1f M bones/s, %.2fx)\n", StoreTime, ((SampleCount / 1000000.0) / (StoreTime / 1000.0)), (SourceTime / StoreTime));
+
+	return ((BudgetCount == 0) ? 0 : 1);
+}
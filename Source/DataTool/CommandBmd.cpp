@@ -0,0 +1,152 @@
+#include "stdafx.h"
+#include "DataTool.h"
+#include "BmdModel.h"
+
+struct BMD_CORPUS_INFO
+{
+	DWORD FileCount;
+	DWORD ModelCount;
+	DWORD EncryptedCount;
+	DWORD SkipCount;
+	DWORD ErrorCount;
+	DWORD InvalidCount;
+	QWORD ByteCount;
+	QWORD MeshCount;
+	QWORD VertexCount;
+	QWORD TriangleCount;
+	QWORD ActionCount;
+	QWORD BoneCount;
+	QWORD KeyCount;
+};
+
+static bool IsModelFile(char* path)
+{
+	HANDLE file = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_ARCHIVE, 0);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	BYTE head[4] = { 0 };
+
+	DWORD OutSize = 0;
+
+	ReadFile(file, head, sizeof(head), &OutSize, 0);
+
+	CloseHandle(file);
+
+	return (OutSize == sizeof(head) && head[0] == 'B' && head[1] == 'M' && head[2] == 'D');
+}
+
+static void LoadCorpus(std::vector<std::string>& list, BMD_CORPUS_INFO* lpInfo, bool verbose)
+{
+	memset(lpInfo, 0, sizeof(BMD_CORPUS_INFO));
+
+	CBmdModel model;
+
+	for (size_t n = 0; n < list.size(); n++)
+	{
+		lpInfo->FileCount++;
+
+		if (model.Open((char*)list[n].c_str()) == 0)
+		{
+			if (IsModelFile((char*)list[n].c_str()) == 0)
+			{
+				lpInfo->SkipCount++;
+
+				continue;
+			}
+
+			lpInfo->ErrorCount++;
+
+			if (verbose != 0)
+			{
+				printf("error: %s\n", list[n].c_str());
+			}
+
+			continue;
+		}
+
+		if (model.Validate() == 0)
+		{
+			lpInfo->InvalidCount++;
+
+			if (verbose != 0)
+			{
+				printf("invalid: %s\n", list[n].c_str());
+			}
+		}
+
+		lpInfo->ModelCount++;
+
+		lpInfo->EncryptedCount += ((model.GetVersion() == BMD_VERSION_ENCRYPTED) ? 1 : 0);
+
+		lpInfo->ByteCount += model.GetDataSize();
+
+		lpInfo->MeshCount += model.GetMeshCount();
+
+		lpInfo->ActionCount += model.GetActionCount();
+
+		lpInfo->BoneCount += model.GetBoneCount();
+
+		for (DWORD i = 0; i < model.GetMeshCount(); i++)
+		{
+			lpInfo->VertexCount += model.GetMesh(i)->Vertex.GetCount();
+
+			lpInfo->TriangleCount += model.GetMesh(i)->Triangle.GetCount();
+		}
+
+		for (DWORD i = 0; i < model.GetActionCount(); i++)
+		{
+			lpInfo->KeyCount += model.GetAction(i)->KeyCount * model.GetBoneCount();
+		}
+	}
+}
+
+int CommandBmd(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printf("Usage: DataTool bmd <directory> [runs]\n");
+		return 1;
+	}
+
+	int runs = ((argc >= 2) ? atoi(argv[1]) : 5);
+
+	if (runs <= 0)
+	{
+		runs = 1;
+	}
+
+	std::vector<std::string> list;
+
+	ScanFiles(argv[0], ".bmd", list);
+
+	BMD_CORPUS_INFO info;
+
+	double start = GetTimeMs();
+
+	LoadCorpus(list, &info, 1);
+
+	double ColdTime = GetTimeMs() - start;
+
+	start = GetTimeMs();
+
+	for (int n = 0; n < runs; n++)
+	{
+		LoadCorpus(list, &info, 0);
+	}
+
+	double WarmTime = (GetTimeMs() - start) / runs;
+
+	printf("files: %d, models: %d (%d encrypted), skipped: %d, errors: %d, invalid: %d\n", info.FileCount, info.ModelCount, info.EncryptedCount, info.SkipCount, info.ErrorCount, info.InvalidCount);
+
+	printf("meshes: %llu, vertices: %llu, triangles: %llu, actions: %llu, bones: %llu, bone keys: %llu\n", info.MeshCount, info.VertexCount, info.TriangleCount, info.ActionCount, info.BoneCount, info.KeyCount);
+
+	printf("first pass: %.2f ms (%.1f MB/s)\n", ColdTime, ((info.ByteCount / 1048576.0) / (ColdTime / 1000.0)));
+
+	printf("warm pass: %.2f ms (%.1f MB/s, %.0f models/s)\n", WarmTime, ((info.ByteCount / 1048576.0) / (WarmTime / 1000.0)), (info.ModelCount / (WarmTime / 1000.0)));
+
+	return ((info.ErrorCount == 0 && info.InvalidCount == 0) ? 0 : 1);
+}
@@ -0,0 +1,87 @@
+#include "stdafx.h"
+#include "DataTool.h"
+#include "BmdCook.h"
+
+int CommandCookBmd(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printf("Usage: DataTool cookbmd <directory>\n");
+		return 1;
+	}
+
+	std::vector<std::string> list;
+
+	ScanFiles(argv[0], ".bmd", list);
+
+	BMD_COOK_INFO total;
+
+	memset(&total, 0, sizeof(total));
+
+	DWORD ModelCount = 0;
+
+	DWORD SkipCount = 0;
+
+	DWORD ErrorCount = 0;
+
+	QWORD SourceSize = 0;
+
+	QWORD CookedSize = 0;
+
+	double start = GetTimeMs();
+
+	for (size_t n = 0; n < list.size(); n++)
+	{
+		BMD_COOK_INFO info;
+
+		if (CBmdCook::CookFile((char*)list[n].c_str(), &info) == 0)
+		{
+			SkipCount++;
+			continue;
+		}
+
+		char CookPath[MAX_PATH];
+
+		wsprintf(CookPath, "%s%s", list[n].c_str(), BMD_COOK_EXTENSION);
+
+		CBmdCookedModel cooked;
+
+		if (cooked.Open(CookPath, info.SourceCRC, info.SourceSize) == 0)
+		{
+			ErrorCount++;
+			printf("error: %s\n", CookPath);
+		}
+
+		ModelCount++;
+
+		SourceSize += info.SourceSize;
+
+		CookedSize += info.CookedSize;
+
+		total.CornerCount += info.CornerCount;
+
+		total.VertexCount += info.VertexCount;
+
+		total.TriangleCount += info.TriangleCount;
+
+		total.SourceMiss += info.SourceMiss;
+
+		total.CookedMiss += info.CookedMiss;
+	}
+
+	double CookTime = GetTimeMs() - start;
+
+	double triangles = ((total.TriangleCount > 0) ? total.TriangleCount : 1);
+
+	printf("files: %d, cooked: %d, skipped: %d, errors: %d\n", list.size(), ModelCount, SkipCount, ErrorCount);
+
+	printf("corners: %d, welded vertices: %d (%.2f corners/vertex), triangles: %d\n", total.CornerCount, total.VertexCount, ((double)total.CornerCount / ((total.VertexCount > 0) ? total.VertexCount : 1)), total.TriangleCount);
+
+	printf("acmr (fifo %d): source order %.3f, cooked order %.3f, lower bound %.3f\n", BMD_COOK_CACHE_SIZE, (total.SourceMiss / triangles), (total.CookedMiss / triangles), (total.VertexCount / triangles));
+
+	printf("size: source %llu bytes, cooked %llu bytes (%.1f%%)\n", SourceSize, CookedSize, ((SourceSize > 0) ? ((CookedSize * 100.0) / SourceSize) : 0.0));
+
+	printf("cook time: %.2f ms (%.1f MB/s, %.0f models/s)\n", CookTime, ((SourceSize / 1048576.0) / (CookTime / 1000.0)), (ModelCount / (CookTime / 1000.0)));
+
+	return ((ErrorCount == 0) ? 0 : 1);
+}
@@ -0,0 +1,171 @@
+#include "stdafx.h"
+#include "DataTool.h"
+#include "TextureCook.h"
+
+struct TEXTURE_COOK_STATE
+{
+	std::vector<std::string>* List;
+	volatile LONG Next;
+	CRITICAL_SECTION Lock;
+	CTextureBufferPool Pool;
+	DWORD CookCount;
+	DWORD AlphaCount;
+	DWORD ErrorCount;
+	QWORD SourceSize;
+	QWORD DecodedSize;
+	QWORD CookedSize;
+	QWORD PixelCount;
+	BC_ERROR ColorError;
+	BC_ERROR AlphaError;
+	double WorstPsnr;
+	std::string WorstPath;
+};
+
+static DWORD WINAPI CookTextureThread(LPVOID lpParam)
+{
+	TEXTURE_COOK_STATE* lpState = (TEXTURE_COOK_STATE*)lpParam;
+
+	CTextureDecoder decoder;
+
+	LONG index;
+
+	while ((index = InterlockedIncrement(&lpState->Next) - 1) < (LONG)lpState->List->size())
+	{
+		char* path = (char*)(*lpState->List)[index].c_str();
+
+		TEXTURE_COOK_INFO info;
+
+		bool result = CTextureCook::CookFile(path, &decoder, &lpState->Pool, &info);
+
+		EnterCriticalSection(&lpState->Lock);
+
+		if (result == 0)
+		{
+			lpState->ErrorCount++;
+
+			printf("cook failed: %s\n", path);
+		}
+		else
+		{
+			lpState->CookCount++;
+
+			lpState->SourceSize += info.SourceSize;
+
+			lpState->DecodedSize += info.DecodedSize;
+
+			lpState->CookedSize += info.CookedSize;
+
+			lpState->PixelCount += info.Width * info.Height;
+
+			lpState->ColorError.Color += info.Error.Color;
+
+			lpState->ColorError.PixelCount += info.Error.PixelCount;
+
+			if (info.Alpha != 0)
+			{
+				lpState->AlphaCount++;
+
+				lpState->AlphaError.Alpha += info.Error.Alpha;
+
+				lpState->AlphaError.PixelCount += info.Error.PixelCount;
+			}
+
+			double psnr = CBcEncoder::GetPsnr(info.Error.Color, (info.Error.PixelCount * 3));
+
+			if (psnr < lpState->WorstPsnr)
+			{
+				lpState->WorstPsnr = psnr;
+
+				lpState->WorstPath = path;
+			}
+		}
+
+		LeaveCriticalSection(&lpState->Lock);
+	}
+
+	return 0;
+}
+
+int CommandCookTexture(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printf("Usage: DataTool cooktex <directory> [threads]\n");
+		return 1;
+	}
+
+	int ThreadCount = ((argc >= 2) ? atoi(argv[1]) : 0);
+
+	if (ThreadCount <= 0)
+	{
+		SYSTEM_INFO info;
+
+		GetSystemInfo(&info);
+
+		ThreadCount = info.dwNumberOfProcessors;
+	}
+
+	std::vector<std::string> list;
+
+	ScanFiles(argv[0], ".ozj", list);
+
+	ScanFiles(argv[0], ".ozt", list);
+
+	TEXTURE_COOK_STATE state;
+
+	state.List = &list;
+
+	state.Next = 0;
+
+	state.CookCount = 0;
+
+	state.AlphaCount = 0;
+
+	state.ErrorCount = 0;
+
+	state.SourceSize = 0;
+
+	state.DecodedSize = 0;
+
+	state.CookedSize = 0;
+
+	state.PixelCount = 0;
+
+	memset(&state.ColorError, 0, sizeof(state.ColorError));
+
+	memset(&state.AlphaError, 0, sizeof(state.AlphaError));
+
+	state.WorstPsnr = 99.0;
+
+	InitializeCriticalSection(&state.Lock);
+
+	std::vector<HANDLE> thread(ThreadCount);
+
+	double start = GetTimeMs();
+
+	for (int n = 0; n < ThreadCount; n++)
+	{
+		thread[n] = CreateThread(0, 0, CookTextureThread, &state, 0, 0);
+	}
+
+	for (int n = 0; n < ThreadCount; n++)
+	{
+		WaitForSingleObject(thread[n], INFINITE);
+
+		CloseHandle(thread[n]);
+	}
+
+	double time = GetTimeMs() - start;
+
+	DeleteCriticalSection(&state.Lock);
+
+	printf("textures: %d cooked (%d BC3, %d BC1), %d errors, %d threads\n", state.CookCount, state.AlphaCount, (state.CookCount - state.AlphaCount), state.ErrorCount, ThreadCount);
+
+	printf("size: source %.2f MB, RGBA with mips %.2f MB, cooked %.2f MB (%.1f%% of RGBA)\n", (state.SourceSize / 1048576.0), (state.DecodedSize / 1048576.0), (state.CookedSize / 1048576.0), ((state.DecodedSize > 0) ? ((state.CookedSize * 100.0) / state.DecodedSize) : 0.0));
+
+	printf("quality: RGB PSNR %.2f dB, alpha PSNR %.2f dB, worst RGB PSNR %.2f dB (%s)\n", CBcEncoder::GetPsnr(state.ColorError.Color, (state.ColorError.PixelCount * 3)), CBcEncoder::GetPsnr(state.AlphaError.Alpha, state.AlphaError.PixelCount), state.WorstPsnr, state.WorstPath.c_str());
+
+	printf("time: %.2f ms, %.2f M pixels/s\n", time, ((state.PixelCount / 1000000.0) / (time / 1000.0)));
+
+	return ((state.ErrorCount == 0) ? 0 : 1);
+}
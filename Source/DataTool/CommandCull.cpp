@@ -0,0 +1,451 @@
+#include "stdafx.h"
+#include "DataTool.h"
+#include "MemScript.h"
+#include "TerrainCull.h"
+
+#define CULL_STATE_PER_WORLD 32
+#define CULL_STATE_DEFAULT 8
+#define CULL_RAY_WIDTH 40
+#define CULL_RAY_HEIGHT 30
+#define CULL_RAY_STEP 25.0f
+#define CULL_ASPECT (4.0f / 3.0f)
+
+struct CULL_STATE
+{
+	int World;
+	float X;
+	float Y;
+	CAMERA_INFO Camera;
+};
+
+struct CULL_STAT
+{
+	DWORD StateCount;
+	double Rectangle;
+	double Frustum;
+	double Horizon;
+	double TestCount;
+	double Time;
+	DWORD RayCount;
+	DWORD RectangleMiss;
+	DWORD FrustumMiss;
+	DWORD HorizonMiss;
+};
+
+static void SetDefaultCamera(CAMERA_INFO* lpCamera)
+{
+	memset(lpCamera, 0, sizeof(CAMERA_INFO));
+
+	lpCamera->Zoom = 35.0f;
+
+	lpCamera->RotX = -45.0f;
+
+	lpCamera->RotY = 48.5f;
+
+	lpCamera->PosZ = 150.0f;
+
+	lpCamera->ClipX[0] = lpCamera->ClipX[1] = 1272.0f;
+
+	lpCamera->ClipY[0] = lpCamera->ClipY[1] = -672.0f;
+
+	lpCamera->ClipZ = 1190.0f;
+
+	lpCamera->ClipGL = 2000.0f;
+}
+
+static void SetCameraClip(CAMERA_INFO* lpCamera)
+{
+	// Same values CCamera::SetCurrentValue writes while the 3D camera is on
+	float offset = fabs(lpCamera->PosZ - 150) * 3;
+
+	lpCamera->ClipX[0] = lpCamera->ClipX[1] = 1272 + offset + 1000;
+
+	lpCamera->ClipY[0] = lpCamera->ClipY[1] = -672 - offset - 3000;
+
+	lpCamera->ClipZ = 1190 + offset + 3000;
+
+	lpCamera->ClipGL = 2000 + offset + 1500;
+}
+
+static void MakeStates(char* path, std::vector<CULL_STATE>& list)
+{
+	// A fixed set per world: the stock camera and random 3D camera moves, all standing on walkable cells
+	CTextureDecoder decoder;
+
+	CTextureBufferPool pool;
+
+	TERRAIN_DATA terrain;
+
+	for (int world = 1; world < TERRAIN_MAX_WORLD; world++)
+	{
+		char directory[MAX_PATH];
+
+		wsprintf(directory, "%s\\World%d", path, world);
+
+		if (GetFileAttributes(directory) == INVALID_FILE_ATTRIBUTES || CTerrainPackage::LoadSource(directory, world, &decoder, &pool, &terrain) == 0)
+		{
+			continue;
+		}
+
+		srand(world);
+
+		for (int n = 0; n < CULL_STATE_PER_WORLD; n++)
+		{
+			CULL_STATE state;
+
+			state.World = world;
+
+			for (int i = 0; i < 1000; i++)
+			{
+				int x = 16 + (rand() % (TERRAIN_SIZE - 32));
+
+				int y = 16 + (rand() % (TERRAIN_SIZE - 32));
+
+				state.X = (x + 0.5f) * TERRAIN_CULL_SCALE;
+
+				state.Y = (y + 0.5f) * TERRAIN_CULL_SCALE;
+
+				if ((terrain.Chunk[TERRAIN_CHUNK_ATTRIBUTE][(y * TERRAIN_SIZE) + x] & 0x0C) == 0)
+				{
+					break;
+				}
+			}
+
+			SetDefaultCamera(&state.Camera);
+
+			if (n >= CULL_STATE_DEFAULT)
+			{
+				int step = (rand() % 12) - 10;
+
+				state.Camera.Zoom = 35.0f * (0.5f + ((rand() % 251) / 100.0f));
+
+				state.Camera.RotX = -45.0f + (6.0f * ((rand() % 121) - 62));
+
+				state.Camera.RotY = 48.5f + (2.420f * step);
+
+				state.Camera.PosZ = 150.0f + (44.0f * step);
+
+				state.Camera.IsLoad = 1;
+
+				SetCameraClip(&state.Camera);
+			}
+
+			list.push_back(state);
+		}
+	}
+}
+
+static bool ReadStates(char* path, std::vector<CULL_STATE>& list)
+{
+	CMemScript* lpMemScript = new CMemScript;
+
+	if (lpMemScript->SetBuffer(path) == 0)
+	{
+		delete lpMemScript;
+		return false;
+	}
+
+	while (lpMemScript->GetToken() == TOKEN_NUMBER)
+	{
+		CULL_STATE state;
+
+		memset(&state, 0, sizeof(state));
+
+		state.World = lpMemScript->GetNumber();
+
+		state.X = lpMemScript->GetAsFloatNumber();
+
+		state.Y = lpMemScript->GetAsFloatNumber();
+
+		state.Camera.IsLoad = lpMemScript->GetAsNumber();
+
+		state.Camera.Zoom = lpMemScript->GetAsFloatNumber();
+
+		state.Camera.RotX = lpMemScript->GetAsFloatNumber();
+
+		state.Camera.RotY = lpMemScript->GetAsFloatNumber();
+
+		state.Camera.PosZ = lpMemScript->GetAsFloatNumber();
+
+		state.Camera.ClipX[0] = state.Camera.ClipX[1] = lpMemScript->GetAsFloatNumber();
+
+		state.Camera.ClipY[0] = state.Camera.ClipY[1] = lpMemScript->GetAsFloatNumber();
+
+		state.Camera.ClipZ = lpMemScript->GetAsFloatNumber();
+
+		state.Camera.ClipGL = lpMemScript->GetAsFloatNumber();
+
+		list.push_back(state);
+	}
+
+	delete lpMemScript;
+
+	return (list.empty() == 0);
+}
+
+static bool WriteStates(char* path, std::vector<CULL_STATE>& list)
+{
+	std::string text = "//World X Y Camera3D Zoom RotX RotY PosZ ClipX ClipY ClipZ ClipGL\r\n";
+
+	for (size_t n = 0; n < list.size(); n++)
+	{
+		CULL_STATE* lpState = &list[n];
+
+		char line[256];
+
+		sprintf_s(line, sizeof(line), "%d %.1f %.1f %d %.3f %.3f %.3f %.3f %.3f %.3f %.3f %.3f\r\n", lpState->World, lpState->X, lpState->Y, lpState->Camera.IsLoad, lpState->Camera.Zoom, lpState->Camera.RotX, lpState->Camera.RotY, lpState->Camera.PosZ, lpState->Camera.ClipX[0], lpState->Camera.ClipY[0], lpState->Camera.ClipZ, lpState->Camera.ClipGL);
+
+		text += line;
+	}
+
+	text += "end\r\n";
+
+	HANDLE handle = CreateFile(path, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_ARCHIVE, 0);
+
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	DWORD OutSize = 0;
+
+	WriteFile(handle, text.c_str(), text.size(), &OutSize, 0);
+
+	CloseHandle(handle);
+
+	return (OutSize == text.size());
+}
+
+static void CheckRays(CTerrainCull* lpCull, float far, std::vector<BYTE> flag[3], CULL_STAT* lpStat)
+{
+	// Marches a grid of screen rays to the first terrain hit, every hit block must be in the culled list
+	for (int py = 0; py < CULL_RAY_HEIGHT; py++)
+	{
+		for (int px = 0; px < CULL_RAY_WIDTH; px++)
+		{
+			float origin[3];
+
+			float direction[3];
+
+			lpCull->GetRay(((((px + 0.5f) * 2.0f) / CULL_RAY_WIDTH) - 1.0f), ((((py + 0.5f) * 2.0f) / CULL_RAY_HEIGHT) - 1.0f), origin, direction);
+
+			float last = TERRAIN_CULL_NEAR;
+
+			for (float t = TERRAIN_CULL_NEAR; t <= far; t += CULL_RAY_STEP)
+			{
+				float x = origin[0] + (direction[0] * t);
+
+				float y = origin[1] + (direction[1] * t);
+
+				float z = origin[2] + (direction[2] * t);
+
+				float limit = TERRAIN_SIZE * TERRAIN_CULL_SCALE;
+
+				if (x < 0.0f || y < 0.0f || x >= limit || y >= limit || z > lpCull->GetHeight(x, y))
+				{
+					last = t;
+					continue;
+				}
+
+				float low = last;
+
+				float high = t;
+
+				for (int i = 0; i < 12; i++)
+				{
+					float mid = (low + high) * 0.5f;
+
+					float mx = origin[0] + (direction[0] * mid);
+
+					float my = origin[1] + (direction[1] * mid);
+
+					float mz = origin[2] + (direction[2] * mid);
+
+					if (mx >= 0.0f && my >= 0.0f && mx < limit && my < limit && mz <= lpCull->GetHeight(mx, my))
+					{
+						high = mid;
+					}
+					else
+					{
+						low = mid;
+					}
+				}
+
+				int bx = (int)((origin[0] + (direction[0] * high)) / (TERRAIN_CULL_BLOCK * TERRAIN_CULL_SCALE));
+
+				int by = (int)((origin[1] + (direction[1] * high)) / (TERRAIN_CULL_BLOCK * TERRAIN_CULL_SCALE));
+
+				bx = ((bx >= TERRAIN_CULL_BLOCK_COUNT) ? (TERRAIN_CULL_BLOCK_COUNT - 1) : bx);
+
+				by = ((by >= TERRAIN_CULL_BLOCK_COUNT) ? (TERRAIN_CULL_BLOCK_COUNT - 1) : by);
+
+				int block = (by * TERRAIN_CULL_BLOCK_COUNT) + bx;
+
+				lpStat->RayCount++;
+
+				lpStat->RectangleMiss += (flag[0][block] == 0);
+
+				lpStat->FrustumMiss += (flag[1][block] == 0);
+
+				lpStat->HorizonMiss += (flag[2][block] == 0);
+
+				break;
+			}
+		}
+	}
+}
+
+static void PrintStat(char* name, CULL_STAT* lpStat)
+{
+	double count = ((lpStat->StateCount > 0) ? lpStat->StateCount : 1);
+
+	printf("%-10s %4d states  tiles: rectangle %6.0f  frustum %6.0f  horizon %6.0f (%4.1f%%)  nodes %5.0f  cull %6.1f us  ray misses: rectangle %d, frustum %d, horizon %d of %d\n", name, lpStat->StateCount, ((lpStat->Rectangle * 16) / count), ((lpStat->Frustum * 16) / count), ((lpStat->Horizon * 16) / count), ((lpStat->Rectangle > 0) ? ((lpStat->Horizon * 100.0) / lpStat->Rectangle) : 0.0), (lpStat->TestCount / count), ((lpStat->Time * 1000.0) / count), lpStat->RectangleMiss, lpStat->FrustumMiss, lpStat->HorizonMiss, lpStat->RayCount);
+}
+
+int CommandCull(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printf("Usage: DataTool cull <directory> [camera file]\n");
+		return 1;
+	}
+
+	std::vector<CULL_STATE> list;
+
+	if (argc < 2 || ReadStates(argv[1], list) == 0)
+	{
+		MakeStates(argv[0], list);
+
+		if (argc >= 2 && WriteStates(argv[1], list) != 0)
+		{
+			printf("recorded %d camera states to %s\n", list.size(), argv[1]);
+		}
+	}
+
+	CTextureDecoder decoder;
+
+	CTextureBufferPool pool;
+
+	TERRAIN_DATA terrain;
+
+	CTerrainCull cull;
+
+	CULL_STAT world;
+
+	CULL_STAT total[2];
+
+	memset(total, 0, sizeof(total));
+
+	std::vector<BYTE> flag[3];
+
+	int LoadedWorld = 0;
+
+	for (size_t n = 0; n <= list.size(); n++)
+	{
+		if (n == list.size() || list[n].World != LoadedWorld)
+		{
+			if (LoadedWorld != 0)
+			{
+				char name[32];
+
+				wsprintf(name, "World%d", LoadedWorld);
+
+				PrintStat(name, &world);
+			}
+
+			if (n == list.size())
+			{
+				break;
+			}
+
+			char directory[MAX_PATH];
+
+			wsprintf(directory, "%s\\World%d", argv[0], list[n].World);
+
+			LoadedWorld = list[n].World;
+
+			memset(&world, 0, sizeof(world));
+
+			if (CTerrainPackage::LoadSource(directory, LoadedWorld, &decoder, &pool, &terrain) == 0)
+			{
+				printf("World%d: load failed\n", LoadedWorld);
+				LoadedWorld = 0;
+				continue;
+			}
+
+			cull.Build(&terrain.Chunk[TERRAIN_CHUNK_HEIGHT][0]);
+		}
+
+		CULL_STATE* lpState = &list[n];
+
+		CULL_STAT* lpTotal = &total[((lpState->Camera.IsLoad != 0) ? 1 : 0)];
+
+		cull.SetCamera(&lpState->Camera, lpState->X, lpState->Y, CULL_ASPECT);
+
+		for (int i = 0; i < 3; i++)
+		{
+			flag[i].assign((TERRAIN_CULL_BLOCK_COUNT * TERRAIN_CULL_BLOCK_COUNT), 0);
+
+			if (i == 0)
+			{
+				cull.CullRectangle();
+			}
+			else
+			{
+				double start = GetTimeMs();
+
+				for (int r = 0; r < 10; r++)
+				{
+					cull.Cull(i == 2);
+				}
+
+				double time = (GetTimeMs() - start) / 10;
+
+				if (i == 2)
+				{
+					world.Time += time;
+					lpTotal->Time += time;
+					world.TestCount += cull.GetTestCount();
+					lpTotal->TestCount += cull.GetTestCount();
+				}
+			}
+
+			for (DWORD b = 0; b < cull.GetVisibleCount(); b++)
+			{
+				flag[i][cull.GetVisible()[b]] = 1;
+			}
+
+			double* lpCount = ((i == 0) ? &world.Rectangle : ((i == 1) ? &world.Frustum : &world.Horizon));
+
+			double* lpTotalCount = ((i == 0) ? &lpTotal->Rectangle : ((i == 1) ? &lpTotal->Frustum : &lpTotal->Horizon));
+
+			(*lpCount) += cull.GetVisibleCount();
+
+			(*lpTotalCount) += cull.GetVisibleCount();
+		}
+
+		CULL_STAT rays;
+
+		memset(&rays, 0, sizeof(rays));
+
+		CheckRays(&cull, lpState->Camera.ClipGL, flag, &rays);
+
+		world.StateCount++;
+		world.RayCount += rays.RayCount;
+		world.RectangleMiss += rays.RectangleMiss;
+		world.FrustumMiss += rays.FrustumMiss;
+		world.HorizonMiss += rays.HorizonMiss;
+
+		lpTotal->StateCount++;
+		lpTotal->RayCount += rays.RayCount;
+		lpTotal->RectangleMiss += rays.RectangleMiss;
+		lpTotal->FrustumMiss += rays.FrustumMiss;
+		lpTotal->HorizonMiss += rays.HorizonMiss;
+	}
+
+	PrintStat("default", &total[0]);
+
+	PrintStat("camera 3D", &total[1]);
+
+	return (((total[0].FrustumMiss + total[1].FrustumMiss + total[0].HorizonMiss + total[1].HorizonMiss) == 0) ? 0 : 1);
+}
@@ -0,0 +1,194 @@
+#include "stdafx.h"
+#include "DataTool.h"
+#include "CCRC32.H"
+#include "DataPack.h"
+#include "TextureCache.h"
+#include "TextureQuality.h"
+
+#define DEDUP_KIND_TEXTURE 0
+#define DEDUP_KIND_MODEL 1
+#define DEDUP_KIND_OTHER 2
+#define DEDUP_KIND_MAX 3
+
+static char* DedupKindName[DEDUP_KIND_MAX] = { "textures", "models", "other" };
+
+struct DEDUP_STAT
+{
+	int FileCount;
+	int SharedCount;
+	DWORD Size;
+	DWORD SharedSize;
+};
+
+static bool ReadContent(char* path, std::vector<BYTE>& data)
+{
+	data.clear();
+
+	HANDLE handle = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	DWORD size = GetFileSize(handle, 0);
+
+	data.resize(size);
+
+	DWORD InSize = 0;
+
+	bool result = (size == 0 || (ReadFile(handle, &data[0], size, &InSize, 0) != 0 && InSize == size));
+
+	CloseHandle(handle);
+
+	return result;
+}
+
+static int GetDedupKind(char* path)
+{
+	DWORD prefix = 0;
+
+	char* ext = strrchr(path, '.');
+
+	return ((CTextureDecoder::GetType(path, &prefix) != TEXTURE_TYPE_NONE) ? DEDUP_KIND_TEXTURE : ((ext != 0 && _stricmp(ext, ".bmd") == 0) ? DEDUP_KIND_MODEL : DEDUP_KIND_OTHER));
+}
+
+int CommandDedup(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printf("Usage: DataTool dedup <directory> [pack]\n");
+		return 1;
+	}
+
+	std::vector<std::string> list;
+
+	ScanFiles(argv[0], 0, list);
+
+	// On disk: files with the same checksum and size are compared byte by byte before they count as copies
+	DEDUP_STAT stat[DEDUP_KIND_MAX];
+
+	memset(stat, 0, sizeof(stat));
+
+	std::map<std::pair<DWORD, DWORD>, std::vector<int>> content;
+
+	std::vector<BYTE> data;
+
+	std::vector<BYTE> other;
+
+	CCRC32 CRC32;
+
+	for (size_t n = 0; n < list.size(); n++)
+	{
+		if (ReadContent((char*)list[n].c_str(), data) == 0)
+		{
+			continue;
+		}
+
+		DEDUP_STAT* lpStat = &stat[GetDedupKind((char*)list[n].c_str())];
+
+		lpStat->FileCount++;
+
+		lpStat->Size += data.size();
+
+		std::vector<int>* lpGroup = &content[std::make_pair((DWORD)CRC32.FullCRC((data.empty() ? (BYTE*)"" : &data[0]), data.size()), (DWORD)data.size())];
+
+		bool shared = 0;
+
+		for (size_t i = 0; i < lpGroup->size() && shared == 0; i++)
+		{
+			shared = (ReadContent((char*)list[(*lpGroup)[i]].c_str(), other) != 0 && other == data);
+		}
+
+		if (shared != 0)
+		{
+			lpStat->SharedCount++;
+
+			lpStat->SharedSize += data.size();
+		}
+		else
+		{
+			lpGroup->push_back(n);
+		}
+	}
+
+	for (int n = 0; n < DEDUP_KIND_MAX; n++)
+	{
+		printf("%-8s %5d files, %5d copies of another file, %9u of %9u bytes saved on disk (%.1f%%)\n", DedupKindName[n], stat[n].FileCount, stat[n].SharedCount, stat[n].SharedSize, stat[n].Size, ((stat[n].SharedSize * 100.0) / ((stat[n].Size == 0) ? 1 : stat[n].Size)));
+	}
+
+	if (argc >= 2 && gDataPack.Open(argv[1]) == 0)
+	{
+		printf("Could not open %s\n", argv[1]);
+		return 1;
+	}
+
+	// In memory: every texture decoded and kept on its own like the game does now, then through the cache that shares identical content
+	CTextureDecoder decoder;
+
+	std::vector<TEXTURE_IMAGE> held;
+
+	CTextureBufferPool pool;
+
+	int TextureCount = 0;
+
+	DWORD DecodedSize = 0;
+
+	double start = GetTimeMs();
+
+	for (size_t n = 0; n < list.size(); n++)
+	{
+		char* path = (char*)list[n].c_str();
+
+		TEXTURE_IMAGE image;
+
+		if (GetDedupKind(path) == DEDUP_KIND_TEXTURE && decoder.Decode(path, &pool, &image) != 0)
+		{
+			gTextureQuality.Apply(path, &image, &pool);
+
+			TextureCount++;
+
+			DecodedSize += image.Capacity;
+
+			held.push_back(image);
+		}
+	}
+
+	double DecodeTime = GetTimeMs() - start;
+
+	for (size_t n = 0; n < held.size(); n++)
+	{
+		pool.Free(held[n].Data, held[n].Capacity);
+	}
+
+	std::vector<TEXTURE_CACHE_ENTRY*> entry;
+
+	start = GetTimeMs();
+
+	for (size_t n = 0; n < list.size(); n++)
+	{
+		TEXTURE_CACHE_ENTRY* lpEntry = ((GetDedupKind((char*)list[n].c_str()) == DEDUP_KIND_TEXTURE) ? gTextureCache.Load((char*)list[n].c_str(), &decoder) : 0);
+
+		if (lpEntry != 0)
+		{
+			entry.push_back(lpEntry);
+		}
+	}
+
+	double CacheTime = GetTimeMs() - start;
+
+	int mismatch = ((entry.size() != TextureCount) || ((gTextureCache.GetSize() + gTextureCache.GetSharedSize()) != DecodedSize));
+
+	printf("%d textures, %u bytes decoded one by one in %.2f ms, %d unique images holding %u bytes through the cache in %.2f ms (%u bytes saved, %.1f%%)%s\n", TextureCount, DecodedSize, DecodeTime, gTextureCache.GetCount(), gTextureCache.GetSize(), CacheTime, gTextureCache.GetSharedSize(), ((gTextureCache.GetSharedSize() * 100.0) / ((DecodedSize == 0) ? 1 : DecodedSize)), ((gDataPack.IsOpen() != 0) ? ", checksums from the pack" : ""));
+
+	for (size_t n = 0; n < entry.size(); n++)
+	{
+		gTextureCache.Release(entry[n]);
+	}
+
+	mismatch += (gTextureCache.GetCount() != 0 || gTextureCache.GetRefCount() != 0 || gTextureCache.GetSize() != 0 || gTextureCache.GetSharedSize() != 0);
+
+	printf("mismatches %d\n", mismatch);
+
+	return ((mismatch == 0) ? 0 : 1);
+}
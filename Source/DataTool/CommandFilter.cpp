@@ -0,0 +1,305 @@
+#include "stdafx.h"
+#include "DataTool.h"
+#include "FileCrypt.h"
+#include "WordFilter.h"
+
+#define FILTER_LINE_DEFAULT 1000000
+#define FILTER_NAME_COUNT 200000
+#define FILTER_DIRTY_RATE 50
+
+static char* FilterVocabulary[] = { "hi", "hello", "sell", "buy", "jewel", "of", "bless", "soul", "chaos", "zen", "party", "pls", "need", "lorencia", "devias", "noria", "dungeon", "atlans", "lost", "tower", "anyone", "help", "lol", "ok", "thx", "guild", "war", "+9", "sword", "set", "dark", "knight", "elf", "wizard", "come", "here", "spot", "bc", "ds", "now", "who", "wants", "trade", "me", "pm", "gg", "nice", "drop", "wings", "level", "reset", "exp", "event", "golden", "dragon", "kundun", "box", "excellent", "option", "price" };
+
+struct FILTER_LINE_LIST
+{
+	std::vector<char> Text;
+	std::vector<int> Offset;
+};
+
+struct FILTER_STAT
+{
+	double Time[4];
+	int Flagged[4];
+	int Mismatch;
+	int MatchCount;
+};
+
+static bool LoadRawWords(char* path, std::vector<std::string>& list)
+{
+	// The words exactly as the file spells them, which is all a plain strstr pass can use
+	HANDLE file = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	BYTE buff[WORD_FILTER_RECORD_SIZE + 1];
+
+	DWORD OutSize = 0;
+
+	for (int n = 0; n < WORD_FILTER_RECORD_COUNT && ReadFile(file, buff, WORD_FILTER_RECORD_SIZE, &OutSize, 0) != 0 && OutSize == WORD_FILTER_RECORD_SIZE; n++)
+	{
+		BuxConvert(buff, WORD_FILTER_RECORD_SIZE);
+
+		buff[WORD_FILTER_RECORD_SIZE] = 0;
+
+		if (buff[0] != 0)
+		{
+			list.push_back((char*)buff);
+		}
+	}
+
+	CloseHandle(file);
+
+	return true;
+}
+
+static void AddLine(FILTER_LINE_LIST* lpList, std::string& line)
+{
+	lpList->Offset.push_back(lpList->Text.size());
+
+	lpList->Text.insert(lpList->Text.end(), line.begin(), line.end());
+
+	lpList->Text.push_back(0);
+}
+
+static void InsertWord(std::string& line, std::string word)
+{
+	// Players dodge the list with random case, the position in the line is random too
+	for (size_t n = 0; n < word.size(); n++)
+	{
+		if ((word[n] >= 'a' && word[n] <= 'z') && (rand() % 3) == 0)
+		{
+			word[n] -= ('a' - 'A');
+		}
+	}
+
+	line.insert((line.empty() ? 0 : ((rand() & 0x7FFF) % (line.size() + 1))), word);
+}
+
+static void MakeLines(std::vector<std::string>& words, int count, FILTER_LINE_LIST* lpList)
+{
+	int VocabularyCount = sizeof(FilterVocabulary) / sizeof(FilterVocabulary[0]);
+
+	std::string line;
+
+	for (int n = 0; n < count; n++)
+	{
+		line.clear();
+
+		int TokenCount = 3 + (rand() % 8);
+
+		for (int i = 0; i < TokenCount; i++)
+		{
+			line += ((i == 0) ? "" : " ");
+
+			line += FilterVocabulary[(rand() & 0x7FFF) % VocabularyCount];
+		}
+
+		if ((rand() % FILTER_DIRTY_RATE) == 0)
+		{
+			InsertWord(line, words[(rand() & 0x7FFF) % words.size()]);
+		}
+
+		AddLine(lpList, line);
+	}
+}
+
+static void MakeNames(std::vector<std::string>& words, int count, FILTER_LINE_LIST* lpList)
+{
+	std::string name;
+
+	for (int n = 0; n < count; n++)
+	{
+		name.clear();
+
+		int length = 4 + (rand() % 7);
+
+		for (int i = 0; i < length; i++)
+		{
+			int value = (rand() & 0x7FFF) % 36;
+
+			name.push_back((char)((value < 26) ? ((((rand() % 4) == 0) ? 'A' : 'a') + value) : ('0' + (value - 26))));
+		}
+
+		if ((rand() % FILTER_DIRTY_RATE) == 0)
+		{
+			InsertWord(name, words[(rand() & 0x7FFF) % words.size()]);
+
+			name.resize((name.size() > 10) ? 10 : name.size());
+		}
+
+		AddLine(lpList, name);
+	}
+}
+
+static void RunLines(CWordFilter* lpFilter, std::vector<std::string>& words, FILTER_LINE_LIST* lpList, int list, FILTER_STAT* lpStat)
+{
+	memset(lpStat, 0, sizeof(FILTER_STAT));
+
+	int count = lpList->Offset.size();
+
+	std::vector<BYTE> result[3];
+
+	std::vector<std::string> folded;
+
+	for (int n = 0; n < lpFilter->GetWordCount(); n++)
+	{
+		if ((lpFilter->GetWordList(n) & list) != 0)
+		{
+			folded.push_back(lpFilter->GetWord(n));
+		}
+	}
+
+	for (int method = 0; method < 4; method++)
+	{
+		std::vector<WORD_FILTER_MATCH> match;
+
+		char buff[256];
+
+		if (method < 3)
+		{
+			result[method].resize(count);
+		}
+
+		double start = GetTimeMs();
+
+		for (int n = 0; n < count; n++)
+		{
+			char* text = &lpList->Text[lpList->Offset[n]];
+
+			bool found = 0;
+
+			if (method == 0)
+			{
+				// 0: the entry by entry check, every spelling of the file with strstr
+				for (size_t i = 0; i < words.size() && found == 0; i++)
+				{
+					found = (strstr(text, words[i].c_str()) != 0);
+				}
+			}
+			else if (method == 1)
+			{
+				// 1: the same loop with case folding, the reference the automaton has to agree with
+				int length = 0;
+
+				for (; text[length] != 0 && length < (int)(sizeof(buff) - 1); length++)
+				{
+					buff[length] = (char)CWordFilter::Fold((BYTE)text[length]);
+				}
+
+				buff[length] = 0;
+
+				for (size_t i = 0; i < folded.size() && found == 0; i++)
+				{
+					found = (strstr(buff, folded[i].c_str()) != 0);
+				}
+			}
+			else if (method == 2)
+			{
+				found = lpFilter->Check(text, list);
+			}
+			else
+			{
+				found = (lpFilter->Find(text, list, match) != 0);
+
+				lpStat->MatchCount += match.size();
+			}
+
+			if (method < 3)
+			{
+				result[method][n] = found;
+			}
+
+			lpStat->Flagged[method] += found;
+		}
+
+		lpStat->Time[method] = GetTimeMs() - start;
+	}
+
+	for (int n = 0; n < count; n++)
+	{
+		lpStat->Mismatch += (result[1][n] != result[2][n]);
+	}
+}
+
+static void PrintStat(char* name, int count, FILTER_STAT* lpStat)
+{
+	printf("%-5s %7d lines  strstr %8.2f ms (%6d flagged)  folded strstr %8.2f ms (%6d)  automaton %7.2f ms (%6d, %5.1fx)  with match list %7.2f ms (%d matches)  mismatches %d\n", name, count, lpStat->Time[0], lpStat->Flagged[0], lpStat->Time[1], lpStat->Flagged[1], lpStat->Time[2], lpStat->Flagged[2], (lpStat->Time[0] / lpStat->Time[2]), lpStat->Time[3], lpStat->MatchCount, lpStat->Mismatch);
+}
+
+int CommandFilter(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printf("Usage: DataTool filter <directory> [lines]\n");
+		return 1;
+	}
+
+	int count = ((argc >= 2) ? atoi(argv[1]) : FILTER_LINE_DEFAULT);
+
+	if (count <= 0)
+	{
+		count = FILTER_LINE_DEFAULT;
+	}
+
+	char ChatPath[MAX_PATH];
+
+	char NamePath[MAX_PATH];
+
+	wsprintf(ChatPath, "%s\\Local\\Filter.bmd", argv[0]);
+
+	wsprintf(NamePath, "%s\\Local\\FilterName.bmd", argv[0]);
+
+	std::vector<std::string> ChatWords;
+
+	std::vector<std::string> NameWords;
+
+	if (LoadRawWords(ChatPath, ChatWords) == 0 || LoadRawWords(NamePath, NameWords) == 0)
+	{
+		printf("Filter.bmd or FilterName.bmd not found in %s\\Local\n", argv[0]);
+		return 1;
+	}
+
+	CWordFilter filter;
+
+	double start = GetTimeMs();
+
+	filter.Load(ChatPath, WORD_FILTER_CHAT);
+
+	filter.Load(NamePath, WORD_FILTER_NAME);
+
+	filter.Build();
+
+	double BuildTime = GetTimeMs() - start;
+
+	printf("%d + %d words, %d after folding: %d states, %d byte classes, %d byte table, built in %.3f ms\n", ChatWords.size(), NameWords.size(), filter.GetWordCount(), filter.GetStateCount(), filter.GetClassCount(), filter.GetTableSize(), BuildTime);
+
+	srand(1);
+
+	FILTER_LINE_LIST lines;
+
+	MakeLines(ChatWords, count, &lines);
+
+	FILTER_LINE_LIST names;
+
+	MakeNames(NameWords, FILTER_NAME_COUNT, &names);
+
+	FILTER_STAT stat[2];
+
+	RunLines(&filter, ChatWords, &lines, WORD_FILTER_CHAT, &stat[0]);
+
+	RunLines(&filter, NameWords, &names, WORD_FILTER_NAME, &stat[1]);
+
+	PrintStat("chat", count, &stat[0]);
+
+	PrintStat("name", FILTER_NAME_COUNT, &stat[1]);
+
+	char sample[] = "sell FuCk set, ask webzen GM";
+
+	int masked = filter.Mask(sample, (WORD_FILTER_CHAT | WORD_FILTER_NAME), '*');
+
+	printf("mask sample: \"%s\" (%d matches)\n", sample, masked);
+
+	return ((stat[0].Mismatch == 0 && stat[1].Mismatch == 0) ? 0 : 1);
+}
@@ -0,0 +1,175 @@
+#include "stdafx.h"
+#include "DataTool.h"
+#include "JpegDecoder.h"
+#include "MappedFile.h"
+
+struct JPEG_CORPUS_FILE
+{
+	std::string Path;
+	std::vector<BYTE> Data;
+	int Width;
+	int Height;
+};
+
+static bool DecodeFile(CJpegDecoder* lpDecoder, JPEG_CORPUS_FILE* lpFile, std::vector<BYTE>& output)
+{
+	int width = 0;
+
+	int height = 0;
+
+	if (lpDecoder->ReadHeader(&lpFile->Data[0], (DWORD)lpFile->Data.size(), &width, &height) == 0)
+	{
+		return false;
+	}
+
+	output.resize(width * height * 4);
+
+	return lpDecoder->Decode(&output[0]);
+}
+
+static double DecodeCorpus(CJpegDecoder* lpDecoder, std::vector<JPEG_CORPUS_FILE>& corpus, int runs)
+{
+	std::vector<BYTE> output;
+
+	double start = GetTimeMs();
+
+	for (int i = 0; i < runs; i++)
+	{
+		for (size_t n = 0; n < corpus.size(); n++)
+		{
+			DecodeFile(lpDecoder, &corpus[n], output);
+		}
+	}
+
+	return GetTimeMs() - start;
+}
+
+int CommandJpeg(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printf("Usage: DataTool jpeg <directory> [runs]\n");
+		return 1;
+	}
+
+	int runs = ((argc >= 2) ? atoi(argv[1]) : 3);
+
+	if (runs <= 0)
+	{
+		runs = 1;
+	}
+
+	std::vector<std::string> list;
+
+	ScanFiles(argv[0], ".ozj", list);
+
+	std::vector<JPEG_CORPUS_FILE> corpus;
+
+	CJpegDecoder decoder;
+
+	QWORD ByteCount = 0;
+
+	QWORD PixelCount = 0;
+
+	DWORD ErrorCount = 0;
+
+	DWORD MismatchCount = 0;
+
+	DWORD ProgressiveCount = 0;
+
+	int MaxDelta = 0;
+
+	std::vector<BYTE> reference;
+
+	std::vector<BYTE> output;
+
+	for (size_t n = 0; n < list.size(); n++)
+	{
+		CMappedFile file;
+
+		if (file.Open((char*)list[n].c_str()) == 0 || file.GetSize() <= 24)
+		{
+			ErrorCount++;
+			continue;
+		}
+
+		JPEG_CORPUS_FILE entry;
+
+		entry.Path = list[n];
+
+		entry.Data.assign(file.GetData() + 24, file.GetData() + file.GetSize());
+
+		decoder.SetReference(1);
+
+		if (DecodeFile(&decoder, &entry, reference) == 0)
+		{
+			ErrorCount++;
+
+			printf("decode failed: %s\n", list[n].c_str());
+
+			continue;
+		}
+
+		ProgressiveCount += ((decoder.IsProgressive() != 0) ? 1 : 0);
+
+		decoder.SetReference(0);
+
+		if (DecodeFile(&decoder, &entry, output) == 0 || output.size() != reference.size())
+		{
+			ErrorCount++;
+
+			printf("fast decode failed: %s\n", list[n].c_str());
+
+			continue;
+		}
+
+		int delta = 0;
+
+		for (size_t i = 0; i < output.size(); i++)
+		{
+			int d = abs((int)output[i] - (int)reference[i]);
+
+			delta = ((d > delta) ? d : delta);
+		}
+
+		if (delta != 0)
+		{
+			MismatchCount++;
+
+			printf("mismatch: %s (max delta %d)\n", list[n].c_str(), delta);
+		}
+
+		MaxDelta = ((delta > MaxDelta) ? delta : MaxDelta);
+
+		ByteCount += entry.Data.size();
+
+		PixelCount += output.size() / 4;
+
+		corpus.push_back(entry);
+	}
+
+	printf("files: %d, progressive: %d, errors: %d, mismatches: %d, max delta: %d\n", (int)corpus.size(), ProgressiveCount, ErrorCount, MismatchCount, MaxDelta);
+
+	if (corpus.empty() != 0)
+	{
+		return 1;
+	}
+
+	decoder.SetReference(1);
+
+	double ReferenceTime = DecodeCorpus(&decoder, corpus, runs);
+
+	decoder.SetReference(0);
+
+	double FastTime = DecodeCorpus(&decoder, corpus, runs);
+
+	double MegaBytes = (ByteCount * runs) / 1048576.0;
+
+	double MegaPixels = (PixelCount * runs) / 1000000.0;
+
+	printf("reference: %8.2f ms, %6.1f MB/s, %6.1f M pixels/s\n", ReferenceTime, (MegaBytes / (ReferenceTime / 1000.0)), (MegaPixels / (ReferenceTime / 1000.0)));
+
+	printf("fast:      %8.2f ms, %6.1f MB/s, %6.1f M pixels/s, %.2fx\n", FastTime, (MegaBytes / (FastTime / 1000.0)), (MegaPixels / (FastTime / 1000.0)), (ReferenceTime / FastTime));
+
+	return (((ErrorCount + MismatchCount) == 0) ? 0 : 1);
+}
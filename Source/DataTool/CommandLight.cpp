@@ -0,0 +1,236 @@
+#include "stdafx.h"
+#include "DataTool.h"
+#include "TerrainLight.h"
+
+#define LIGHT_SOURCE_COUNT 32
+#define LIGHT_MOVING_COUNT 4
+#define LIGHT_FRAME_COUNT 200
+
+struct LIGHT_STAT
+{
+	double BuildScalar;
+	double BuildSimd;
+	double FullScalar;
+	double FullSimd;
+	double Dirty;
+	double DirtyCells;
+	float SimdError;
+	float DirtyError;
+};
+
+static float CompareLight(CTerrainLight* a, CTerrainLight* b)
+{
+	float error = 0.0f;
+
+	for (int n = 0; n < 3; n++)
+	{
+		float* ca = a->GetChannel(n);
+
+		float* cb = b->GetChannel(n);
+
+		for (int i = 0; i < TERRAIN_CELL_COUNT; i++)
+		{
+			float d = fabs(ca[i] - cb[i]);
+
+			error = ((d > error) ? d : error);
+		}
+	}
+
+	return error;
+}
+
+static void MakeSources(int world, std::vector<TERRAIN_LIGHT_SOURCE>& source)
+{
+	// Torches and spell glows: a few cells of range, scattered around one screen of the map like a busy town
+	srand(world);
+
+	source.resize(LIGHT_SOURCE_COUNT);
+
+	for (int n = 0; n < LIGHT_SOURCE_COUNT; n++)
+	{
+		source[n].X = (96 + ((rand() & 0x7FFF) % 64)) * TERRAIN_LIGHT_SCALE;
+
+		source[n].Y = (96 + ((rand() & 0x7FFF) % 64)) * TERRAIN_LIGHT_SCALE;
+
+		source[n].Color[0] = 0.2f + ((rand() % 80) / 100.0f);
+
+		source[n].Color[1] = 0.2f + ((rand() % 80) / 100.0f);
+
+		source[n].Color[2] = 0.2f + ((rand() % 80) / 100.0f);
+
+		source[n].Range = 2 + (rand() % 5);
+	}
+}
+
+int CommandLight(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printf("Usage: DataTool light <directory> [runs]\n");
+		return 1;
+	}
+
+	int runs = ((argc >= 2) ? atoi(argv[1]) : 20);
+
+	if (runs <= 0)
+	{
+		runs = 1;
+	}
+
+	CTextureDecoder decoder;
+
+	CTextureBufferPool pool;
+
+	TERRAIN_DATA terrain;
+
+	CTerrainLight scalar;
+
+	CTerrainLight simd;
+
+	CTerrainLight dirty;
+
+	LIGHT_STAT total;
+
+	memset(&total, 0, sizeof(total));
+
+	int WorldCount = 0;
+
+	for (int world = 1; world < TERRAIN_MAX_WORLD; world++)
+	{
+		char directory[MAX_PATH];
+
+		wsprintf(directory, "%s\\World%d", argv[0], world);
+
+		if (GetFileAttributes(directory) == INVALID_FILE_ATTRIBUTES || CTerrainPackage::LoadSource(directory, world, &decoder, &pool, &terrain) == 0)
+		{
+			continue;
+		}
+
+		BYTE* height = &terrain.Chunk[TERRAIN_CHUNK_HEIGHT][0];
+
+		BYTE* light = ((terrain.Chunk[TERRAIN_CHUNK_LIGHT].empty() == 0) ? &terrain.Chunk[TERRAIN_CHUNK_LIGHT][0] : 0);
+
+		LIGHT_STAT stat;
+
+		memset(&stat, 0, sizeof(stat));
+
+		double start = GetTimeMs();
+
+		for (int n = 0; n < runs; n++)
+		{
+			scalar.Build(height, light, 0);
+		}
+
+		stat.BuildScalar = (GetTimeMs() - start) / runs;
+
+		start = GetTimeMs();
+
+		for (int n = 0; n < runs; n++)
+		{
+			simd.Build(height, light, 1);
+		}
+
+		stat.BuildSimd = (GetTimeMs() - start) / runs;
+
+		std::vector<TERRAIN_LIGHT_SOURCE> source;
+
+		MakeSources(world, source);
+
+		scalar.SetLights(&source[0], source.size());
+
+		simd.SetLights(&source[0], source.size());
+
+		start = GetTimeMs();
+
+		for (int n = 0; n < runs; n++)
+		{
+			scalar.UpdateAll();
+		}
+
+		stat.FullScalar = (GetTimeMs() - start) / runs;
+
+		start = GetTimeMs();
+
+		for (int n = 0; n < runs; n++)
+		{
+			simd.UpdateAll();
+		}
+
+		stat.FullSimd = (GetTimeMs() - start) / runs;
+
+		stat.SimdError = CompareLight(&scalar, &simd);
+
+		// A few lights move every frame, the dirty path must match a full rebuild of the same frame
+		dirty.Build(height, light, 1);
+
+		dirty.SetLights(&source[0], source.size());
+
+		dirty.Update();
+
+		for (int frame = 0; frame < LIGHT_FRAME_COUNT; frame++)
+		{
+			for (int n = 0; n < LIGHT_MOVING_COUNT; n++)
+			{
+				TERRAIN_LIGHT_SOURCE* lpSource = &source[(frame + (n * 7)) % LIGHT_SOURCE_COUNT];
+
+				lpSource->X += (float)((rand() % 41) - 20);
+
+				lpSource->Y += (float)((rand() % 41) - 20);
+			}
+
+			start = GetTimeMs();
+
+			dirty.SetLights(&source[0], source.size());
+
+			stat.DirtyCells += dirty.Update();
+
+			stat.Dirty += GetTimeMs() - start;
+
+			if ((frame % 20) == 19)
+			{
+				simd.SetLights(&source[0], source.size());
+
+				simd.UpdateAll();
+
+				float error = CompareLight(&simd, &dirty);
+
+				stat.DirtyError = ((error > stat.DirtyError) ? error : stat.DirtyError);
+			}
+		}
+
+		stat.Dirty /= LIGHT_FRAME_COUNT;
+
+		stat.DirtyCells /= LIGHT_FRAME_COUNT;
+
+		printf("World%-3d normals+static: scalar %6.3f ms, SIMD %6.3f ms (%4.2fx)  %d lights full grid: scalar %6.3f ms, SIMD %6.3f ms (%4.2fx)  dirty %d moving: %6.3f ms, %5.0f cells  errors: SIMD %g, dirty %g%s\n", world, stat.BuildScalar, stat.BuildSimd, (stat.BuildScalar / stat.BuildSimd), LIGHT_SOURCE_COUNT, stat.FullScalar, stat.FullSimd, (stat.FullScalar / stat.FullSimd), LIGHT_MOVING_COUNT, stat.Dirty, stat.DirtyCells, stat.SimdError, stat.DirtyError, ((light == 0) ? " (no light map)" : ""));
+
+		total.BuildScalar += stat.BuildScalar;
+		total.BuildSimd += stat.BuildSimd;
+		total.FullScalar += stat.FullScalar;
+		total.FullSimd += stat.FullSimd;
+		total.Dirty += stat.Dirty;
+		total.DirtyCells += stat.DirtyCells;
+		total.SimdError = ((stat.SimdError > total.SimdError) ? stat.SimdError : total.SimdError);
+		total.DirtyError = ((stat.DirtyError > total.DirtyError) ? stat.DirtyError : total.DirtyError);
+
+		WorldCount++;
+	}
+
+	if (WorldCount == 0)
+	{
+		printf("no worlds found in %s\n", argv[0]);
+		return 1;
+	}
+
+	printf("average over %d worlds:\n", WorldCount);
+
+	printf("normals + static light: scalar %.3f ms, SIMD %.3f ms (%.2fx)\n", (total.BuildScalar / WorldCount), (total.BuildSimd / WorldCount), (total.BuildScalar / total.BuildSimd));
+
+	printf("full grid with %d lights: scalar %.3f ms, SIMD %.3f ms (%.2fx)\n", LIGHT_SOURCE_COUNT, (total.FullScalar / WorldCount), (total.FullSimd / WorldCount), (total.FullScalar / total.FullSimd));
+
+	printf("dirty rect, %d of %d lights moving: %.3f ms per frame, %.0f of %d cells (%.2fx over SIMD full grid)\n", LIGHT_MOVING_COUNT, LIGHT_SOURCE_COUNT, (total.Dirty / WorldCount), (total.DirtyCells / WorldCount), TERRAIN_CELL_COUNT, (total.FullSimd / total.Dirty));
+
+	printf("max error: SIMD vs scalar %g, dirty vs full %g\n", total.SimdError, total.DirtyError);
+
+	return ((total.DirtyError == 0.0f) ? 0 : 1);
+}
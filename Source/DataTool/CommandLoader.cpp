@@ -0,0 +1,285 @@
+#include "stdafx.h"
+#include "DataTool.h"
+#include "AssetLoader.h"
+
+#define LOADER_DISK_LATENCY 8 // Milliseconds of seek per read on the simulated disk
+#define LOADER_DISK_RATE 40 // MB/s of the simulated disk
+#define LOADER_FRAME_WORK 5 // Milliseconds of render work in a frame
+#define LOADER_MAX_FRAME 2000
+
+enum eLoaderGroup
+{
+	LOADER_GROUP_VISIBLE = 1,
+	LOADER_GROUP_PREFETCH = 2,
+	LOADER_GROUP_BACKGROUND = 3,
+};
+
+struct LOADER_TEST_ITEM
+{
+	int Group;
+	int Calls;
+	bool Canceled;
+};
+
+struct LOADER_TEST_STATE
+{
+	DWORD MainThread;
+	int Mismatch;
+	int VisibleLeft;
+	int BackgroundDone;
+	int BackgroundBeforeVisible;
+	double Start;
+	double VisibleTime;
+};
+
+static DWORD DiskLatency = LOADER_DISK_LATENCY;
+
+static volatile LONG DiskInFlight = 0;
+
+static volatile LONG DiskMaxInFlight = 0;
+
+static LOADER_TEST_STATE TestState;
+
+static bool SlowRead(char* path, std::vector<BYTE>& data)
+{
+	// The real read plus the time a slow disk would take for it, several can be in flight like on a real device
+	LONG count = InterlockedIncrement(&DiskInFlight);
+
+	for (LONG max = DiskMaxInFlight; count > max; max = DiskMaxInFlight)
+	{
+		InterlockedCompareExchange(&DiskMaxInFlight, count, max);
+	}
+
+	bool result = CAssetLoader::ReadAsset(path, data);
+
+	Sleep(DiskLatency + (data.size() / ((LOADER_DISK_RATE * 1048576) / 1000)));
+
+	InterlockedDecrement(&DiskInFlight);
+
+	return result;
+}
+
+static void LoaderCallback(ASSET_LOAD_RESULT* lpResult, void* param)
+{
+	LOADER_TEST_ITEM* lpItem = (LOADER_TEST_ITEM*)param;
+
+	lpItem->Calls++;
+
+	// Callbacks belong on the main thread, never for a canceled request, and a texture always comes decoded
+	TestState.Mismatch += (GetCurrentThreadId() != TestState.MainThread || lpItem->Canceled != 0 || lpResult->Success == 0);
+
+	TestState.Mismatch += (lpItem->Group != LOADER_GROUP_BACKGROUND && lpResult->Image.Data == 0);
+
+	if (lpItem->Group == LOADER_GROUP_BACKGROUND)
+	{
+		TestState.BackgroundDone++;
+	}
+
+	if (lpItem->Group == LOADER_GROUP_VISIBLE && (--TestState.VisibleLeft) == 0)
+	{
+		TestState.VisibleTime = GetTimeMs() - TestState.Start;
+
+		TestState.BackgroundBeforeVisible = TestState.BackgroundDone;
+	}
+}
+
+static void GetTextureList(char* path, std::vector<std::string>& list)
+{
+	std::vector<std::string> files;
+
+	ScanFiles(path, 0, files);
+
+	list.clear();
+
+	for (size_t n = 0; n < files.size(); n++)
+	{
+		DWORD prefix = 0;
+
+		if (CTextureDecoder::GetType((char*)files[n].c_str(), &prefix) != TEXTURE_TYPE_NONE)
+		{
+			list.push_back(files[n]);
+		}
+	}
+}
+
+static bool RunFrames(bool priority, std::vector<std::string>& visible, std::vector<std::string>& prefetch, std::vector<std::string>& background, double* lpMaxFrame, int* lpFrames)
+{
+	// Background and prefetch work is queued first, then what the camera sees, each visible texture asked for twice
+	std::vector<LOADER_TEST_ITEM> item(prefetch.size() + background.size() + (visible.size() * 2));
+
+	size_t next = 0;
+
+	memset(&TestState, 0, sizeof(TestState));
+
+	TestState.MainThread = GetCurrentThreadId();
+
+	TestState.VisibleLeft = visible.size() * 2;
+
+	TestState.Start = GetTimeMs();
+
+	for (size_t n = 0; n < background.size(); n++, next++)
+	{
+		item[next].Group = LOADER_GROUP_BACKGROUND;
+
+		gAssetLoader.Request((char*)background[n].c_str(), ASSET_LOAD_FILE, ASSET_PRIORITY_BACKGROUND, LOADER_GROUP_BACKGROUND, LoaderCallback, &item[next]);
+	}
+
+	for (size_t n = 0; n < prefetch.size(); n++, next++)
+	{
+		item[next].Group = LOADER_GROUP_PREFETCH;
+
+		gAssetLoader.Request((char*)prefetch[n].c_str(), ASSET_LOAD_TEXTURE, ((priority != 0) ? ASSET_PRIORITY_PREFETCH : ASSET_PRIORITY_BACKGROUND), LOADER_GROUP_PREFETCH, LoaderCallback, &item[next]);
+	}
+
+	for (int copy = 0; copy < 2; copy++)
+	{
+		for (size_t n = 0; n < visible.size(); n++, next++)
+		{
+			item[next].Group = LOADER_GROUP_VISIBLE;
+
+			gAssetLoader.Request((char*)visible[n].c_str(), ASSET_LOAD_TEXTURE, ((priority != 0) ? ASSET_PRIORITY_VISIBLE : ASSET_PRIORITY_BACKGROUND), LOADER_GROUP_VISIBLE, LoaderCallback, &item[next]);
+		}
+	}
+
+	*lpMaxFrame = 0;
+
+	*lpFrames = 0;
+
+	bool left = 0;
+
+	while (gAssetLoader.GetPendingCount() != 0 && (*lpFrames) < LOADER_MAX_FRAME)
+	{
+		double start = GetTimeMs();
+
+		gAssetLoader.Dispatch(ASSET_LOAD_DISPATCH_TIME);
+
+		// The player walks out of the prefetched area once what is on screen is in
+		if (TestState.VisibleLeft == 0 && left == 0)
+		{
+			for (size_t n = 0; n < item.size(); n++)
+			{
+				item[n].Canceled = (item[n].Group == LOADER_GROUP_PREFETCH && item[n].Calls == 0);
+			}
+
+			gAssetLoader.CancelGroup(LOADER_GROUP_PREFETCH);
+
+			left = 1;
+		}
+
+		Sleep(LOADER_FRAME_WORK);
+
+		double time = GetTimeMs() - start;
+
+		*lpMaxFrame = ((time > *lpMaxFrame) ? time : *lpMaxFrame);
+
+		(*lpFrames)++;
+	}
+
+	for (size_t n = 0; n < item.size(); n++)
+	{
+		TestState.Mismatch += ((item[n].Canceled != 0) ? (item[n].Calls != 0) : (item[n].Calls != 1));
+	}
+
+	return (gAssetLoader.GetPendingCount() == 0);
+}
+
+int CommandLoader(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printf("Usage: DataTool loader <directory> [latency ms] [reads in flight]\n");
+		return 1;
+	}
+
+	DiskLatency = ((argc >= 2) ? atoi(argv[1]) : LOADER_DISK_LATENCY);
+
+	int IoCount = ((argc >= 3) ? atoi(argv[2]) : ASSET_LOAD_DEFAULT_IO);
+
+	char path[MAX_PATH];
+
+	std::vector<std::string> visible;
+
+	wsprintf(path, "%s\\World1", argv[0]);
+
+	GetTextureList(path, visible);
+
+	std::vector<std::string> prefetch;
+
+	wsprintf(path, "%s\\World2", argv[0]);
+
+	GetTextureList(path, prefetch);
+
+	std::vector<std::string> background;
+
+	wsprintf(path, "%s\\Object3", argv[0]);
+
+	ScanFiles(path, 0, background);
+
+	// What the game does now: the render thread reads and decodes what it needs before it draws the frame
+	CTextureDecoder decoder;
+
+	CTextureBufferPool pool;
+
+	std::vector<BYTE> data;
+
+	double start = GetTimeMs();
+
+	for (size_t n = 0; n < visible.size(); n++)
+	{
+		DWORD prefix = 0;
+
+		int type = CTextureDecoder::GetType((char*)visible[n].c_str(), &prefix);
+
+		TEXTURE_IMAGE image;
+
+		if (SlowRead((char*)visible[n].c_str(), data) != 0 && data.size() > prefix && decoder.Decode(&data[prefix], (data.size() - prefix), type, &pool, &image) != 0)
+		{
+			pool.Free(image.Data, image.Capacity);
+		}
+	}
+
+	double SyncTime = GetTimeMs() - start;
+
+	printf("simulated disk: %d ms a read, %d MB/s, %d visible textures, %d prefetch textures, %d background files\n", DiskLatency, LOADER_DISK_RATE, visible.size(), prefetch.size(), background.size());
+
+	printf("synchronous: one frame stalled %.2f ms for the visible textures\n", SyncTime);
+
+	gAssetLoader.SetReader(SlowRead);
+
+	int mismatch = 0;
+
+	for (int priority = 0; priority < 2; priority++)
+	{
+		if (gAssetLoader.Start(ASSET_LOAD_DEFAULT_THREAD, IoCount) == 0)
+		{
+			printf("Could not start the loader\n");
+			return 1;
+		}
+
+		DiskMaxInFlight = 0;
+
+		double MaxFrame = 0;
+
+		int frames = 0;
+
+		bool finished = RunFrames((priority != 0), visible, prefetch, background, &MaxFrame, &frames);
+
+		ASSET_LOAD_STAT stat;
+
+		gAssetLoader.GetStat(&stat);
+
+		gAssetLoader.Stop();
+
+		mismatch += TestState.Mismatch + (finished == 0) + (DiskMaxInFlight > IoCount);
+
+		printf("%-10s visible ready in %8.2f ms after %3d background files, longest frame %6.2f ms over %4d frames\n", ((priority != 0) ? "priority" : "one queue"), TestState.VisibleTime, TestState.BackgroundBeforeVisible, MaxFrame, frames);
+
+		printf("%-10s %d requests, %d coalesced, %d canceled, %d read (%d of them wasted), %d callbacks, at most %d reads in flight\n", "", stat.RequestCount, stat.CoalescedCount, stat.CanceledCount, stat.ReadCount, stat.WastedCount, stat.CallbackCount, DiskMaxInFlight);
+	}
+
+	gAssetLoader.SetReader(0);
+
+	printf("mismatches %d\n", mismatch);
+
+	return ((mismatch == 0) ? 0 : 1);
+}
@@ -0,0 +1,247 @@
+#include "stdafx.h"
+#include "DataTool.h"
+#include "DataPack.h"
+
+#define PACK_LOOKUP_RUNS 100
+#define PACK_READ_LOOSE 0
+#define PACK_READ_HANDLE 1
+#define PACK_READ_VIEW 2
+#define PACK_READ_MAX 3
+
+static char* PackReadName[PACK_READ_MAX] = { "loose", "handle", "view" };
+
+static bool ReadLoose(char* path, std::vector<BYTE>& data)
+{
+	data.clear();
+
+	HANDLE handle = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	DWORD size = GetFileSize(handle, 0);
+
+	data.resize(size);
+
+	DWORD InSize = 0;
+
+	bool result = (size == 0 || (ReadFile(handle, &data[0], size, &InSize, 0) != 0 && InSize == size));
+
+	CloseHandle(handle);
+
+	return result;
+}
+
+static DWORD SumBytes(BYTE* data, DWORD size)
+{
+	// Stands in for the parser, every page of the file is touched once whatever way it was loaded
+	DWORD sum = 0;
+
+	for (DWORD n = 0; n < size; n++)
+	{
+		sum += data[n];
+	}
+
+	return sum;
+}
+
+static double ReadAll(int method, std::vector<std::string>& list, char* PackPath, DWORD* lpSum, DWORD* lpSize)
+{
+	// The way the game loads: open, size, read, close per file, or the same calls served by the pack, or the zero copy view
+	*lpSum = 0;
+
+	*lpSize = 0;
+
+	double start = GetTimeMs();
+
+	CDataPack pack;
+
+	if (method != PACK_READ_LOOSE && pack.Open(PackPath) == 0)
+	{
+		return -1;
+	}
+
+	std::vector<BYTE> buff;
+
+	for (size_t n = 0; n < list.size(); n++)
+	{
+		char* name = (char*)list[n].c_str();
+
+		if (method == PACK_READ_VIEW)
+		{
+			DATA_PACK_VIEW view;
+
+			if (pack.GetView(pack.Find(name), &view) != 0)
+			{
+				*lpSum += SumBytes(view.Data, view.Size);
+
+				*lpSize += view.Size;
+
+				pack.ReleaseView(&view);
+			}
+
+			continue;
+		}
+
+		HANDLE handle = ((method == PACK_READ_LOOSE) ? CreateFile(name, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0) : pack.OpenFile(name));
+
+		if (handle == INVALID_HANDLE_VALUE)
+		{
+			continue;
+		}
+
+		DWORD size = ((method == PACK_READ_LOOSE) ? GetFileSize(handle, 0) : pack.FileSize(handle));
+
+		buff.resize(size + 1);
+
+		DWORD InSize = 0;
+
+		if (method == PACK_READ_LOOSE)
+		{
+			ReadFile(handle, &buff[0], size, &InSize, 0);
+
+			CloseHandle(handle);
+		}
+		else
+		{
+			pack.FileRead(handle, &buff[0], size, &InSize);
+
+			pack.FileClose(handle);
+		}
+
+		*lpSum += SumBytes(&buff[0], InSize);
+
+		*lpSize += InSize;
+	}
+
+	return GetTimeMs() - start;
+}
+
+int CommandPack(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printf("Usage: DataTool pack <directory> <output> [lz]\n");
+		return 1;
+	}
+
+	bool compress = (argc >= 3 && _stricmp(argv[2], "lz") == 0);
+
+	std::vector<std::string> list;
+
+	ScanFiles(argv[0], 0, list);
+
+	DATA_PACK_BUILD_INFO info;
+
+	double start = GetTimeMs();
+
+	if (CDataPack::Build(list, argv[1], compress, &info) == 0)
+	{
+		printf("Could not build %s\n", argv[1]);
+		return 1;
+	}
+
+	double BuildTime = GetTimeMs() - start;
+
+	CDataPack pack;
+
+	start = GetTimeMs();
+
+	if (pack.Open(argv[1]) == 0)
+	{
+		printf("Could not open %s\n", argv[1]);
+		return 1;
+	}
+
+	double OpenTime = GetTimeMs() - start;
+
+	printf("%d files (%d left on disk), %d slots, largest seed %d, %d compressed, %d stored once for an identical file (%u bytes): %u bytes in, %u bytes packed (%.1f%%), built in %.0f ms, opened in %.3f ms\n", info.EntryCount, info.SkippedCount, pack.GetSlotCount(), info.MaxSeed, info.PackedCount, info.SharedCount, info.SharedSize, info.RawSize, info.FileSize, ((info.FileSize * 100.0) / info.RawSize), BuildTime, OpenTime);
+
+	// Every file has to come back byte for byte and with its checksum, files the game writes must not be in the pack at all
+	int mismatch = 0;
+
+	std::vector<BYTE> data;
+
+	for (size_t n = 0; n < list.size(); n++)
+	{
+		int index = pack.Find((char*)list[n].c_str());
+
+		if (CDataPack::IsPackable((char*)list[n].c_str()) == 0)
+		{
+			mismatch += (index != -1);
+			continue;
+		}
+
+		DATA_PACK_VIEW view;
+
+		if (index == -1 || pack.IsCurrent(index) == 0 || ReadLoose((char*)list[n].c_str(), data) == 0 || pack.Verify(index) == 0 || pack.GetView(index, &view) == 0)
+		{
+			mismatch++;
+			continue;
+		}
+
+		mismatch += (view.Size != data.size() || (view.Size != 0 && memcmp(view.Data, &data[0], view.Size) != 0));
+
+		pack.ReleaseView(&view);
+	}
+
+	mismatch += (pack.Find("Data\\Missing\\Missing.bmd") != -1);
+
+	int found = 0;
+
+	start = GetTimeMs();
+
+	for (int run = 0; run < PACK_LOOKUP_RUNS; run++)
+	{
+		for (size_t n = 0; n < list.size(); n++)
+		{
+			found += (pack.Find((char*)list[n].c_str()) != -1);
+		}
+	}
+
+	double LookupTime = GetTimeMs() - start;
+
+	printf("%d lookups in %.2f ms (%.0f ns each), %d found, mismatches %d\n", (PACK_LOOKUP_RUNS * list.size()), LookupTime, ((LookupTime * 1000000.0) / (PACK_LOOKUP_RUNS * list.size())), found, mismatch);
+
+	return ((mismatch == 0) ? 0 : 1);
+}
+
+int CommandPackRead(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printf("Usage: DataTool packread <directory> <pack> [loose|handle|view]\n");
+		return 1;
+	}
+
+	std::vector<std::string> list;
+
+	ScanFiles(argv[0], 0, list);
+
+	// A single method per run lets the caller flush the disk cache in between for cold numbers
+	for (int method = 0; method < PACK_READ_MAX; method++)
+	{
+		if (argc >= 3 && _stricmp(argv[2], PackReadName[method]) != 0)
+		{
+			continue;
+		}
+
+		DWORD sum = 0;
+
+		DWORD size = 0;
+
+		double time = ReadAll(method, list, argv[1], &sum, &size);
+
+		if (time < 0)
+		{
+			printf("Could not open %s\n", argv[1]);
+			return 1;
+		}
+
+		printf("%-6s %d files, %u bytes in %.2f ms (%.0f MB/s), checksum %08X\n", PackReadName[method], list.size(), size, time, ((size / 1048576.0) / (time / 1000.0)), sum);
+	}
+
+	return 0;
+}
@@ -0,0 +1,298 @@
+#include "stdafx.h"
+#include "DataTool.h"
+#include "TerrainPath.h"
+
+static int GetRandom(int count)
+{
+	return ((((rand() & 0x7FFF) << 15) | (rand() & 0x7FFF)) % count);
+}
+
+static bool CheckPath(CTerrainPath* lpPath, std::vector<TERRAIN_PATH_POINT>& path, int cost)
+{
+	// Every step must be a legal move and the steps must add up to the reported cost
+	int total = 0;
+
+	for (size_t n = 1; n < path.size(); n++)
+	{
+		int dx = path[n].X - path[n - 1].X;
+
+		int dy = path[n].Y - path[n - 1].Y;
+
+		if (abs(dx) > 1 || abs(dy) > 1 || (dx == 0 && dy == 0) || lpPath->IsWalkable(path[n].X, path[n].Y) == 0)
+		{
+			return false;
+		}
+
+		if (dx != 0 && dy != 0 && (lpPath->IsWalkable(path[n - 1].X + dx, path[n - 1].Y) == 0 || lpPath->IsWalkable(path[n - 1].X, path[n - 1].Y + dy) == 0))
+		{
+			return false;
+		}
+
+		total += ((dx != 0 && dy != 0) ? TERRAIN_PATH_COST_DIAGONAL : TERRAIN_PATH_COST_STRAIGHT);
+	}
+
+	return (total == cost);
+}
+
+static bool LineOfSightReference(CTerrainPath* lpPath, int x1, int y1, int x2, int y2)
+{
+	// Cell by cell walk of the same line, checks the row and column bit tests
+	int dx = abs(x2 - x1);
+
+	int dy = abs(y2 - y1);
+
+	int sx = ((x2 > x1) ? 1 : ((x2 < x1) ? -1 : 0));
+
+	int sy = ((y2 > y1) ? 1 : ((y2 < y1) ? -1 : 0));
+
+	int error = dx - dy;
+
+	int x = x1;
+
+	int y = y1;
+
+	if (lpPath->IsWalkable(x, y) == 0)
+	{
+		return false;
+	}
+
+	while (x != x2 || y != y2)
+	{
+		int nx = x;
+
+		int ny = y;
+
+		int e2 = error * 2;
+
+		if (e2 > -dy)
+		{
+			error -= dy;
+			nx += sx;
+		}
+
+		if (e2 < dx)
+		{
+			error += dx;
+			ny += sy;
+		}
+
+		if (lpPath->IsWalkable(nx, ny) == 0 || (nx != x && ny != y && (lpPath->IsWalkable(nx, y) == 0 || lpPath->IsWalkable(x, ny) == 0)))
+		{
+			return false;
+		}
+
+		x = nx;
+
+		y = ny;
+	}
+
+	return true;
+}
+
+int CommandPath(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printf("Usage: DataTool path <directory> [queries]\n");
+		return 1;
+	}
+
+	int queries = ((argc >= 2) ? atoi(argv[1]) : 10000);
+
+	if (queries <= 0)
+	{
+		queries = 1;
+	}
+
+	CTextureDecoder decoder;
+
+	CTextureBufferPool pool;
+
+	TERRAIN_DATA terrain;
+
+	CTerrainPath* lpPath = new CTerrainPath;
+
+	std::vector<TERRAIN_PATH_POINT> path;
+
+	std::vector<int> walkable;
+
+	std::vector<int> query;
+
+	std::vector<int> cost;
+
+	int ErrorCount = 0;
+
+	double ReferenceTotal = 0;
+
+	double PathTotal = 0;
+
+	double SightTotal = 0;
+
+	for (int world = 1; world < TERRAIN_MAX_WORLD; world++)
+	{
+		char directory[MAX_PATH];
+
+		wsprintf(directory, "%s\\World%d", argv[0], world);
+
+		if (GetFileAttributes(directory) == INVALID_FILE_ATTRIBUTES || CTerrainPackage::LoadSource(directory, world, &decoder, &pool, &terrain) == 0)
+		{
+			continue;
+		}
+
+		double start = GetTimeMs();
+
+		lpPath->Build(&terrain.Chunk[TERRAIN_CHUNK_ATTRIBUTE][0]);
+
+		double BuildTime = GetTimeMs() - start;
+
+		walkable.clear();
+
+		for (int n = 0; n < TERRAIN_CELL_COUNT; n++)
+		{
+			if (lpPath->IsWalkable((n % TERRAIN_SIZE), (n / TERRAIN_SIZE)) != 0)
+			{
+				walkable.push_back(n);
+			}
+		}
+
+		if (walkable.empty() != 0)
+		{
+			continue;
+		}
+
+		srand(world);
+
+		query.resize(queries * 2);
+
+		for (int n = 0; n < (queries * 2); n++)
+		{
+			query[n] = walkable[GetRandom(walkable.size())];
+		}
+
+		cost.resize(queries);
+
+		QWORD ReferenceExpanded = 0;
+
+		QWORD PathExpanded = 0;
+
+		QWORD PathLength = 0;
+
+		int FoundCount = 0;
+
+		start = GetTimeMs();
+
+		for (int n = 0; n < queries; n++)
+		{
+			int a = query[n * 2];
+
+			int b = query[(n * 2) + 1];
+
+			lpPath->FindPathReference((a % TERRAIN_SIZE), (a / TERRAIN_SIZE), (b % TERRAIN_SIZE), (b / TERRAIN_SIZE), path);
+
+			cost[n] = lpPath->GetLastCost();
+
+			ReferenceExpanded += lpPath->GetLastExpanded();
+		}
+
+		double ReferenceTime = GetTimeMs() - start;
+
+		start = GetTimeMs();
+
+		for (int n = 0; n < queries; n++)
+		{
+			int a = query[n * 2];
+
+			int b = query[(n * 2) + 1];
+
+			lpPath->FindPath((a % TERRAIN_SIZE), (a / TERRAIN_SIZE), (b % TERRAIN_SIZE), (b / TERRAIN_SIZE), path);
+
+			PathExpanded += lpPath->GetLastExpanded();
+		}
+
+		double PathTime = GetTimeMs() - start;
+
+		// Checked in a separate pass so the timing above only holds the searches
+		int MismatchCount = 0;
+
+		for (int n = 0; n < queries; n++)
+		{
+			int a = query[n * 2];
+
+			int b = query[(n * 2) + 1];
+
+			bool found = lpPath->FindPath((a % TERRAIN_SIZE), (a / TERRAIN_SIZE), (b % TERRAIN_SIZE), (b / TERRAIN_SIZE), path);
+
+			if (lpPath->GetLastCost() != cost[n] || (found != 0 && CheckPath(lpPath, path, cost[n]) == 0))
+			{
+				MismatchCount++;
+			}
+
+			if (found != 0)
+			{
+				FoundCount++;
+
+				PathLength += path.size();
+			}
+		}
+
+		// Half of the sight queries share a row or a column so the bit test paths get exercised
+		for (int n = 0; n < queries; n++)
+		{
+			int a = query[n * 2];
+
+			int b = query[(n * 2) + 1];
+
+			if ((n % 4) == 1)
+			{
+				query[(n * 2) + 1] = ((a / TERRAIN_SIZE) * TERRAIN_SIZE) + (b % TERRAIN_SIZE);
+			}
+			else if ((n % 4) == 3)
+			{
+				query[(n * 2) + 1] = ((b / TERRAIN_SIZE) * TERRAIN_SIZE) + (a % TERRAIN_SIZE);
+			}
+		}
+
+		int SightCount = 0;
+
+		start = GetTimeMs();
+
+		for (int n = 0; n < queries; n++)
+		{
+			int a = query[n * 2];
+
+			int b = query[(n * 2) + 1];
+
+			SightCount += lpPath->LineOfSight((a % TERRAIN_SIZE), (a / TERRAIN_SIZE), (b % TERRAIN_SIZE), (b / TERRAIN_SIZE));
+		}
+
+		double SightTime = GetTimeMs() - start;
+
+		for (int n = 0; n < queries; n++)
+		{
+			int a = query[n * 2];
+
+			int b = query[(n * 2) + 1];
+
+			if (lpPath->LineOfSight((a % TERRAIN_SIZE), (a / TERRAIN_SIZE), (b % TERRAIN_SIZE), (b / TERRAIN_SIZE)) != LineOfSightReference(lpPath, (a % TERRAIN_SIZE), (a / TERRAIN_SIZE), (b % TERRAIN_SIZE), (b / TERRAIN_SIZE)))
+			{
+				MismatchCount++;
+			}
+		}
+
+		printf("World%-3d walkable %5d  found %5.1f%%  avg length %5.1f  A* %8.2f ms (%6llu nodes)  JPS %7.2f ms (%4llu nodes)  %5.1fx  sight %5.2f ms (%d clear)  build %.3f ms  mismatch %d\n", world, walkable.size(), ((FoundCount * 100.0) / queries), ((FoundCount > 0) ? ((double)PathLength / FoundCount) : 0.0), ReferenceTime, (ReferenceExpanded / queries), PathTime, (PathExpanded / queries), (ReferenceTime / PathTime), SightTime, SightCount, BuildTime, MismatchCount);
+
+		ReferenceTotal += ReferenceTime;
+
+		PathTotal += PathTime;
+
+		SightTotal += SightTime;
+
+		ErrorCount += MismatchCount;
+	}
+
+	printf("total: A* %.2f ms, JPS %.2f ms (%.1fx), sight %.2f ms, mismatch %d\n", ReferenceTotal, PathTotal, ((PathTotal > 0) ? (ReferenceTotal / PathTotal) : 0.0), SightTotal, ErrorCount);
+
+	delete lpPath;
+
+	return ((ErrorCount == 0) ? 0 : 1);
+}
@@ -0,0 +1,271 @@
+#include "stdafx.h"
+#include "DataTool.h"
+#include "TerrainCull.h"
+#include "TerrainPick.h"
+
+#define PICK_RAY_DEFAULT 100000
+#define PICK_RAY_PER_CAMERA 64
+#define PICK_MAX_DISTANCE 4000.0f
+#define PICK_STEP 10.0f
+#define PICK_FINE_STEP 0.01f
+#define PICK_FINE_TOLERANCE 0.1f
+#define PICK_GRAZING_PITCH 20.0f
+#define PICK_ASPECT (4.0f / 3.0f)
+
+struct PICK_RAY
+{
+	float Origin[3];
+	float Direction[3];
+	bool Grazing;
+};
+
+struct PICK_STAT
+{
+	DWORD RayCount;
+	DWORD HitCount;
+	DWORD HitMismatch;
+	DWORD CellMismatch;
+	DWORD FineMismatch;
+	double Time[2];
+	double Step[2];
+	float DistanceError;
+};
+
+static void MakeRays(CTerrainCull* lpCull, TERRAIN_DATA* lpData, int world, int count, std::vector<PICK_RAY>& list)
+{
+	// Free 3D camera around walkable cells, the pitch goes down to near grazing angles
+	srand(world);
+
+	list.resize(count);
+
+	for (int n = 0; n < count; n++)
+	{
+		if ((n % PICK_RAY_PER_CAMERA) == 0)
+		{
+			int x = 0;
+
+			int y = 0;
+
+			for (int i = 0; i < 1000; i++)
+			{
+				x = 16 + ((rand() & 0x7FFF) % (TERRAIN_SIZE - 32));
+
+				y = 16 + ((rand() & 0x7FFF) % (TERRAIN_SIZE - 32));
+
+				if ((lpData->Chunk[TERRAIN_CHUNK_ATTRIBUTE][(y * TERRAIN_SIZE) + x] & 0x0C) == 0)
+				{
+					break;
+				}
+			}
+
+			CAMERA_INFO camera;
+
+			memset(&camera, 0, sizeof(camera));
+
+			camera.Zoom = 35.0f;
+
+			camera.RotX = (float)(rand() % 360);
+
+			camera.RotY = 5.0f + (float)(rand() % 76);
+
+			camera.PosZ = 150.0f;
+
+			camera.ClipGL = PICK_MAX_DISTANCE;
+
+			lpCull->SetCamera(&camera, ((x + 0.5f) * TERRAIN_CULL_SCALE), ((y + 0.5f) * TERRAIN_CULL_SCALE), PICK_ASPECT);
+
+			for (int i = n; i < count && i < (n + PICK_RAY_PER_CAMERA); i++)
+			{
+				list[i].Grazing = (camera.RotY < PICK_GRAZING_PITCH);
+			}
+		}
+
+		float ScreenX = (((rand() & 0x7FFF) % 2001) / 1000.0f) - 1.0f;
+
+		float ScreenY = (((rand() & 0x7FFF) % 2001) / 1000.0f) - 1.0f;
+
+		lpCull->GetRay(ScreenX, ScreenY, list[n].Origin, list[n].Direction);
+	}
+}
+
+static void RunRays(CTerrainPick* lpPick, std::vector<PICK_RAY>& list, PICK_STAT* lpStat, PICK_STAT* lpGrazing)
+{
+	std::vector<TERRAIN_PICK_RESULT> result[2];
+
+	std::vector<BYTE> hit[2];
+
+	for (int method = 0; method < 2; method++)
+	{
+		result[method].resize(list.size());
+
+		hit[method].resize(list.size());
+
+		for (size_t n = 0; n < list.size(); n++)
+		{
+			double start = GetTimeMs();
+
+			if (method == 0)
+			{
+				hit[method][n] = lpPick->PickStep(list[n].Origin, list[n].Direction, PICK_MAX_DISTANCE, PICK_STEP, &result[method][n]);
+			}
+			else
+			{
+				hit[method][n] = lpPick->Pick(list[n].Origin, list[n].Direction, PICK_MAX_DISTANCE, &result[method][n]);
+			}
+
+			double time = GetTimeMs() - start;
+
+			PICK_STAT* lpTarget[2] = { lpStat, ((list[n].Grazing != 0) ? lpGrazing : 0) };
+
+			for (int i = 0; i < 2; i++)
+			{
+				if (lpTarget[i] != 0)
+				{
+					lpTarget[i]->Time[method] += time;
+
+					lpTarget[i]->Step[method] += lpPick->GetLastStepCount();
+				}
+			}
+		}
+	}
+
+	for (size_t n = 0; n < list.size(); n++)
+	{
+		PICK_STAT* lpTarget[2] = { lpStat, ((list[n].Grazing != 0) ? lpGrazing : 0) };
+
+		for (int i = 0; i < 2; i++)
+		{
+			if (lpTarget[i] == 0)
+			{
+				continue;
+			}
+
+			lpTarget[i]->RayCount++;
+
+			lpTarget[i]->HitCount += hit[1][n];
+
+			bool mismatch = (hit[0][n] != hit[1][n] || (hit[0][n] != 0 && (result[0][n].X != result[1][n].X || result[0][n].Y != result[1][n].Y)));
+
+			if (mismatch != 0)
+			{
+				// Fixed steps jump over thin ridges and corners, a much finer march settles who is right, cells may differ on a shared border
+				TERRAIN_PICK_RESULT fine;
+
+				bool FineHit = lpPick->PickStep(list[n].Origin, list[n].Direction, PICK_MAX_DISTANCE, PICK_FINE_STEP, &fine);
+
+				lpTarget[i]->FineMismatch += (FineHit != hit[1][n] || (FineHit != 0 && fabs(fine.Distance - result[1][n].Distance) > PICK_FINE_TOLERANCE));
+			}
+
+			if (hit[0][n] != hit[1][n])
+			{
+				lpTarget[i]->HitMismatch++;
+				continue;
+			}
+
+			if (hit[0][n] == 0)
+			{
+				continue;
+			}
+
+			if (result[0][n].X != result[1][n].X || result[0][n].Y != result[1][n].Y)
+			{
+				lpTarget[i]->CellMismatch++;
+				continue;
+			}
+
+			float error = fabs(result[0][n].Distance - result[1][n].Distance);
+
+			lpTarget[i]->DistanceError = ((error > lpTarget[i]->DistanceError) ? error : lpTarget[i]->DistanceError);
+		}
+	}
+}
+
+static void PrintStat(char* name, PICK_STAT* lpStat)
+{
+	double count = ((lpStat->RayCount > 0) ? lpStat->RayCount : 1);
+
+	printf("%-8s %6d rays, %6d hits  step %7.2f ms (%5.0f steps/ray)  pyramid %6.2f ms (%4.0f nodes/ray, %5.1fx)  step mismatch: hit %d, cell %d, max distance %.3f, pyramid wrong vs %.2f step %d\n", name, lpStat->RayCount, lpStat->HitCount, lpStat->Time[0], (lpStat->Step[0] / count), lpStat->Time[1], (lpStat->Step[1] / count), ((lpStat->Time[1] > 0) ? (lpStat->Time[0] / lpStat->Time[1]) : 0.0), lpStat->HitMismatch, lpStat->CellMismatch, lpStat->DistanceError, PICK_FINE_STEP, lpStat->FineMismatch);
+}
+
+int CommandPick(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printf("Usage: DataTool pick <directory> [rays]\n");
+		return 1;
+	}
+
+	int count = ((argc >= 2) ? atoi(argv[1]) : PICK_RAY_DEFAULT);
+
+	if (count <= 0)
+	{
+		count = PICK_RAY_DEFAULT;
+	}
+
+	CTextureDecoder decoder;
+
+	CTextureBufferPool pool;
+
+	TERRAIN_DATA terrain;
+
+	CTerrainCull cull;
+
+	CTerrainPick pick;
+
+	PICK_STAT total;
+
+	PICK_STAT grazing;
+
+	memset(&total, 0, sizeof(total));
+
+	memset(&grazing, 0, sizeof(grazing));
+
+	std::vector<PICK_RAY> list;
+
+	for (int world = 1; world < TERRAIN_MAX_WORLD; world++)
+	{
+		char directory[MAX_PATH];
+
+		wsprintf(directory, "%s\\World%d", argv[0], world);
+
+		if (GetFileAttributes(directory) == INVALID_FILE_ATTRIBUTES || CTerrainPackage::LoadSource(directory, world, &decoder, &pool, &terrain) == 0)
+		{
+			continue;
+		}
+
+		cull.Build(&terrain.Chunk[TERRAIN_CHUNK_HEIGHT][0]);
+
+		pick.Build(&terrain.Chunk[TERRAIN_CHUNK_HEIGHT][0], &terrain.Chunk[TERRAIN_CHUNK_ATTRIBUTE][0]);
+
+		MakeRays(&cull, &terrain, world, count, list);
+
+		PICK_STAT stat;
+
+		memset(&stat, 0, sizeof(stat));
+
+		RunRays(&pick, list, &stat, &grazing);
+
+		char name[32];
+
+		wsprintf(name, "World%d", world);
+
+		PrintStat(name, &stat);
+
+		total.RayCount += stat.RayCount;
+		total.HitCount += stat.HitCount;
+		total.HitMismatch += stat.HitMismatch;
+		total.CellMismatch += stat.CellMismatch;
+		total.FineMismatch += stat.FineMismatch;
+		total.Time[0] += stat.Time[0];
+		total.Time[1] += stat.Time[1];
+		total.Step[0] += stat.Step[0];
+		total.Step[1] += stat.Step[1];
+		total.DistanceError = ((stat.DistanceError > total.DistanceError) ? stat.DistanceError : total.DistanceError);
+	}
+
+	PrintStat("grazing", &grazing);
+
+	PrintStat("total", &total);
+
+	return ((total.FineMismatch == 0) ? 0 : 1);
+}
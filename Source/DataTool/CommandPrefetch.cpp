@@ -0,0 +1,353 @@
+#include "stdafx.h"
+#include "DataTool.h"
+#include "MapPrefetch.h"
+#include "TextureQuality.h"
+
+#define PREFETCH_QUERY_COUNT 1000000
+#define PREFETCH_WAIT_LIMIT 30000
+
+struct PREFETCH_LOAD
+{
+	double Time;
+	DWORD FileSize;
+	int ImageCount;
+	int ImageHit;
+	bool TerrainHit;
+};
+
+static int FindGateLinear(CMapPrefetch* lpPrefetch, int map, int x, int y)
+{
+	// Reference for the bucket index, every gate of the file with the same distance rule
+	int result = -1;
+
+	int best = MAP_PREFETCH_RADIUS + 1;
+
+	for (int n = 0; n < lpPrefetch->GetGateCount(); n++)
+	{
+		GATE_INFO* lpGate = lpPrefetch->GetGate(n);
+
+		int destination = lpPrefetch->GetDestination(n);
+
+		if (lpGate->Map != map || destination == -1 || destination == lpGate->Map)
+		{
+			continue;
+		}
+
+		int MinX = ((lpGate->X1 < lpGate->X2) ? lpGate->X1 : lpGate->X2);
+
+		int MaxX = ((lpGate->X1 > lpGate->X2) ? lpGate->X1 : lpGate->X2);
+
+		int MinY = ((lpGate->Y1 < lpGate->Y2) ? lpGate->Y1 : lpGate->Y2);
+
+		int MaxY = ((lpGate->Y1 > lpGate->Y2) ? lpGate->Y1 : lpGate->Y2);
+
+		int dx = ((x < MinX) ? (MinX - x) : ((x > MaxX) ? (x - MaxX) : 0));
+
+		int dy = ((y < MinY) ? (MinY - y) : ((y > MaxY) ? (y - MaxY) : 0));
+
+		int distance = ((dx > dy) ? dx : dy);
+
+		if (distance < best)
+		{
+			best = distance;
+
+			result = n;
+		}
+	}
+
+	return result;
+}
+
+static DWORD ReadFiles(char* path)
+{
+	char find[MAX_PATH];
+
+	if (_snprintf_s(find, sizeof(find), _TRUNCATE, "%s\\*", path) < 0)
+	{
+		return 0;
+	}
+
+	WIN32_FIND_DATA data;
+
+	HANDLE handle = FindFirstFile(find, &data);
+
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return 0;
+	}
+
+	std::vector<BYTE> buff(MAP_PREFETCH_READ_SIZE);
+
+	DWORD total = 0;
+
+	do
+	{
+		if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+		{
+			continue;
+		}
+
+		char name[MAX_PATH];
+
+		if (_snprintf_s(name, sizeof(name), _TRUNCATE, "%s\\%s", path, data.cFileName) < 0)
+		{
+			continue;
+		}
+
+		HANDLE file = CreateFile(name, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			continue;
+		}
+
+		DWORD OutSize = 0;
+
+		while (ReadFile(file, &buff[0], MAP_PREFETCH_READ_SIZE, &OutSize, 0) != 0 && OutSize != 0)
+		{
+			total += OutSize;
+		}
+
+		CloseHandle(file);
+	}
+	while (FindNextFile(handle, &data) != 0);
+
+	FindClose(handle);
+
+	return total;
+}
+
+static void LoadWorld(CMapPrefetch* lpPrefetch, char* directory, int world, CTextureDecoder* lpDecoder, CTextureBufferPool* lpPool, PREFETCH_LOAD* lpLoad)
+{
+	// What the warp does before the first frame: terrain, every world texture decoded, the object models read, with or without the prefetcher
+	memset(lpLoad, 0, sizeof(PREFETCH_LOAD));
+
+	double start = GetTimeMs();
+
+	char path[MAX_PATH];
+
+	wsprintf(path, "%s\\World%d", directory, world);
+
+	TERRAIN_DATA terrain;
+
+	lpLoad->TerrainHit = ((lpPrefetch != 0) && lpPrefetch->TakeTerrain(world, &terrain) != 0);
+
+	if (lpLoad->TerrainHit == 0)
+	{
+		CTerrainPackage::LoadSource(path, world, lpDecoder, lpPool, &terrain);
+	}
+
+	char find[MAX_PATH];
+
+	WIN32_FIND_DATA data;
+
+	HANDLE handle = ((_snprintf_s(find, sizeof(find), _TRUNCATE, "%s\\*", path) < 0) ? INVALID_HANDLE_VALUE : FindFirstFile(find, &data));
+
+	while (handle != INVALID_HANDLE_VALUE)
+	{
+		char name[MAX_PATH];
+
+		DWORD prefix = 0;
+
+		if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0 && _strnicmp(data.cFileName, "Terrain", 7) != 0 && _snprintf_s(name, sizeof(name), _TRUNCATE, "%s\\%s", path, data.cFileName) >= 0 && CTextureDecoder::GetType(name, &prefix) != TEXTURE_TYPE_NONE)
+		{
+			TEXTURE_IMAGE image;
+
+			lpLoad->ImageCount++;
+
+			if (lpPrefetch != 0 && lpPrefetch->TakeImage(world, data.cFileName, &image) != 0)
+			{
+				lpLoad->ImageHit++;
+
+				lpPrefetch->FreeImage(&image);
+			}
+			else if (lpDecoder->Decode(name, lpPool, &image) != 0)
+			{
+				gTextureQuality.Apply(name, &image, lpPool);
+
+				lpPool->Free(image.Data, image.Capacity);
+			}
+		}
+
+		if (FindNextFile(handle, &data) == 0)
+		{
+			FindClose(handle);
+
+			break;
+		}
+	}
+
+	wsprintf(path, "%s\\Object%d", directory, world);
+
+	lpLoad->FileSize = ReadFiles(path);
+
+	lpLoad->Time = GetTimeMs() - start;
+}
+
+static int FindEntrance(CMapPrefetch* lpPrefetch, int world)
+{
+	for (int n = 0; n < lpPrefetch->GetGateCount(); n++)
+	{
+		int destination = lpPrefetch->GetDestination(n);
+
+		if (destination != -1 && CMapPrefetch::GetWorld(destination) == world && destination != lpPrefetch->GetGate(n)->Map)
+		{
+			return n;
+		}
+	}
+
+	return -1;
+}
+
+int CommandPrefetch(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printf("Usage: DataTool prefetch <directory> [budget MB]\n");
+		return 1;
+	}
+
+	DWORD budget = ((argc >= 2) ? (atoi(argv[1]) * 1024 * 1024) : MAP_PREFETCH_DEFAULT_BUDGET);
+
+	budget = ((budget == 0) ? MAP_PREFETCH_DEFAULT_BUDGET : budget);
+
+	char path[MAX_PATH];
+
+	wsprintf(path, "%s\\Gate.bmd", argv[0]);
+
+	CMapPrefetch prefetch;
+
+	if (prefetch.Load(path) == 0)
+	{
+		printf("Gate.bmd not found in %s\n", argv[0]);
+		return 1;
+	}
+
+	int EntranceCount = 0;
+
+	int CrossCount = 0;
+
+	for (int n = 0; n < prefetch.GetGateCount(); n++)
+	{
+		int destination = prefetch.GetDestination(n);
+
+		EntranceCount += (destination != -1);
+
+		CrossCount += (destination != -1 && destination != prefetch.GetGate(n)->Map);
+	}
+
+	printf("%d gates, %d entrances, %d into another map\n", prefetch.GetGateCount(), EntranceCount, CrossCount);
+
+	// Hero positions anywhere on the first maps, most of them far from any gate
+	srand(1);
+
+	std::vector<int> query(PREFETCH_QUERY_COUNT * 3);
+
+	for (int n = 0; n < PREFETCH_QUERY_COUNT; n++)
+	{
+		query[(n * 3) + 0] = (rand() & 0x7FFF) % 11;
+
+		query[(n * 3) + 1] = (rand() & 0x7FFF) % TERRAIN_SIZE;
+
+		query[(n * 3) + 2] = (rand() & 0x7FFF) % TERRAIN_SIZE;
+	}
+
+	int result[2] = { 0, 0 };
+
+	int mismatch = 0;
+
+	double start = GetTimeMs();
+
+	for (int n = 0; n < PREFETCH_QUERY_COUNT; n++)
+	{
+		result[0] += (FindGateLinear(&prefetch, query[(n * 3) + 0], query[(n * 3) + 1], query[(n * 3) + 2]) != -1);
+	}
+
+	double LinearTime = GetTimeMs() - start;
+
+	start = GetTimeMs();
+
+	for (int n = 0; n < PREFETCH_QUERY_COUNT; n++)
+	{
+		result[1] += (prefetch.FindGate(query[(n * 3) + 0], query[(n * 3) + 1], query[(n * 3) + 2]) != -1);
+	}
+
+	double BucketTime = GetTimeMs() - start;
+
+	for (int n = 0; n < PREFETCH_QUERY_COUNT; n++)
+	{
+		mismatch += (FindGateLinear(&prefetch, query[(n * 3) + 0], query[(n * 3) + 1], query[(n * 3) + 2]) != prefetch.FindGate(query[(n * 3) + 0], query[(n * 3) + 1], query[(n * 3) + 2]));
+	}
+
+	printf("%d position queries: linear %.2f ms, buckets %.2f ms (%.1fx), %d near a gate, mismatches %d\n", PREFETCH_QUERY_COUNT, LinearTime, BucketTime, (LinearTime / BucketTime), result[1], mismatch);
+
+	if (prefetch.Start(argv[0], budget) == 0)
+	{
+		printf("Could not start the prefetch thread\n");
+		return 1;
+	}
+
+	CTextureDecoder decoder;
+
+	CTextureBufferPool pool;
+
+	double ColdTotal = 0;
+
+	double WarmTotal = 0;
+
+	int WorldCount = 0;
+
+	for (int world = 1; world < TERRAIN_MAX_WORLD; world++)
+	{
+		int gate = FindEntrance(&prefetch, world);
+
+		wsprintf(path, "%s\\World%d", argv[0], world);
+
+		if (gate == -1 || (GetFileAttributes(path) & FILE_ATTRIBUTE_DIRECTORY) == 0 || GetFileAttributes(path) == INVALID_FILE_ATTRIBUTES)
+		{
+			continue;
+		}
+
+		// The first pass only fills the OS cache so both loads below start from the same disk state
+		PREFETCH_LOAD cold;
+
+		LoadWorld(0, argv[0], world, &decoder, &pool, &cold);
+
+		LoadWorld(0, argv[0], world, &decoder, &pool, &cold);
+
+		GATE_INFO* lpGate = prefetch.GetGate(gate);
+
+		double wait = GetTimeMs();
+
+		prefetch.Update(lpGate->Map, lpGate->X1, lpGate->Y1);
+
+		while (prefetch.IsReady(world) == 0 && (GetTimeMs() - wait) < PREFETCH_WAIT_LIMIT)
+		{
+			Sleep(1);
+		}
+
+		wait = GetTimeMs() - wait;
+
+		DWORD resident = prefetch.GetDecodedSize();
+
+		PREFETCH_LOAD warm;
+
+		LoadWorld(&prefetch, argv[0], world, &decoder, &pool, &warm);
+
+		prefetch.Release(world);
+
+		ColdTotal += cold.Time;
+
+		WarmTotal += warm.Time;
+
+		WorldCount++;
+
+		printf("World%-3d gate %3d on map %2d: cold %7.2f ms, warm %6.2f ms (%4.1fx), warmed in %7.2f ms, %d/%d images and %s terrain held, %6d KB resident, %5d KB objects\n", world, gate, lpGate->Map, cold.Time, warm.Time, (cold.Time / warm.Time), wait, warm.ImageHit, warm.ImageCount, ((warm.TerrainHit != 0) ? "the" : "no"), (resident / 1024), (warm.FileSize / 1024));
+	}
+
+	prefetch.Stop();
+
+	printf("%d worlds: cold %.2f ms, warm %.2f ms, %.2f ms saved per warp on average (%.1fx)\n", WorldCount, ColdTotal, WarmTotal, ((ColdTotal - WarmTotal) / ((WorldCount == 0) ? 1 : WorldCount)), (ColdTotal / WarmTotal));
+
+	return ((mismatch == 0) ? 0 : 1);
+}
@@ -0,0 +1,280 @@
+#include "stdafx.h"
+#include "DataTool.h"
+#include "TerrainSample.h"
+
+#define SAMPLE_ENTITY_COUNT 5000
+#define SAMPLE_FRAME_DEFAULT 200
+#define SAMPLE_CLUSTER_RANGE 2000.0f
+#define SAMPLE_MOVE_RANGE 30
+
+struct SAMPLE_ENTITY_LIST
+{
+	std::vector<float> X;
+	std::vector<float> Y;
+	std::vector<float> Height;
+	std::vector<float> Normal[3];
+};
+
+struct SAMPLE_STAT
+{
+	double Time[4];
+	float HeightError;
+	float NormalError;
+};
+
+static void MakeEntities(int world, SAMPLE_ENTITY_LIST* lpList)
+{
+	// Most entities crowd the screen around the player, the rest are monsters and drops spread over the map
+	srand(world);
+
+	float CenterX = (64 + ((rand() & 0x7FFF) % 128)) * TERRAIN_SAMPLE_SCALE;
+
+	float CenterY = (64 + ((rand() & 0x7FFF) % 128)) * TERRAIN_SAMPLE_SCALE;
+
+	lpList->X.resize(SAMPLE_ENTITY_COUNT);
+
+	lpList->Y.resize(SAMPLE_ENTITY_COUNT);
+
+	lpList->Height.resize(SAMPLE_ENTITY_COUNT);
+
+	for (int n = 0; n < 3; n++)
+	{
+		lpList->Normal[n].resize(SAMPLE_ENTITY_COUNT);
+	}
+
+	for (int n = 0; n < SAMPLE_ENTITY_COUNT; n++)
+	{
+		if ((n % 4) != 3)
+		{
+			lpList->X[n] = CenterX + ((((rand() & 0x7FFF) % 2001) / 1000.0f) - 1.0f) * SAMPLE_CLUSTER_RANGE;
+
+			lpList->Y[n] = CenterY + ((((rand() & 0x7FFF) % 2001) / 1000.0f) - 1.0f) * SAMPLE_CLUSTER_RANGE;
+		}
+		else
+		{
+			lpList->X[n] = ((rand() & 0x7FFF) % (TERRAIN_SIZE * 100)) * (TERRAIN_SAMPLE_SCALE / 100.0f);
+
+			lpList->Y[n] = ((rand() & 0x7FFF) % (TERRAIN_SIZE * 100)) * (TERRAIN_SAMPLE_SCALE / 100.0f);
+		}
+	}
+}
+
+static void MoveEntities(SAMPLE_ENTITY_LIST* lpList)
+{
+	for (int n = 0; n < SAMPLE_ENTITY_COUNT; n++)
+	{
+		lpList->X[n] += (float)((rand() % ((SAMPLE_MOVE_RANGE * 2) + 1)) - SAMPLE_MOVE_RANGE);
+
+		lpList->Y[n] += (float)((rand() % ((SAMPLE_MOVE_RANGE * 2) + 1)) - SAMPLE_MOVE_RANGE);
+	}
+}
+
+static void SetBatch(SAMPLE_ENTITY_LIST* lpList, TERRAIN_SAMPLE_BATCH* lpBatch)
+{
+	lpBatch->Count = SAMPLE_ENTITY_COUNT;
+
+	lpBatch->X = &lpList->X[0];
+
+	lpBatch->Y = &lpList->Y[0];
+
+	lpBatch->Height = &lpList->Height[0];
+
+	lpBatch->NormalX = &lpList->Normal[0][0];
+
+	lpBatch->NormalY = &lpList->Normal[1][0];
+
+	lpBatch->NormalZ = &lpList->Normal[2][0];
+}
+
+static void CompareBatch(SAMPLE_ENTITY_LIST* a, SAMPLE_ENTITY_LIST* b, int* order, SAMPLE_STAT* lpStat)
+{
+	// Entry n of b belongs to entity order[n] of a when b was laid out in tile order
+	for (int n = 0; n < SAMPLE_ENTITY_COUNT; n++)
+	{
+		int i = ((order != 0) ? order[n] : n);
+
+		float error = fabs(a->Height[i] - b->Height[n]);
+
+		lpStat->HeightError = ((error > lpStat->HeightError) ? error : lpStat->HeightError);
+
+		for (int c = 0; c < 3; c++)
+		{
+			error = fabs(a->Normal[c][i] - b->Normal[c][n]);
+
+			lpStat->NormalError = ((error > lpStat->NormalError) ? error : lpStat->NormalError);
+		}
+	}
+}
+
+int CommandSample(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printf("Usage: DataTool sample <directory> [frames]\n");
+		return 1;
+	}
+
+	int frames = ((argc >= 2) ? atoi(argv[1]) : SAMPLE_FRAME_DEFAULT);
+
+	if (frames <= 0)
+	{
+		frames = SAMPLE_FRAME_DEFAULT;
+	}
+
+	CTextureDecoder decoder;
+
+	CTextureBufferPool pool;
+
+	TERRAIN_DATA terrain;
+
+	CTerrainSample sample;
+
+	SAMPLE_STAT total;
+
+	memset(&total, 0, sizeof(total));
+
+	int WorldCount = 0;
+
+	for (int world = 1; world < TERRAIN_MAX_WORLD; world++)
+	{
+		char directory[MAX_PATH];
+
+		wsprintf(directory, "%s\\World%d", argv[0], world);
+
+		if (GetFileAttributes(directory) == INVALID_FILE_ATTRIBUTES || CTerrainPackage::LoadSource(directory, world, &decoder, &pool, &terrain) == 0)
+		{
+			continue;
+		}
+
+		sample.Build(&terrain.Chunk[TERRAIN_CHUNK_HEIGHT][0]);
+
+		// Every method gets the same positions, the entity list is copied so only the outputs differ
+		SAMPLE_ENTITY_LIST list[4];
+
+		MakeEntities(world, &list[0]);
+
+		std::vector<int> order;
+
+		SAMPLE_STAT stat;
+
+		memset(&stat, 0, sizeof(stat));
+
+		for (int frame = 0; frame < frames; frame++)
+		{
+			MoveEntities(&list[0]);
+
+			for (int n = 1; n < 4; n++)
+			{
+				list[n].X = list[0].X;
+
+				list[n].Y = list[0].Y;
+
+				list[n].Height.resize(SAMPLE_ENTITY_COUNT);
+
+				for (int i = 0; i < 3; i++)
+				{
+					list[n].Normal[i].resize(SAMPLE_ENTITY_COUNT);
+				}
+			}
+
+			// 0: one call per entity like the client does today
+			double start = GetTimeMs();
+
+			for (int n = 0; n < SAMPLE_ENTITY_COUNT; n++)
+			{
+				float normal[3];
+
+				list[0].Height[n] = sample.GetHeight(list[0].X[n], list[0].Y[n]);
+
+				sample.GetNormal(list[0].X[n], list[0].Y[n], normal);
+
+				list[0].Normal[0][n] = normal[0];
+
+				list[0].Normal[1][n] = normal[1];
+
+				list[0].Normal[2][n] = normal[2];
+			}
+
+			stat.Time[0] += GetTimeMs() - start;
+
+			TERRAIN_SAMPLE_BATCH batch;
+
+			// 1: batch in entity order
+			SetBatch(&list[1], &batch);
+
+			start = GetTimeMs();
+
+			sample.Sample(&batch);
+
+			stat.Time[1] += GetTimeMs() - start;
+
+			// 2: sort by tile, lay the positions out in tile order and sample, 3: positions already kept in tile order
+			SetBatch(&list[2], &batch);
+
+			start = GetTimeMs();
+
+			sample.Sort(&batch, order);
+
+			for (int n = 0; n < SAMPLE_ENTITY_COUNT; n++)
+			{
+				list[2].X[n] = list[0].X[order[n]];
+
+				list[2].Y[n] = list[0].Y[order[n]];
+			}
+
+			sample.SampleSorted(&batch);
+
+			stat.Time[2] += GetTimeMs() - start;
+
+			list[3].X = list[2].X;
+
+			list[3].Y = list[2].Y;
+
+			SetBatch(&list[3], &batch);
+
+			start = GetTimeMs();
+
+			sample.SampleSorted(&batch);
+
+			stat.Time[3] += GetTimeMs() - start;
+
+			CompareBatch(&list[0], &list[1], 0, &stat);
+
+			CompareBatch(&list[0], &list[2], &order[0], &stat);
+
+			CompareBatch(&list[0], &list[3], &order[0], &stat);
+		}
+
+		for (int n = 0; n < 4; n++)
+		{
+			stat.Time[n] /= frames;
+		}
+
+		printf("World%-3d %d entities: scalar %6.3f ms  batch %6.3f ms (%4.2fx)  sort+tiled %6.3f ms (%4.2fx)  presorted %6.3f ms (%4.2fx)  max error: height %g, normal %g\n", world, SAMPLE_ENTITY_COUNT, stat.Time[0], stat.Time[1], (stat.Time[0] / stat.Time[1]), stat.Time[2], (stat.Time[0] / stat.Time[2]), stat.Time[3], (stat.Time[0] / stat.Time[3]), stat.HeightError, stat.NormalError);
+
+		for (int n = 0; n < 4; n++)
+		{
+			total.Time[n] += stat.Time[n];
+		}
+
+		total.HeightError = ((stat.HeightError > total.HeightError) ? stat.HeightError : total.HeightError);
+
+		total.NormalError = ((stat.NormalError > total.NormalError) ? stat.NormalError : total.NormalError);
+
+		WorldCount++;
+	}
+
+	if (WorldCount == 0)
+	{
+		printf("no worlds found in %s\n", argv[0]);
+		return 1;
+	}
+
+	printf("average over %d worlds, %d entities per frame:\n", WorldCount, SAMPLE_ENTITY_COUNT);
+
+	printf("scalar %.3f ms, batch %.3f ms (%.2fx), sort+tiled %.3f ms (%.2fx), presorted %.3f ms (%.2fx)\n", (total.Time[0] / WorldCount), (total.Time[1] / WorldCount), (total.Time[0] / total.Time[1]), (total.Time[2] / WorldCount), (total.Time[0] / total.Time[2]), (total.Time[3] / WorldCount), (total.Time[0] / total.Time[3]));
+
+	printf("max error vs scalar: height %g, normal %g\n", total.HeightError, total.NormalError);
+
+	return ((total.HeightError < 0.001f && total.NormalError < 0.0001f) ? 0 : 1);
+}
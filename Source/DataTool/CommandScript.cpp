@@ -0,0 +1,88 @@
+#include "stdafx.h"
+#include "DataTool.h"
+#include "MemScript.h"
+
+static DWORD ReadScriptTokens(CMemScript* lpMemScript, char* path)
+{
+	if (lpMemScript->SetBuffer(path) == 0)
+	{
+		printf("%s", lpMemScript->GetLastError());
+		return 0;
+	}
+
+	DWORD count = 0;
+
+	try
+	{
+		while (lpMemScript->GetToken() != TOKEN_END)
+		{
+			count++;
+		}
+	}
+	catch (...)
+	{
+		printf("%s", lpMemScript->GetLastError());
+		return 0;
+	}
+
+	return count;
+}
+
+int CommandScript(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printf("Usage: DataTool script <file> [runs]\n");
+		return 1;
+	}
+
+	int runs = ((argc >= 2) ? atoi(argv[1]) : 10);
+
+	if (runs <= 0)
+	{
+		runs = 1;
+	}
+
+	char cache[MAX_PATH];
+
+	wsprintf(cache, "%s%s", argv[0], MEM_SCRIPT_CACHE_EXTENSION);
+
+	double ColdTime = 0;
+
+	double WarmTime = 0;
+
+	DWORD tokens = 0;
+
+	for (int n = 0; n < runs; n++)
+	{
+		DeleteFile(cache);
+
+		CMemScript* lpMemScript = new CMemScript;
+
+		double start = GetTimeMs();
+
+		tokens = ReadScriptTokens(lpMemScript, argv[0]);
+
+		ColdTime += GetTimeMs() - start;
+
+		delete lpMemScript;
+
+		lpMemScript = new CMemScript;
+
+		start = GetTimeMs();
+
+		ReadScriptTokens(lpMemScript, argv[0]);
+
+		WarmTime += GetTimeMs() - start;
+
+		delete lpMemScript;
+	}
+
+	printf("%s: %d tokens\n", argv[0], tokens);
+
+	printf("cold (tokenize + write cache): %.3f ms\n", (ColdTime / runs));
+
+	printf("warm (mapped cache): %.3f ms\n", (WarmTime / runs));
+
+	return 0;
+}
@@ -0,0 +1,210 @@
+#include "stdafx.h"
+#include "DataTool.h"
+#include "BmdCook.h"
+#include "SharedCache.h"
+#include "TextureCache.h"
+#include "TextureQuality.h"
+
+static bool CheckTexture(char* path, TEXTURE_CACHE_ENTRY* lpEntry, CTextureDecoder* lpDecoder, CTextureBufferPool* lpPool)
+{
+	// What this client would hold without the shared cache, decoded here from the file
+	DWORD prefix = 0;
+
+	int type = CTextureDecoder::GetType(path, &prefix);
+
+	CMappedFile file;
+
+	TEXTURE_IMAGE image;
+
+	if (file.Open(path) == 0 || file.GetSize() <= prefix || lpDecoder->Decode((file.GetData() + prefix), (file.GetSize() - prefix), type, lpPool, &image) == 0)
+	{
+		return false;
+	}
+
+	CTextureQuality::Apply(lpEntry->Key.Quality, &image, lpPool);
+
+	bool result = (image.Width == lpEntry->Image.Width && image.Height == lpEntry->Image.Height && memcmp(image.Data, lpEntry->Image.Data, (image.Width * image.Height * 4)) == 0);
+
+	lpPool->Free(image.Data, image.Capacity);
+
+	return result;
+}
+
+static bool CheckModel(char* path, CBmdCookedModel* lpModel)
+{
+	CMappedFile file;
+
+	CBmdModel model;
+
+	if (file.Open(path) == 0 || model.Open(file.GetData(), file.GetSize()) == 0)
+	{
+		return false;
+	}
+
+	CCRC32 CRC32;
+
+	std::vector<BYTE> data;
+
+	BMD_COOK_INFO info;
+
+	memset(&info, 0, sizeof(info));
+
+	if (CBmdCook::Cook(&model, CRC32.FullCRC(file.GetData(), file.GetSize()), file.GetSize(), data, &info) == 0)
+	{
+		return false;
+	}
+
+	BMD_COOK_HEADER* lpHeader = (BMD_COOK_HEADER*)&data[0];
+
+	BMD_COOK_MESH* lpMeshList = (BMD_COOK_MESH*)(&data[0] + sizeof(BMD_COOK_HEADER));
+
+	if (lpHeader->MeshCount != lpModel->GetMeshCount())
+	{
+		return false;
+	}
+
+	for (DWORD n = 0; n < lpHeader->MeshCount; n++)
+	{
+		BMD_COOK_MESH* lpMesh = lpModel->GetMesh(n);
+
+		if (lpMesh->VertexCount != lpMeshList[n].VertexCount || lpMesh->IndexCount != lpMeshList[n].IndexCount)
+		{
+			return false;
+		}
+
+		if (memcmp(lpModel->GetVertex(lpMesh), &data[lpMeshList[n].VertexOffset], (lpMesh->VertexCount * sizeof(BMD_COOK_VERTEX))) != 0)
+		{
+			return false;
+		}
+
+		if (memcmp(lpModel->GetIndex(lpMesh), &data[lpMeshList[n].IndexOffset], (lpMesh->IndexCount * sizeof(WORD))) != 0)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int CommandSharedCache(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printf("Usage: DataTool sharedcache <directory> [hold seconds]\n");
+		return 1;
+	}
+
+	int hold = ((argc >= 2) ? atoi(argv[1]) : 0);
+
+	if (gSharedCache.Open(SHARED_CACHE_NAME) == 0)
+	{
+		printf("Could not open the shared cache\n");
+		return 1;
+	}
+
+	std::vector<std::string> list;
+
+	ScanFiles(argv[0], 0, list);
+
+	// Loads what a client entering the area would, run it again while this one holds to see what a second client gets
+	CTextureDecoder decoder;
+
+	std::vector<TEXTURE_CACHE_ENTRY*> texture;
+
+	std::vector<std::string> TexturePath;
+
+	std::vector<CBmdCookedModel*> model;
+
+	std::vector<std::string> ModelPath;
+
+	double start = GetTimeMs();
+
+	for (size_t n = 0; n < list.size(); n++)
+	{
+		char* path = (char*)list[n].c_str();
+
+		char* ext = strrchr(path, '.');
+
+		DWORD prefix = 0;
+
+		if (CTextureDecoder::GetType(path, &prefix) != TEXTURE_TYPE_NONE)
+		{
+			TEXTURE_CACHE_ENTRY* lpEntry = gTextureCache.Load(path, &decoder);
+
+			if (lpEntry != 0)
+			{
+				texture.push_back(lpEntry);
+
+				TexturePath.push_back(list[n]);
+			}
+		}
+		else if (ext != 0 && _stricmp(ext, ".bmd") == 0)
+		{
+			CBmdCookedModel* lpModel = new CBmdCookedModel;
+
+			if (lpModel->OpenShared(path) != 0)
+			{
+				model.push_back(lpModel);
+
+				ModelPath.push_back(list[n]);
+			}
+			else
+			{
+				delete lpModel;
+			}
+		}
+	}
+
+	double LoadTime = GetTimeMs() - start;
+
+	DWORD size = gSharedCache.GetPublishedSize() + gSharedCache.GetMappedSize();
+
+	printf("loaded %d textures and %d models in %.2f ms\n", texture.size(), model.size(), LoadTime);
+
+	printf("decoded here and published %5d (%9u bytes)\n", gSharedCache.GetPublishedCount(), gSharedCache.GetPublishedSize());
+
+	printf("mapped from the shared cache %5d (%9u bytes), %.1f%% of this client's decoded data\n", gSharedCache.GetMappedCount(), gSharedCache.GetMappedSize(), ((gSharedCache.GetMappedSize() * 100.0) / ((size == 0) ? 1 : size)));
+
+	printf("shared cache %d entries, %u bytes live across all clients\n", gSharedCache.GetEntryCount(), gSharedCache.GetLiveSize());
+
+	int mismatch = 0;
+
+	CTextureBufferPool pool;
+
+	for (size_t n = 0; n < texture.size(); n++)
+	{
+		mismatch += (CheckTexture((char*)TexturePath[n].c_str(), texture[n], &decoder, &pool) == 0);
+	}
+
+	for (size_t n = 0; n < model.size(); n++)
+	{
+		mismatch += (CheckModel((char*)ModelPath[n].c_str(), model[n]) == 0);
+	}
+
+	printf("mismatches %d\n", mismatch);
+
+	if (hold > 0)
+	{
+		printf("holding for %d seconds\n", hold);
+
+		fflush(stdout);
+
+		Sleep(hold * 1000);
+	}
+
+	for (size_t n = 0; n < texture.size(); n++)
+	{
+		gTextureCache.Release(texture[n]);
+	}
+
+	for (size_t n = 0; n < model.size(); n++)
+	{
+		delete model[n];
+	}
+
+	gTextureCache.Clear();
+
+	gSharedCache.Close();
+
+	return ((mismatch == 0) ? 0 : 1);
+}
@@ -0,0 +1,188 @@
+#include "stdafx.h"
+#include "DataTool.h"
+#include "BmdSkin.h"
+
+#define SKIN_POSE_PER_ACTION 4
+
+static void GetSkinResult(CBmdModel* lpModel, CBmdSkin* lpSkin, std::vector<BMD_VECTOR>& result)
+{
+	// Only real vertices are compared, the lane padding slots are never read back
+	result.clear();
+
+	for (DWORD n = 0; n < lpModel->GetMeshCount(); n++)
+	{
+		BMD_MESH* lpMesh = lpModel->GetMesh(n);
+
+		BMD_VECTOR value;
+
+		for (DWORD i = 0; i < lpMesh->Vertex.GetCount(); i++)
+		{
+			lpSkin->GetPosition(n, i, &value);
+
+			result.push_back(value);
+		}
+
+		for (DWORD i = 0; i < lpMesh->Normal.GetCount(); i++)
+		{
+			lpSkin->GetNormal(n, i, &value);
+
+			result.push_back(value);
+		}
+	}
+}
+
+static float GetSkinError(std::vector<BMD_VECTOR>& result, std::vector<BMD_VECTOR>& reference)
+{
+	float error = 0.0f;
+
+	for (DWORD n = 0; n < result.size(); n++)
+	{
+		float delta[3] = { fabs(result[n].X - reference[n].X), fabs(result[n].Y - reference[n].Y), fabs(result[n].Z - reference[n].Z) };
+
+		for (int i = 0; i < 3; i++)
+		{
+			error = ((delta[i] > error) ? delta[i] : error);
+		}
+	}
+
+	return error;
+}
+
+int CommandSkin(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printf("Usage: DataTool skin <file or directory> [runs] [skeleton]\n");
+		return 1;
+	}
+
+	int runs = ((argc >= 2) ? atoi(argv[1]) : 5);
+
+	if (runs <= 0)
+	{
+		runs = 1;
+	}
+
+	std::vector<std::string> list;
+
+	if ((GetFileAttributes(argv[0]) & FILE_ATTRIBUTE_DIRECTORY) == 0)
+	{
+		list.push_back(argv[0]);
+	}
+	else
+	{
+		ScanFiles(argv[0], ".bmd", list);
+	}
+
+	DWORD ModelCount = 0;
+
+	DWORD PoseCount = 0;
+
+	DWORD MismatchCount = 0;
+
+	QWORD VertexCount = 0;
+
+	double ScalarTime = 0;
+
+	double SimdTime = 0;
+
+	float MaxError = 0.0f;
+
+	CBmdModel model;
+
+	CBmdModel skeleton;
+
+	if (argc >= 3 && skeleton.Open(argv[2]) == 0)
+	{
+		printf("Could not open skeleton %s\n", argv[2]);
+		return 1;
+	}
+
+	CBmdSkin skin;
+
+	std::vector<BMD_VECTOR> reference;
+
+	std::vector<BMD_VECTOR> result;
+
+	for (size_t n = 0; n < list.size(); n++)
+	{
+		if (model.Open((char*)list[n].c_str()) == 0 || model.GetMeshCount() == 0)
+		{
+			continue;
+		}
+
+		CBmdModel* lpSkeleton = ((argc >= 3) ? &skeleton : &model);
+
+		if (lpSkeleton->GetBoneCount() == 0 || skin.Build(&model, lpSkeleton) == 0)
+		{
+			continue;
+		}
+
+		ModelCount++;
+
+		DWORD ElementCount = 0;
+
+		for (DWORD i = 0; i < model.GetMeshCount(); i++)
+		{
+			ElementCount += model.GetMesh(i)->Vertex.GetCount() + model.GetMesh(i)->Normal.GetCount();
+		}
+
+		for (DWORD action = 0; action < lpSkeleton->GetActionCount(); action++)
+		{
+			DWORD KeyCount = lpSkeleton->GetAction(action)->KeyCount;
+
+			for (DWORD pose = 0; pose < SKIN_POSE_PER_ACTION; pose++)
+			{
+				if (skin.SetPose(action, ((float)(KeyCount * pose) / SKIN_POSE_PER_ACTION) + 0.37f) == 0)
+				{
+					break;
+				}
+
+				double start = GetTimeMs();
+
+				for (int i = 0; i < runs; i++)
+				{
+					skin.SkinScalar();
+				}
+
+				ScalarTime += GetTimeMs() - start;
+
+				GetSkinResult(&model, &skin, reference);
+
+				start = GetTimeMs();
+
+				for (int i = 0; i < runs; i++)
+				{
+					skin.Skin();
+				}
+
+				SimdTime += GetTimeMs() - start;
+
+				GetSkinResult(&model, &skin, result);
+
+				float error = GetSkinError(result, reference);
+
+				if (error > 0.01f)
+				{
+					MismatchCount++;
+
+					printf("mismatch: %s action %d pose %d error %f\n", list[n].c_str(), action, pose, error);
+				}
+
+				MaxError = ((error > MaxError) ? error : MaxError);
+
+				PoseCount++;
+
+				VertexCount += (QWORD)ElementCount * runs;
+			}
+		}
+	}
+
+	printf("models: %d, poses: %d, mismatches: %d, max error: %g\n", ModelCount, PoseCount, MismatchCount, MaxError);
+
+	printf("scalar: %.2f ms (%.1f M vertices/s)\n", ScalarTime, ((VertexCount / 1000000.0) / (ScalarTime / 1000.0)));
+
+	printf("simd: %.2f ms (%.1f M vertices/s, %.2fx)\n", SimdTime, ((VertexCount / 1000000.0) / (SimdTime / 1000.0)), (ScalarTime / SimdTime));
+
+	return ((MismatchCount == 0) ? 0 : 1);
+}
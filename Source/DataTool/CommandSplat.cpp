@@ -0,0 +1,377 @@
+#include "stdafx.h"
+#include "DataTool.h"
+#include "TerrainCull.h"
+#include "TerrainSplat.h"
+
+#define SPLAT_STATE_PER_WORLD 32
+#define SPLAT_ASPECT (4.0f / 3.0f)
+
+struct SPLAT_WORLD
+{
+	int World;
+	bool Result;
+	double Time;
+	TERRAIN_SPLAT_INFO Info;
+};
+
+struct SPLAT_BAKE_STATE
+{
+	char* Directory;
+	int Density;
+	std::vector<SPLAT_WORLD>* List;
+	volatile LONG Next;
+	CTextureBufferPool Pool;
+};
+
+struct SPLAT_FRAME
+{
+	double Tile;
+	double DrawCall;
+	double TextureSwitch;
+	double BlendSwitch;
+};
+
+static DWORD WINAPI BakeSplatThread(LPVOID lpParam)
+{
+	SPLAT_BAKE_STATE* lpState = (SPLAT_BAKE_STATE*)lpParam;
+
+	CTextureDecoder decoder;
+
+	LONG index;
+
+	while ((index = InterlockedIncrement(&lpState->Next) - 1) < (LONG)lpState->List->size())
+	{
+		SPLAT_WORLD* lpWorld = &(*lpState->List)[index];
+
+		char directory[MAX_PATH];
+
+		wsprintf(directory, "%s\\World%d", lpState->Directory, lpWorld->World);
+
+		double start = GetTimeMs();
+
+		lpWorld->Result = CTerrainSplat::Bake(directory, lpWorld->World, lpState->Density, &decoder, &lpState->Pool, &lpWorld->Info);
+
+		lpWorld->Time = GetTimeMs() - start;
+	}
+
+	return 0;
+}
+
+static void CountFrame(CTerrainCull* lpCull, TERRAIN_DATA* lpData, SPLAT_FRAME* lpLayer, SPLAT_FRAME* lpSplat)
+{
+	// Layer path: the client binds and draws layer1 per cell, then a blended layer2 pass wherever a corner has alpha
+	BYTE* layer1 = &lpData->Chunk[TERRAIN_CHUNK_LAYER1][0];
+
+	BYTE* layer2 = &lpData->Chunk[TERRAIN_CHUNK_LAYER2][0];
+
+	BYTE* alpha = &lpData->Chunk[TERRAIN_CHUNK_ALPHA][0];
+
+	int texture = -1;
+
+	bool blend = 0;
+
+	std::vector<BYTE> chunk(TERRAIN_SPLAT_CHUNK_COUNT, 0);
+
+	for (DWORD n = 0; n < lpCull->GetVisibleCount(); n++)
+	{
+		int BlockX = (lpCull->GetVisible()[n] % TERRAIN_CULL_BLOCK_COUNT) * TERRAIN_CULL_BLOCK;
+
+		int BlockY = (lpCull->GetVisible()[n] / TERRAIN_CULL_BLOCK_COUNT) * TERRAIN_CULL_BLOCK;
+
+		chunk[CTerrainSplat::GetChunkIndex(BlockX, BlockY)] = 1;
+
+		// Splat path: one draw per block from its chunk texture, water cells keep their own scrolling pass on top
+		lpSplat->DrawCall++;
+
+		for (int y = BlockY; y < (BlockY + TERRAIN_CULL_BLOCK); y++)
+		{
+			for (int x = BlockX; x < (BlockX + TERRAIN_CULL_BLOCK); x++)
+			{
+				int cell = (y * TERRAIN_SIZE) + x;
+
+				int x1 = (x + 1) & (TERRAIN_SIZE - 1);
+
+				int y1 = (y + 1) & (TERRAIN_SIZE - 1);
+
+				int a[4] = { alpha[cell], alpha[(y * TERRAIN_SIZE) + x1], alpha[(y1 * TERRAIN_SIZE) + x1], alpha[(y1 * TERRAIN_SIZE) + x] };
+
+				bool pass = (layer2[cell] != TERRAIN_SPLAT_TILE_NONE && (a[0] + a[1] + a[2] + a[3]) > 0);
+
+				bool opaque = (pass != 0 && (a[0] & a[1] & a[2] & a[3]) == 0xFF);
+
+				lpLayer->Tile++;
+
+				lpSplat->Tile++;
+
+				if (opaque == 0)
+				{
+					lpLayer->TextureSwitch += (texture != layer1[cell]);
+					lpLayer->BlendSwitch += (blend != 0);
+					lpLayer->DrawCall++;
+					texture = layer1[cell];
+					blend = 0;
+				}
+
+				if (pass != 0)
+				{
+					lpLayer->TextureSwitch += (texture != layer2[cell]);
+					lpLayer->BlendSwitch += (blend != (opaque == 0));
+					lpLayer->DrawCall++;
+					texture = layer2[cell];
+					blend = (opaque == 0);
+				}
+
+				if (layer1[cell] == TERRAIN_SPLAT_TILE_WATER || (pass != 0 && layer2[cell] == TERRAIN_SPLAT_TILE_WATER))
+				{
+					lpSplat->DrawCall++;
+				}
+			}
+		}
+	}
+
+	// Blocks are drawn grouped by chunk, so every chunk on screen costs one bind
+	for (int n = 0; n < TERRAIN_SPLAT_CHUNK_COUNT; n++)
+	{
+		lpSplat->TextureSwitch += chunk[n];
+	}
+}
+
+static void CountWater(CTerrainCull* lpCull, TERRAIN_DATA* lpData, SPLAT_FRAME* lpSplat)
+{
+	// Water cells go last in one group: a bind and the blend change around it when any are visible
+	BYTE* layer1 = &lpData->Chunk[TERRAIN_CHUNK_LAYER1][0];
+
+	BYTE* layer2 = &lpData->Chunk[TERRAIN_CHUNK_LAYER2][0];
+
+	for (DWORD n = 0; n < lpCull->GetVisibleCount(); n++)
+	{
+		int BlockX = (lpCull->GetVisible()[n] % TERRAIN_CULL_BLOCK_COUNT) * TERRAIN_CULL_BLOCK;
+
+		int BlockY = (lpCull->GetVisible()[n] / TERRAIN_CULL_BLOCK_COUNT) * TERRAIN_CULL_BLOCK;
+
+		for (int y = BlockY; y < (BlockY + TERRAIN_CULL_BLOCK); y++)
+		{
+			for (int x = BlockX; x < (BlockX + TERRAIN_CULL_BLOCK); x++)
+			{
+				int cell = (y * TERRAIN_SIZE) + x;
+
+				if (layer1[cell] == TERRAIN_SPLAT_TILE_WATER || layer2[cell] == TERRAIN_SPLAT_TILE_WATER)
+				{
+					lpSplat->TextureSwitch++;
+					lpSplat->BlendSwitch += 2;
+					return;
+				}
+			}
+		}
+	}
+}
+
+static void PrintFrame(char* name, DWORD count, SPLAT_FRAME* lpLayer, SPLAT_FRAME* lpSplat)
+{
+	double frame = ((count > 0) ? count : 1);
+
+	printf("%-8s %3d frames  tiles %6.0f  draw calls %6.0f -> %5.0f (%5.1fx)  texture binds %6.0f -> %4.0f  blend changes %6.0f -> %2.0f\n", name, count, (lpLayer->Tile / frame), (lpLayer->DrawCall / frame), (lpSplat->DrawCall / frame), ((lpSplat->DrawCall > 0) ? (lpLayer->DrawCall / lpSplat->DrawCall) : 0.0), (lpLayer->TextureSwitch / frame), (lpSplat->TextureSwitch / frame), (lpLayer->BlendSwitch / frame), (lpSplat->BlendSwitch / frame));
+}
+
+int CommandSplat(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printf("Usage: DataTool splat <directory> [density] [threads]\n");
+		return 1;
+	}
+
+	int density = ((argc >= 2) ? atoi(argv[1]) : TERRAIN_SPLAT_DEFAULT_DENSITY);
+
+	if (CTerrainSplat::IsValidDensity(density) == 0)
+	{
+		printf("density must be a power of two from %d to %d texels per tile\n", TERRAIN_SPLAT_MIN_DENSITY, TERRAIN_SPLAT_SOURCE_DENSITY);
+		return 1;
+	}
+
+	int ThreadCount = ((argc >= 3) ? atoi(argv[2]) : 0);
+
+	if (ThreadCount <= 0)
+	{
+		SYSTEM_INFO info;
+
+		GetSystemInfo(&info);
+
+		ThreadCount = info.dwNumberOfProcessors;
+	}
+
+	std::vector<SPLAT_WORLD> list;
+
+	for (int world = 1; world < TERRAIN_MAX_WORLD; world++)
+	{
+		char directory[MAX_PATH];
+
+		wsprintf(directory, "%s\\World%d", argv[0], world);
+
+		char path[MAX_PATH];
+
+		CTerrainPackage::GetSourcePath(directory, world, TERRAIN_SOURCE_MAP, path);
+
+		if (GetFileAttributes(path) == INVALID_FILE_ATTRIBUTES)
+		{
+			continue;
+		}
+
+		SPLAT_WORLD item;
+
+		memset(&item, 0, sizeof(item));
+
+		item.World = world;
+
+		list.push_back(item);
+	}
+
+	SPLAT_BAKE_STATE state;
+
+	state.Directory = argv[0];
+
+	state.Density = density;
+
+	state.List = &list;
+
+	state.Next = 0;
+
+	std::vector<HANDLE> thread(ThreadCount);
+
+	double start = GetTimeMs();
+
+	for (int n = 0; n < ThreadCount; n++)
+	{
+		thread[n] = CreateThread(0, 0, BakeSplatThread, &state, 0, 0);
+	}
+
+	for (int n = 0; n < ThreadCount; n++)
+	{
+		WaitForSingleObject(thread[n], INFINITE);
+
+		CloseHandle(thread[n]);
+	}
+
+	double time = GetTimeMs() - start;
+
+	int ErrorCount = 0;
+
+	QWORD FileSize = 0;
+
+	BC_ERROR error;
+
+	memset(&error, 0, sizeof(error));
+
+	CTextureDecoder decoder;
+
+	TERRAIN_DATA terrain;
+
+	CTerrainCull cull;
+
+	SPLAT_FRAME total[2];
+
+	memset(total, 0, sizeof(total));
+
+	DWORD FrameCount = 0;
+
+	for (size_t n = 0; n < list.size(); n++)
+	{
+		SPLAT_WORLD* lpWorld = &list[n];
+
+		char name[32];
+
+		wsprintf(name, "World%d", lpWorld->World);
+
+		if (lpWorld->Result == 0)
+		{
+			printf("%-8s bake failed\n", name);
+			ErrorCount++;
+			continue;
+		}
+
+		FileSize += lpWorld->Info.FileSize;
+
+		error.Color += lpWorld->Info.Error.Color;
+
+		error.PixelCount += lpWorld->Info.Error.PixelCount;
+
+		printf("%-8s %2d tile textures  %7.2f MB  %6.1f ms  PSNR %.2f dB  water cells %5d  missing texture cells %5d\n", name, lpWorld->Info.TileCount, (lpWorld->Info.FileSize / 1048576.0), lpWorld->Time, CBcEncoder::GetPsnr(lpWorld->Info.Error.Color, (lpWorld->Info.Error.PixelCount * 3)), lpWorld->Info.WaterCount, lpWorld->Info.MissingCount);
+
+		char directory[MAX_PATH];
+
+		wsprintf(directory, "%s\\World%d", argv[0], lpWorld->World);
+
+		if (CTerrainPackage::LoadSource(directory, lpWorld->World, &decoder, &state.Pool, &terrain) == 0)
+		{
+			continue;
+		}
+
+		cull.Build(&terrain.Chunk[TERRAIN_CHUNK_HEIGHT][0]);
+
+		SPLAT_FRAME frame[2];
+
+		memset(frame, 0, sizeof(frame));
+
+		// The stock camera over walkable cells, culled the same way for both paths so only the batching differs
+		srand(lpWorld->World);
+
+		for (int i = 0; i < SPLAT_STATE_PER_WORLD; i++)
+		{
+			int x = 0;
+
+			int y = 0;
+
+			for (int r = 0; r < 1000; r++)
+			{
+				x = 16 + ((rand() & 0x7FFF) % (TERRAIN_SIZE - 32));
+
+				y = 16 + ((rand() & 0x7FFF) % (TERRAIN_SIZE - 32));
+
+				if ((terrain.Chunk[TERRAIN_CHUNK_ATTRIBUTE][(y * TERRAIN_SIZE) + x] & 0x0C) == 0)
+				{
+					break;
+				}
+			}
+
+			CAMERA_INFO camera;
+
+			memset(&camera, 0, sizeof(camera));
+
+			camera.Zoom = 35.0f;
+
+			camera.RotX = -45.0f;
+
+			camera.RotY = 48.5f;
+
+			camera.PosZ = 150.0f;
+
+			camera.ClipGL = 2000.0f;
+
+			cull.SetCamera(&camera, ((x + 0.5f) * TERRAIN_CULL_SCALE), ((y + 0.5f) * TERRAIN_CULL_SCALE), SPLAT_ASPECT);
+
+			cull.Cull(1);
+
+			CountFrame(&cull, &terrain, &frame[0], &frame[1]);
+
+			CountWater(&cull, &terrain, &frame[1]);
+		}
+
+		for (int i = 0; i < 2; i++)
+		{
+			total[i].Tile += frame[i].Tile;
+			total[i].DrawCall += frame[i].DrawCall;
+			total[i].TextureSwitch += frame[i].TextureSwitch;
+			total[i].BlendSwitch += frame[i].BlendSwitch;
+		}
+
+		FrameCount += SPLAT_STATE_PER_WORLD;
+
+		PrintFrame(name, SPLAT_STATE_PER_WORLD, &frame[0], &frame[1]);
+	}
+
+	printf("baked: %d worlds, %d failed, density %d texels per tile (%dx%d per chunk), %.2f MB, PSNR %.2f dB, %.1f ms on %d threads\n", (list.size() - ErrorCount), ErrorCount, density, (TERRAIN_SPLAT_CHUNK_TILES * density), (TERRAIN_SPLAT_CHUNK_TILES * density), (FileSize / 1048576.0), CBcEncoder::GetPsnr(error.Color, (error.PixelCount * 3)), time, ThreadCount);
+
+	PrintFrame("total", FrameCount, &total[0], &total[1]);
+
+	return ((ErrorCount == 0) ? 0 : 1);
+}
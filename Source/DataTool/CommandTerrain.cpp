@@ -0,0 +1,133 @@
+#include "stdafx.h"
+#include "DataTool.h"
+#include "TerrainPackage.h"
+
+static DWORD TouchPackage(CTerrainPackage* lpPackage)
+{
+	// Reads one byte per page so the mapped pages are actually brought in like the game would on first use
+	DWORD sum = 0;
+
+	for (int n = 0; n < TERRAIN_CHUNK_MAX; n++)
+	{
+		BYTE* data = lpPackage->GetChunk(n);
+
+		for (DWORD i = 0; i < lpPackage->GetChunkSize(n); i += 4096)
+		{
+			sum += data[i];
+		}
+	}
+
+	return sum;
+}
+
+int CommandTerrain(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printf("Usage: DataTool terrain <directory> [runs]\n");
+		return 1;
+	}
+
+	int runs = ((argc >= 2) ? atoi(argv[1]) : 10);
+
+	if (runs <= 0)
+	{
+		runs = 1;
+	}
+
+	CTextureDecoder decoder;
+
+	CTextureBufferPool pool;
+
+	CTerrainPackage package;
+
+	TERRAIN_DATA source;
+
+	int WorldCount = 0;
+
+	int ErrorCount = 0;
+
+	double SourceTime = 0;
+
+	double PackageTime = 0;
+
+	double CookTime = 0;
+
+	DWORD sum = 0;
+
+	for (int world = 1; world < TERRAIN_MAX_WORLD; world++)
+	{
+		char directory[MAX_PATH];
+
+		wsprintf(directory, "%s\\World%d", argv[0], world);
+
+		if (GetFileAttributes(directory) == INVALID_FILE_ATTRIBUTES)
+		{
+			continue;
+		}
+
+		double start = GetTimeMs();
+
+		if (CTerrainPackage::Cook(directory, world, &decoder, &pool) == 0)
+		{
+			printf("World%d: cook failed\n", world);
+			ErrorCount++;
+			continue;
+		}
+
+		CookTime += GetTimeMs() - start;
+
+		start = GetTimeMs();
+
+		for (int n = 0; n < runs; n++)
+		{
+			CTerrainPackage::LoadSource(directory, world, &decoder, &pool, &source);
+		}
+
+		double WorldSourceTime = (GetTimeMs() - start) / runs;
+
+		start = GetTimeMs();
+
+		for (int n = 0; n < runs; n++)
+		{
+			if (package.Open(directory, world) != 0)
+			{
+				sum += TouchPackage(&package);
+			}
+		}
+
+		double WorldPackageTime = (GetTimeMs() - start) / runs;
+
+		if (package.Open(directory, world) == 0)
+		{
+			printf("World%d: open failed\n", world);
+			ErrorCount++;
+			continue;
+		}
+
+		for (int n = 0; n < TERRAIN_CHUNK_MAX; n++)
+		{
+			if (package.GetChunkSize(n) != source.Chunk[n].size() || (source.Chunk[n].empty() == 0 && memcmp(package.GetChunk(n), &source.Chunk[n][0], source.Chunk[n].size()) != 0))
+			{
+				printf("World%d: chunk %d mismatch\n", world, n);
+				ErrorCount++;
+			}
+		}
+
+		printf("World%-3d separate %7.3f ms  package %7.3f ms  %6.1fx  (%d bytes%s%s)\n", world, WorldSourceTime, WorldPackageTime, (WorldSourceTime / WorldPackageTime), package.GetFileSize(), ((package.GetChunk(TERRAIN_CHUNK_LAYER1) == 0) ? ", no map" : ""), ((package.GetChunk(TERRAIN_CHUNK_LIGHT) == 0) ? ", no light" : ""));
+
+		package.Close();
+
+		SourceTime += WorldSourceTime;
+
+		PackageTime += WorldPackageTime;
+
+		WorldCount++;
+	}
+
+	printf("worlds: %d, errors: %d, cook %.2f ms (checksum %08X)\n", WorldCount, ErrorCount, CookTime, sum);
+
+	printf("map change total: separate %.3f ms, package %.3f ms (%.1fx)\n", SourceTime, PackageTime, ((PackageTime > 0) ? (SourceTime / PackageTime) : 0.0));
+
+	return ((ErrorCount == 0) ? 0 : 1);
+}
@@ -0,0 +1,281 @@
+#include "stdafx.h"
+#include "DataTool.h"
+#include "FileCrypt.h"
+#include "StringTable.h"
+
+#define TEXT_SESSION_TEXT 250
+#define TEXT_SESSION_DIALOG 10
+
+static bool FullDecode(char* path, int RecordSize, std::vector<BYTE>& data)
+{
+	// What the client does at startup: read the whole table into fixed-width slots and decode every record
+	HANDLE file = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	DWORD size = GetFileSize(file, 0);
+
+	data.resize(size);
+
+	DWORD OutSize = 0;
+
+	bool result = (size != 0 && (size % RecordSize) == 0 && ReadFile(file, &data[0], size, &OutSize, 0) != 0 && OutSize == size);
+
+	CloseHandle(file);
+
+	if (result != 0)
+	{
+		for (DWORD n = 0; n < size; n += RecordSize)
+		{
+			BuxConvert(&data[n], RecordSize);
+		}
+	}
+
+	return result;
+}
+
+static bool SameField(char* text, BYTE* field, int size)
+{
+	int length = 0;
+
+	while (length < size && field[length] != 0)
+	{
+		length++;
+	}
+
+	return ((int)strlen(text) == length && memcmp(text, field, length) == 0);
+}
+
+static int CheckLanguage(CLocalText* lpText, std::vector<BYTE>& text, std::vector<BYTE>& dialog)
+{
+	// Every field of every record against the full decode, this also leaves the whole table decoded
+	int ErrorCount = 0;
+
+	for (int n = 0; n < (int)(text.size() / TEXT_RECORD_SIZE); n++)
+	{
+		ErrorCount += (SameField(lpText->GetText(n), &text[n * TEXT_RECORD_SIZE], TEXT_RECORD_SIZE) == 0);
+	}
+
+	for (int n = 0; n < (int)(dialog.size() / DIALOG_RECORD_SIZE); n++)
+	{
+		BYTE* record = &dialog[n * DIALOG_RECORD_SIZE];
+
+		ErrorCount += (SameField(lpText->GetDialog(n), record, DIALOG_TEXT_SIZE) == 0);
+
+		ErrorCount += (lpText->GetAnswerCount(n) != *(int*)&record[DIALOG_ANSWER_COUNT_OFFSET]);
+
+		for (int i = 0; i < DIALOG_MAX_ANSWER; i++)
+		{
+			ErrorCount += (SameField(lpText->GetAnswer(n, i), &record[DIALOG_ANSWER_OFFSET + (i * DIALOG_ANSWER_SIZE)], DIALOG_ANSWER_SIZE) == 0);
+
+			ErrorCount += (lpText->GetAnswerLink(n, i) != *(int*)&record[DIALOG_ANSWER_LINK_OFFSET + (i * sizeof(int))]);
+
+			ErrorCount += (lpText->GetAnswerReturn(n, i) != *(int*)&record[DIALOG_ANSWER_RETURN_OFFSET + (i * sizeof(int))]);
+		}
+	}
+
+	return ErrorCount;
+}
+
+static DWORD RunSession(CLocalText* lpText)
+{
+	// A play session: the interface strings in use plus a few NPC talks, the rest of the table is never shown
+	DWORD sum = 0;
+
+	srand(1);
+
+	for (int n = 0; n < TEXT_SESSION_TEXT; n++)
+	{
+		sum += strlen(lpText->GetText((rand() & 0x7FFF) % 1000));
+	}
+
+	for (int n = 0; n < TEXT_SESSION_DIALOG; n++)
+	{
+		int index = n * 4;
+
+		sum += strlen(lpText->GetDialog(index));
+
+		for (int i = 0; i < lpText->GetAnswerCount(index) && i < DIALOG_MAX_ANSWER; i++)
+		{
+			sum += strlen(lpText->GetAnswer(index, i));
+		}
+	}
+
+	return sum;
+}
+
+int CommandText(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printf("Usage: DataTool text <directory> [runs]\n");
+		return 1;
+	}
+
+	int runs = ((argc >= 2) ? atoi(argv[1]) : 50);
+
+	if (runs <= 0)
+	{
+		runs = 1;
+	}
+
+	char directory[MAX_PATH];
+
+	if (_snprintf_s(directory, sizeof(directory), _TRUNCATE, "%s\\Local", argv[0]) < 0)
+	{
+		printf("path too long: %s\n", argv[0]);
+		return 1;
+	}
+
+	int ErrorCount = 0;
+
+	int LanguageCount = 0;
+
+	DWORD sum = 0;
+
+	for (int language = 0; language < LOCAL_TEXT_MAX_LANGUAGE; language++)
+	{
+		char* suffix = CLocalText::GetLanguageSuffix(language);
+
+		char* name = ((suffix[0] == 0) ? suffix : &suffix[1]);
+
+		char TextPath[MAX_PATH];
+
+		char DialogPath[MAX_PATH];
+
+		if (_snprintf_s(TextPath, sizeof(TextPath), _TRUNCATE, "%s\\Text%s.bmd", directory, suffix) < 0 || _snprintf_s(DialogPath, sizeof(DialogPath), _TRUNCATE, "%s\\Dialog%s.bmd", directory, suffix) < 0)
+		{
+			continue;
+		}
+
+		std::vector<BYTE> text;
+
+		std::vector<BYTE> dialog;
+
+		double start = GetTimeMs();
+
+		for (int n = 0; n < runs; n++)
+		{
+			if (FullDecode(TextPath, TEXT_RECORD_SIZE, text) == 0 || FullDecode(DialogPath, DIALOG_RECORD_SIZE, dialog) == 0)
+			{
+				text.clear();
+				break;
+			}
+		}
+
+		if (text.empty() != 0)
+		{
+			continue;
+		}
+
+		double FullTime = (GetTimeMs() - start) / runs;
+
+		double OpenTime = 0;
+
+		double SessionTime = 0;
+
+		double HitTime = 0;
+
+		DWORD OpenMemory = 0;
+
+		DWORD SessionMemory = 0;
+
+		DWORD SessionCount = 0;
+
+		for (int n = 0; n < runs; n++)
+		{
+			CLocalText local;
+
+			start = GetTimeMs();
+
+			local.SetLanguage(directory, name);
+
+			OpenTime += GetTimeMs() - start;
+
+			OpenMemory = local.GetMemorySize();
+
+			start = GetTimeMs();
+
+			sum += RunSession(&local);
+
+			SessionTime += GetTimeMs() - start;
+
+			start = GetTimeMs();
+
+			sum += RunSession(&local);
+
+			HitTime += GetTimeMs() - start;
+
+			SessionMemory = local.GetMemorySize();
+
+			SessionCount = local.GetTextTable()->GetDecodedCount() + local.GetDialogTable()->GetDecodedCount();
+		}
+
+		CLocalText local;
+
+		local.SetLanguage(directory, name);
+
+		int error = CheckLanguage(&local, text, dialog);
+
+		printf("%-4s full decode %6.3f ms, %6d bytes  lazy open %6.3f ms, %5d bytes  session %4d fields: first %6.3f ms, again %6.3f ms, %6d bytes  everything decoded: %6d bytes  mismatches %d\n", ((name[0] == 0) ? "Base" : name), FullTime, (text.size() + dialog.size()), (OpenTime / runs), OpenMemory, SessionCount, (SessionTime / runs), (HitTime / runs), SessionMemory, local.GetMemorySize(), error);
+
+		ErrorCount += error;
+
+		LanguageCount++;
+	}
+
+	if (LanguageCount == 0)
+	{
+		printf("no Text.bmd and Dialog.bmd found in %s\n", directory);
+		return 1;
+	}
+
+	// Runtime switching: every language is opened once, then the game flips between them after strings were shown
+	CLocalText local;
+
+	double first = 0;
+
+	double again = 0;
+
+	for (int language = 0; language < LOCAL_TEXT_MAX_LANGUAGE; language++)
+	{
+		char* suffix = CLocalText::GetLanguageSuffix(language);
+
+		double start = GetTimeMs();
+
+		if (local.SetLanguage(directory, ((suffix[0] == 0) ? suffix : &suffix[1])) == 0)
+		{
+			continue;
+		}
+
+		first += GetTimeMs() - start;
+
+		sum += RunSession(&local);
+	}
+
+	for (int n = 0; n < runs; n++)
+	{
+		for (int language = 0; language < LOCAL_TEXT_MAX_LANGUAGE; language++)
+		{
+			char* suffix = CLocalText::GetLanguageSuffix(language);
+
+			double start = GetTimeMs();
+
+			if (local.SetLanguage(directory, ((suffix[0] == 0) ? suffix : &suffix[1])) == 0)
+			{
+				continue;
+			}
+
+			sum += RunSession(&local);
+
+			again += GetTimeMs() - start;
+		}
+	}
+
+	printf("language switch: first open of all %d languages %.3f ms, switch back plus session %.3f ms each, %d bytes resident for all of them (checksum %u)\n", LanguageCount, first, (again / (runs * LanguageCount)), local.GetMemorySize(), sum);
+
+	return ((ErrorCount == 0) ? 0 : 1);
+}
@@ -0,0 +1,127 @@
+#include "stdafx.h"
+#include "DataTool.h"
+#include "TextureDecodePool.h"
+
+static bool DecodeAll(std::vector<std::string>& list, int ThreadCount, double* time, QWORD* PixelCount)
+{
+	CTextureDecodePool pool;
+
+	double start = GetTimeMs();
+
+	if (pool.Start(ThreadCount) == 0)
+	{
+		return false;
+	}
+
+	for (size_t n = 0; n < list.size(); n++)
+	{
+		pool.AddJob((char*)list[n].c_str(), (DWORD)n);
+	}
+
+	DWORD FailCount = 0;
+
+	*PixelCount = 0;
+
+	TEXTURE_DECODE_RESULT result;
+
+	for (size_t n = 0; n < list.size(); n++)
+	{
+		if (pool.WaitResult(&result, INFINITE) == 0)
+		{
+			return false;
+		}
+
+		if (result.Success == 0)
+		{
+			FailCount++;
+
+			printf("decode failed: %s\n", result.Path);
+		}
+		else
+		{
+			*PixelCount += (QWORD)result.Image.Width * result.Image.Height;
+		}
+
+		pool.FreeResult(&result);
+	}
+
+	*time = GetTimeMs() - start;
+
+	pool.Stop();
+
+	return (FailCount == 0);
+}
+
+int CommandTexture(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printf("Usage: DataTool texdecode <directory> [threads]\n");
+		return 1;
+	}
+
+	int ThreadCount = ((argc >= 2) ? atoi(argv[1]) : 0);
+
+	if (ThreadCount <= 0)
+	{
+		SYSTEM_INFO info;
+
+		GetSystemInfo(&info);
+
+		ThreadCount = info.dwNumberOfProcessors;
+	}
+
+	ThreadCount = ((ThreadCount > TEXTURE_DECODE_MAX_THREAD) ? TEXTURE_DECODE_MAX_THREAD : ThreadCount);
+
+	std::vector<std::string> list;
+
+	ScanFiles(argv[0], ".ozj", list);
+
+	ScanFiles(argv[0], ".ozt", list);
+
+	if (list.empty() != 0)
+	{
+		printf("no textures found in %s\n", argv[0]);
+		return 1;
+	}
+
+	QWORD FileSize = 0;
+
+	for (size_t n = 0; n < list.size(); n++)
+	{
+		WIN32_FILE_ATTRIBUTE_DATA data;
+
+		if (GetFileAttributesEx(list[n].c_str(), GetFileExInfoStandard, &data) != 0)
+		{
+			FileSize += data.nFileSizeLow;
+		}
+	}
+
+	double time = 0;
+
+	QWORD PixelCount = 0;
+
+	// Warm pass so the file cache does not favour the later thread counts
+	if (DecodeAll(list, 1, &time, &PixelCount) == 0)
+	{
+		return 1;
+	}
+
+	printf("textures: %d, %.2f MB on disk, %.2f M pixels\n", (int)list.size(), (FileSize / 1048576.0), (PixelCount / 1000000.0));
+
+	double BaseTime = 0;
+
+	for (int n = 1; n <= ThreadCount; n++)
+	{
+		if (DecodeAll(list, n, &time, &PixelCount) == 0)
+		{
+			return 1;
+		}
+
+		BaseTime = ((n == 1) ? time : BaseTime);
+
+		printf("threads %2d: %8.2f ms, %7.1f MB/s, %7.1f M pixels/s, %.2fx\n", n, time, ((FileSize / 1048576.0) / (time / 1000.0)), ((PixelCount / 1000000.0) / (time / 1000.0)), (BaseTime / time));
+	}
+
+	return 0;
+}
@@ -0,0 +1,234 @@
+#include "stdafx.h"
+#include "DataTool.h"
+#include "TextureDecoder.h"
+#include "TextureFilter.h"
+
+struct TEXTURE_FILTER_FILE
+{
+	int Width;
+	int Height;
+	bool Cutout;
+	std::vector<BYTE> Data;
+};
+
+static int CompareChain(std::vector<TEXTURE_MIP_LEVEL>& a, std::vector<TEXTURE_MIP_LEVEL>& b)
+{
+	if (a.size() != b.size())
+	{
+		return 256;
+	}
+
+	int delta = 0;
+
+	for (size_t n = 0; n < a.size(); n++)
+	{
+		for (size_t i = 0; i < a[n].Data.size(); i++)
+		{
+			int d = abs((int)a[n].Data[i] - (int)b[n].Data[i]);
+
+			delta = ((d > delta) ? d : delta);
+		}
+	}
+
+	return delta;
+}
+
+static double GetCoverageDrift(std::vector<TEXTURE_MIP_LEVEL>& chain, float reference)
+{
+	// Mean coverage change against the top level over the mips that still have at least 4x4 texels
+	double target = CTextureFilter::GetCoverage(&chain[0].Data[0], (chain[0].Width * chain[0].Height), reference);
+
+	double drift = 0.0;
+
+	int count = 0;
+
+	for (size_t n = 1; n < chain.size(); n++)
+	{
+		if (chain[n].Width < 4 || chain[n].Height < 4)
+		{
+			break;
+		}
+
+		drift += fabs(CTextureFilter::GetCoverage(&chain[n].Data[0], (chain[n].Width * chain[n].Height), reference) - target);
+
+		count++;
+	}
+
+	return ((count > 0) ? (drift / count) : 0.0);
+}
+
+static double BuildCorpus(std::vector<TEXTURE_FILTER_FILE>& corpus, TEXTURE_FILTER_OPTION* lpOption, int runs, QWORD* PixelCount)
+{
+	std::vector<TEXTURE_MIP_LEVEL> chain;
+
+	*PixelCount = 0;
+
+	double start = GetTimeMs();
+
+	for (int i = 0; i < runs; i++)
+	{
+		for (size_t n = 0; n < corpus.size(); n++)
+		{
+			CTextureFilter::BuildMipChain(&corpus[n].Data[0], corpus[n].Width, corpus[n].Height, lpOption, chain);
+
+			*PixelCount += corpus[n].Width * corpus[n].Height;
+		}
+	}
+
+	return GetTimeMs() - start;
+}
+
+int CommandTextureFilter(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printf("Usage: DataTool texfilter <directory> [runs]\n");
+		return 1;
+	}
+
+	int runs = ((argc >= 2) ? atoi(argv[1]) : 3);
+
+	if (runs <= 0)
+	{
+		runs = 1;
+	}
+
+	std::vector<std::string> list;
+
+	ScanFiles(argv[0], ".ozt", list);
+
+	std::vector<TEXTURE_FILTER_FILE> corpus;
+
+	CTextureDecoder decoder;
+
+	CTextureBufferPool pool;
+
+	DWORD CutoutCount = 0;
+
+	for (size_t n = 0; n < list.size(); n++)
+	{
+		TEXTURE_IMAGE image;
+
+		if (decoder.Decode((char*)list[n].c_str(), &pool, &image) == 0)
+		{
+			printf("decode failed: %s\n", list[n].c_str());
+			continue;
+		}
+
+		TEXTURE_FILTER_FILE entry;
+
+		entry.Width = image.Width;
+
+		entry.Height = image.Height;
+
+		entry.Cutout = CTextureFilter::IsCutout(image.Data, (image.Width * image.Height));
+
+		entry.Data.assign(image.Data, image.Data + (image.Width * image.Height * 4));
+
+		CutoutCount += ((entry.Cutout != 0) ? 1 : 0);
+
+		corpus.push_back(entry);
+
+		pool.Free(image.Data, image.Capacity);
+	}
+
+	printf("textures: %d, alpha tested: %d\n", (int)corpus.size(), CutoutCount);
+
+	if (corpus.empty() != 0)
+	{
+		return 1;
+	}
+
+	int MaxDelta = 0;
+
+	double DriftBefore = 0.0;
+
+	double DriftAfter = 0.0;
+
+	std::vector<TEXTURE_MIP_LEVEL> scalar;
+
+	std::vector<TEXTURE_MIP_LEVEL> simd;
+
+	for (size_t n = 0; n < corpus.size(); n++)
+	{
+		TEXTURE_FILTER_OPTION option = { TEXTURE_FILTER_KAISER, 1, 1, ((corpus[n].Cutout != 0) ? 0.5f : 0.0f), 0 };
+
+		CTextureFilter::BuildMipChain(&corpus[n].Data[0], corpus[n].Width, corpus[n].Height, &option, scalar);
+
+		option.Simd = 1;
+
+		CTextureFilter::BuildMipChain(&corpus[n].Data[0], corpus[n].Width, corpus[n].Height, &option, simd);
+
+		int delta = CompareChain(scalar, simd);
+
+		MaxDelta = ((delta > MaxDelta) ? delta : MaxDelta);
+
+		if (corpus[n].Cutout != 0)
+		{
+			option.Premultiply = 0;
+
+			CTextureFilter::BuildMipChain(&corpus[n].Data[0], corpus[n].Width, corpus[n].Height, &option, simd);
+
+			DriftAfter += GetCoverageDrift(simd, 0.5f);
+
+			option.Coverage = 0.0f;
+
+			CTextureFilter::BuildMipChain(&corpus[n].Data[0], corpus[n].Width, corpus[n].Height, &option, simd);
+
+			DriftBefore += GetCoverageDrift(simd, 0.5f);
+		}
+	}
+
+	printf("simd vs scalar: max delta %d\n", MaxDelta);
+
+	if (CutoutCount > 0)
+	{
+		printf("alpha test coverage drift: %.2f%% plain, %.2f%% preserved\n", ((DriftBefore * 100.0) / CutoutCount), ((DriftAfter * 100.0) / CutoutCount));
+	}
+
+	const char* name[2] = { "box", "kaiser" };
+
+	for (int filter = TEXTURE_FILTER_BOX; filter <= TEXTURE_FILTER_KAISER; filter++)
+	{
+		TEXTURE_FILTER_OPTION option = { filter, 1, 0, 0.0f, 0 };
+
+		QWORD PixelCount = 0;
+
+		double ScalarTime = BuildCorpus(corpus, &option, runs, &PixelCount);
+
+		option.Simd = 1;
+
+		double SimdTime = BuildCorpus(corpus, &option, runs, &PixelCount);
+
+		printf("%-6s mips: scalar %8.2f ms (%6.1f M pixels/s), simd %8.2f ms (%6.1f M pixels/s), %.2fx\n", name[filter], ScalarTime, ((PixelCount / 1000000.0) / (ScalarTime / 1000.0)), SimdTime, ((PixelCount / 1000000.0) / (SimdTime / 1000.0)), (ScalarTime / SimdTime));
+	}
+
+	QWORD PixelCount = 0;
+
+	double time[2] = { 0.0, 0.0 };
+
+	std::vector<BYTE> buffer;
+
+	for (int mode = 0; mode < 2; mode++)
+	{
+		for (int i = 0; i < runs; i++)
+		{
+			for (size_t n = 0; n < corpus.size(); n++)
+			{
+				buffer = corpus[n].Data;
+
+				double start = GetTimeMs();
+
+				CTextureFilter::Premultiply(&buffer[0], (corpus[n].Width * corpus[n].Height), (mode != 0));
+
+				time[mode] += GetTimeMs() - start;
+
+				PixelCount += ((mode == 0) ? (corpus[n].Width * corpus[n].Height) : 0);
+			}
+		}
+	}
+
+	printf("premultiply: scalar %.2f ms (%.1f M pixels/s), simd %.2f ms (%.1f M pixels/s), %.2fx\n", time[0], ((PixelCount / 1000000.0) / (time[0] / 1000.0)), time[1], ((PixelCount / 1000000.0) / (time[1] / 1000.0)), (time[0] / time[1]));
+
+	return ((MaxDelta == 0) ? 0 : 1);
+}
@@ -0,0 +1,164 @@
+#include "stdafx.h"
+#include "DataTool.h"
+#include "TextureDecoder.h"
+#include "TextureQuality.h"
+
+#define TEXTURE_QUALITY_COUNT 3
+#define TEXTURE_QUALITY_MAX_WORLD 64
+
+struct TEXTURE_QUALITY_STAT
+{
+	DWORD FileCount;
+	QWORD Size[TEXTURE_QUALITY_COUNT];
+};
+
+static int GetWorldIndex(char* path)
+{
+	// Data\WorldN and Data\ObjectN belong to the same map
+	char name[MAX_PATH];
+
+	int length = 0;
+
+	for (; path[length] != 0 && length < (MAX_PATH - 1); length++)
+	{
+		name[length] = ((path[length] == '/') ? '\\' : (char)tolower((BYTE)path[length]));
+	}
+
+	name[length] = 0;
+
+	char* lpWorld = strstr(name, "\\world");
+
+	char* lpObject = strstr(name, "\\object");
+
+	if (lpWorld == 0 && lpObject == 0)
+	{
+		return -1;
+	}
+
+	int index = ((lpWorld != 0) ? atoi(lpWorld + 6) : atoi(lpObject + 7));
+
+	return ((index > 0 && index < TEXTURE_QUALITY_MAX_WORLD) ? index : -1);
+}
+
+static void PrintStat(char* name, TEXTURE_QUALITY_STAT* lpStat)
+{
+	printf("%-10s %5d files  full %8.2f MB  half %8.2f MB (%4.1f%%)  quarter %8.2f MB (%4.1f%%)\n", name, lpStat->FileCount, (lpStat->Size[0] / 1048576.0), (lpStat->Size[1] / 1048576.0), ((lpStat->Size[0] > 0) ? ((lpStat->Size[1] * 100.0) / lpStat->Size[0]) : 0.0), (lpStat->Size[2] / 1048576.0), ((lpStat->Size[0] > 0) ? ((lpStat->Size[2] * 100.0) / lpStat->Size[0]) : 0.0));
+}
+
+int CommandTextureQuality(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printf("Usage: DataTool texquality <directory>\n");
+		return 1;
+	}
+
+	std::vector<std::string> list;
+
+	ScanFiles(argv[0], ".ozj", list);
+
+	ScanFiles(argv[0], ".ozt", list);
+
+	TEXTURE_QUALITY_STAT world[TEXTURE_QUALITY_MAX_WORLD];
+
+	TEXTURE_QUALITY_STAT category[TEXTURE_CATEGORY_MAX];
+
+	TEXTURE_QUALITY_STAT total;
+
+	memset(world, 0, sizeof(world));
+
+	memset(category, 0, sizeof(category));
+
+	memset(&total, 0, sizeof(total));
+
+	double DecodeTime = 0;
+
+	double ScaleTime[TEXTURE_QUALITY_COUNT] = { 0, 0, 0 };
+
+	CTextureDecoder decoder;
+
+	CTextureBufferPool pool;
+
+	for (size_t n = 0; n < list.size(); n++)
+	{
+		char* path = (char*)list[n].c_str();
+
+		TEXTURE_IMAGE image;
+
+		double start = GetTimeMs();
+
+		if (decoder.Decode(path, &pool, &image) == 0)
+		{
+			continue;
+		}
+
+		DecodeTime += GetTimeMs() - start;
+
+		TEXTURE_QUALITY_STAT* lpStat[3] = { &total, &category[CTextureQuality::GetCategory(path)], 0 };
+
+		int index = GetWorldIndex(path);
+
+		lpStat[2] = ((index >= 0 && lpStat[1] == &category[TEXTURE_CATEGORY_WORLD]) ? &world[index] : 0);
+
+		for (int quality = TEXTURE_QUALITY_FULL; quality < TEXTURE_QUALITY_COUNT; quality++)
+		{
+			// Every tier starts from the full image like the loader does
+			TEXTURE_IMAGE scaled = image;
+
+			scaled.Data = pool.Alloc((image.Width * image.Height * 4), &scaled.Capacity);
+
+			memcpy(scaled.Data, image.Data, (image.Width * image.Height * 4));
+
+			start = GetTimeMs();
+
+			CTextureQuality::Apply(quality, &scaled, &pool);
+
+			ScaleTime[quality] += GetTimeMs() - start;
+
+			for (int i = 0; i < 3; i++)
+			{
+				if (lpStat[i] != 0)
+				{
+					lpStat[i]->Size[quality] += scaled.Width * scaled.Height * 4;
+				}
+			}
+
+			pool.Free(scaled.Data, scaled.Capacity);
+		}
+
+		for (int i = 0; i < 3; i++)
+		{
+			if (lpStat[i] != 0)
+			{
+				lpStat[i]->FileCount++;
+			}
+		}
+
+		pool.Free(image.Data, image.Capacity);
+	}
+
+	for (int n = 0; n < TEXTURE_QUALITY_MAX_WORLD; n++)
+	{
+		if (world[n].FileCount != 0)
+		{
+			char name[32];
+
+			wsprintf(name, "World%d", n);
+
+			PrintStat(name, &world[n]);
+		}
+	}
+
+	static char* name[TEXTURE_CATEGORY_MAX] = { "other", "world", "player", "item", "interface" };
+
+	for (int n = 0; n < TEXTURE_CATEGORY_MAX; n++)
+	{
+		PrintStat(name[n], &category[n]);
+	}
+
+	PrintStat("total", &total);
+
+	printf("decode: %.2f ms, downscale half %.2f ms, quarter %.2f ms (%.1f MP/s)\n", DecodeTime, ScaleTime[1], ScaleTime[2], (((total.Size[0] / 4) / 1000000.0) / ((ScaleTime[1] + ScaleTime[2]) / 2000.0)));
+
+	return 0;
+}
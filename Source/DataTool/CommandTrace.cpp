@@ -0,0 +1,495 @@
+#include "stdafx.h"
+#include "DataTool.h"
+#include "DataPack.h"
+#include "FileTrace.h"
+#include <algorithm>
+
+#define TRACE_SCENE_WEBZEN 0
+#define TRACE_SCENE_LOGIN 2
+#define TRACE_SCENE_CHARACTER 4
+#define TRACE_SCENE_GAME 5
+#define TRACE_MONSTER_SHARE 6 // One monster or NPC file in this many is read in a world
+
+static bool IsTerrainMap(std::string& name)
+{
+	char key[MAX_PATH];
+
+	CDataPack::GetPackName((char*)name.c_str(), key);
+
+	char* file = strrchr(key, '\\');
+
+	char* ext = strrchr(key, '.');
+
+	return (file != 0 && ext != 0 && strstr(file, "terrain") != 0 && strcmp(ext, ".map") == 0);
+}
+
+static void ReadTraced(std::vector<std::string>& list, int share, DWORD seed, std::vector<BYTE>& buff)
+{
+	// Opens, sizes and reads every file the way the client does, through the same tracer calls as the hooks
+	std::sort(list.begin(), list.end());
+
+	std::stable_partition(list.begin(), list.end(), IsTerrainMap);
+
+	for (size_t n = 0; n < list.size(); n++)
+	{
+		char* name = (char*)list[n].c_str();
+
+		if (share > 1 && (CDataPack::Hash(name, seed) % share) != 0)
+		{
+			continue;
+		}
+
+		HANDLE handle = CreateFile(name, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+
+		if (handle == INVALID_HANDLE_VALUE)
+		{
+			continue;
+		}
+
+		DWORD size = GetFileSize(handle, 0);
+
+		gFileTrace.Open(handle, name, size);
+
+		buff.resize(size + 1);
+
+		DWORD InSize = 0;
+
+		if (ReadFile(handle, &buff[0], size, &InSize, 0) != 0)
+		{
+			gFileTrace.Read(handle, InSize);
+		}
+
+		gFileTrace.Close(handle);
+
+		CloseHandle(handle);
+	}
+}
+
+static void ReadFolder(char* path, int share, DWORD seed, std::vector<BYTE>& buff)
+{
+	std::vector<std::string> list;
+
+	ScanFiles(path, 0, list);
+
+	ReadTraced(list, share, seed, buff);
+}
+
+int CommandTrace(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printf("Usage: DataTool trace <directory> <output> [world...]\n");
+		return 1;
+	}
+
+	// A scripted session with the client's load order: startup, login, character select, then each world entered in turn
+	static int scene = TRACE_SCENE_WEBZEN;
+
+	std::vector<int> world;
+
+	for (int n = 2; n < argc; n++)
+	{
+		world.push_back(atoi(argv[n]));
+	}
+
+	if (world.empty() != 0)
+	{
+		static int DefaultWorld[] = { 1, 3, 2, 4, 1, 7 };
+
+		world.assign(DefaultWorld, (DefaultWorld + (sizeof(DefaultWorld) / sizeof(int))));
+	}
+
+	if (gFileTrace.Start(argv[1], &scene) == 0)
+	{
+		printf("Could not start the trace\n");
+		return 1;
+	}
+
+	double start = GetTimeMs();
+
+	std::vector<BYTE> buff;
+
+	char path[MAX_PATH];
+
+	std::vector<std::string> root;
+
+	ScanFiles(argv[0], 0, root);
+
+	std::vector<std::string> RootFile;
+
+	for (size_t n = 0; n < root.size(); n++)
+	{
+		if (strchr(&root[n][strlen(argv[0]) + 1], '\\') == 0)
+		{
+			RootFile.push_back(root[n]);
+		}
+	}
+
+	ReadTraced(RootFile, 0, 0, buff);
+
+	wsprintf(path, "%s\\Local", argv[0]);
+
+	ReadFolder(path, 0, 0, buff);
+
+	wsprintf(path, "%s\\Interface", argv[0]);
+
+	ReadFolder(path, 0, 0, buff);
+
+	scene = TRACE_SCENE_LOGIN;
+
+	wsprintf(path, "%s\\Logo", argv[0]);
+
+	ReadFolder(path, 0, 0, buff);
+
+	scene = TRACE_SCENE_CHARACTER;
+
+	wsprintf(path, "%s\\Player", argv[0]);
+
+	ReadFolder(path, 0, 0, buff);
+
+	wsprintf(path, "%s\\Item", argv[0]);
+
+	ReadFolder(path, 0, 0, buff);
+
+	scene = TRACE_SCENE_GAME;
+
+	for (size_t n = 0; n < world.size(); n++)
+	{
+		wsprintf(path, "%s\\World%d", argv[0], world[n]);
+
+		ReadFolder(path, 0, 0, buff);
+
+		wsprintf(path, "%s\\Object%d", argv[0], world[n]);
+
+		ReadFolder(path, 0, 0, buff);
+
+		wsprintf(path, "%s\\Monster", argv[0]);
+
+		ReadFolder(path, TRACE_MONSTER_SHARE, world[n], buff);
+
+		wsprintf(path, "%s\\NPC", argv[0]);
+
+		ReadFolder(path, TRACE_MONSTER_SHARE, world[n], buff);
+
+		if (n == 0)
+		{
+			wsprintf(path, "%s\\Skill", argv[0]);
+
+			ReadFolder(path, 0, 0, buff);
+
+			wsprintf(path, "%s\\Effect", argv[0]);
+
+			ReadFolder(path, 0, 0, buff);
+		}
+	}
+
+	double TraceTime = GetTimeMs() - start;
+
+	if (gFileTrace.Stop() == 0 || gFileTrace.Load(argv[1]) == 0)
+	{
+		printf("Could not write %s\n", argv[1]);
+		return 1;
+	}
+
+	int count[FILE_TRACE_PHASE + 1] = { 0 };
+
+	for (int n = 0; n < gFileTrace.GetEventCount(); n++)
+	{
+		count[gFileTrace.GetEvent(n)->Type]++;
+	}
+
+	printf("%d events (%d opens, %d reads, %d closes, %d phases) on %d files from %d threads in %.2f ms, %d bytes per event\n", gFileTrace.GetEventCount(), count[FILE_TRACE_OPEN], count[FILE_TRACE_READ], count[FILE_TRACE_CLOSE], count[FILE_TRACE_PHASE], gFileTrace.GetNameCount(), gFileTrace.GetThreadCount(), TraceTime, sizeof(FILE_TRACE_EVENT));
+
+	return 0;
+}
+
+int CommandLayout(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		printf("Usage: DataTool layout <directory> <output> <trace> [trace...]\n");
+		return 1;
+	}
+
+	std::vector<std::string> list;
+
+	ScanFiles(argv[0], 0, list);
+
+	std::map<std::string, int> index;
+
+	for (size_t n = 0; n < list.size(); n++)
+	{
+		char key[MAX_PATH];
+
+		CDataPack::GetPackName((char*)list[n].c_str(), key);
+
+		index[key] = n;
+	}
+
+	// Phases keep the order they first show up in, their files the order they are first read in, over every trace given
+	std::vector<std::pair<DWORD, DWORD>> phase;
+
+	std::vector<std::vector<int>> PhaseFile;
+
+	std::vector<int> FilePhase(list.size(), -1);
+
+	int missing = 0;
+
+	for (int n = 2; n < argc; n++)
+	{
+		CFileTrace trace;
+
+		if (trace.Load(argv[n]) == 0)
+		{
+			printf("Could not read %s\n", argv[n]);
+			return 1;
+		}
+
+		int current = -1;
+
+		for (int i = 0; i < trace.GetEventCount(); i++)
+		{
+			FILE_TRACE_EVENT* lpEvent = trace.GetEvent(i);
+
+			if (lpEvent->Type == FILE_TRACE_PHASE)
+			{
+				std::pair<DWORD, DWORD> key = std::make_pair(lpEvent->Offset, lpEvent->Size);
+
+				current = std::find(phase.begin(), phase.end(), key) - phase.begin();
+
+				if (current == phase.size())
+				{
+					phase.push_back(key);
+
+					PhaseFile.push_back(std::vector<int>());
+				}
+
+				continue;
+			}
+
+			if (lpEvent->Type != FILE_TRACE_OPEN || current == -1)
+			{
+				continue;
+			}
+
+			std::map<std::string, int>::iterator it = index.find(trace.GetName(lpEvent->Name));
+
+			if (it == index.end())
+			{
+				missing++;
+				continue;
+			}
+
+			if (FilePhase[it->second] == -1)
+			{
+				FilePhase[it->second] = current;
+
+				PhaseFile[current].push_back(it->second);
+			}
+		}
+	}
+
+	std::vector<std::string> order;
+
+	for (size_t n = 0; n < phase.size(); n++)
+	{
+		char name[64];
+
+		CFileTrace::GetPhaseName(phase[n].first, phase[n].second, name);
+
+		DWORD size = 0;
+
+		for (size_t i = 0; i < PhaseFile[n].size(); i++)
+		{
+			order.push_back(list[PhaseFile[n][i]]);
+
+			HANDLE handle = CreateFile((char*)list[PhaseFile[n][i]].c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+
+			if (handle != INVALID_HANDLE_VALUE)
+			{
+				size += GetFileSize(handle, 0);
+
+				CloseHandle(handle);
+			}
+		}
+
+		printf("%-18s %5d files, %9u bytes\n", name, PhaseFile[n].size(), size);
+	}
+
+	int traced = order.size();
+
+	// Files no trace touched keep their folder order after the traced ones
+	for (size_t n = 0; n < list.size(); n++)
+	{
+		if (FilePhase[n] == -1)
+		{
+			order.push_back(list[n]);
+		}
+	}
+
+	DATA_PACK_BUILD_INFO info;
+
+	if (CDataPack::Build(order, argv[1], 0, &info) == 0)
+	{
+		printf("Could not build %s\n", argv[1]);
+		return 1;
+	}
+
+	printf("%d traced files first, %d untraced after them, %d traced files not in the folder: %u bytes packed\n", traced, (order.size() - traced), missing, info.FileSize);
+
+	return 0;
+}
+
+int CommandReplay(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printf("Usage: DataTool replay <trace> <pack>\n");
+		return 1;
+	}
+
+	CFileTrace trace;
+
+	if (trace.Load(argv[0]) == 0)
+	{
+		printf("Could not read %s\n", argv[0]);
+		return 1;
+	}
+
+	// Opens, seeks and reads are played back in trace order against the pack, a single pack per run lets the caller flush the disk cache in between
+	double start = GetTimeMs();
+
+	CDataPack pack;
+
+	if (pack.Open(argv[1]) == 0)
+	{
+		printf("Could not open %s\n", argv[1]);
+		return 1;
+	}
+
+	std::map<WORD, HANDLE> open;
+
+	std::vector<BYTE> buff;
+
+	int missing = 0;
+
+	int reads = 0;
+
+	int seeks = 0;
+
+	DWORD size = 0;
+
+	DWORD sum = 0;
+
+	DWORD SeekSize = 0;
+
+	DWORD end = 0;
+
+	double PhaseStart = start;
+
+	char name[64] = "start";
+
+	for (int n = 0; n <= trace.GetEventCount(); n++)
+	{
+		FILE_TRACE_EVENT* lpEvent = ((n < trace.GetEventCount()) ? trace.GetEvent(n) : 0);
+
+		if (lpEvent == 0 || lpEvent->Type == FILE_TRACE_PHASE)
+		{
+			if (n != 0)
+			{
+				printf("%-18s %5d reads, %9u bytes, %4d seeks over %9u bytes, %8.2f ms\n", name, reads, size, seeks, SeekSize, (GetTimeMs() - PhaseStart));
+			}
+
+			if (lpEvent != 0)
+			{
+				CFileTrace::GetPhaseName(lpEvent->Offset, lpEvent->Size, name);
+			}
+
+			reads = 0;
+
+			seeks = 0;
+
+			size = 0;
+
+			SeekSize = 0;
+
+			PhaseStart = GetTimeMs();
+
+			continue;
+		}
+
+		int index = pack.Find(trace.GetName(lpEvent->Name));
+
+		if (index == -1)
+		{
+			missing += (lpEvent->Type == FILE_TRACE_OPEN);
+			continue;
+		}
+
+		DATA_PACK_ENTRY* lpEntry = pack.GetEntry(index);
+
+		if (lpEvent->Type == FILE_TRACE_OPEN)
+		{
+			open[lpEvent->Name] = pack.OpenFile(trace.GetName(lpEvent->Name));
+		}
+
+		if (lpEvent->Type == FILE_TRACE_CLOSE && open.find(lpEvent->Name) != open.end())
+		{
+			pack.FileClose(open[lpEvent->Name]);
+
+			open.erase(lpEvent->Name);
+		}
+
+		// A seek is any read that does not start where the one before ended, the alignment padding between entries aside
+		DWORD offset = lpEntry->Offset + (((lpEntry->Flags & DATA_PACK_FLAG_LZ) != 0) ? 0 : lpEvent->Offset);
+
+		DWORD length = (((lpEntry->Flags & DATA_PACK_FLAG_LZ) != 0) ? lpEntry->PackedSize : lpEvent->Size);
+
+		bool touch = (((lpEntry->Flags & DATA_PACK_FLAG_LZ) != 0) ? (lpEvent->Type == FILE_TRACE_OPEN) : (lpEvent->Type == FILE_TRACE_READ));
+
+		if (touch != 0 && length != 0)
+		{
+			if (offset < end || offset >= (end + DATA_PACK_ALIGN))
+			{
+				seeks++;
+
+				SeekSize += ((offset > end) ? (offset - end) : (end - offset));
+			}
+
+			end = offset + length;
+		}
+
+		if (lpEvent->Type != FILE_TRACE_READ || open.find(lpEvent->Name) == open.end())
+		{
+			continue;
+		}
+
+		HANDLE handle = open[lpEvent->Name];
+
+		buff.resize(lpEvent->Size + 1);
+
+		DWORD InSize = 0;
+
+		pack.FileSeek(handle, lpEvent->Offset, FILE_BEGIN);
+
+		pack.FileRead(handle, &buff[0], lpEvent->Size, &InSize);
+
+		for (DWORD i = 0; i < InSize; i++)
+		{
+			sum += buff[i];
+		}
+
+		reads++;
+
+		size += InSize;
+	}
+
+	for (std::map<WORD, HANDLE>::iterator it = open.begin(); it != open.end(); it++)
+	{
+		pack.FileClose(it->second);
+	}
+
+	printf("replayed %d events in %.2f ms, %d files not in the pack, checksum %08X\n", trace.GetEventCount(), (GetTimeMs() - start), missing, sum);
+
+	return 0;
+}
@@ -0,0 +1,117 @@
+#include "stdafx.h"
+#include "DataTool.h"
+
+DATA_TOOL_COMMAND gDataToolCommand[] =
+{
+	{ "script", "script <file> [runs]", CommandScript },
+	{ "bmd", "bmd <directory> [runs]", CommandBmd },
+	{ "cookbmd", "cookbmd <directory>", CommandCookBmd },
+	{ "skin", "skin <file or directory> [runs] [skeleton]", CommandSkin },
+	{ "anim", "anim <directory> [runs]", CommandAnimation },
+	{ "texdecode", "texdecode <directory> [threads]", CommandTexture },
+	{ "jpeg", "jpeg <directory> [runs]", CommandJpeg },
+	{ "cooktex", "cooktex <directory> [threads]", CommandCookTexture },
+	{ "texfilter", "texfilter <directory> [runs]", CommandTextureFilter },
+	{ "texquality", "texquality <directory>", CommandTextureQuality },
+	{ "terrain", "terrain <directory> [runs]", CommandTerrain },
+	{ "path", "path <directory> [queries]", CommandPath },
+	{ "cull", "cull <directory> [camera file]", CommandCull },
+	{ "splat", "splat <directory> [density] [threads]", CommandSplat },
+	{ "light", "light <directory> [runs]", CommandLight },
+	{ "pick", "pick <directory> [rays]", CommandPick },
+	{ "sample", "sample <directory> [frames]", CommandSample },
+	{ "text", "text <directory> [runs]", CommandText },
+	{ "filter", "filter <directory> [lines]", CommandFilter },
+	{ "prefetch", "prefetch <directory> [budget MB]", CommandPrefetch },
+	{ "pack", "pack <directory> <output> [lz]", CommandPack },
+	{ "packread", "packread <directory> <pack> [loose|handle|view]", CommandPackRead },
+	{ "dedup", "dedup <directory> [pack]", CommandDedup },
+	{ "trace", "trace <directory> <output> [world...]", CommandTrace },
+	{ "layout", "layout <directory> <output> <trace> [trace...]", CommandLayout },
+	{ "replay", "replay <trace> <pack>", CommandReplay },
+	{ "loader", "loader <directory> [latency ms] [reads in flight]", CommandLoader },
+	{ "sharedcache", "sharedcache <directory> [hold seconds]", CommandSharedCache },
+};
+
+double GetTimeMs()
+{
+	static LARGE_INTEGER frequency = { 0 };
+
+	if (frequency.QuadPart == 0)
+	{
+		QueryPerformanceFrequency(&frequency);
+	}
+
+	LARGE_INTEGER counter;
+
+	QueryPerformanceCounter(&counter);
+
+	return ((double)counter.QuadPart * 1000.0) / (double)frequency.QuadPart;
+}
+
+void ScanFiles(char* path, char* extension, std::vector<std::string>& list)
+{
+	char search[MAX_PATH];
+
+	wsprintf(search, "%s\\*", path);
+
+	WIN32_FIND_DATA data;
+
+	HANDLE file = FindFirstFile(search, &data);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+
+	do
+	{
+		if (strcmp(data.cFileName, ".") == 0 || strcmp(data.cFileName, "..") == 0)
+		{
+			continue;
+		}
+
+		char name[MAX_PATH];
+
+		wsprintf(name, "%s\\%s", path, data.cFileName);
+
+		if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+		{
+			ScanFiles(name, extension, list);
+
+			continue;
+		}
+
+		char* ext = strrchr(data.cFileName, '.');
+
+		if (extension == 0 || (ext != 0 && _stricmp(ext, extension) == 0))
+		{
+			list.push_back(name);
+		}
+	} while (FindNextFile(file, &data) != 0);
+
+	FindClose(file);
+}
+
+int _tmain(int argc, _TCHAR* argv[])
+{
+	if (argc >= 2)
+	{
+		for (int n = 0; n < (sizeof(gDataToolCommand) / sizeof(DATA_TOOL_COMMAND)); n++)
+		{
+			if (_stricmp(argv[1], gDataToolCommand[n].Name) == 0)
+			{
+				return gDataToolCommand[n].Function((argc - 2), &argv[2]);
+			}
+		}
+	}
+
+	printf("Usage: DataTool <command> [arguments]\n");
+
+	for (int n = 0; n < (sizeof(gDataToolCommand) / sizeof(DATA_TOOL_COMMAND)); n++)
+	{
+		printf("  DataTool %s\n", gDataToolCommand[n].Usage);
+	}
+
+	return 1;
+}
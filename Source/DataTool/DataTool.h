@@ -0,0 +1,68 @@
+#pragma once
+
+struct DATA_TOOL_COMMAND
+{
+	char* Name;
+	char* Usage;
+	int(*Function)(int argc, char** argv);
+};
+
+double GetTimeMs();
+
+void ScanFiles(char* path, char* extension, std::vector<std::string>& list);
+
+int CommandScript(int argc, char** argv);
+
+int CommandBmd(int argc, char** argv);
+
+int CommandCookBmd(int argc, char** argv);
+
+int CommandSkin(int argc, char** argv);
+
+int CommandAnimation(int argc, char** argv);
+
+int CommandTexture(int argc, char** argv);
+
+int CommandJpeg(int argc, char** argv);
+
+int CommandCookTexture(int argc, char** argv);
+
+int CommandTextureFilter(int argc, char** argv);
+
+int CommandTextureQuality(int argc, char** argv);
+
+int CommandTerrain(int argc, char** argv);
+
+int CommandPath(int argc, char** argv);
+
+int CommandCull(int argc, char** argv);
+
+int CommandSplat(int argc, char** argv);
+
+int CommandLight(int argc, char** argv);
+
+int CommandPick(int argc, char** argv);
+
+int CommandSample(int argc, char** argv);
+
+int CommandText(int argc, char** argv);
+
+int CommandFilter(int argc, char** argv);
+
+int CommandPrefetch(int argc, char** argv);
+
+int CommandPack(int argc, char** argv);
+
+int CommandPackRead(int argc, char** argv);
+
+int CommandDedup(int argc, char** argv);
+
+int CommandTrace(int argc, char** argv);
+
+int CommandLayout(int argc, char** argv);
+
+int CommandReplay(int argc, char** argv);
+
+int CommandLoader(int argc, char** argv);
+
+int CommandSharedCache(int argc, char** argv);
@@ -0,0 +1,16 @@
+#pragma once
+
+typedef unsigned __int64 QWORD;
+
+#define WIN32_LEAN_AND_MEAN
+
+// System Include
+#include <stdio.h>
+#include <tchar.h>
+#include <windows.h>
+#include <gl\GL.h>
+#include <math.h>
+#include <deque>
+#include <vector>
+#include <map>
+#include <string>
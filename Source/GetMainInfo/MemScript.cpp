@@ -4,6 +4,7 @@
 
 #include "stdafx.h"
 #include "MemScript.h"
+#include "CCRC32.H"
 
 //////////////////////////////////////////////////////////////////////
 // Construction/Destruction
@@ -16,6 +17,21 @@ CMemScript::CMemScript()
 
 	memset(this->m_path,0,sizeof(this->m_path));
 
+	memset(this->m_CachePath,0,sizeof(this->m_CachePath));
+
+	this->m_CacheFile = INVALID_HANDLE_VALUE;
+	this->m_CacheMapping = 0;
+	this->m_CacheView = 0;
+	this->m_CacheToken = 0;
+	this->m_CacheTokenCount = 0;
+	this->m_CacheString = 0;
+	this->m_CacheStringSize = 0;
+	this->m_CacheCount = 0;
+
+	memset(&this->m_SourceTime,0,sizeof(this->m_SourceTime));
+
+	this->m_CacheRecord = 0;
+
 	this->SetLastError(4);
 }
 
@@ -28,28 +44,67 @@ CMemScript::~CMemScript()
 	}
 
 	this->m_size = 0;
+
+	this->FreeCache();
 }
 
 bool CMemScript::SetBuffer(char* path)
 {
 	strcpy_s(this->m_path,path);
 
-	HANDLE file = CreateFile(this->m_path,GENERIC_READ,FILE_SHARE_READ,0,OPEN_EXISTING,FILE_ATTRIBUTE_ARCHIVE,0);
+	// The size and write time stamp the cache, a hit never opens the source
+	WIN32_FILE_ATTRIBUTE_DATA data;
 
-	if(file == INVALID_HANDLE_VALUE)
+	if(GetFileAttributesEx(this->m_path,GetFileExInfoStandard,&data) == 0)
 	{
 		this->SetLastError(0);
 		return 0;
 	}
 
-	this->m_size = GetFileSize(file,0);
-
 	if(this->m_buff != 0)
 	{
 		delete[] this->m_buff;
 		this->m_buff = 0;
 	}
 
+	this->m_size = data.nFileSizeLow;
+
+	this->m_SourceTime = data.ftLastWriteTime;
+
+	this->FreeCache();
+
+	wsprintf(this->m_CachePath,"%s%s",this->m_path,MEM_SCRIPT_CACHE_EXTENSION);
+
+	if(this->LoadCache() == 0)
+	{
+		if(this->ReadSource() == 0)
+		{
+			return 0;
+		}
+
+		// Tokens are recorded as the caller reads them, the cache is written once the end is reached
+		this->m_CacheRecord = 1;
+	}
+
+	this->m_count = 0;
+
+	this->m_tick = GetTickCount();
+
+	return 1;
+}
+
+bool CMemScript::ReadSource()
+{
+	HANDLE file = CreateFile(this->m_path,GENERIC_READ,FILE_SHARE_READ,0,OPEN_EXISTING,FILE_ATTRIBUTE_ARCHIVE,0);
+
+	if(file == INVALID_HANDLE_VALUE)
+	{
+		this->SetLastError(0);
+		return 0;
+	}
+
+	this->m_size = GetFileSize(file,0);
+
 	this->m_buff = new char[this->m_size];
 
 	if(this->m_buff == 0)
@@ -70,16 +125,12 @@ bool CMemScript::SetBuffer(char* path)
 
 	CloseHandle(file);
 
-	this->m_count = 0;
-
-	this->m_tick = GetTickCount();
-
 	return 1;
 }
 
 bool CMemScript::GetBuffer(char* buff,DWORD* size)
 {
-	if(this->m_buff == 0)
+	if(this->m_buff == 0 && (this->m_CacheToken == 0 || this->ReadSource() == 0))
 	{
 		this->SetLastError(3);
 		return 0;
@@ -141,6 +192,23 @@ eTokenResult CMemScript::GetToken()
 		throw 1;
 	}
 
+	if(this->m_CacheToken != 0)
+	{
+		return this->GetCacheToken();
+	}
+
+	eTokenResult result = this->ReadToken();
+
+	if(this->m_CacheRecord != 0)
+	{
+		this->RecordToken(result);
+	}
+
+	return result;
+}
+
+eTokenResult CMemScript::ReadToken()
+{
 	this->m_number = 0;
 
 	memset(this->m_string,0,sizeof(this->m_string));
@@ -314,3 +382,256 @@ char* CMemScript::GetAsString()
 
 	return this->m_string;
 }
+
+
+bool CMemScript::IsCacheLoaded()
+{
+	return (this->m_CacheToken != 0);
+}
+
+bool CMemScript::LoadCache()
+{
+	this->m_CacheFile = CreateFile(this->m_CachePath,GENERIC_READ,FILE_SHARE_READ,0,OPEN_EXISTING,FILE_ATTRIBUTE_ARCHIVE,0);
+
+	if(this->m_CacheFile == INVALID_HANDLE_VALUE)
+	{
+		return 0;
+	}
+
+	DWORD size = GetFileSize(this->m_CacheFile,0);
+
+	if(size < sizeof(MEM_SCRIPT_CACHE_HEADER) || size == INVALID_FILE_SIZE)
+	{
+		this->FreeCache();
+		return 0;
+	}
+
+	this->m_CacheMapping = CreateFileMapping(this->m_CacheFile,0,PAGE_READONLY,0,0,0);
+
+	if(this->m_CacheMapping == 0)
+	{
+		this->FreeCache();
+		return 0;
+	}
+
+	this->m_CacheView = (BYTE*)MapViewOfFile(this->m_CacheMapping,FILE_MAP_READ,0,0,0);
+
+	if(this->m_CacheView == 0 || this->CheckCache(this->m_CacheView,size) == 0)
+	{
+		this->FreeCache();
+		return 0;
+	}
+
+	this->SetCache(this->m_CacheView);
+
+	return 1;
+}
+
+void CMemScript::RecordToken(eTokenResult result)
+{
+	MEM_SCRIPT_CACHE_TOKEN info;
+
+	info.Type = result;
+
+	info.Length = strlen(this->m_string);
+
+	info.Number = this->m_number;
+
+	info.String = this->m_RecordString.size();
+
+	this->m_RecordString.insert(this->m_RecordString.end(),this->m_string,(this->m_string+info.Length+1));
+
+	this->m_RecordToken.push_back(info);
+
+	if(result == TOKEN_END)
+	{
+		this->m_CacheRecord = 0;
+
+		this->WriteCache();
+
+		this->m_RecordToken.clear();
+
+		this->m_RecordString.clear();
+	}
+}
+
+bool CMemScript::WriteCache()
+{
+	MEM_SCRIPT_CACHE_HEADER header;
+
+	header.Magic = MEM_SCRIPT_CACHE_MAGIC;
+
+	header.Version = MEM_SCRIPT_CACHE_VERSION;
+
+	header.SourceSize = this->m_size;
+
+	header.SourceTime = this->m_SourceTime;
+
+	header.TokenCount = this->m_RecordToken.size();
+
+	header.StringSize = this->m_RecordString.size();
+
+	CCRC32 CRC32;
+
+	header.HeaderCRC = CRC32.FullCRC((unsigned char*)&header,offsetof(MEM_SCRIPT_CACHE_HEADER,HeaderCRC));
+
+	// Write to a temporary file first so a crash never leaves a half written cache behind
+	char temp[260];
+
+	wsprintf(temp,"%s.tmp",this->m_CachePath);
+
+	HANDLE file = CreateFile(temp,GENERIC_WRITE,0,0,CREATE_ALWAYS,FILE_ATTRIBUTE_ARCHIVE,0);
+
+	if(file == INVALID_HANDLE_VALUE)
+	{
+		return 0;
+	}
+
+	DWORD TokenSize = header.TokenCount*sizeof(MEM_SCRIPT_CACHE_TOKEN);
+
+	DWORD OutSize[3] = {0,0,0};
+
+	if(WriteFile(file,&header,sizeof(header),&OutSize[0],0) == 0 || WriteFile(file,&this->m_RecordToken[0],TokenSize,&OutSize[1],0) == 0 || WriteFile(file,&this->m_RecordString[0],header.StringSize,&OutSize[2],0) == 0 || (OutSize[0]+OutSize[1]+OutSize[2]) != (sizeof(header)+TokenSize+header.StringSize))
+	{
+		CloseHandle(file);
+		DeleteFile(temp);
+		return 0;
+	}
+
+	CloseHandle(file);
+
+	if(MoveFileEx(temp,this->m_CachePath,MOVEFILE_REPLACE_EXISTING) == 0)
+	{
+		DeleteFile(temp);
+		return 0;
+	}
+
+	return 1;
+}
+
+bool CMemScript::CheckCache(BYTE* data,DWORD size)
+{
+	MEM_SCRIPT_CACHE_HEADER* lpHeader = (MEM_SCRIPT_CACHE_HEADER*)data;
+
+	if(lpHeader->Magic != MEM_SCRIPT_CACHE_MAGIC || lpHeader->Version != MEM_SCRIPT_CACHE_VERSION)
+	{
+		return 0;
+	}
+
+	if(lpHeader->SourceSize != this->m_size || CompareFileTime(&lpHeader->SourceTime,&this->m_SourceTime) != 0)
+	{
+		return 0;
+	}
+
+	CCRC32 CRC32;
+
+	if(lpHeader->HeaderCRC != CRC32.FullCRC(data,offsetof(MEM_SCRIPT_CACHE_HEADER,HeaderCRC)))
+	{
+		return 0;
+	}
+
+	if(lpHeader->TokenCount == 0 || lpHeader->StringSize == 0 || lpHeader->TokenCount > (size/sizeof(MEM_SCRIPT_CACHE_TOKEN)))
+	{
+		return 0;
+	}
+
+	if(size != (sizeof(MEM_SCRIPT_CACHE_HEADER)+(lpHeader->TokenCount*sizeof(MEM_SCRIPT_CACHE_TOKEN))+lpHeader->StringSize))
+	{
+		return 0;
+	}
+
+	MEM_SCRIPT_CACHE_TOKEN* lpToken = (MEM_SCRIPT_CACHE_TOKEN*)(data+sizeof(MEM_SCRIPT_CACHE_HEADER));
+
+	char* lpString = (char*)(lpToken+lpHeader->TokenCount);
+
+	if(lpString[lpHeader->StringSize-1] != 0 || lpToken[lpHeader->TokenCount-1].Type != TOKEN_END)
+	{
+		return 0;
+	}
+
+	for(DWORD n=0;n < lpHeader->TokenCount;n++)
+	{
+		if(lpToken[n].Type > TOKEN_ERROR || lpToken[n].Length >= sizeof(this->m_string))
+		{
+			return 0;
+		}
+
+		if(lpToken[n].String >= lpHeader->StringSize || lpToken[n].Length >= (lpHeader->StringSize-lpToken[n].String))
+		{
+			return 0;
+		}
+
+		if(lpString[lpToken[n].String+lpToken[n].Length] != 0)
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+void CMemScript::SetCache(BYTE* data)
+{
+	MEM_SCRIPT_CACHE_HEADER* lpHeader = (MEM_SCRIPT_CACHE_HEADER*)data;
+
+	this->m_CacheToken = (MEM_SCRIPT_CACHE_TOKEN*)(data+sizeof(MEM_SCRIPT_CACHE_HEADER));
+
+	this->m_CacheTokenCount = lpHeader->TokenCount;
+
+	this->m_CacheString = (char*)(this->m_CacheToken+lpHeader->TokenCount);
+
+	this->m_CacheStringSize = lpHeader->StringSize;
+
+	this->m_CacheCount = 0;
+}
+
+void CMemScript::FreeCache()
+{
+	if(this->m_CacheView != 0)
+	{
+		UnmapViewOfFile(this->m_CacheView);
+		this->m_CacheView = 0;
+	}
+
+	if(this->m_CacheMapping != 0)
+	{
+		CloseHandle(this->m_CacheMapping);
+		this->m_CacheMapping = 0;
+	}
+
+	if(this->m_CacheFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(this->m_CacheFile);
+		this->m_CacheFile = INVALID_HANDLE_VALUE;
+	}
+
+	this->m_CacheToken = 0;
+	this->m_CacheTokenCount = 0;
+	this->m_CacheString = 0;
+	this->m_CacheStringSize = 0;
+	this->m_CacheCount = 0;
+
+	this->m_CacheRecord = 0;
+	this->m_RecordToken.clear();
+	this->m_RecordString.clear();
+}
+
+eTokenResult CMemScript::GetCacheToken()
+{
+	if(this->m_CacheCount >= this->m_CacheTokenCount)
+	{
+		this->m_number = 0;
+
+		memset(this->m_string,0,sizeof(this->m_string));
+
+		return TOKEN_END;
+	}
+
+	MEM_SCRIPT_CACHE_TOKEN* lpToken = &this->m_CacheToken[this->m_CacheCount++];
+
+	this->m_number = lpToken->Number;
+
+	memcpy(this->m_string,&this->m_CacheString[lpToken->String],(lpToken->Length+1));
+
+	return (eTokenResult)lpToken->Type;
+}
\ No newline at end of file
@@ -12,6 +12,10 @@
 #define MEM_SCRIPT_ERROR_CODE4 "[%s] The file were not configured correctly\n"
 #define MEM_SCRIPT_ERROR_CODEX "[%s] Unknow error code: %d\n"
 
+#define MEM_SCRIPT_CACHE_MAGIC 0x4353534D // "MSSC"
+#define MEM_SCRIPT_CACHE_VERSION 2
+#define MEM_SCRIPT_CACHE_EXTENSION ".msc"
+
 enum eTokenResult
 {
 	TOKEN_NUMBER = 0,
@@ -20,6 +24,25 @@ enum eTokenResult
 	TOKEN_ERROR = 3,
 };
 
+struct MEM_SCRIPT_CACHE_HEADER
+{
+	DWORD Magic;
+	DWORD Version;
+	DWORD SourceSize;
+	FILETIME SourceTime;
+	DWORD TokenCount;
+	DWORD StringSize;
+	DWORD HeaderCRC;
+};
+
+struct MEM_SCRIPT_CACHE_TOKEN
+{
+	WORD Type;
+	WORD Length;
+	float Number;
+	DWORD String;
+};
+
 class CMemScript
 {
 public:
@@ -42,6 +65,17 @@ public:
 	float GetAsFloatNumber();
 	char* GetString();
 	char* GetAsString();
+	bool IsCacheLoaded();
+private:
+	bool ReadSource();
+	eTokenResult ReadToken();
+	bool LoadCache();
+	void RecordToken(eTokenResult result);
+	bool WriteCache();
+	bool CheckCache(BYTE* data,DWORD size);
+	void SetCache(BYTE* data);
+	void FreeCache();
+	eTokenResult GetCacheToken();
 private:
 	char* m_buff;
 	DWORD m_size;
@@ -51,4 +85,17 @@ private:
 	char m_string[256];
 	DWORD m_tick;
 	char m_LastError[256];
+	char m_CachePath[260];
+	HANDLE m_CacheFile;
+	HANDLE m_CacheMapping;
+	BYTE* m_CacheView;
+	MEM_SCRIPT_CACHE_TOKEN* m_CacheToken;
+	DWORD m_CacheTokenCount;
+	char* m_CacheString;
+	DWORD m_CacheStringSize;
+	DWORD m_CacheCount;
+	FILETIME m_SourceTime;
+	bool m_CacheRecord;
+	std::vector<MEM_SCRIPT_CACHE_TOKEN> m_RecordToken;
+	std::vector<char> m_RecordString;
 };
@@ -4,3 +4,4 @@
 #include <stdio.h>
 #include <tchar.h>
 #include <windows.h>
+#include <vector>
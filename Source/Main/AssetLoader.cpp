@@ -0,0 +1,575 @@
+#include "stdafx.h"
+#include "AssetLoader.h"
+#include "DataPack.h"
+
+CAssetLoader gAssetLoader;
+
+CAssetLoader::CAssetLoader()
+{
+	memset(this->m_Thread, 0, sizeof(this->m_Thread));
+
+	this->m_ThreadCount = 0;
+
+	this->m_StopEvent = 0;
+
+	this->m_JobSemaphore = 0;
+
+	this->m_IoSemaphore = 0;
+
+	this->m_Reader = CAssetLoader::ReadAsset;
+
+	this->m_NextIndex = 0;
+
+	this->m_NextTicket = 0;
+
+	memset(&this->m_Stat, 0, sizeof(this->m_Stat));
+
+	InitializeCriticalSection(&this->m_Lock);
+}
+
+CAssetLoader::~CAssetLoader()
+{
+	this->Stop();
+
+	DeleteCriticalSection(&this->m_Lock);
+}
+
+bool CAssetLoader::Start(int ThreadCount, int IoCount)
+{
+	this->Stop();
+
+	ThreadCount = ((ThreadCount <= 0) ? ASSET_LOAD_DEFAULT_THREAD : ((ThreadCount > ASSET_LOAD_MAX_THREAD) ? ASSET_LOAD_MAX_THREAD : ThreadCount));
+
+	IoCount = ((IoCount <= 0) ? ASSET_LOAD_DEFAULT_IO : IoCount);
+
+	this->m_StopEvent = CreateEvent(0, 1, 0, 0);
+
+	this->m_JobSemaphore = CreateSemaphore(0, 0, 0x7FFFFFFF, 0);
+
+	this->m_IoSemaphore = CreateSemaphore(0, IoCount, IoCount, 0);
+
+	if (this->m_StopEvent == 0 || this->m_JobSemaphore == 0 || this->m_IoSemaphore == 0)
+	{
+		this->Stop();
+		return false;
+	}
+
+	memset(&this->m_Stat, 0, sizeof(this->m_Stat));
+
+	for (int n = 0; n < ThreadCount; n++)
+	{
+		this->m_Thread[n] = CreateThread(0, 0, CAssetLoader::WorkerThread, this, 0, 0);
+
+		if (this->m_Thread[n] == 0)
+		{
+			this->Stop();
+			return false;
+		}
+
+		this->m_ThreadCount++;
+	}
+
+	return true;
+}
+
+void CAssetLoader::Stop()
+{
+	if (this->m_StopEvent != 0)
+	{
+		SetEvent(this->m_StopEvent);
+	}
+
+	for (int n = 0; n < this->m_ThreadCount; n++)
+	{
+		WaitForSingleObject(this->m_Thread[n], INFINITE);
+
+		CloseHandle(this->m_Thread[n]);
+
+		this->m_Thread[n] = 0;
+	}
+
+	this->m_ThreadCount = 0;
+
+	// Nothing is delivered after a stop, every request still around is dropped with its data
+	while (this->m_Request.empty() == 0)
+	{
+		this->DeleteRequest(this->m_Request.begin()->second);
+	}
+
+	for (int n = 0; n < ASSET_PRIORITY_MAX; n++)
+	{
+		this->m_Queue[n].clear();
+	}
+
+	this->m_Done.clear();
+
+	if (this->m_StopEvent != 0)
+	{
+		CloseHandle(this->m_StopEvent);
+	}
+
+	if (this->m_JobSemaphore != 0)
+	{
+		CloseHandle(this->m_JobSemaphore);
+	}
+
+	if (this->m_IoSemaphore != 0)
+	{
+		CloseHandle(this->m_IoSemaphore);
+	}
+
+	this->m_StopEvent = 0;
+
+	this->m_JobSemaphore = 0;
+
+	this->m_IoSemaphore = 0;
+
+	this->m_BufferPool.Clear();
+}
+
+void CAssetLoader::SetReader(ASSET_LOAD_READER reader)
+{
+	this->m_Reader = ((reader == 0) ? CAssetLoader::ReadAsset : reader);
+}
+
+DWORD CAssetLoader::Request(char* path, int type, int priority, DWORD group, ASSET_LOAD_CALLBACK callback, void* param)
+{
+	// A file already queued or loading gets one more waiter, and moves up when the new request is more urgent
+	if (this->m_ThreadCount == 0 || priority < 0 || priority >= ASSET_PRIORITY_MAX)
+	{
+		return 0;
+	}
+
+	char key[MAX_PATH];
+
+	CDataPack::GetPackName(path, key);
+
+	std::string name = ((key[0] == 0) ? path : key);
+
+	name += ((type == ASSET_LOAD_TEXTURE) ? "|texture" : "|file");
+
+	EnterCriticalSection(&this->m_Lock);
+
+	ASSET_LOAD_WAITER waiter;
+
+	waiter.Ticket = ++this->m_NextTicket;
+
+	waiter.Group = group;
+
+	waiter.Callback = callback;
+
+	waiter.Param = param;
+
+	this->m_Stat.RequestCount++;
+
+	ASSET_LOAD_REQUEST* lpRequest = 0;
+
+	std::map<std::string, ASSET_LOAD_REQUEST*>::iterator it = this->m_Name.find(name);
+
+	if (it != this->m_Name.end())
+	{
+		lpRequest = it->second;
+
+		this->m_Stat.CoalescedCount++;
+
+		if (lpRequest->State == ASSET_LOAD_CANCELED)
+		{
+			lpRequest->State = ASSET_LOAD_LOADING;
+		}
+
+		if (lpRequest->State == ASSET_LOAD_QUEUED && priority < lpRequest->Priority)
+		{
+			lpRequest->Priority = priority;
+
+			this->m_Queue[priority].push_back(lpRequest->Index);
+
+			ReleaseSemaphore(this->m_JobSemaphore, 1, 0);
+		}
+	}
+	else
+	{
+		lpRequest = new ASSET_LOAD_REQUEST;
+
+		lpRequest->Index = ++this->m_NextIndex;
+
+		lpRequest->Name = name;
+
+		strcpy_s(lpRequest->Path, path);
+
+		lpRequest->Type = type;
+
+		lpRequest->Priority = priority;
+
+		lpRequest->State = ASSET_LOAD_QUEUED;
+
+		lpRequest->Success = 0;
+
+		memset(&lpRequest->Image, 0, sizeof(lpRequest->Image));
+
+		this->m_Request[lpRequest->Index] = lpRequest;
+
+		this->m_Name[name] = lpRequest;
+
+		this->m_Queue[priority].push_back(lpRequest->Index);
+
+		ReleaseSemaphore(this->m_JobSemaphore, 1, 0);
+	}
+
+	lpRequest->Waiter.push_back(waiter);
+
+	this->m_Ticket[waiter.Ticket] = lpRequest->Index;
+
+	LeaveCriticalSection(&this->m_Lock);
+
+	return waiter.Ticket;
+}
+
+void CAssetLoader::Cancel(DWORD ticket)
+{
+	EnterCriticalSection(&this->m_Lock);
+
+	std::map<DWORD, DWORD>::iterator it = this->m_Ticket.find(ticket);
+
+	if (it != this->m_Ticket.end())
+	{
+		this->RemoveWaiter(this->m_Request[it->second], ticket, 0);
+	}
+
+	LeaveCriticalSection(&this->m_Lock);
+}
+
+void CAssetLoader::CancelGroup(DWORD group)
+{
+	// Leaving an area drops everything asked for it, files other areas still wait for keep loading
+	EnterCriticalSection(&this->m_Lock);
+
+	std::vector<ASSET_LOAD_REQUEST*> list;
+
+	for (std::map<DWORD, ASSET_LOAD_REQUEST*>::iterator it = this->m_Request.begin(); it != this->m_Request.end(); it++)
+	{
+		list.push_back(it->second);
+	}
+
+	for (size_t n = 0; n < list.size(); n++)
+	{
+		this->RemoveWaiter(list[n], 0, group);
+	}
+
+	LeaveCriticalSection(&this->m_Lock);
+}
+
+int CAssetLoader::Dispatch(DWORD MaxTime)
+{
+	// Called by the main thread once a frame, callbacks run here and may queue or cancel requests themselves
+	DWORD start = GetTickCount();
+
+	int count = 0;
+
+	while (true)
+	{
+		EnterCriticalSection(&this->m_Lock);
+
+		if (this->m_Done.empty() != 0)
+		{
+			LeaveCriticalSection(&this->m_Lock);
+			break;
+		}
+
+		ASSET_LOAD_REQUEST* lpRequest = this->m_Request[this->m_Done.front()];
+
+		this->m_Done.pop_front();
+
+		this->m_Request.erase(lpRequest->Index);
+
+		this->m_Name.erase(lpRequest->Name);
+
+		for (size_t n = 0; n < lpRequest->Waiter.size(); n++)
+		{
+			this->m_Ticket.erase(lpRequest->Waiter[n].Ticket);
+		}
+
+		this->m_Stat.CallbackCount += lpRequest->Waiter.size();
+
+		LeaveCriticalSection(&this->m_Lock);
+
+		ASSET_LOAD_RESULT result;
+
+		result.Path = lpRequest->Path;
+
+		result.Success = lpRequest->Success;
+
+		result.Data = ((lpRequest->Data.empty() != 0) ? 0 : &lpRequest->Data[0]);
+
+		result.Size = lpRequest->Data.size();
+
+		result.Image = lpRequest->Image;
+
+		for (size_t n = 0; n < lpRequest->Waiter.size(); n++)
+		{
+			result.Ticket = lpRequest->Waiter[n].Ticket;
+
+			lpRequest->Waiter[n].Callback(&result, lpRequest->Waiter[n].Param);
+
+			count++;
+		}
+
+		if (result.Image.Data != 0)
+		{
+			this->m_BufferPool.Free(result.Image.Data, result.Image.Capacity);
+		}
+
+		delete lpRequest;
+
+		if (MaxTime != 0 && (GetTickCount() - start) >= MaxTime)
+		{
+			break;
+		}
+	}
+
+	return count;
+}
+
+void CAssetLoader::FreeImage(TEXTURE_IMAGE* lpImage)
+{
+	if (lpImage->Data != 0)
+	{
+		this->m_BufferPool.Free(lpImage->Data, lpImage->Capacity);
+	}
+
+	lpImage->Data = 0;
+
+	lpImage->Capacity = 0;
+}
+
+int CAssetLoader::GetPendingCount()
+{
+	EnterCriticalSection(&this->m_Lock);
+
+	int count = this->m_Request.size();
+
+	LeaveCriticalSection(&this->m_Lock);
+
+	return count;
+}
+
+void CAssetLoader::GetStat(ASSET_LOAD_STAT* lpStat)
+{
+	EnterCriticalSection(&this->m_Lock);
+
+	*lpStat = this->m_Stat;
+
+	LeaveCriticalSection(&this->m_Lock);
+}
+
+bool CAssetLoader::ReadAsset(char* path, std::vector<BYTE>& data)
+{
+	// The loader's own reads do not go through the game's hooks, packed files are taken from the pack here
+	data.clear();
+
+	int index = gDataPack.Find(path);
+
+	DATA_PACK_VIEW view;
+
+	if (index != -1 && gDataPack.IsCurrent(index) != 0 && gDataPack.GetView(index, &view) != 0)
+	{
+		data.assign(view.Data, (view.Data + view.Size));
+
+		gDataPack.ReleaseView(&view);
+
+		return true;
+	}
+
+	HANDLE handle = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	DWORD size = GetFileSize(handle, 0);
+
+	data.resize((size == INVALID_FILE_SIZE) ? 0 : size);
+
+	DWORD InSize = 0;
+
+	bool result = (size != INVALID_FILE_SIZE && (size == 0 || (ReadFile(handle, &data[0], size, &InSize, 0) != 0 && InSize == size)));
+
+	CloseHandle(handle);
+
+	return result;
+}
+
+DWORD WINAPI CAssetLoader::WorkerThread(LPVOID lpParam)
+{
+	CAssetLoader* lpLoader = (CAssetLoader*)lpParam;
+
+	CTextureDecoder decoder;
+
+	HANDLE handle[2] = { lpLoader->m_StopEvent, lpLoader->m_JobSemaphore };
+
+	HANDLE io[2] = { lpLoader->m_StopEvent, lpLoader->m_IoSemaphore };
+
+	while (WaitForMultipleObjects(2, handle, 0, INFINITE) == (WAIT_OBJECT_0 + 1))
+	{
+		ASSET_LOAD_REQUEST* lpRequest = 0;
+
+		if (lpLoader->PopRequest(&lpRequest) == 0)
+		{
+			continue;
+		}
+
+		// Only the read waits for a slot, decoding runs on every worker at once
+		if (WaitForMultipleObjects(2, io, 0, INFINITE) != (WAIT_OBJECT_0 + 1))
+		{
+			break;
+		}
+
+		bool success = lpLoader->m_Reader(lpRequest->Path, lpRequest->Data);
+
+		ReleaseSemaphore(lpLoader->m_IoSemaphore, 1, 0);
+
+		bool decoded = (lpRequest->Type != ASSET_LOAD_TEXTURE);
+
+		while (true)
+		{
+			EnterCriticalSection(&lpLoader->m_Lock);
+
+			if (lpRequest->State == ASSET_LOAD_CANCELED)
+			{
+				lpLoader->m_Stat.ReadCount++;
+
+				lpLoader->m_Stat.WastedCount++;
+
+				lpLoader->DeleteRequest(lpRequest);
+
+				LeaveCriticalSection(&lpLoader->m_Lock);
+				break;
+			}
+
+			if (success == 0 || decoded != 0)
+			{
+				lpLoader->m_Stat.ReadCount++;
+
+				lpRequest->Success = success;
+
+				lpRequest->State = ASSET_LOAD_DONE;
+
+				lpLoader->m_Done.push_back(lpRequest->Index);
+
+				LeaveCriticalSection(&lpLoader->m_Lock);
+				break;
+			}
+
+			LeaveCriticalSection(&lpLoader->m_Lock);
+
+			// The decode is skipped when the request is canceled during the read, and done late when it comes back
+			DWORD prefix = 0;
+
+			int type = CTextureDecoder::GetType(lpRequest->Path, &prefix);
+
+			success = (type != TEXTURE_TYPE_NONE && lpRequest->Data.size() > prefix && decoder.Decode(&lpRequest->Data[prefix], (lpRequest->Data.size() - prefix), type, &lpLoader->m_BufferPool, &lpRequest->Image) != 0);
+
+			if (success == 0)
+			{
+				memset(&lpRequest->Image, 0, sizeof(lpRequest->Image));
+			}
+
+			std::vector<BYTE>().swap(lpRequest->Data);
+
+			decoded = 1;
+		}
+	}
+
+	return 0;
+}
+
+bool CAssetLoader::PopRequest(ASSET_LOAD_REQUEST** lpRequest)
+{
+	// Entries whose request was dropped or moved to a more urgent queue are thrown away on the way
+	EnterCriticalSection(&this->m_Lock);
+
+	for (int n = 0; n < ASSET_PRIORITY_MAX; n++)
+	{
+		while (this->m_Queue[n].empty() == 0)
+		{
+			std::map<DWORD, ASSET_LOAD_REQUEST*>::iterator it = this->m_Request.find(this->m_Queue[n].front());
+
+			this->m_Queue[n].pop_front();
+
+			if (it != this->m_Request.end() && it->second->State == ASSET_LOAD_QUEUED && it->second->Priority == n)
+			{
+				it->second->State = ASSET_LOAD_LOADING;
+
+				*lpRequest = it->second;
+
+				LeaveCriticalSection(&this->m_Lock);
+
+				return true;
+			}
+		}
+	}
+
+	LeaveCriticalSection(&this->m_Lock);
+
+	return false;
+}
+
+bool CAssetLoader::RemoveWaiter(ASSET_LOAD_REQUEST* lpRequest, DWORD ticket, DWORD group)
+{
+	// By ticket when one is given, by group otherwise
+	bool result = false;
+
+	for (size_t n = 0; n < lpRequest->Waiter.size();)
+	{
+		ASSET_LOAD_WAITER* lpWaiter = &lpRequest->Waiter[n];
+
+		if ((ticket != 0) ? (lpWaiter->Ticket != ticket) : (lpWaiter->Group != group))
+		{
+			n++;
+			continue;
+		}
+
+		this->m_Ticket.erase(lpWaiter->Ticket);
+
+		lpRequest->Waiter.erase(lpRequest->Waiter.begin() + n);
+
+		this->m_Stat.CanceledCount++;
+
+		result = true;
+	}
+
+	if (result == 0 || lpRequest->Waiter.empty() == 0)
+	{
+		return result;
+	}
+
+	if (lpRequest->State == ASSET_LOAD_QUEUED)
+	{
+		this->DeleteRequest(lpRequest);
+	}
+	else if (lpRequest->State == ASSET_LOAD_LOADING)
+	{
+		lpRequest->State = ASSET_LOAD_CANCELED;
+	}
+
+	return result;
+}
+
+void CAssetLoader::DeleteRequest(ASSET_LOAD_REQUEST* lpRequest)
+{
+	this->m_Request.erase(lpRequest->Index);
+
+	this->m_Name.erase(lpRequest->Name);
+
+	for (size_t n = 0; n < lpRequest->Waiter.size(); n++)
+	{
+		this->m_Ticket.erase(lpRequest->Waiter[n].Ticket);
+	}
+
+	if (lpRequest->Image.Data != 0)
+	{
+		this->m_BufferPool.Free(lpRequest->Image.Data, lpRequest->Image.Capacity);
+	}
+
+	delete lpRequest;
+}
\ No newline at end of file
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "TextureDecoder.h"
+
+#define ASSET_LOAD_MAX_THREAD 16
+#define ASSET_LOAD_DEFAULT_THREAD 2
+#define ASSET_LOAD_DEFAULT_IO 2 // Reads in flight at once, more only make a hard disk seek between them
+#define ASSET_LOAD_DISPATCH_TIME 2 // Milliseconds of callbacks per frame, the rest waits for the next one
+
+enum eAssetLoadPriority
+{
+	ASSET_PRIORITY_VISIBLE = 0,
+	ASSET_PRIORITY_PREFETCH = 1,
+	ASSET_PRIORITY_BACKGROUND = 2,
+	ASSET_PRIORITY_MAX = 3,
+};
+
+enum eAssetLoadType
+{
+	ASSET_LOAD_FILE = 0,
+	ASSET_LOAD_TEXTURE = 1,
+};
+
+enum eAssetLoadState
+{
+	ASSET_LOAD_QUEUED = 0,
+	ASSET_LOAD_LOADING = 1,
+	ASSET_LOAD_DONE = 2,
+	ASSET_LOAD_CANCELED = 3, // Still loading with nobody left waiting, a new request takes it back
+};
+
+struct ASSET_LOAD_RESULT
+{
+	DWORD Ticket;
+	char* Path;
+	bool Success;
+	BYTE* Data; // The file as read, freed when the callbacks return
+	DWORD Size;
+	TEXTURE_IMAGE Image; // A callback that keeps the image sets Image.Data to 0 and frees it with FreeImage later
+};
+
+typedef void(*ASSET_LOAD_CALLBACK)(ASSET_LOAD_RESULT* lpResult, void* param);
+
+typedef bool(*ASSET_LOAD_READER)(char* path, std::vector<BYTE>& data);
+
+struct ASSET_LOAD_WAITER
+{
+	DWORD Ticket;
+	DWORD Group;
+	ASSET_LOAD_CALLBACK Callback;
+	void* Param;
+};
+
+struct ASSET_LOAD_REQUEST
+{
+	DWORD Index;
+	std::string Name;
+	char Path[MAX_PATH];
+	int Type;
+	int Priority;
+	int State;
+	bool Success;
+	std::vector<BYTE> Data;
+	TEXTURE_IMAGE Image;
+	std::vector<ASSET_LOAD_WAITER> Waiter;
+};
+
+struct ASSET_LOAD_STAT
+{
+	DWORD RequestCount;
+	DWORD CoalescedCount; // Requests for a file already queued or loading
+	DWORD CanceledCount; // Requests dropped before their callback
+	DWORD ReadCount;
+	DWORD WastedCount; // Files read for requests canceled while they loaded
+	DWORD CallbackCount;
+};
+
+class CAssetLoader
+{
+public:
+
+	CAssetLoader();
+
+	~CAssetLoader();
+
+	bool Start(int ThreadCount, int IoCount);
+
+	void Stop();
+
+	void SetReader(ASSET_LOAD_READER reader);
+
+	DWORD Request(char* path, int type, int priority, DWORD group, ASSET_LOAD_CALLBACK callback, void* param);
+
+	void Cancel(DWORD ticket);
+
+	void CancelGroup(DWORD group);
+
+	int Dispatch(DWORD MaxTime);
+
+	void FreeImage(TEXTURE_IMAGE* lpImage);
+
+	int GetPendingCount();
+
+	void GetStat(ASSET_LOAD_STAT* lpStat);
+
+	static bool ReadAsset(char* path, std::vector<BYTE>& data);
+
+private:
+
+	static DWORD WINAPI WorkerThread(LPVOID lpParam);
+
+	bool PopRequest(ASSET_LOAD_REQUEST** lpRequest);
+
+	bool RemoveWaiter(ASSET_LOAD_REQUEST* lpRequest, DWORD ticket, DWORD group);
+
+	void DeleteRequest(ASSET_LOAD_REQUEST* lpRequest);
+
+private:
+
+	HANDLE m_Thread[ASSET_LOAD_MAX_THREAD];
+
+	int m_ThreadCount;
+
+	HANDLE m_StopEvent;
+
+	HANDLE m_JobSemaphore; // One count per queue entry, entries left behind by a cancel or a priority raise are skipped
+
+	HANDLE m_IoSemaphore;
+
+	ASSET_LOAD_READER m_Reader;
+
+	DWORD m_NextIndex;
+
+	DWORD m_NextTicket;
+
+	std::deque<DWORD> m_Queue[ASSET_PRIORITY_MAX];
+
+	std::map<DWORD, ASSET_LOAD_REQUEST*> m_Request;
+
+	std::map<std::string, ASSET_LOAD_REQUEST*> m_Name;
+
+	std::map<DWORD, DWORD> m_Ticket;
+
+	std::deque<DWORD> m_Done;
+
+	ASSET_LOAD_STAT m_Stat;
+
+	CTextureBufferPool m_BufferPool;
+
+	CRITICAL_SECTION m_Lock;
+};
+
+extern CAssetLoader gAssetLoader;
\ No newline at end of file
@@ -0,0 +1,550 @@
+#include "stdafx.h"
+#include "BcEncoder.h"
+#include <emmintrin.h>
+
+static WORD PackColor(float r, float g, float b)
+{
+	int r5 = (int)(((r < 0.0f) ? 0.0f : ((r > 255.0f) ? 255.0f : r)) * (31.0f / 255.0f) + 0.5f);
+
+	int g6 = (int)(((g < 0.0f) ? 0.0f : ((g > 255.0f) ? 255.0f : g)) * (63.0f / 255.0f) + 0.5f);
+
+	int b5 = (int)(((b < 0.0f) ? 0.0f : ((b > 255.0f) ? 255.0f : b)) * (31.0f / 255.0f) + 0.5f);
+
+	return (WORD)((r5 << 11) | (g6 << 5) | b5);
+}
+
+static void UnpackColor(WORD color, BYTE* rgb)
+{
+	int r5 = (color >> 11) & 31;
+
+	int g6 = (color >> 5) & 63;
+
+	int b5 = color & 31;
+
+	rgb[0] = (BYTE)((r5 << 3) | (r5 >> 2));
+
+	rgb[1] = (BYTE)((g6 << 2) | (g6 >> 4));
+
+	rgb[2] = (BYTE)((b5 << 3) | (b5 >> 2));
+}
+
+DWORD CBcEncoder::GetImageSize(int width, int height, bool alpha)
+{
+	return ((width + 3) / 4) * ((height + 3) / 4) * ((alpha != 0) ? BC3_BLOCK_SIZE : BC1_BLOCK_SIZE);
+}
+
+void CBcEncoder::EncodeImage(BYTE* rgba, int width, int height, bool alpha, BYTE* output)
+{
+	BYTE block[64];
+
+	for (int by = 0; by < height; by += 4)
+	{
+		for (int bx = 0; bx < width; bx += 4)
+		{
+			// Blocks hanging over the edge repeat the last row and column
+			for (int y = 0; y < 4; y++)
+			{
+				int sy = (((by + y) < height) ? (by + y) : (height - 1));
+
+				for (int x = 0; x < 4; x++)
+				{
+					int sx = (((bx + x) < width) ? (bx + x) : (width - 1));
+
+					*(DWORD*)&block[((y * 4) + x) * 4] = *(DWORD*)&rgba[((sy * width) + sx) * 4];
+				}
+			}
+
+			CBcEncoder::EncodeBlock(block, alpha, output);
+
+			output += ((alpha != 0) ? BC3_BLOCK_SIZE : BC1_BLOCK_SIZE);
+		}
+	}
+}
+
+void CBcEncoder::DecodeImage(BYTE* input, int width, int height, bool alpha, BYTE* rgba)
+{
+	BYTE block[64];
+
+	for (int by = 0; by < height; by += 4)
+	{
+		for (int bx = 0; bx < width; bx += 4)
+		{
+			CBcEncoder::DecodeBlock(input, alpha, block);
+
+			input += ((alpha != 0) ? BC3_BLOCK_SIZE : BC1_BLOCK_SIZE);
+
+			for (int y = 0; y < 4 && (by + y) < height; y++)
+			{
+				for (int x = 0; x < 4 && (bx + x) < width; x++)
+				{
+					*(DWORD*)&rgba[(((by + y) * width) + bx + x) * 4] = *(DWORD*)&block[((y * 4) + x) * 4];
+				}
+			}
+		}
+	}
+}
+
+void CBcEncoder::EncodeBlock(BYTE* block, bool alpha, BYTE* output)
+{
+	if (alpha != 0)
+	{
+		CBcEncoder::EncodeAlpha(block, output);
+
+		output += 8;
+	}
+
+	CBcEncoder::EncodeColor(block, output);
+}
+
+void CBcEncoder::DecodeBlock(BYTE* input, bool alpha, BYTE* block)
+{
+	BYTE value[8];
+
+	if (alpha != 0)
+	{
+		value[0] = input[0];
+
+		value[1] = input[1];
+
+		for (int n = 0; n < 6; n++)
+		{
+			value[2 + n] = (BYTE)((value[0] > value[1]) ? ((((6 - n) * value[0]) + ((n + 1) * value[1])) / 7) : ((n < 4) ? ((((4 - n) * value[0]) + ((n + 1) * value[1])) / 5) : ((n == 4) ? 0 : 255)));
+		}
+
+		QWORD bits = 0;
+
+		memcpy(&bits, &input[2], 6);
+
+		for (int n = 0; n < 16; n++)
+		{
+			block[(n * 4) + 3] = value[(bits >> (n * 3)) & 7];
+		}
+
+		input += 8;
+	}
+
+	WORD c0 = input[0] | (input[1] << 8);
+
+	WORD c1 = input[2] | (input[3] << 8);
+
+	DWORD index = input[4] | (input[5] << 8) | (input[6] << 16) | (input[7] << 24);
+
+	BYTE palette[16];
+
+	CBcEncoder::BuildPalette(c0, c1, palette);
+
+	if (alpha == 0 && c0 <= c1)
+	{
+		// Three color mode, only plain BC1 honours it
+		for (int n = 0; n < 3; n++)
+		{
+			palette[8 + n] = (BYTE)((palette[n] + palette[4 + n]) / 2);
+
+			palette[12 + n] = 0;
+		}
+
+		palette[15] = 0;
+	}
+
+	for (int n = 0; n < 16; n++)
+	{
+		BYTE* color = &palette[((index >> (n * 2)) & 3) * 4];
+
+		block[(n * 4) + 0] = color[0];
+		block[(n * 4) + 1] = color[1];
+		block[(n * 4) + 2] = color[2];
+
+		if (alpha == 0)
+		{
+			block[(n * 4) + 3] = color[3];
+		}
+	}
+}
+
+void CBcEncoder::GetError(BYTE* source, BYTE* decoded, int width, int height, BC_ERROR* lpError)
+{
+	for (int n = 0; n < (width * height); n++)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			int d = source[i] - decoded[i];
+
+			lpError->Color += d * d;
+		}
+
+		int d = source[3] - decoded[3];
+
+		lpError->Alpha += d * d;
+
+		source += 4;
+
+		decoded += 4;
+	}
+
+	lpError->PixelCount += width * height;
+}
+
+double CBcEncoder::GetPsnr(QWORD error, QWORD count)
+{
+	if (count == 0 || error == 0)
+	{
+		return 99.0;
+	}
+
+	return 10.0 * log10((255.0 * 255.0) / ((double)error / (double)count));
+}
+
+void CBcEncoder::EncodeColor(BYTE* block, BYTE* output)
+{
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+
+	int min[3] = { 255, 255, 255 };
+
+	int max[3] = { 0, 0, 0 };
+
+	for (int n = 0; n < 16; n++)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			int value = block[(n * 4) + i];
+
+			mean[i] += value;
+
+			min[i] = ((value < min[i]) ? value : min[i]);
+
+			max[i] = ((value > max[i]) ? value : max[i]);
+		}
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		mean[i] /= 16.0f;
+	}
+
+	// Principal axis of the block colors, a few power iterations on the covariance are enough for 16 points
+	float cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+
+	for (int n = 0; n < 16; n++)
+	{
+		float r = block[(n * 4) + 0] - mean[0];
+
+		float g = block[(n * 4) + 1] - mean[1];
+
+		float b = block[(n * 4) + 2] - mean[2];
+
+		cov[0] += r * r;
+		cov[1] += r * g;
+		cov[2] += r * b;
+		cov[3] += g * g;
+		cov[4] += g * b;
+		cov[5] += b * b;
+	}
+
+	float axis[3] = { (float)(max[0] - min[0]), (float)(max[1] - min[1]), (float)(max[2] - min[2]) };
+
+	for (int n = 0; n < 4; n++)
+	{
+		float r = (axis[0] * cov[0]) + (axis[1] * cov[1]) + (axis[2] * cov[2]);
+
+		float g = (axis[0] * cov[1]) + (axis[1] * cov[3]) + (axis[2] * cov[4]);
+
+		float b = (axis[0] * cov[2]) + (axis[1] * cov[4]) + (axis[2] * cov[5]);
+
+		float scale = ((fabs(r) > fabs(g)) ? fabs(r) : fabs(g));
+
+		scale = ((fabs(b) > scale) ? fabs(b) : scale);
+
+		if (scale < 1e-6f)
+		{
+			break;
+		}
+
+		axis[0] = r / scale;
+
+		axis[1] = g / scale;
+
+		axis[2] = b / scale;
+	}
+
+	int MinIndex = 0;
+
+	int MaxIndex = 0;
+
+	float MinDot = 1e30f;
+
+	float MaxDot = -1e30f;
+
+	for (int n = 0; n < 16; n++)
+	{
+		float dot = (block[(n * 4) + 0] * axis[0]) + (block[(n * 4) + 1] * axis[1]) + (block[(n * 4) + 2] * axis[2]);
+
+		if (dot < MinDot)
+		{
+			MinDot = dot;
+			MinIndex = n;
+		}
+
+		if (dot > MaxDot)
+		{
+			MaxDot = dot;
+			MaxIndex = n;
+		}
+	}
+
+	WORD c0 = PackColor(block[(MaxIndex * 4) + 0], block[(MaxIndex * 4) + 1], block[(MaxIndex * 4) + 2]);
+
+	WORD c1 = PackColor(block[(MinIndex * 4) + 0], block[(MinIndex * 4) + 1], block[(MinIndex * 4) + 2]);
+
+	BYTE palette[16];
+
+	CBcEncoder::BuildPalette(c0, c1, palette);
+
+	DWORD BestIndex = 0;
+
+	DWORD BestError = CBcEncoder::MatchPalette(block, palette, &BestIndex);
+
+	WORD BestC0 = c0;
+
+	WORD BestC1 = c1;
+
+	// Least squares refit of the endpoints against the chosen indices, kept only when the error drops
+	for (int n = 0; n < BC_REFINE_COUNT && BestError != 0; n++)
+	{
+		if (CBcEncoder::FitEndpoints(block, BestIndex, &c0, &c1) == 0)
+		{
+			break;
+		}
+
+		CBcEncoder::BuildPalette(c0, c1, palette);
+
+		DWORD index = 0;
+
+		DWORD error = CBcEncoder::MatchPalette(block, palette, &index);
+
+		if (error >= BestError)
+		{
+			break;
+		}
+
+		BestError = error;
+
+		BestIndex = index;
+
+		BestC0 = c0;
+
+		BestC1 = c1;
+	}
+
+	if (BestC0 < BestC1)
+	{
+		WORD swap = BestC0;
+
+		BestC0 = BestC1;
+
+		BestC1 = swap;
+
+		BestIndex ^= 0x55555555;
+	}
+	else if (BestC0 == BestC1)
+	{
+		BestIndex = 0;
+	}
+
+	output[0] = (BYTE)BestC0;
+	output[1] = (BYTE)(BestC0 >> 8);
+	output[2] = (BYTE)BestC1;
+	output[3] = (BYTE)(BestC1 >> 8);
+	output[4] = (BYTE)BestIndex;
+	output[5] = (BYTE)(BestIndex >> 8);
+	output[6] = (BYTE)(BestIndex >> 16);
+	output[7] = (BYTE)(BestIndex >> 24);
+}
+
+void CBcEncoder::EncodeAlpha(BYTE* block, BYTE* output)
+{
+	int min = 255;
+
+	int max = 0;
+
+	for (int n = 0; n < 16; n++)
+	{
+		int value = block[(n * 4) + 3];
+
+		min = ((value < min) ? value : min);
+
+		max = ((value > max) ? value : max);
+	}
+
+	output[0] = (BYTE)max;
+
+	output[1] = (BYTE)min;
+
+	QWORD bits = 0;
+
+	if (max > min)
+	{
+		int range = max - min;
+
+		for (int n = 0; n < 16; n++)
+		{
+			// Position on the min..max ramp, 7 is the first endpoint, 0 the second
+			int t = ((((block[(n * 4) + 3] - min) * 14) + range) / (range * 2));
+
+			QWORD index = ((t == 7) ? 0 : ((t == 0) ? 1 : (8 - t)));
+
+			bits |= index << (n * 3);
+		}
+	}
+
+	memcpy(&output[2], &bits, 6);
+}
+
+void CBcEncoder::BuildPalette(WORD c0, WORD c1, BYTE* palette)
+{
+	UnpackColor(c0, &palette[0]);
+
+	UnpackColor(c1, &palette[4]);
+
+	for (int n = 0; n < 3; n++)
+	{
+		palette[8 + n] = (BYTE)(((2 * palette[n]) + palette[4 + n]) / 3);
+
+		palette[12 + n] = (BYTE)((palette[n] + (2 * palette[4 + n])) / 3);
+	}
+
+	palette[3] = 0xFF;
+	palette[7] = 0xFF;
+	palette[11] = 0xFF;
+	palette[15] = 0xFF;
+}
+
+DWORD CBcEncoder::MatchPalette(BYTE* block, BYTE* palette, DWORD* index)
+{
+	// Squared RGB distance of four pixels against each palette entry, two pixels per vector of words
+	__m128i zero = _mm_setzero_si128();
+
+	__m128i mask = _mm_set1_epi32(0x00FFFFFF);
+
+	__m128i color[4];
+
+	for (int n = 0; n < 4; n++)
+	{
+		__m128i entry = _mm_and_si128(_mm_set1_epi32(*(int*)&palette[n * 4]), mask);
+
+		color[n] = _mm_unpacklo_epi8(entry, zero);
+	}
+
+	__m128i total = zero;
+
+	DWORD result = 0;
+
+	for (int n = 0; n < 4; n++)
+	{
+		__m128i pixel = _mm_and_si128(_mm_loadu_si128((__m128i*)&block[n * 16]), mask);
+
+		__m128i lo = _mm_unpacklo_epi8(pixel, zero);
+
+		__m128i hi = _mm_unpackhi_epi8(pixel, zero);
+
+		__m128i best = _mm_set1_epi32(0x7FFFFFFF);
+
+		__m128i select = zero;
+
+		for (int i = 0; i < 4; i++)
+		{
+			__m128i dl = _mm_sub_epi16(lo, color[i]);
+
+			__m128i dh = _mm_sub_epi16(hi, color[i]);
+
+			__m128 sl = _mm_castsi128_ps(_mm_madd_epi16(dl, dl));
+
+			__m128 sh = _mm_castsi128_ps(_mm_madd_epi16(dh, dh));
+
+			__m128i distance = _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(sl, sh, _MM_SHUFFLE(2, 0, 2, 0))), _mm_castps_si128(_mm_shuffle_ps(sl, sh, _MM_SHUFFLE(3, 1, 3, 1))));
+
+			__m128i closer = _mm_cmplt_epi32(distance, best);
+
+			best = _mm_or_si128(_mm_and_si128(closer, distance), _mm_andnot_si128(closer, best));
+
+			select = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(i)), _mm_andnot_si128(closer, select));
+		}
+
+		total = _mm_add_epi32(total, best);
+
+		int lane[4];
+
+		_mm_storeu_si128((__m128i*)lane, select);
+
+		for (int i = 0; i < 4; i++)
+		{
+			result |= lane[i] << (((n * 4) + i) * 2);
+		}
+	}
+
+	*index = result;
+
+	total = _mm_add_epi32(total, _mm_shuffle_epi32(total, _MM_SHUFFLE(1, 0, 3, 2)));
+
+	total = _mm_add_epi32(total, _mm_shuffle_epi32(total, _MM_SHUFFLE(2, 3, 0, 1)));
+
+	return _mm_cvtsi128_si32(total);
+}
+
+bool CBcEncoder::FitEndpoints(BYTE* block, DWORD index, WORD* c0, WORD* c1)
+{
+	static const float weight[4] = { 0.0f, 1.0f, (1.0f / 3.0f), (2.0f / 3.0f) };
+
+	float aa = 0.0f;
+
+	float ab = 0.0f;
+
+	float bb = 0.0f;
+
+	float ax[3] = { 0.0f, 0.0f, 0.0f };
+
+	float bx[3] = { 0.0f, 0.0f, 0.0f };
+
+	for (int n = 0; n < 16; n++)
+	{
+		float b = weight[(index >> (n * 2)) & 3];
+
+		float a = 1.0f - b;
+
+		aa += a * a;
+
+		ab += a * b;
+
+		bb += b * b;
+
+		for (int i = 0; i < 3; i++)
+		{
+			ax[i] += a * block[(n * 4) + i];
+
+			bx[i] += b * block[(n * 4) + i];
+		}
+	}
+
+	float det = (aa * bb) - (ab * ab);
+
+	if (fabs(det) < 1e-6f)
+	{
+		return false;
+	}
+
+	float e0[3];
+
+	float e1[3];
+
+	for (int i = 0; i < 3; i++)
+	{
+		e0[i] = ((ax[i] * bb) - (bx[i] * ab)) / det;
+
+		e1[i] = ((bx[i] * aa) - (ax[i] * ab)) / det;
+	}
+
+	*c0 = PackColor(e0[0], e0[1], e0[2]);
+
+	*c1 = PackColor(e1[0], e1[1], e1[2]);
+
+	return true;
+}
\ No newline at end of file
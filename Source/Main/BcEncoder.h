@@ -0,0 +1,43 @@
+#pragma once
+
+#define BC1_BLOCK_SIZE 8
+#define BC3_BLOCK_SIZE 16
+#define BC_REFINE_COUNT 2
+
+struct BC_ERROR
+{
+	QWORD Color;
+	QWORD Alpha;
+	QWORD PixelCount;
+};
+
+class CBcEncoder
+{
+public:
+
+	static DWORD GetImageSize(int width, int height, bool alpha);
+
+	static void EncodeImage(BYTE* rgba, int width, int height, bool alpha, BYTE* output);
+
+	static void DecodeImage(BYTE* input, int width, int height, bool alpha, BYTE* rgba);
+
+	static void EncodeBlock(BYTE* block, bool alpha, BYTE* output);
+
+	static void DecodeBlock(BYTE* input, bool alpha, BYTE* block);
+
+	static void GetError(BYTE* source, BYTE* decoded, int width, int height, BC_ERROR* lpError);
+
+	static double GetPsnr(QWORD error, QWORD count);
+
+private:
+
+	static void EncodeColor(BYTE* block, BYTE* output);
+
+	static void EncodeAlpha(BYTE* block, BYTE* output);
+
+	static void BuildPalette(WORD c0, WORD c1, BYTE* palette);
+
+	static DWORD MatchPalette(BYTE* block, BYTE* palette, DWORD* index);
+
+	static bool FitEndpoints(BYTE* block, DWORD index, WORD* c0, WORD* c1);
+};
\ No newline at end of file
@@ -0,0 +1,637 @@
+#include "stdafx.h"
+#include "BmdAnimation.h"
+#include "BmdSkin.h"
+#include <xmmintrin.h>
+
+#define BMD_ROTATION_RANGE 0.70710678f
+#define BMD_ROTATION_MAX ((1 << BMD_ANIMATION_ROTATION_BITS) - 1)
+
+CBmdAnimation::CBmdAnimation()
+{
+	this->m_Arena = 0;
+
+	this->Clear();
+}
+
+CBmdAnimation::~CBmdAnimation()
+{
+	this->Clear();
+}
+
+bool CBmdAnimation::Build(CBmdModel* lpModel)
+{
+	this->Clear();
+
+	DWORD BoneCount = lpModel->GetBoneCount();
+
+	DWORD ActionCount = lpModel->GetActionCount();
+
+	this->m_BoneCount = BoneCount;
+
+	this->m_LaneCount = (BoneCount + 3) & ~3;
+
+	this->m_Action.resize(ActionCount);
+
+	this->m_Track.resize(ActionCount * BoneCount);
+
+	for (DWORD n = 0; n < ActionCount; n++)
+	{
+		BMD_ANIMATION_ACTION* lpAction = &this->m_Action[n];
+
+		lpAction->KeyCount = lpModel->GetAction(n)->KeyCount;
+
+		// Positions share one fixed point range per action, the range is the bounding box of every bone key
+		float min[3] = { 0.0f, 0.0f, 0.0f };
+
+		float max[3] = { 0.0f, 0.0f, 0.0f };
+
+		bool first = 1;
+
+		for (DWORD b = 0; b < BoneCount; b++)
+		{
+			BMD_BONE_KEY* lpKey = lpModel->GetBoneKey(b, n);
+
+			if (lpKey == 0)
+			{
+				continue;
+			}
+
+			for (DWORD k = 0; k < lpAction->KeyCount; k++)
+			{
+				const float* p = &lpKey->Position.Get(k)->X;
+
+				for (int i = 0; i < 3; i++)
+				{
+					min[i] = ((first != 0 || p[i] < min[i]) ? p[i] : min[i]);
+
+					max[i] = ((first != 0 || p[i] > max[i]) ? p[i] : max[i]);
+				}
+
+				first = 0;
+			}
+		}
+
+		for (int i = 0; i < 3; i++)
+		{
+			lpAction->Range[i] = min[i];
+
+			lpAction->Range[i + 3] = (max[i] - min[i]) / 65535.0f;
+		}
+
+		for (DWORD b = 0; b < BoneCount; b++)
+		{
+			BMD_ANIMATION_TRACK* lpTrack = &this->m_Track[(n * BoneCount) + b];
+
+			BMD_BONE_KEY* lpKey = lpModel->GetBoneKey(b, n);
+
+			lpTrack->Rotation = this->m_Rotation.size();
+
+			lpTrack->Position = this->m_Position.size();
+
+			lpTrack->Flags = 0;
+
+			if (lpKey == 0 || lpAction->KeyCount == 0)
+			{
+				lpTrack->Flags = BMD_TRACK_DUMMY;
+				continue;
+			}
+
+			this->m_SourceSize += lpKey->Position.GetSize() + lpKey->Rotation.GetSize();
+
+			// Bones that never move during an action only keep their first key
+			bool constant[2] = { 1, 1 };
+
+			for (DWORD k = 1; k < lpAction->KeyCount; k++)
+			{
+				constant[0] = (constant[0] != 0 && memcmp(lpKey->Rotation.Get(k), lpKey->Rotation.Get(0), sizeof(BMD_VECTOR)) == 0);
+
+				constant[1] = (constant[1] != 0 && memcmp(lpKey->Position.Get(k), lpKey->Position.Get(0), sizeof(BMD_VECTOR)) == 0);
+			}
+
+			lpTrack->Flags |= ((constant[0] != 0) ? BMD_TRACK_CONSTANT_ROTATION : 0);
+
+			lpTrack->Flags |= ((constant[1] != 0) ? BMD_TRACK_CONSTANT_POSITION : 0);
+
+			DWORD RotationCount = (((lpTrack->Flags & BMD_TRACK_CONSTANT_ROTATION) != 0) ? 1 : lpAction->KeyCount);
+
+			DWORD PositionCount = (((lpTrack->Flags & BMD_TRACK_CONSTANT_POSITION) != 0) ? 1 : lpAction->KeyCount);
+
+			for (DWORD k = 0; k < RotationCount; k++)
+			{
+				float q[4];
+
+				AngleQuaternion(lpKey->Rotation.Get(k), q);
+
+				WORD packed[3];
+
+				this->PackRotation(q, packed);
+
+				this->m_Rotation.insert(this->m_Rotation.end(), packed, (packed + 3));
+			}
+
+			float range[6];
+
+			memcpy(range, lpAction->Range, sizeof(range));
+
+			if ((lpTrack->Flags & BMD_TRACK_CONSTANT_POSITION) == 0 && (range[3] > BMD_ANIMATION_POSITION_ERROR || range[4] > BMD_ANIMATION_POSITION_ERROR || range[5] > BMD_ANIMATION_POSITION_ERROR))
+			{
+				// The action range is too wide for this budget, the track gets its own range in front of its keys
+				for (int i = 0; i < 3; i++)
+				{
+					float min = (&lpKey->Position.Get(0)->X)[i];
+
+					float max = min;
+
+					for (DWORD k = 1; k < PositionCount; k++)
+					{
+						float value = (&lpKey->Position.Get(k)->X)[i];
+
+						min = ((value < min) ? value : min);
+
+						max = ((value > max) ? value : max);
+					}
+
+					range[i] = min;
+
+					range[i + 3] = (max - min) / 65535.0f;
+				}
+
+				lpTrack->Flags |= BMD_TRACK_LOCAL_RANGE;
+
+				// A track that travels too far for 16 bits even on its own range keeps float keys
+				if (range[3] > BMD_ANIMATION_POSITION_ERROR || range[4] > BMD_ANIMATION_POSITION_ERROR || range[5] > BMD_ANIMATION_POSITION_ERROR)
+				{
+					lpTrack->Flags = (lpTrack->Flags & ~BMD_TRACK_LOCAL_RANGE) | BMD_TRACK_FLOAT_POSITION;
+
+					this->m_Position.insert(this->m_Position.end(), (WORD*)lpKey->Position.GetData(), ((WORD*)lpKey->Position.GetData() + (PositionCount * BMD_TRACK_FLOAT_SIZE)));
+
+					continue;
+				}
+
+				this->m_Position.insert(this->m_Position.end(), (WORD*)range, ((WORD*)range + BMD_TRACK_RANGE_SIZE));
+			}
+
+			for (DWORD k = 0; k < PositionCount; k++)
+			{
+				const float* p = &lpKey->Position.Get(k)->X;
+
+				for (int i = 0; i < 3; i++)
+				{
+					float value = ((range[i + 3] > 0.0f) ? ((p[i] - range[i]) / range[i + 3]) : 0.0f);
+
+					value = ((value < 0.0f) ? 0.0f : ((value > 65535.0f) ? 65535.0f : value));
+
+					this->m_Position.push_back((WORD)(value + 0.5f));
+				}
+			}
+		}
+	}
+
+	// Check every key against the source so the store never goes over the error budget
+	for (DWORD n = 0; n < ActionCount; n++)
+	{
+		for (DWORD b = 0; b < BoneCount; b++)
+		{
+			BMD_BONE_KEY* lpKey = lpModel->GetBoneKey(b, n);
+
+			if (lpKey == 0)
+			{
+				continue;
+			}
+
+			for (DWORD k = 0; k < this->m_Action[n].KeyCount; k++)
+			{
+				float q[4], source[4];
+
+				BMD_VECTOR position;
+
+				this->GetKey(b, n, k, q, &position);
+
+				AngleQuaternion(lpKey->Rotation.Get(k), source);
+
+				float angle = this->GetRotationDelta(q, source);
+
+				this->m_RotationError = ((angle > this->m_RotationError) ? angle : this->m_RotationError);
+
+				const BMD_VECTOR* p = lpKey->Position.Get(k);
+
+				float error[3] = { fabs(position.X - p->X), fabs(position.Y - p->Y), fabs(position.Z - p->Z) };
+
+				for (int i = 0; i < 3; i++)
+				{
+					this->m_PositionError = ((error[i] > this->m_PositionError) ? error[i] : this->m_PositionError);
+				}
+			}
+		}
+	}
+
+	DWORD size = this->m_LaneCount * 7 * 3;
+
+	this->m_Arena = (float*)_aligned_malloc(((size > 0) ? size : 4) * sizeof(float), 16);
+
+	if (this->m_Arena == 0)
+	{
+		this->Clear();
+		return false;
+	}
+
+	memset(this->m_Arena, 0, (size * sizeof(float)));
+
+	BMD_ANIMATION_POSE* pose[3] = { &this->m_Key[0], &this->m_Key[1], &this->m_Pose };
+
+	for (int n = 0; n < 3; n++)
+	{
+		float** stream = &pose[n]->X;
+
+		for (int i = 0; i < 7; i++)
+		{
+			stream[i] = this->m_Arena + (((n * 7) + i) * this->m_LaneCount);
+		}
+
+		// Padding lanes hold a packed identity rotation in the key buffers
+		for (DWORD i = 0; i < this->m_LaneCount; i++)
+		{
+			pose[n]->X[i] = ((n < 2) ? (BMD_ROTATION_MAX * 0.5f) : 0.0f);
+			pose[n]->Y[i] = ((n < 2) ? (BMD_ROTATION_MAX * 0.5f) : 0.0f);
+			pose[n]->Z[i] = ((n < 2) ? (BMD_ROTATION_MAX * 0.5f) : 0.0f);
+			pose[n]->W[i] = ((n < 2) ? 3.0f : 1.0f);
+		}
+	}
+
+	return (this->m_RotationError <= BMD_ANIMATION_ROTATION_ERROR && this->m_PositionError <= BMD_ANIMATION_POSITION_ERROR);
+}
+
+void CBmdAnimation::Clear()
+{
+	if (this->m_Arena != 0)
+	{
+		_aligned_free(this->m_Arena);
+	}
+
+	this->m_Arena = 0;
+
+	this->m_BoneCount = 0;
+
+	this->m_LaneCount = 0;
+
+	this->m_SourceSize = 0;
+
+	this->m_RotationError = 0.0f;
+
+	this->m_PositionError = 0.0f;
+
+	this->m_Action.clear();
+
+	this->m_Track.clear();
+
+	this->m_Rotation.clear();
+
+	this->m_Position.clear();
+
+	memset(this->m_Key, 0, sizeof(this->m_Key));
+
+	memset(&this->m_Pose, 0, sizeof(this->m_Pose));
+}
+
+float CBmdAnimation::GetRotationDelta(const float* a, const float* b)
+{
+	// acos of the dot product has no precision left near zero, the chord length does
+	float d1 = 0.0f, d2 = 0.0f;
+
+	for (int n = 0; n < 4; n++)
+	{
+		d1 += (a[n] - b[n]) * (a[n] - b[n]);
+
+		d2 += (a[n] + b[n]) * (a[n] + b[n]);
+	}
+
+	float chord = sqrt((d1 < d2) ? d1 : d2) * 0.5f;
+
+	return 4.0f * asin((chord > 1.0f) ? 1.0f : chord);
+}
+
+void CBmdAnimation::PackRotation(const float* q, WORD* lpOut)
+{
+	// Smallest three, the largest component is rebuilt from the other three and its index goes in the top bits
+	int largest = 0;
+
+	for (int n = 1; n < 4; n++)
+	{
+		largest = ((fabs(q[n]) > fabs(q[largest])) ? n : largest);
+	}
+
+	float sign = ((q[largest] < 0.0f) ? -1.0f : 1.0f);
+
+	for (int n = 0, i = 0; n < 4; n++)
+	{
+		if (n == largest)
+		{
+			continue;
+		}
+
+		float value = (((q[n] * sign) / BMD_ROTATION_RANGE) + 1.0f) * 0.5f;
+
+		value = ((value < 0.0f) ? 0.0f : ((value > 1.0f) ? 1.0f : value));
+
+		lpOut[i++] = (WORD)((value * BMD_ROTATION_MAX) + 0.5f);
+	}
+
+	lpOut[0] |= (WORD)((largest & 1) << 15);
+
+	lpOut[1] |= (WORD)((largest >> 1) << 15);
+}
+
+void CBmdAnimation::UnpackRotation(const WORD* lpIn, float* q)
+{
+	int largest = (lpIn[0] >> 15) | ((lpIn[1] >> 15) << 1);
+
+	float sum = 0.0f;
+
+	for (int n = 0, i = 0; n < 4; n++)
+	{
+		if (n == largest)
+		{
+			continue;
+		}
+
+		q[n] = ((((lpIn[i++] & BMD_ROTATION_MAX) * (2.0f / BMD_ROTATION_MAX)) - 1.0f) * BMD_ROTATION_RANGE);
+
+		sum += q[n] * q[n];
+	}
+
+	q[largest] = sqrt((sum < 1.0f) ? (1.0f - sum) : 0.0f);
+}
+
+bool CBmdAnimation::GetKey(DWORD bone, DWORD action, DWORD key, float* q, BMD_VECTOR* lpPosition)
+{
+	if (bone >= this->m_BoneCount || action >= this->m_Action.size() || key >= this->m_Action[action].KeyCount)
+	{
+		return false;
+	}
+
+	this->DecodeTrack(&this->m_Action[action], &this->m_Track[(action * this->m_BoneCount) + bone], key, q, lpPosition);
+
+	return true;
+}
+
+void CBmdAnimation::DecodeTrack(BMD_ANIMATION_ACTION* lpAction, BMD_ANIMATION_TRACK* lpTrack, DWORD key, float* q, BMD_VECTOR* lpPosition)
+{
+	if ((lpTrack->Flags & BMD_TRACK_DUMMY) != 0)
+	{
+		q[0] = 0.0f;
+		q[1] = 0.0f;
+		q[2] = 0.0f;
+		q[3] = 1.0f;
+	}
+	else
+	{
+		this->UnpackRotation(&this->m_Rotation[lpTrack->Rotation + ((((lpTrack->Flags & BMD_TRACK_CONSTANT_ROTATION) != 0) ? 0 : key) * 3)], q);
+	}
+
+	this->DecodePosition(lpAction, lpTrack, key, lpPosition);
+}
+
+void CBmdAnimation::DecodePosition(BMD_ANIMATION_ACTION* lpAction, BMD_ANIMATION_TRACK* lpTrack, DWORD key, BMD_VECTOR* lpPosition)
+{
+	if ((lpTrack->Flags & BMD_TRACK_DUMMY) != 0)
+	{
+		memset(lpPosition, 0, sizeof(BMD_VECTOR));
+		return;
+	}
+
+	key = (((lpTrack->Flags & BMD_TRACK_CONSTANT_POSITION) != 0) ? 0 : key);
+
+	if ((lpTrack->Flags & BMD_TRACK_FLOAT_POSITION) != 0)
+	{
+		memcpy(lpPosition, &this->m_Position[lpTrack->Position + (key * BMD_TRACK_FLOAT_SIZE)], sizeof(BMD_VECTOR));
+		return;
+	}
+
+	const float* range = lpAction->Range;
+
+	const WORD* p = &this->m_Position[lpTrack->Position];
+
+	if ((lpTrack->Flags & BMD_TRACK_LOCAL_RANGE) != 0)
+	{
+		range = (const float*)p;
+
+		p += BMD_TRACK_RANGE_SIZE;
+	}
+
+	p += key * 3;
+
+	lpPosition->X = range[0] + (p[0] * range[3]);
+	lpPosition->Y = range[1] + (p[1] * range[4]);
+	lpPosition->Z = range[2] + (p[2] * range[5]);
+}
+
+static __m128 SelectLane(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static void UnpackLane(BMD_ANIMATION_POSE* lpPose, DWORD n, __m128* q)
+{
+	// Same reconstruction as UnpackRotation for four packed keys, the largest index selects where the rebuilt component goes
+	__m128 scale = _mm_set1_ps((2.0f / BMD_ROTATION_MAX) * BMD_ROTATION_RANGE);
+
+	__m128 bias = _mm_set1_ps(-BMD_ROTATION_RANGE);
+
+	__m128 a = _mm_add_ps(_mm_mul_ps(_mm_load_ps(&lpPose->X[n]), scale), bias);
+	__m128 b = _mm_add_ps(_mm_mul_ps(_mm_load_ps(&lpPose->Y[n]), scale), bias);
+	__m128 c = _mm_add_ps(_mm_mul_ps(_mm_load_ps(&lpPose->Z[n]), scale), bias);
+
+	__m128 sum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, a), _mm_mul_ps(b, b)), _mm_mul_ps(c, c));
+
+	__m128 r = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(1.0f), sum), _mm_setzero_ps()));
+
+	__m128 largest = _mm_load_ps(&lpPose->W[n]);
+
+	__m128 m0 = _mm_cmpeq_ps(largest, _mm_set1_ps(0.0f));
+	__m128 m1 = _mm_cmpeq_ps(largest, _mm_set1_ps(1.0f));
+	__m128 m2 = _mm_cmpeq_ps(largest, _mm_set1_ps(2.0f));
+	__m128 m3 = _mm_cmpeq_ps(largest, _mm_set1_ps(3.0f));
+
+	q[0] = SelectLane(m0, r, a);
+	q[1] = SelectLane(m0, a, SelectLane(m1, r, b));
+	q[2] = SelectLane(m2, r, SelectLane(m3, c, b));
+	q[3] = SelectLane(m3, r, c);
+}
+
+bool CBmdAnimation::Sample(DWORD action, float frame)
+{
+	if (action >= this->m_Action.size() || this->m_Action[action].KeyCount == 0)
+	{
+		return false;
+	}
+
+	DWORD KeyCount = this->m_Action[action].KeyCount;
+
+	frame = ((frame < 0.0f) ? 0.0f : frame);
+
+	DWORD key1 = ((DWORD)frame) % KeyCount;
+
+	DWORD key2 = (key1 + 1) % KeyCount;
+
+	BMD_ANIMATION_ACTION* lpAction = &this->m_Action[action];
+
+	BMD_ANIMATION_TRACK* lpTrack = &this->m_Track[action * this->m_BoneCount];
+
+	DWORD key[2] = { key1, key2 };
+
+	for (DWORD n = 0; n < this->m_BoneCount; n++)
+	{
+		BMD_ANIMATION_TRACK* lpBoneTrack = &lpTrack[n];
+
+		for (int i = 0; i < 2; i++)
+		{
+			BMD_ANIMATION_POSE* lpPose = &this->m_Key[i];
+
+			BMD_VECTOR position;
+
+			this->DecodePosition(lpAction, lpBoneTrack, key[i], &position);
+
+			lpPose->PX[n] = position.X;
+			lpPose->PY[n] = position.Y;
+			lpPose->PZ[n] = position.Z;
+
+			// Rotations stay packed here, UnpackLane rebuilds them four at a time
+			if ((lpBoneTrack->Flags & BMD_TRACK_DUMMY) != 0)
+			{
+				lpPose->X[n] = BMD_ROTATION_MAX * 0.5f;
+				lpPose->Y[n] = BMD_ROTATION_MAX * 0.5f;
+				lpPose->Z[n] = BMD_ROTATION_MAX * 0.5f;
+				lpPose->W[n] = 3.0f;
+				continue;
+			}
+
+			const WORD* p = &this->m_Rotation[lpBoneTrack->Rotation + ((((lpBoneTrack->Flags & BMD_TRACK_CONSTANT_ROTATION) != 0) ? 0 : key[i]) * 3)];
+
+			lpPose->X[n] = (float)(p[0] & BMD_ROTATION_MAX);
+			lpPose->Y[n] = (float)(p[1] & BMD_ROTATION_MAX);
+			lpPose->Z[n] = (float)(p[2] & BMD_ROTATION_MAX);
+			lpPose->W[n] = (float)((p[0] >> 15) | ((p[1] >> 15) << 1));
+		}
+	}
+
+	// Normalised lerp on the shortest arc with a corrected blend factor, four bones per step
+	BMD_ANIMATION_POSE* a = &this->m_Key[0];
+
+	BMD_ANIMATION_POSE* b = &this->m_Key[1];
+
+	BMD_ANIMATION_POSE* o = &this->m_Pose;
+
+	__m128 t = _mm_set1_ps(frame - floor(frame));
+
+	__m128 th = _mm_sub_ps(t, _mm_set1_ps(0.5f));
+
+	__m128 t1 = _mm_sub_ps(t, _mm_set1_ps(1.0f));
+
+	__m128 one = _mm_set1_ps(1.0f);
+
+	__m128 sign = _mm_set1_ps(-0.0f);
+
+	for (DWORD n = 0; n < this->m_LaneCount; n += 4)
+	{
+		__m128 qa[4], qb[4];
+
+		UnpackLane(a, n, qa);
+
+		UnpackLane(b, n, qb);
+
+		__m128 ax = qa[0], ay = qa[1], az = qa[2], aw = qa[3];
+		__m128 bx = qb[0], by = qb[1], bz = qb[2], bw = qb[3];
+
+		__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+
+		__m128 flip = _mm_and_ps(dot, sign);
+
+		bx = _mm_xor_ps(bx, flip);
+		by = _mm_xor_ps(by, flip);
+		bz = _mm_xor_ps(bz, flip);
+		bw = _mm_xor_ps(bw, flip);
+
+		// The blend factor is bent towards slerp with a fitted polynomial of the key angle
+		__m128 d = _mm_andnot_ps(sign, dot);
+
+		__m128 A = _mm_add_ps(_mm_set1_ps(1.0904f), _mm_mul_ps(d, _mm_add_ps(_mm_set1_ps(-3.2452f), _mm_mul_ps(d, _mm_sub_ps(_mm_set1_ps(3.55645f), _mm_mul_ps(d, _mm_set1_ps(1.43519f)))))));
+
+		__m128 B = _mm_add_ps(_mm_set1_ps(0.848013f), _mm_mul_ps(d, _mm_add_ps(_mm_set1_ps(-1.06021f), _mm_mul_ps(d, _mm_set1_ps(0.215638f)))));
+
+		__m128 k = _mm_add_ps(_mm_mul_ps(A, _mm_mul_ps(th, th)), B);
+
+		__m128 ot = _mm_add_ps(t, _mm_mul_ps(_mm_mul_ps(t, _mm_mul_ps(th, t1)), k));
+
+		__m128 x = _mm_add_ps(ax, _mm_mul_ps(_mm_sub_ps(bx, ax), ot));
+		__m128 y = _mm_add_ps(ay, _mm_mul_ps(_mm_sub_ps(by, ay), ot));
+		__m128 z = _mm_add_ps(az, _mm_mul_ps(_mm_sub_ps(bz, az), ot));
+		__m128 w = _mm_add_ps(aw, _mm_mul_ps(_mm_sub_ps(bw, aw), ot));
+
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w))));
+
+		__m128 scale = _mm_div_ps(one, length);
+
+		_mm_store_ps(&o->X[n], _mm_mul_ps(x, scale));
+		_mm_store_ps(&o->Y[n], _mm_mul_ps(y, scale));
+		_mm_store_ps(&o->Z[n], _mm_mul_ps(z, scale));
+		_mm_store_ps(&o->W[n], _mm_mul_ps(w, scale));
+
+		__m128 px = _mm_load_ps(&a->PX[n]), py = _mm_load_ps(&a->PY[n]), pz = _mm_load_ps(&a->PZ[n]);
+
+		_mm_store_ps(&o->PX[n], _mm_add_ps(px, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&b->PX[n]), px), t)));
+		_mm_store_ps(&o->PY[n], _mm_add_ps(py, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&b->PY[n]), py), t)));
+		_mm_store_ps(&o->PZ[n], _mm_add_ps(pz, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&b->PZ[n]), pz), t)));
+	}
+
+	return true;
+}
+
+void CBmdAnimation::GetRotation(DWORD bone, float* q)
+{
+	q[0] = this->m_Pose.X[bone];
+	q[1] = this->m_Pose.Y[bone];
+	q[2] = this->m_Pose.Z[bone];
+	q[3] = this->m_Pose.W[bone];
+}
+
+void CBmdAnimation::GetPosition(DWORD bone, BMD_VECTOR* lpPosition)
+{
+	lpPosition->X = this->m_Pose.PX[bone];
+	lpPosition->Y = this->m_Pose.PY[bone];
+	lpPosition->Z = this->m_Pose.PZ[bone];
+}
+
+DWORD CBmdAnimation::GetBoneCount()
+{
+	return this->m_BoneCount;
+}
+
+DWORD CBmdAnimation::GetActionCount()
+{
+	return this->m_Action.size();
+}
+
+DWORD CBmdAnimation::GetKeyCount(DWORD action)
+{
+	return ((action < this->m_Action.size()) ? this->m_Action[action].KeyCount : 0);
+}
+
+DWORD CBmdAnimation::GetSourceSize()
+{
+	return this->m_SourceSize;
+}
+
+DWORD CBmdAnimation::GetDataSize()
+{
+	return (this->m_Action.size() * sizeof(BMD_ANIMATION_ACTION)) + (this->m_Track.size() * sizeof(BMD_ANIMATION_TRACK)) + ((this->m_Rotation.size() + this->m_Position.size()) * sizeof(WORD));
+}
+
+float CBmdAnimation::GetRotationError()
+{
+	return this->m_RotationError;
+}
+
+float CBmdAnimation::GetPositionError()
+{
+	return this->m_PositionError;
+}
\ No newline at end of file
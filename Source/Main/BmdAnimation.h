@@ -0,0 +1,113 @@
+#pragma once
+
+#include "BmdModel.h"
+
+#define BMD_ANIMATION_ROTATION_BITS 15
+#define BMD_ANIMATION_ROTATION_ERROR 0.001f // radians
+#define BMD_ANIMATION_POSITION_ERROR 0.01f // model units
+
+#define BMD_TRACK_DUMMY 0x01
+#define BMD_TRACK_CONSTANT_ROTATION 0x02
+#define BMD_TRACK_CONSTANT_POSITION 0x04
+#define BMD_TRACK_LOCAL_RANGE 0x08
+#define BMD_TRACK_FLOAT_POSITION 0x10
+
+#define BMD_TRACK_RANGE_SIZE ((sizeof(float) * 6) / sizeof(WORD))
+#define BMD_TRACK_FLOAT_SIZE (sizeof(BMD_VECTOR) / sizeof(WORD))
+
+struct BMD_ANIMATION_ACTION
+{
+	DWORD KeyCount;
+	float Range[6]; // minimum and step for X, Y, Z
+};
+
+struct BMD_ANIMATION_TRACK
+{
+	DWORD Rotation;
+	DWORD Position;
+	DWORD Flags;
+};
+
+struct BMD_ANIMATION_POSE
+{
+	float* X;
+	float* Y;
+	float* Z;
+	float* W;
+	float* PX;
+	float* PY;
+	float* PZ;
+};
+
+class CBmdAnimation
+{
+public:
+
+	CBmdAnimation();
+
+	~CBmdAnimation();
+
+	bool Build(CBmdModel* lpModel);
+
+	void Clear();
+
+	bool Sample(DWORD action, float frame);
+
+	void GetRotation(DWORD bone, float* q);
+
+	void GetPosition(DWORD bone, BMD_VECTOR* lpPosition);
+
+	bool GetKey(DWORD bone, DWORD action, DWORD key, float* q, BMD_VECTOR* lpPosition);
+
+	DWORD GetBoneCount();
+
+	DWORD GetActionCount();
+
+	DWORD GetKeyCount(DWORD action);
+
+	DWORD GetSourceSize();
+
+	DWORD GetDataSize();
+
+	float GetRotationError();
+
+	float GetPositionError();
+
+	static float GetRotationDelta(const float* a, const float* b);
+
+private:
+
+	void PackRotation(const float* q, WORD* lpOut);
+
+	void UnpackRotation(const WORD* lpIn, float* q);
+
+	void DecodeTrack(BMD_ANIMATION_ACTION* lpAction, BMD_ANIMATION_TRACK* lpTrack, DWORD key, float* q, BMD_VECTOR* lpPosition);
+
+	void DecodePosition(BMD_ANIMATION_ACTION* lpAction, BMD_ANIMATION_TRACK* lpTrack, DWORD key, BMD_VECTOR* lpPosition);
+
+private:
+
+	std::vector<BMD_ANIMATION_ACTION> m_Action;
+
+	std::vector<BMD_ANIMATION_TRACK> m_Track;
+
+	std::vector<WORD> m_Rotation;
+
+	std::vector<WORD> m_Position;
+
+	DWORD m_BoneCount;
+
+	DWORD m_LaneCount;
+
+	DWORD m_SourceSize;
+
+	float m_RotationError;
+
+	float m_PositionError;
+
+	float* m_Arena;
+
+	BMD_ANIMATION_POSE m_Key[2];
+
+	BMD_ANIMATION_POSE m_Pose;
+};
\ No newline at end of file
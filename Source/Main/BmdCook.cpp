@@ -0,0 +1,666 @@
+#include "stdafx.h"
+#include "BmdCook.h"
+#include <algorithm>
+
+static DWORD AlignCookOffset(DWORD offset)
+{
+	return ((offset + (BMD_COOK_ALIGN - 1)) & ~(BMD_COOK_ALIGN - 1));
+}
+
+static short PackCookNormal(float value)
+{
+	value = ((value < -1.0f) ? -1.0f : ((value > 1.0f) ? 1.0f : value));
+
+	return (short)floor((value * 32767.0f) + 0.5f);
+}
+
+bool CBmdCook::CookFile(char* path, BMD_COOK_INFO* lpInfo)
+{
+	CMappedFile file;
+
+	if (file.Open(path) == 0)
+	{
+		return false;
+	}
+
+	CBmdModel model;
+
+	if (model.Open(file.GetData(), file.GetSize()) == 0)
+	{
+		return false;
+	}
+
+	CCRC32 CRC32;
+
+	DWORD crc = CRC32.FullCRC(file.GetData(), file.GetSize());
+
+	std::vector<BYTE> data;
+
+	if (CBmdCook::Cook(&model, crc, file.GetSize(), data, lpInfo) == 0)
+	{
+		return false;
+	}
+
+	char CookPath[MAX_PATH];
+
+	wsprintf(CookPath, "%s%s", path, BMD_COOK_EXTENSION);
+
+	char temp[MAX_PATH];
+
+	wsprintf(temp, "%s.tmp", CookPath);
+
+	HANDLE handle = CreateFile(temp, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_ARCHIVE, 0);
+
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	DWORD OutSize = 0;
+
+	if (WriteFile(handle, &data[0], data.size(), &OutSize, 0) == 0 || OutSize != data.size())
+	{
+		CloseHandle(handle);
+		DeleteFile(temp);
+		return false;
+	}
+
+	CloseHandle(handle);
+
+	if (MoveFileEx(temp, CookPath, MOVEFILE_REPLACE_EXISTING) == 0)
+	{
+		DeleteFile(temp);
+		return false;
+	}
+
+	lpInfo->SourceCRC = crc;
+
+	lpInfo->SourceSize = file.GetSize();
+
+	lpInfo->CookedSize = data.size();
+
+	return true;
+}
+
+bool CBmdCook::Cook(CBmdModel* lpModel, DWORD crc, DWORD size, std::vector<BYTE>& data, BMD_COOK_INFO* lpInfo)
+{
+	memset(lpInfo, 0, sizeof(BMD_COOK_INFO));
+
+	// The weld key packs each index into 15 bits, an index outside its array would spill into the next field
+	if (lpModel->Validate() == 0)
+	{
+		return false;
+	}
+
+	DWORD MeshCount = lpModel->GetMeshCount();
+
+	std::vector<std::vector<BMD_COOK_VERTEX>> VertexList(MeshCount);
+
+	std::vector<std::vector<WORD>> IndexList(MeshCount);
+
+	std::vector<BMD_COOK_MESH> MeshList(MeshCount);
+
+	DWORD offset = AlignCookOffset(sizeof(BMD_COOK_HEADER) + (MeshCount * sizeof(BMD_COOK_MESH)));
+
+	for (DWORD n = 0; n < MeshCount; n++)
+	{
+		BMD_MESH* lpMesh = lpModel->GetMesh(n);
+
+		lpInfo->CornerCount += CBmdCook::WeldMesh(lpMesh, VertexList[n], IndexList[n]);
+
+		if (VertexList[n].size() > 0xFFFF)
+		{
+			return false;
+		}
+
+		DWORD IndexCount = IndexList[n].size();
+
+		if (IndexCount > 0)
+		{
+			lpInfo->SourceMiss += CBmdCook::GetCacheMiss(&IndexList[n][0], IndexCount, BMD_COOK_CACHE_SIZE);
+
+			CBmdCook::OptimizeVertexCache(&IndexList[n][0], IndexCount, VertexList[n].size());
+
+			lpInfo->CookedMiss += CBmdCook::GetCacheMiss(&IndexList[n][0], IndexCount, BMD_COOK_CACHE_SIZE);
+		}
+
+		lpInfo->VertexCount += VertexList[n].size();
+
+		lpInfo->TriangleCount += IndexCount / 3;
+
+		BMD_COOK_MESH* lpCookMesh = &MeshList[n];
+
+		memset(lpCookMesh, 0, sizeof(BMD_COOK_MESH));
+
+		lpCookMesh->VertexOffset = offset;
+
+		lpCookMesh->VertexCount = VertexList[n].size();
+
+		offset = AlignCookOffset(offset + (lpCookMesh->VertexCount * sizeof(BMD_COOK_VERTEX)));
+
+		lpCookMesh->IndexOffset = offset;
+
+		lpCookMesh->IndexCount = IndexCount;
+
+		offset = AlignCookOffset(offset + (IndexCount * sizeof(WORD)));
+
+		lpCookMesh->Texture = lpMesh->Texture;
+
+		memcpy(lpCookMesh->TextureName, lpMesh->TextureName, BMD_NAME_SIZE);
+	}
+
+	data.assign(offset, 0);
+
+	BMD_COOK_HEADER* lpHeader = (BMD_COOK_HEADER*)&data[0];
+
+	lpHeader->Magic = BMD_COOK_MAGIC;
+
+	lpHeader->Version = BMD_COOK_VERSION;
+
+	lpHeader->MeshCount = (WORD)MeshCount;
+
+	lpHeader->SourceCRC = crc;
+
+	lpHeader->SourceSize = size;
+
+	for (DWORD n = 0; n < MeshCount; n++)
+	{
+		memcpy(&data[sizeof(BMD_COOK_HEADER) + (n * sizeof(BMD_COOK_MESH))], &MeshList[n], sizeof(BMD_COOK_MESH));
+
+		if (MeshList[n].VertexCount > 0)
+		{
+			memcpy(&data[MeshList[n].VertexOffset], &VertexList[n][0], (MeshList[n].VertexCount * sizeof(BMD_COOK_VERTEX)));
+		}
+
+		if (MeshList[n].IndexCount > 0)
+		{
+			memcpy(&data[MeshList[n].IndexOffset], &IndexList[n][0], (MeshList[n].IndexCount * sizeof(WORD)));
+		}
+	}
+
+	return true;
+}
+
+DWORD CBmdCook::WeldMesh(BMD_MESH* lpMesh, std::vector<BMD_COOK_VERTEX>& vertex, std::vector<WORD>& index)
+{
+	// Every corner is keyed by its (vertex, normal, texcoord) triple, sorting the keys welds identical corners
+	// Cook has validated the indices, each one is below its array's short count and fits 15 bits
+	std::vector<QWORD> corner;
+
+	for (DWORD n = 0; n < lpMesh->Triangle.GetCount(); n++)
+	{
+		const BMD_TRIANGLE* lpTriangle = lpMesh->Triangle.Get(n);
+
+		int order[6] = { 0, 1, 2, 0, 2, 3 };
+
+		int count = ((lpTriangle->Polygon == 4) ? 6 : 3);
+
+		for (int i = 0; i < count; i++)
+		{
+			int c = order[i];
+
+			QWORD key = ((QWORD)(WORD)lpTriangle->VertexIndex[c] << 49) | ((QWORD)(WORD)lpTriangle->NormalIndex[c] << 34) | ((QWORD)(WORD)lpTriangle->TexCoordIndex[c] << 19);
+
+			corner.push_back(key | corner.size());
+		}
+	}
+
+	std::sort(corner.begin(), corner.end());
+
+	index.resize(corner.size());
+
+	vertex.clear();
+
+	QWORD last = (QWORD)-1;
+
+	for (DWORD n = 0; n < corner.size(); n++)
+	{
+		QWORD key = corner[n] >> 19;
+
+		if (key != last)
+		{
+			last = key;
+
+			const BMD_VERTEX* lpVertex = lpMesh->Vertex.Get((DWORD)(key >> 30));
+
+			const BMD_NORMAL* lpNormal = lpMesh->Normal.Get((DWORD)(key >> 15) & 0x7FFF);
+
+			const BMD_TEXCOORD* lpTexCoord = lpMesh->TexCoord.Get((DWORD)key & 0x7FFF);
+
+			BMD_COOK_VERTEX info;
+
+			memset(&info, 0, sizeof(info));
+
+			if (lpVertex != 0)
+			{
+				info.Position[0] = lpVertex->Position.X;
+				info.Position[1] = lpVertex->Position.Y;
+				info.Position[2] = lpVertex->Position.Z;
+				info.Node = (BYTE)lpVertex->Node;
+			}
+
+			if (lpNormal != 0)
+			{
+				info.Normal[0] = PackCookNormal(lpNormal->Normal.X);
+				info.Normal[1] = PackCookNormal(lpNormal->Normal.Y);
+				info.Normal[2] = PackCookNormal(lpNormal->Normal.Z);
+				info.NormalNode = (BYTE)lpNormal->Node;
+			}
+
+			if (lpTexCoord != 0)
+			{
+				info.TexCoord[0] = lpTexCoord->U;
+				info.TexCoord[1] = lpTexCoord->V;
+			}
+
+			vertex.push_back(info);
+		}
+
+		index[(DWORD)(corner[n] & 0x7FFFF)] = (WORD)(vertex.size() - 1);
+	}
+
+	return corner.size();
+}
+
+static float GetVertexCacheScore(int CachePosition, int remaining)
+{
+	// Forsyth linear-speed vertex cache optimisation scoring
+	if (remaining == 0)
+	{
+		return -1.0f;
+	}
+
+	float score = 0.0f;
+
+	if (CachePosition >= 0)
+	{
+		if (CachePosition < 3)
+		{
+			score = 0.75f;
+		}
+		else
+		{
+			score = pow(1.0f - ((float)(CachePosition - 3) / (BMD_COOK_CACHE_SIZE - 3)), 1.5f);
+		}
+	}
+
+	return (score + (2.0f * pow((float)remaining, -0.5f)));
+}
+
+void CBmdCook::OptimizeVertexCache(WORD* index, DWORD IndexCount, DWORD VertexCount)
+{
+	DWORD TriangleCount = IndexCount / 3;
+
+	std::vector<int> remaining(VertexCount, 0);
+
+	std::vector<int> offset(VertexCount + 1, 0);
+
+	for (DWORD n = 0; n < IndexCount; n++)
+	{
+		offset[index[n] + 1]++;
+	}
+
+	for (DWORD n = 0; n < VertexCount; n++)
+	{
+		offset[n + 1] += offset[n];
+
+		remaining[n] = offset[n + 1] - offset[n];
+	}
+
+	std::vector<DWORD> adjacency(IndexCount);
+
+	std::vector<int> fill(offset.begin(), (offset.end() - 1));
+
+	for (DWORD n = 0; n < IndexCount; n++)
+	{
+		adjacency[fill[index[n]]++] = n / 3;
+	}
+
+	std::vector<int> position(VertexCount, -1);
+
+	std::vector<float> VertexScore(VertexCount);
+
+	for (DWORD n = 0; n < VertexCount; n++)
+	{
+		VertexScore[n] = GetVertexCacheScore(-1, remaining[n]);
+	}
+
+	std::vector<float> TriangleScore(TriangleCount);
+
+	std::vector<BYTE> added(TriangleCount, 0);
+
+	for (DWORD n = 0; n < TriangleCount; n++)
+	{
+		TriangleScore[n] = VertexScore[index[(n * 3) + 0]] + VertexScore[index[(n * 3) + 1]] + VertexScore[index[(n * 3) + 2]];
+	}
+
+	std::vector<WORD> output;
+
+	output.reserve(IndexCount);
+
+	int cache[BMD_COOK_CACHE_SIZE + 3];
+
+	int CacheCount = 0;
+
+	DWORD scan = 0;
+
+	while (output.size() < IndexCount)
+	{
+		int best = -1;
+
+		float BestScore = -1.0f;
+
+		for (int n = 0; n < CacheCount; n++)
+		{
+			int v = cache[n];
+
+			for (int i = offset[v]; i < offset[v + 1]; i++)
+			{
+				DWORD t = adjacency[i];
+
+				if (added[t] == 0 && TriangleScore[t] > BestScore)
+				{
+					BestScore = TriangleScore[t];
+
+					best = t;
+				}
+			}
+		}
+
+		if (best < 0)
+		{
+			while (scan < TriangleCount && added[scan] != 0)
+			{
+				scan++;
+			}
+
+			best = scan;
+		}
+
+		added[best] = 1;
+
+		int NewCache[BMD_COOK_CACHE_SIZE + 3];
+
+		int NewCount = 0;
+
+		for (int i = 0; i < 3; i++)
+		{
+			int v = index[(best * 3) + i];
+
+			output.push_back((WORD)v);
+
+			NewCache[NewCount++] = v;
+
+			remaining[v]--;
+		}
+
+		for (int n = 0; n < CacheCount; n++)
+		{
+			int v = cache[n];
+
+			if (v != NewCache[0] && v != NewCache[1] && v != NewCache[2])
+			{
+				NewCache[NewCount++] = v;
+			}
+		}
+
+		for (int n = 0; n < NewCount; n++)
+		{
+			position[NewCache[n]] = ((n < BMD_COOK_CACHE_SIZE) ? n : -1);
+		}
+
+		CacheCount = ((NewCount < BMD_COOK_CACHE_SIZE) ? NewCount : BMD_COOK_CACHE_SIZE);
+
+		memcpy(cache, NewCache, (CacheCount * sizeof(int)));
+
+		for (int n = 0; n < NewCount; n++)
+		{
+			int v = NewCache[n];
+
+			float score = GetVertexCacheScore(position[v], remaining[v]);
+
+			float delta = score - VertexScore[v];
+
+			VertexScore[v] = score;
+
+			for (int i = offset[v]; i < offset[v + 1]; i++)
+			{
+				TriangleScore[adjacency[i]] += delta;
+			}
+		}
+	}
+
+	memcpy(index, &output[0], (IndexCount * sizeof(WORD)));
+}
+
+DWORD CBmdCook::GetCacheMiss(WORD* index, DWORD IndexCount, DWORD CacheSize)
+{
+	// Simulates a FIFO post-transform cache, which is what the fixed function pipeline uses
+	std::vector<int> stamp(0x10000, -1);
+
+	int time = 0;
+
+	DWORD miss = 0;
+
+	for (DWORD n = 0; n < IndexCount; n++)
+	{
+		if (stamp[index[n]] < 0 || (time - stamp[index[n]]) >= (int)CacheSize)
+		{
+			stamp[index[n]] = time++;
+
+			miss++;
+		}
+	}
+
+	return miss;
+}
+
+CBmdCookedModel::CBmdCookedModel()
+{
+	this->m_Data = 0;
+
+	this->m_Header = 0;
+
+	this->m_Mesh = 0;
+
+	memset(&this->m_Shared, 0, sizeof(this->m_Shared));
+}
+
+CBmdCookedModel::~CBmdCookedModel()
+{
+	this->Close();
+}
+
+bool CBmdCookedModel::Open(char* path, DWORD crc, DWORD size)
+{
+	this->Close();
+
+	if (this->m_File.Open(path) == 0)
+	{
+		return false;
+	}
+
+	if (this->Parse(this->m_File.GetData(), this->m_File.GetSize(), crc, size) == 0)
+	{
+		this->Close();
+
+		return false;
+	}
+
+	return true;
+}
+
+bool CBmdCookedModel::OpenShared(char* path)
+{
+	// A cooked file on disk is already shared by the system cache, otherwise the model is cooked once for every client running
+	this->Close();
+
+	CMappedFile file;
+
+	if (file.Open(path) == 0)
+	{
+		return false;
+	}
+
+	CCRC32 CRC32;
+
+	DWORD crc = CRC32.FullCRC(file.GetData(), file.GetSize());
+
+	char CookPath[MAX_PATH];
+
+	wsprintf(CookPath, "%s%s", path, BMD_COOK_EXTENSION);
+
+	if (this->Open(CookPath, crc, file.GetSize()) != 0)
+	{
+		return true;
+	}
+
+	SHARED_CACHE_KEY key;
+
+	key.Crc = crc;
+
+	key.Size = file.GetSize();
+
+	key.Kind = SHARED_CACHE_MODEL;
+
+	key.Param = 0;
+
+	if (gSharedCache.Acquire(&key, &this->m_Shared) != 0)
+	{
+		if (this->Parse(this->m_Shared.Data, this->m_Shared.Size, crc, file.GetSize()) != 0)
+		{
+			return true;
+		}
+
+		this->Close();
+	}
+
+	CBmdModel model;
+
+	if (model.Open(file.GetData(), file.GetSize()) == 0)
+	{
+		return false;
+	}
+
+	BMD_COOK_INFO info;
+
+	memset(&info, 0, sizeof(info));
+
+	if (CBmdCook::Cook(&model, crc, file.GetSize(), this->m_Local, &info) == 0)
+	{
+		return false;
+	}
+
+	if (gSharedCache.Publish(&key, &this->m_Local[0], this->m_Local.size(), 0, &this->m_Shared) != 0)
+	{
+		std::vector<BYTE>().swap(this->m_Local);
+
+		if (this->Parse(this->m_Shared.Data, this->m_Shared.Size, crc, file.GetSize()) != 0)
+		{
+			return true;
+		}
+
+		this->Close();
+
+		return false;
+	}
+
+	if (this->Parse(&this->m_Local[0], this->m_Local.size(), crc, file.GetSize()) == 0)
+	{
+		this->Close();
+
+		return false;
+	}
+
+	return true;
+}
+
+void CBmdCookedModel::Close()
+{
+	this->m_File.Close();
+
+	gSharedCache.Release(&this->m_Shared);
+
+	std::vector<BYTE>().swap(this->m_Local);
+
+	this->m_Data = 0;
+
+	this->m_Header = 0;
+
+	this->m_Mesh = 0;
+}
+
+DWORD CBmdCookedModel::GetMeshCount()
+{
+	return ((this->m_Header != 0) ? this->m_Header->MeshCount : 0);
+}
+
+BMD_COOK_MESH* CBmdCookedModel::GetMesh(DWORD index)
+{
+	return ((index < this->GetMeshCount()) ? &this->m_Mesh[index] : 0);
+}
+
+BMD_COOK_VERTEX* CBmdCookedModel::GetVertex(BMD_COOK_MESH* lpMesh)
+{
+	return (BMD_COOK_VERTEX*)(this->m_Data + lpMesh->VertexOffset);
+}
+
+WORD* CBmdCookedModel::GetIndex(BMD_COOK_MESH* lpMesh)
+{
+	return (WORD*)(this->m_Data + lpMesh->IndexOffset);
+}
+
+bool CBmdCookedModel::Parse(BYTE* data, DWORD FileSize, DWORD crc, DWORD size)
+{
+	BMD_COOK_HEADER* lpHeader = (BMD_COOK_HEADER*)data;
+
+	if (FileSize < sizeof(BMD_COOK_HEADER) || lpHeader->Magic != BMD_COOK_MAGIC || lpHeader->Version != BMD_COOK_VERSION)
+	{
+		return false;
+	}
+
+	if (lpHeader->SourceCRC != crc || lpHeader->SourceSize != size)
+	{
+		return false;
+	}
+
+	if ((sizeof(BMD_COOK_HEADER) + (lpHeader->MeshCount * sizeof(BMD_COOK_MESH))) > FileSize)
+	{
+		return false;
+	}
+
+	BMD_COOK_MESH* lpMeshList = (BMD_COOK_MESH*)(data + sizeof(BMD_COOK_HEADER));
+
+	for (DWORD n = 0; n < lpHeader->MeshCount; n++)
+	{
+		BMD_COOK_MESH* lpMesh = &lpMeshList[n];
+
+		if (lpMesh->VertexOffset > FileSize || lpMesh->VertexCount > ((FileSize - lpMesh->VertexOffset) / sizeof(BMD_COOK_VERTEX)))
+		{
+			return false;
+		}
+
+		if (lpMesh->IndexOffset > FileSize || lpMesh->IndexCount > ((FileSize - lpMesh->IndexOffset) / sizeof(WORD)))
+		{
+			return false;
+		}
+
+		WORD* index = (WORD*)(data + lpMesh->IndexOffset);
+
+		for (DWORD i = 0; i < lpMesh->IndexCount; i++)
+		{
+			if (index[i] >= lpMesh->VertexCount)
+			{
+				return false;
+			}
+		}
+	}
+
+	this->m_Data = data;
+
+	this->m_Header = lpHeader;
+
+	this->m_Mesh = lpMeshList;
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "BmdModel.h"
+#include "CCRC32.H"
+#include "SharedCache.h"
+
+#define BMD_COOK_MAGIC 0x43444D42 // "BMDC"
+#define BMD_COOK_VERSION 1
+#define BMD_COOK_EXTENSION ".bmc"
+#define BMD_COOK_ALIGN 16
+#define BMD_COOK_CACHE_SIZE 32
+
+struct BMD_COOK_HEADER
+{
+	DWORD Magic;
+	WORD Version;
+	WORD MeshCount;
+	DWORD SourceCRC;
+	DWORD SourceSize;
+};
+
+struct BMD_COOK_MESH
+{
+	DWORD VertexOffset;
+	DWORD VertexCount;
+	DWORD IndexOffset;
+	DWORD IndexCount;
+	short Texture;
+	short Padding;
+	char TextureName[BMD_NAME_SIZE];
+};
+
+struct BMD_COOK_VERTEX
+{
+	float Position[3];
+	float TexCoord[2];
+	short Normal[3];
+	BYTE Node;
+	BYTE NormalNode;
+};
+
+struct BMD_COOK_INFO
+{
+	DWORD SourceCRC;
+	DWORD SourceSize;
+	DWORD CookedSize;
+	DWORD CornerCount;
+	DWORD VertexCount;
+	DWORD TriangleCount;
+	DWORD SourceMiss;
+	DWORD CookedMiss;
+};
+
+class CBmdCook
+{
+public:
+
+	static bool CookFile(char* path, BMD_COOK_INFO* lpInfo);
+
+	static bool Cook(CBmdModel* lpModel, DWORD crc, DWORD size, std::vector<BYTE>& data, BMD_COOK_INFO* lpInfo);
+
+	static void OptimizeVertexCache(WORD* index, DWORD IndexCount, DWORD VertexCount);
+
+	static DWORD GetCacheMiss(WORD* index, DWORD IndexCount, DWORD CacheSize);
+
+private:
+
+	static DWORD WeldMesh(BMD_MESH* lpMesh, std::vector<BMD_COOK_VERTEX>& vertex, std::vector<WORD>& index);
+};
+
+class CBmdCookedModel
+{
+public:
+
+	CBmdCookedModel();
+
+	~CBmdCookedModel();
+
+	bool Open(char* path, DWORD crc, DWORD size);
+
+	bool OpenShared(char* path);
+
+	void Close();
+
+	DWORD GetMeshCount();
+
+	BMD_COOK_MESH* GetMesh(DWORD index);
+
+	BMD_COOK_VERTEX* GetVertex(BMD_COOK_MESH* lpMesh);
+
+	WORD* GetIndex(BMD_COOK_MESH* lpMesh);
+
+private:
+
+	bool Parse(BYTE* data, DWORD FileSize, DWORD crc, DWORD size);
+
+private:
+
+	CMappedFile m_File;
+
+	std::vector<BYTE> m_Local; // Cooked here when the shared cache is not open
+
+	SHARED_CACHE_DATA m_Shared;
+
+	BYTE* m_Data;
+
+	BMD_COOK_HEADER* m_Header;
+
+	BMD_COOK_MESH* m_Mesh;
+};
\ No newline at end of file
@@ -0,0 +1,421 @@
+#include "stdafx.h"
+#include "BmdModel.h"
+#include "FileCrypt.h"
+
+CBmdModel::CBmdModel()
+{
+	this->m_Decrypted = 0;
+
+	this->m_Data = 0;
+
+	this->m_Size = 0;
+
+	this->m_Offset = 0;
+
+	this->m_Version = 0;
+
+	memset(this->m_Name, 0, sizeof(this->m_Name));
+}
+
+CBmdModel::~CBmdModel()
+{
+	this->Close();
+}
+
+bool CBmdModel::Open(char* path)
+{
+	this->Close();
+
+	if (this->m_File.Open(path) == 0)
+	{
+		return false;
+	}
+
+	if (this->Parse(this->m_File.GetData(), this->m_File.GetSize()) == 0)
+	{
+		this->Close();
+
+		return false;
+	}
+
+	return true;
+}
+
+bool CBmdModel::Open(BYTE* data, DWORD size)
+{
+	this->Close();
+
+	if (this->Parse(data, size) == 0)
+	{
+		this->Close();
+
+		return false;
+	}
+
+	return true;
+}
+
+void CBmdModel::Close()
+{
+	this->m_File.Close();
+
+	if (this->m_Decrypted != 0)
+	{
+		delete[] this->m_Decrypted;
+
+		this->m_Decrypted = 0;
+	}
+
+	this->m_Data = 0;
+
+	this->m_Size = 0;
+
+	this->m_Offset = 0;
+
+	this->m_Version = 0;
+
+	memset(this->m_Name, 0, sizeof(this->m_Name));
+
+	this->m_Mesh.clear();
+
+	this->m_Bone.clear();
+
+	this->m_Action.clear();
+
+	this->m_BoneKey.clear();
+}
+
+bool CBmdModel::Parse(BYTE* data, DWORD size)
+{
+	if (size < 4 || data[0] != 'B' || data[1] != 'M' || data[2] != 'D')
+	{
+		return false;
+	}
+
+	this->m_Version = data[3];
+
+	if (this->m_Version == BMD_VERSION_ENCRYPTED)
+	{
+		// Encrypted models carry their payload size and need a private copy to decrypt into
+		if (size < 8)
+		{
+			return false;
+		}
+
+		DWORD EncryptedSize = *(DWORD*)(data + 4);
+
+		if (EncryptedSize > (size - 8))
+		{
+			return false;
+		}
+
+		this->m_Decrypted = new BYTE[EncryptedSize];
+
+		MapFileDecrypt(this->m_Decrypted, (data + 8), EncryptedSize);
+
+		this->m_Data = this->m_Decrypted;
+
+		this->m_Size = EncryptedSize;
+
+		this->m_Offset = 0;
+	}
+	else if (this->m_Version == BMD_VERSION || this->m_Version == BMD_VERSION_EMPTY)
+	{
+		this->m_Data = data;
+
+		this->m_Size = size;
+
+		this->m_Offset = 4;
+	}
+	else
+	{
+		return false;
+	}
+
+	BYTE* name = this->Read(BMD_NAME_SIZE);
+
+	BYTE* count = this->Read(sizeof(short) * 3);
+
+	if (name == 0 || count == 0)
+	{
+		return false;
+	}
+
+	memcpy(this->m_Name, name, BMD_NAME_SIZE);
+
+	short MeshCount = ((short*)count)[0];
+
+	short BoneCount = ((short*)count)[1];
+
+	short ActionCount = ((short*)count)[2];
+
+	if (MeshCount < 0 || BoneCount < 0 || ActionCount < 0)
+	{
+		return false;
+	}
+
+	if (this->m_Version == BMD_VERSION_EMPTY && (MeshCount != 0 || BoneCount != 0 || ActionCount != 0))
+	{
+		return false;
+	}
+
+	this->m_Mesh.resize(MeshCount);
+
+	for (int n = 0; n < MeshCount; n++)
+	{
+		short* info = (short*)this->Read(sizeof(short) * 5);
+
+		if (info == 0 || info[0] < 0 || info[1] < 0 || info[2] < 0 || info[3] < 0)
+		{
+			return false;
+		}
+
+		BMD_MESH* lpMesh = &this->m_Mesh[n];
+
+		BYTE* vertex = this->Read(info[0] * sizeof(BMD_VERTEX));
+
+		BYTE* normal = this->Read(info[1] * sizeof(BMD_NORMAL));
+
+		BYTE* texcoord = this->Read(info[2] * sizeof(BMD_TEXCOORD));
+
+		BYTE* triangle = this->Read(info[3] * sizeof(BMD_TRIANGLE));
+
+		BYTE* texture = this->Read(BMD_NAME_SIZE);
+
+		if (vertex == 0 || normal == 0 || texcoord == 0 || triangle == 0 || texture == 0)
+		{
+			return false;
+		}
+
+		lpMesh->Vertex = CBmdSpan<BMD_VERTEX>((BMD_VERTEX*)vertex, info[0]);
+
+		lpMesh->Normal = CBmdSpan<BMD_NORMAL>((BMD_NORMAL*)normal, info[1]);
+
+		lpMesh->TexCoord = CBmdSpan<BMD_TEXCOORD>((BMD_TEXCOORD*)texcoord, info[2]);
+
+		lpMesh->Triangle = CBmdSpan<BMD_TRIANGLE>((BMD_TRIANGLE*)triangle, info[3]);
+
+		lpMesh->Texture = info[4];
+
+		memcpy(lpMesh->TextureName, texture, BMD_NAME_SIZE);
+
+		lpMesh->TextureName[BMD_NAME_SIZE] = 0;
+	}
+
+	this->m_Action.resize(ActionCount);
+
+	for (int n = 0; n < ActionCount; n++)
+	{
+		BYTE* info = this->Read(sizeof(short) + sizeof(BYTE));
+
+		if (info == 0 || *(short*)info < 0)
+		{
+			return false;
+		}
+
+		BMD_ACTION* lpAction = &this->m_Action[n];
+
+		lpAction->KeyCount = *(short*)info;
+
+		lpAction->LockPositions = (info[2] != 0);
+
+		if (lpAction->LockPositions != 0)
+		{
+			BYTE* position = this->Read(lpAction->KeyCount * sizeof(BMD_VECTOR));
+
+			if (position == 0)
+			{
+				return false;
+			}
+
+			lpAction->Position = CBmdSpan<BMD_VECTOR>((BMD_VECTOR*)position, lpAction->KeyCount);
+		}
+	}
+
+	this->m_Bone.resize(BoneCount);
+
+	this->m_BoneKey.resize(BoneCount * ActionCount);
+
+	for (int n = 0; n < BoneCount; n++)
+	{
+		BYTE* dummy = this->Read(sizeof(BYTE));
+
+		if (dummy == 0)
+		{
+			return false;
+		}
+
+		BMD_BONE* lpBone = &this->m_Bone[n];
+
+		memset(lpBone->Name, 0, sizeof(lpBone->Name));
+
+		lpBone->Dummy = ((*dummy) != 0);
+
+		lpBone->Parent = -1;
+
+		if (lpBone->Dummy != 0)
+		{
+			continue;
+		}
+
+		BYTE* name = this->Read(BMD_NAME_SIZE);
+
+		BYTE* parent = this->Read(sizeof(short));
+
+		if (name == 0 || parent == 0)
+		{
+			return false;
+		}
+
+		memcpy(lpBone->Name, name, BMD_NAME_SIZE);
+
+		lpBone->Parent = *(short*)parent;
+
+		for (int i = 0; i < ActionCount; i++)
+		{
+			BMD_BONE_KEY* lpKey = &this->m_BoneKey[(n * ActionCount) + i];
+
+			DWORD KeyCount = this->m_Action[i].KeyCount;
+
+			BYTE* position = this->Read(KeyCount * sizeof(BMD_VECTOR));
+
+			BYTE* rotation = this->Read(KeyCount * sizeof(BMD_VECTOR));
+
+			if (position == 0 || rotation == 0)
+			{
+				return false;
+			}
+
+			lpKey->Position = CBmdSpan<BMD_VECTOR>((BMD_VECTOR*)position, KeyCount);
+
+			lpKey->Rotation = CBmdSpan<BMD_VECTOR>((BMD_VECTOR*)rotation, KeyCount);
+		}
+	}
+
+	return true;
+}
+
+BYTE* CBmdModel::Read(DWORD size)
+{
+	if (this->m_Offset > this->m_Size || size > (this->m_Size - this->m_Offset))
+	{
+		return 0;
+	}
+
+	BYTE* data = &this->m_Data[this->m_Offset];
+
+	this->m_Offset += size;
+
+	return data;
+}
+
+bool CBmdModel::Validate()
+{
+	DWORD BoneCount = this->m_Bone.size();
+
+	for (DWORD n = 0; n < this->m_Mesh.size(); n++)
+	{
+		BMD_MESH* lpMesh = &this->m_Mesh[n];
+
+		for (DWORD i = 0; i < lpMesh->Vertex.GetCount(); i++)
+		{
+			if ((DWORD)lpMesh->Vertex.Get(i)->Node >= BoneCount)
+			{
+				return false;
+			}
+		}
+
+		for (DWORD i = 0; i < lpMesh->Triangle.GetCount(); i++)
+		{
+			const BMD_TRIANGLE* lpTriangle = lpMesh->Triangle.Get(i);
+
+			if (lpTriangle->Polygon != 3 && lpTriangle->Polygon != 4)
+			{
+				return false;
+			}
+
+			for (int j = 0; j < lpTriangle->Polygon; j++)
+			{
+				if ((DWORD)lpTriangle->VertexIndex[j] >= lpMesh->Vertex.GetCount())
+				{
+					return false;
+				}
+
+				if ((DWORD)lpTriangle->NormalIndex[j] >= lpMesh->Normal.GetCount())
+				{
+					return false;
+				}
+
+				if ((DWORD)lpTriangle->TexCoordIndex[j] >= lpMesh->TexCoord.GetCount())
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	for (DWORD n = 0; n < BoneCount; n++)
+	{
+		if (this->m_Bone[n].Parent >= (short)BoneCount || this->m_Bone[n].Parent < -1)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int CBmdModel::GetVersion()
+{
+	return this->m_Version;
+}
+
+char* CBmdModel::GetName()
+{
+	return this->m_Name;
+}
+
+DWORD CBmdModel::GetMeshCount()
+{
+	return this->m_Mesh.size();
+}
+
+DWORD CBmdModel::GetBoneCount()
+{
+	return this->m_Bone.size();
+}
+
+DWORD CBmdModel::GetActionCount()
+{
+	return this->m_Action.size();
+}
+
+BMD_MESH* CBmdModel::GetMesh(DWORD index)
+{
+	return ((index < this->m_Mesh.size()) ? &this->m_Mesh[index] : 0);
+}
+
+BMD_BONE* CBmdModel::GetBone(DWORD index)
+{
+	return ((index < this->m_Bone.size()) ? &this->m_Bone[index] : 0);
+}
+
+BMD_ACTION* CBmdModel::GetAction(DWORD index)
+{
+	return ((index < this->m_Action.size()) ? &this->m_Action[index] : 0);
+}
+
+BMD_BONE_KEY* CBmdModel::GetBoneKey(DWORD bone, DWORD action)
+{
+	if (bone >= this->m_Bone.size() || action >= this->m_Action.size() || this->m_Bone[bone].Dummy != 0)
+	{
+		return 0;
+	}
+
+	return &this->m_BoneKey[(bone * this->m_Action.size()) + action];
+}
+
+DWORD CBmdModel::GetDataSize()
+{
+	return this->m_Size;
+}
\ No newline at end of file
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#define BMD_VERSION 0x0A
+#define BMD_VERSION_ENCRYPTED 0x0C
+#define BMD_VERSION_EMPTY 0x00 // Placeholder models with no mesh, bone or action
+#define BMD_NAME_SIZE 32
+
+#pragma pack(push, 1)
+
+struct BMD_VECTOR
+{
+	float X;
+	float Y;
+	float Z;
+};
+
+struct BMD_VERTEX
+{
+	short Node;
+	short Padding;
+	BMD_VECTOR Position;
+};
+
+struct BMD_NORMAL
+{
+	short Node;
+	short Padding;
+	BMD_VECTOR Normal;
+	short BindVertex;
+	short Padding2;
+};
+
+struct BMD_TEXCOORD
+{
+	float U;
+	float V;
+};
+
+struct BMD_TRIANGLE
+{
+	BYTE Polygon;
+	BYTE Padding;
+	short VertexIndex[4];
+	short NormalIndex[4];
+	short TexCoordIndex[4];
+	BYTE LightMap[38];
+};
+
+#pragma pack(pop)
+
+template <typename T> class CBmdSpan
+{
+public:
+
+	CBmdSpan()
+	{
+		this->m_Data = 0;
+
+		this->m_Count = 0;
+	}
+
+	CBmdSpan(const T* data, DWORD count)
+	{
+		this->m_Data = data;
+
+		this->m_Count = count;
+	}
+
+	const T* Get(DWORD index) const
+	{
+		return ((index < this->m_Count) ? &this->m_Data[index] : 0);
+	}
+
+	const T* GetData() const
+	{
+		return this->m_Data;
+	}
+
+	DWORD GetCount() const
+	{
+		return this->m_Count;
+	}
+
+	DWORD GetSize() const
+	{
+		return (this->m_Count * sizeof(T));
+	}
+
+private:
+
+	const T* m_Data;
+
+	DWORD m_Count;
+};
+
+struct BMD_MESH
+{
+	CBmdSpan<BMD_VERTEX> Vertex;
+	CBmdSpan<BMD_NORMAL> Normal;
+	CBmdSpan<BMD_TEXCOORD> TexCoord;
+	CBmdSpan<BMD_TRIANGLE> Triangle;
+	short Texture;
+	char TextureName[BMD_NAME_SIZE + 1];
+};
+
+struct BMD_ACTION
+{
+	DWORD KeyCount;
+	bool LockPositions;
+	CBmdSpan<BMD_VECTOR> Position;
+};
+
+struct BMD_BONE
+{
+	bool Dummy;
+	char Name[BMD_NAME_SIZE + 1];
+	short Parent;
+};
+
+struct BMD_BONE_KEY
+{
+	CBmdSpan<BMD_VECTOR> Position;
+	CBmdSpan<BMD_VECTOR> Rotation;
+};
+
+class CBmdModel
+{
+public:
+
+	CBmdModel();
+
+	~CBmdModel();
+
+	bool Open(char* path);
+
+	bool Open(BYTE* data, DWORD size);
+
+	void Close();
+
+	bool Validate();
+
+	int GetVersion();
+
+	char* GetName();
+
+	DWORD GetMeshCount();
+
+	DWORD GetBoneCount();
+
+	DWORD GetActionCount();
+
+	BMD_MESH* GetMesh(DWORD index);
+
+	BMD_BONE* GetBone(DWORD index);
+
+	BMD_ACTION* GetAction(DWORD index);
+
+	BMD_BONE_KEY* GetBoneKey(DWORD bone, DWORD action);
+
+	DWORD GetDataSize();
+
+private:
+
+	bool Parse(BYTE* data, DWORD size);
+
+	BYTE* Read(DWORD size);
+
+private:
+
+	CMappedFile m_File;
+
+	BYTE* m_Decrypted;
+
+	BYTE* m_Data;
+
+	DWORD m_Size;
+
+	DWORD m_Offset;
+
+	int m_Version;
+
+	char m_Name[BMD_NAME_SIZE + 1];
+
+	std::vector<BMD_MESH> m_Mesh;
+
+	std::vector<BMD_BONE> m_Bone;
+
+	std::vector<BMD_ACTION> m_Action;
+
+	std::vector<BMD_BONE_KEY> m_BoneKey;
+};
\ No newline at end of file
@@ -0,0 +1,579 @@
+#include "stdafx.h"
+#include "BmdSkin.h"
+#include "BmdAnimation.h"
+#include <xmmintrin.h>
+
+void AngleQuaternion(const BMD_VECTOR* lpAngle, float* q)
+{
+	float sr = sin(lpAngle->X * 0.5f);
+	float cr = cos(lpAngle->X * 0.5f);
+	float sp = sin(lpAngle->Y * 0.5f);
+	float cp = cos(lpAngle->Y * 0.5f);
+	float sy = sin(lpAngle->Z * 0.5f);
+	float cy = cos(lpAngle->Z * 0.5f);
+
+	q[0] = (sr * cp * cy) - (cr * sp * sy);
+	q[1] = (cr * sp * cy) + (sr * cp * sy);
+	q[2] = (cr * cp * sy) - (sr * sp * cy);
+	q[3] = (cr * cp * cy) + (sr * sp * sy);
+}
+
+void QuaternionSlerp(const float* p, const float* q, float t, float* qt)
+{
+	float b[4] = { q[0], q[1], q[2], q[3] };
+
+	float cosom = (p[0] * b[0]) + (p[1] * b[1]) + (p[2] * b[2]) + (p[3] * b[3]);
+
+	if (cosom < 0.0f)
+	{
+		cosom = -cosom;
+		b[0] = -b[0];
+		b[1] = -b[1];
+		b[2] = -b[2];
+		b[3] = -b[3];
+	}
+
+	float sclp = 1.0f - t;
+
+	float sclq = t;
+
+	if ((1.0f - cosom) > 0.000001f)
+	{
+		float omega = acos(cosom);
+
+		float sinom = sin(omega);
+
+		sclp = sin((1.0f - t) * omega) / sinom;
+
+		sclq = sin(t * omega) / sinom;
+	}
+
+	for (int n = 0; n < 4; n++)
+	{
+		qt[n] = (sclp * p[n]) + (sclq * b[n]);
+	}
+}
+
+void QuaternionMatrix(const float* q, const BMD_VECTOR* lpPosition, BMD_SKIN_MATRIX* lpMatrix)
+{
+	float(*m)[4] = lpMatrix->Matrix;
+
+	m[0][0] = 1.0f - (2.0f * q[1] * q[1]) - (2.0f * q[2] * q[2]);
+	m[1][0] = (2.0f * q[0] * q[1]) + (2.0f * q[3] * q[2]);
+	m[2][0] = (2.0f * q[0] * q[2]) - (2.0f * q[3] * q[1]);
+
+	m[0][1] = (2.0f * q[0] * q[1]) - (2.0f * q[3] * q[2]);
+	m[1][1] = 1.0f - (2.0f * q[0] * q[0]) - (2.0f * q[2] * q[2]);
+	m[2][1] = (2.0f * q[1] * q[2]) + (2.0f * q[3] * q[0]);
+
+	m[0][2] = (2.0f * q[0] * q[2]) + (2.0f * q[3] * q[1]);
+	m[1][2] = (2.0f * q[1] * q[2]) - (2.0f * q[3] * q[0]);
+	m[2][2] = 1.0f - (2.0f * q[0] * q[0]) - (2.0f * q[1] * q[1]);
+
+	m[0][3] = lpPosition->X;
+	m[1][3] = lpPosition->Y;
+	m[2][3] = lpPosition->Z;
+}
+
+static void ConcatTransforms(const BMD_SKIN_MATRIX* lpA, const BMD_SKIN_MATRIX* lpB, BMD_SKIN_MATRIX* lpOut)
+{
+	const float(*a)[4] = lpA->Matrix;
+	const float(*b)[4] = lpB->Matrix;
+	float(*o)[4] = lpOut->Matrix;
+
+	for (int n = 0; n < 3; n++)
+	{
+		o[n][0] = (a[n][0] * b[0][0]) + (a[n][1] * b[1][0]) + (a[n][2] * b[2][0]);
+		o[n][1] = (a[n][0] * b[0][1]) + (a[n][1] * b[1][1]) + (a[n][2] * b[2][1]);
+		o[n][2] = (a[n][0] * b[0][2]) + (a[n][1] * b[1][2]) + (a[n][2] * b[2][2]);
+		o[n][3] = (a[n][0] * b[0][3]) + (a[n][1] * b[1][3]) + (a[n][2] * b[2][3]) + a[n][3];
+	}
+}
+
+static void IdentityMatrix(BMD_SKIN_MATRIX* lpMatrix)
+{
+	memset(lpMatrix, 0, sizeof(BMD_SKIN_MATRIX));
+
+	lpMatrix->Matrix[0][0] = 1.0f;
+	lpMatrix->Matrix[1][1] = 1.0f;
+	lpMatrix->Matrix[2][2] = 1.0f;
+}
+
+CBmdSkin::CBmdSkin()
+{
+	this->m_Arena = 0;
+
+	this->Clear();
+}
+
+CBmdSkin::~CBmdSkin()
+{
+	this->Clear();
+}
+
+bool CBmdSkin::Build(CBmdModel* lpModel, CBmdModel* lpSkeleton)
+{
+	this->Clear();
+
+	// Player parts carry their own copy of the bones but are animated with the actions of player.bmd
+	DWORD BoneCount = lpSkeleton->GetBoneCount();
+
+	std::vector<DWORD> VertexNode;
+
+	std::vector<BMD_VECTOR> VertexValue;
+
+	std::vector<DWORD> NormalNode;
+
+	std::vector<BMD_VECTOR> NormalValue;
+
+	this->m_Mesh.resize(lpModel->GetMeshCount());
+
+	for (DWORD n = 0; n < lpModel->GetMeshCount(); n++)
+	{
+		BMD_MESH* lpMesh = lpModel->GetMesh(n);
+
+		BMD_SKIN_MESH* lpSkinMesh = &this->m_Mesh[n];
+
+		lpSkinMesh->VertexBase = VertexNode.size();
+
+		lpSkinMesh->VertexCount = lpMesh->Vertex.GetCount();
+
+		lpSkinMesh->NormalBase = NormalNode.size();
+
+		lpSkinMesh->NormalCount = lpMesh->Normal.GetCount();
+
+		for (DWORD i = 0; i < lpMesh->Vertex.GetCount(); i++)
+		{
+			const BMD_VERTEX* lpVertex = lpMesh->Vertex.Get(i);
+
+			if ((DWORD)lpVertex->Node >= BoneCount)
+			{
+				this->Clear();
+				return false;
+			}
+
+			VertexNode.push_back(lpVertex->Node);
+
+			VertexValue.push_back(lpVertex->Position);
+		}
+
+		for (DWORD i = 0; i < lpMesh->Normal.GetCount(); i++)
+		{
+			const BMD_NORMAL* lpNormal = lpMesh->Normal.Get(i);
+
+			if ((DWORD)lpNormal->Node >= BoneCount)
+			{
+				this->Clear();
+				return false;
+			}
+
+			NormalNode.push_back(lpNormal->Node);
+
+			NormalValue.push_back(lpNormal->Normal);
+		}
+	}
+
+	this->m_Model = lpModel;
+
+	this->m_Skeleton = lpSkeleton;
+
+	this->m_LocalMatrix.resize(BoneCount);
+
+	this->m_BoneMatrix.resize(BoneCount);
+
+	for (DWORD n = 0; n < BoneCount; n++)
+	{
+		IdentityMatrix(&this->m_BoneMatrix[n]);
+	}
+
+	this->BuildStream(VertexNode, VertexValue, this->m_VertexBatch, this->m_VertexSlot, &this->m_VertexSlotCount);
+
+	this->BuildStream(NormalNode, NormalValue, this->m_NormalBatch, this->m_NormalSlot, &this->m_NormalSlotCount);
+
+	// One aligned block holds the bind pose input and the skinned output, it is reused for every pose
+	DWORD size = (this->m_VertexSlotCount + this->m_NormalSlotCount) * 6;
+
+	this->m_Arena = (float*)_aligned_malloc(((size > 0) ? size : BMD_SKIN_LANE) * sizeof(float), 16);
+
+	if (this->m_Arena == 0)
+	{
+		this->Clear();
+		return false;
+	}
+
+	memset(this->m_Arena, 0, (size * sizeof(float)));
+
+	float* arena = this->m_Arena;
+
+	BMD_SKIN_STREAM* stream[4] = { &this->m_BindPosition, &this->m_Position, &this->m_BindNormal, &this->m_Normal };
+
+	for (int n = 0; n < 4; n++)
+	{
+		DWORD count = ((n < 2) ? this->m_VertexSlotCount : this->m_NormalSlotCount);
+
+		stream[n]->X = arena;
+		arena += count;
+		stream[n]->Y = arena;
+		arena += count;
+		stream[n]->Z = arena;
+		arena += count;
+	}
+
+	for (DWORD n = 0; n < VertexValue.size(); n++)
+	{
+		this->m_BindPosition.X[this->m_VertexSlot[n]] = VertexValue[n].X;
+		this->m_BindPosition.Y[this->m_VertexSlot[n]] = VertexValue[n].Y;
+		this->m_BindPosition.Z[this->m_VertexSlot[n]] = VertexValue[n].Z;
+	}
+
+	for (DWORD n = 0; n < NormalValue.size(); n++)
+	{
+		this->m_BindNormal.X[this->m_NormalSlot[n]] = NormalValue[n].X;
+		this->m_BindNormal.Y[this->m_NormalSlot[n]] = NormalValue[n].Y;
+		this->m_BindNormal.Z[this->m_NormalSlot[n]] = NormalValue[n].Z;
+	}
+
+	return true;
+}
+
+void CBmdSkin::BuildStream(std::vector<DWORD>& node, std::vector<BMD_VECTOR>& value, std::vector<BMD_SKIN_BATCH>& batch, std::vector<DWORD>& slot, DWORD* lpSlotCount)
+{
+	// Vertices are grouped by bone so every batch shares one matrix, each batch is padded to a full SIMD lane
+	std::vector<DWORD> count(this->m_BoneMatrix.size(), 0);
+
+	for (DWORD n = 0; n < node.size(); n++)
+	{
+		count[node[n]]++;
+	}
+
+	std::vector<DWORD> start(count.size(), 0);
+
+	DWORD SlotCount = 0;
+
+	for (DWORD n = 0; n < count.size(); n++)
+	{
+		if (count[n] == 0)
+		{
+			continue;
+		}
+
+		BMD_SKIN_BATCH info;
+
+		info.Node = n;
+
+		info.Start = SlotCount;
+
+		info.Count = (count[n] + (BMD_SKIN_LANE - 1)) & ~(BMD_SKIN_LANE - 1);
+
+		batch.push_back(info);
+
+		start[n] = SlotCount;
+
+		SlotCount += info.Count;
+	}
+
+	slot.resize(node.size());
+
+	for (DWORD n = 0; n < node.size(); n++)
+	{
+		slot[n] = start[node[n]]++;
+	}
+
+	*lpSlotCount = SlotCount;
+}
+
+void CBmdSkin::Clear()
+{
+	if (this->m_Arena != 0)
+	{
+		_aligned_free(this->m_Arena);
+	}
+
+	this->m_Model = 0;
+
+	this->m_Skeleton = 0;
+
+	this->m_Arena = 0;
+
+	this->m_VertexSlotCount = 0;
+
+	this->m_NormalSlotCount = 0;
+
+	this->m_Mesh.clear();
+
+	this->m_VertexBatch.clear();
+
+	this->m_NormalBatch.clear();
+
+	this->m_VertexSlot.clear();
+
+	this->m_NormalSlot.clear();
+
+	this->m_LocalMatrix.clear();
+
+	this->m_BoneMatrix.clear();
+
+	memset(&this->m_BindPosition, 0, sizeof(this->m_BindPosition));
+
+	memset(&this->m_BindNormal, 0, sizeof(this->m_BindNormal));
+
+	memset(&this->m_Position, 0, sizeof(this->m_Position));
+
+	memset(&this->m_Normal, 0, sizeof(this->m_Normal));
+}
+
+bool CBmdSkin::SetPose(DWORD action, float frame)
+{
+	if (this->m_Skeleton == 0 || action >= this->m_Skeleton->GetActionCount())
+	{
+		return false;
+	}
+
+	DWORD KeyCount = this->m_Skeleton->GetAction(action)->KeyCount;
+
+	if (KeyCount == 0)
+	{
+		return false;
+	}
+
+	frame = ((frame < 0.0f) ? 0.0f : frame);
+
+	DWORD key1 = ((DWORD)frame) % KeyCount;
+
+	DWORD key2 = (key1 + 1) % KeyCount;
+
+	float t = frame - floor(frame);
+
+	for (DWORD n = 0; n < this->m_LocalMatrix.size(); n++)
+	{
+		BMD_BONE_KEY* lpKey = this->m_Skeleton->GetBoneKey(n, action);
+
+		if (lpKey == 0)
+		{
+			IdentityMatrix(&this->m_LocalMatrix[n]);
+			continue;
+		}
+
+		float q1[4], q2[4], q[4];
+
+		AngleQuaternion(lpKey->Rotation.Get(key1), q1);
+
+		AngleQuaternion(lpKey->Rotation.Get(key2), q2);
+
+		QuaternionSlerp(q1, q2, t, q);
+
+		const BMD_VECTOR* p1 = lpKey->Position.Get(key1);
+
+		const BMD_VECTOR* p2 = lpKey->Position.Get(key2);
+
+		BMD_VECTOR position;
+
+		position.X = p1->X + ((p2->X - p1->X) * t);
+		position.Y = p1->Y + ((p2->Y - p1->Y) * t);
+		position.Z = p1->Z + ((p2->Z - p1->Z) * t);
+
+		QuaternionMatrix(q, &position, &this->m_LocalMatrix[n]);
+	}
+
+	this->BuildBoneMatrix();
+
+	return true;
+}
+
+bool CBmdSkin::SetPose(CBmdAnimation* lpAnimation, DWORD action, float frame)
+{
+	if (this->m_Skeleton == 0 || lpAnimation->GetBoneCount() != this->m_LocalMatrix.size())
+	{
+		return false;
+	}
+
+	if (lpAnimation->Sample(action, frame) == 0)
+	{
+		return false;
+	}
+
+	for (DWORD n = 0; n < this->m_LocalMatrix.size(); n++)
+	{
+		float q[4];
+
+		BMD_VECTOR position;
+
+		lpAnimation->GetRotation(n, q);
+
+		lpAnimation->GetPosition(n, &position);
+
+		QuaternionMatrix(q, &position, &this->m_LocalMatrix[n]);
+	}
+
+	this->BuildBoneMatrix();
+
+	return true;
+}
+
+void CBmdSkin::BuildBoneMatrix()
+{
+	std::vector<BYTE> state(this->m_BoneMatrix.size(), 0);
+
+	for (DWORD n = 0; n < this->m_BoneMatrix.size(); n++)
+	{
+		this->BuildBoneMatrix(n, state);
+	}
+}
+
+void CBmdSkin::BuildBoneMatrix(DWORD bone, std::vector<BYTE>& state)
+{
+	// Parents are normally stored before their children, the state array also covers the files that are not
+	if (state[bone] != 0)
+	{
+		return;
+	}
+
+	state[bone] = 1;
+
+	short parent = this->m_Skeleton->GetBone(bone)->Parent;
+
+	if (parent < 0 || (DWORD)parent >= this->m_BoneMatrix.size() || state[parent] == 1)
+	{
+		this->m_BoneMatrix[bone] = this->m_LocalMatrix[bone];
+	}
+	else
+	{
+		this->BuildBoneMatrix(parent, state);
+
+		ConcatTransforms(&this->m_BoneMatrix[parent], &this->m_LocalMatrix[bone], &this->m_BoneMatrix[bone]);
+	}
+
+	state[bone] = 2;
+}
+
+void CBmdSkin::Skin()
+{
+	this->SkinStream(this->m_VertexBatch, &this->m_BindPosition, &this->m_Position, 1);
+
+	this->SkinStream(this->m_NormalBatch, &this->m_BindNormal, &this->m_Normal, 0);
+}
+
+void CBmdSkin::SkinStream(std::vector<BMD_SKIN_BATCH>& batch, BMD_SKIN_STREAM* lpInput, BMD_SKIN_STREAM* lpOutput, bool translate)
+{
+	for (DWORD n = 0; n < batch.size(); n++)
+	{
+		const float(*m)[4] = this->m_BoneMatrix[batch[n].Node].Matrix;
+
+		__m128 m00 = _mm_set1_ps(m[0][0]), m01 = _mm_set1_ps(m[0][1]), m02 = _mm_set1_ps(m[0][2]);
+		__m128 m10 = _mm_set1_ps(m[1][0]), m11 = _mm_set1_ps(m[1][1]), m12 = _mm_set1_ps(m[1][2]);
+		__m128 m20 = _mm_set1_ps(m[2][0]), m21 = _mm_set1_ps(m[2][1]), m22 = _mm_set1_ps(m[2][2]);
+
+		__m128 t0 = _mm_set1_ps((translate != 0) ? m[0][3] : 0.0f);
+		__m128 t1 = _mm_set1_ps((translate != 0) ? m[1][3] : 0.0f);
+		__m128 t2 = _mm_set1_ps((translate != 0) ? m[2][3] : 0.0f);
+
+		DWORD end = batch[n].Start + batch[n].Count;
+
+		for (DWORD i = batch[n].Start; i < end; i += BMD_SKIN_LANE)
+		{
+			__m128 x = _mm_load_ps(&lpInput->X[i]);
+			__m128 y = _mm_load_ps(&lpInput->Y[i]);
+			__m128 z = _mm_load_ps(&lpInput->Z[i]);
+
+			_mm_store_ps(&lpOutput->X[i], _mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, x), _mm_mul_ps(m01, y)), _mm_add_ps(_mm_mul_ps(m02, z), t0)));
+			_mm_store_ps(&lpOutput->Y[i], _mm_add_ps(_mm_add_ps(_mm_mul_ps(m10, x), _mm_mul_ps(m11, y)), _mm_add_ps(_mm_mul_ps(m12, z), t1)));
+			_mm_store_ps(&lpOutput->Z[i], _mm_add_ps(_mm_add_ps(_mm_mul_ps(m20, x), _mm_mul_ps(m21, y)), _mm_add_ps(_mm_mul_ps(m22, z), t2)));
+		}
+	}
+}
+
+void CBmdSkin::SkinScalar()
+{
+	// Reference path, walks the source vertices one at a time the way the client does
+	for (DWORD n = 0; n < this->m_Mesh.size(); n++)
+	{
+		BMD_MESH* lpMesh = this->m_Model->GetMesh(n);
+
+		for (DWORD i = 0; i < lpMesh->Vertex.GetCount(); i++)
+		{
+			const BMD_VERTEX* lpVertex = lpMesh->Vertex.Get(i);
+
+			const float(*m)[4] = this->m_BoneMatrix[lpVertex->Node].Matrix;
+
+			DWORD slot = this->m_VertexSlot[this->m_Mesh[n].VertexBase + i];
+
+			const BMD_VECTOR* p = &lpVertex->Position;
+
+			this->m_Position.X[slot] = (m[0][0] * p->X) + (m[0][1] * p->Y) + (m[0][2] * p->Z) + m[0][3];
+			this->m_Position.Y[slot] = (m[1][0] * p->X) + (m[1][1] * p->Y) + (m[1][2] * p->Z) + m[1][3];
+			this->m_Position.Z[slot] = (m[2][0] * p->X) + (m[2][1] * p->Y) + (m[2][2] * p->Z) + m[2][3];
+		}
+
+		for (DWORD i = 0; i < lpMesh->Normal.GetCount(); i++)
+		{
+			const BMD_NORMAL* lpNormal = lpMesh->Normal.Get(i);
+
+			const float(*m)[4] = this->m_BoneMatrix[lpNormal->Node].Matrix;
+
+			DWORD slot = this->m_NormalSlot[this->m_Mesh[n].NormalBase + i];
+
+			const BMD_VECTOR* p = &lpNormal->Normal;
+
+			this->m_Normal.X[slot] = (m[0][0] * p->X) + (m[0][1] * p->Y) + (m[0][2] * p->Z);
+			this->m_Normal.Y[slot] = (m[1][0] * p->X) + (m[1][1] * p->Y) + (m[1][2] * p->Z);
+			this->m_Normal.Z[slot] = (m[2][0] * p->X) + (m[2][1] * p->Y) + (m[2][2] * p->Z);
+		}
+	}
+}
+
+DWORD CBmdSkin::GetVertexSlotCount()
+{
+	return this->m_VertexSlotCount;
+}
+
+DWORD CBmdSkin::GetNormalSlotCount()
+{
+	return this->m_NormalSlotCount;
+}
+
+BMD_SKIN_MATRIX* CBmdSkin::GetBoneMatrix(DWORD bone)
+{
+	return ((bone < this->m_BoneMatrix.size()) ? &this->m_BoneMatrix[bone] : 0);
+}
+
+bool CBmdSkin::GetPosition(DWORD mesh, DWORD vertex, BMD_VECTOR* lpOut)
+{
+	if (mesh >= this->m_Mesh.size() || vertex >= this->m_Mesh[mesh].VertexCount)
+	{
+		return false;
+	}
+
+	DWORD slot = this->m_VertexSlot[this->m_Mesh[mesh].VertexBase + vertex];
+
+	lpOut->X = this->m_Position.X[slot];
+	lpOut->Y = this->m_Position.Y[slot];
+	lpOut->Z = this->m_Position.Z[slot];
+
+	return true;
+}
+
+bool CBmdSkin::GetNormal(DWORD mesh, DWORD vertex, BMD_VECTOR* lpOut)
+{
+	if (mesh >= this->m_Mesh.size() || vertex >= this->m_Mesh[mesh].NormalCount)
+	{
+		return false;
+	}
+
+	DWORD slot = this->m_NormalSlot[this->m_Mesh[mesh].NormalBase + vertex];
+
+	lpOut->X = this->m_Normal.X[slot];
+	lpOut->Y = this->m_Normal.Y[slot];
+	lpOut->Z = this->m_Normal.Z[slot];
+
+	return true;
+}
+
+BMD_SKIN_STREAM* CBmdSkin::GetPositionStream()
+{
+	return &this->m_Position;
+}
+
+BMD_SKIN_STREAM* CBmdSkin::GetNormalStream()
+{
+	return &this->m_Normal;
+}
\ No newline at end of file
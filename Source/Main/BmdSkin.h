@@ -0,0 +1,119 @@
+#pragma once
+
+#include "BmdModel.h"
+
+#define BMD_SKIN_LANE 4
+
+struct BMD_SKIN_MATRIX
+{
+	float Matrix[3][4];
+};
+
+struct BMD_SKIN_BATCH
+{
+	DWORD Node;
+	DWORD Start;
+	DWORD Count;
+};
+
+struct BMD_SKIN_MESH
+{
+	DWORD VertexBase;
+	DWORD VertexCount;
+	DWORD NormalBase;
+	DWORD NormalCount;
+};
+
+struct BMD_SKIN_STREAM
+{
+	float* X;
+	float* Y;
+	float* Z;
+};
+
+void AngleQuaternion(const BMD_VECTOR* lpAngle, float* q);
+
+void QuaternionSlerp(const float* p, const float* q, float t, float* qt);
+
+void QuaternionMatrix(const float* q, const BMD_VECTOR* lpPosition, BMD_SKIN_MATRIX* lpMatrix);
+
+class CBmdAnimation;
+
+class CBmdSkin
+{
+public:
+
+	CBmdSkin();
+
+	~CBmdSkin();
+
+	bool Build(CBmdModel* lpModel, CBmdModel* lpSkeleton);
+
+	void Clear();
+
+	bool SetPose(DWORD action, float frame);
+
+	bool SetPose(CBmdAnimation* lpAnimation, DWORD action, float frame);
+
+	void Skin();
+
+	void SkinScalar();
+
+	DWORD GetVertexSlotCount();
+
+	DWORD GetNormalSlotCount();
+
+	BMD_SKIN_MATRIX* GetBoneMatrix(DWORD bone);
+
+	bool GetPosition(DWORD mesh, DWORD vertex, BMD_VECTOR* lpOut);
+
+	bool GetNormal(DWORD mesh, DWORD vertex, BMD_VECTOR* lpOut);
+
+	BMD_SKIN_STREAM* GetPositionStream();
+
+	BMD_SKIN_STREAM* GetNormalStream();
+
+private:
+
+	void BuildStream(std::vector<DWORD>& node, std::vector<BMD_VECTOR>& value, std::vector<BMD_SKIN_BATCH>& batch, std::vector<DWORD>& slot, DWORD* lpSlotCount);
+
+	void BuildBoneMatrix(DWORD bone, std::vector<BYTE>& state);
+
+	void BuildBoneMatrix();
+
+	void SkinStream(std::vector<BMD_SKIN_BATCH>& batch, BMD_SKIN_STREAM* lpInput, BMD_SKIN_STREAM* lpOutput, bool translate);
+
+private:
+
+	CBmdModel* m_Model;
+
+	CBmdModel* m_Skeleton;
+
+	std::vector<BMD_SKIN_MESH> m_Mesh;
+
+	std::vector<BMD_SKIN_BATCH> m_VertexBatch;
+
+	std::vector<BMD_SKIN_BATCH> m_NormalBatch;
+
+	std::vector<DWORD> m_VertexSlot;
+
+	std::vector<DWORD> m_NormalSlot;
+
+	std::vector<BMD_SKIN_MATRIX> m_LocalMatrix;
+
+	std::vector<BMD_SKIN_MATRIX> m_BoneMatrix;
+
+	float* m_Arena;
+
+	DWORD m_VertexSlotCount;
+
+	DWORD m_NormalSlotCount;
+
+	BMD_SKIN_STREAM m_BindPosition;
+
+	BMD_SKIN_STREAM m_BindNormal;
+
+	BMD_SKIN_STREAM m_Position;
+
+	BMD_SKIN_STREAM m_Normal;
+};
\ No newline at end of file
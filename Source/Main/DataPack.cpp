@@ -0,0 +1,1300 @@
+#include "stdafx.h"
+#include "DataPack.h"
+#include "CCRC32.H"
+#include "FileTrace.h"
+#include <algorithm>
+
+CDataPack gDataPack;
+
+struct DATA_PACK_HOOK
+{
+	char* Name;
+	void* Function;
+};
+
+static HANDLE WINAPI DataPackCreateFileA(LPCSTR lpFileName, DWORD dwDesiredAccess, DWORD dwShareMode, LPSECURITY_ATTRIBUTES lpSecurityAttributes, DWORD dwCreationDisposition, DWORD dwFlagsAndAttributes, HANDLE hTemplateFile)
+{
+	// Only plain opens for reading can come from the pack, everything else goes to the disk as before
+	bool read = ((dwDesiredAccess & GENERIC_WRITE) == 0 && dwCreationDisposition == OPEN_EXISTING);
+
+	HANDLE handle = ((read != 0) ? gDataPack.OpenFile((char*)lpFileName) : INVALID_HANDLE_VALUE);
+
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		handle = CreateFileA(lpFileName, dwDesiredAccess, dwShareMode, lpSecurityAttributes, dwCreationDisposition, dwFlagsAndAttributes, hTemplateFile);
+	}
+
+	if (read != 0 && handle != INVALID_HANDLE_VALUE && gFileTrace.IsActive() != 0)
+	{
+		gFileTrace.Open(handle, (char*)lpFileName, ((gDataPack.IsFile(handle) != 0) ? gDataPack.FileSize(handle) : GetFileSize(handle, 0)));
+	}
+
+	return handle;
+}
+
+static BOOL WINAPI DataPackReadFile(HANDLE hFile, LPVOID lpBuffer, DWORD nNumberOfBytesToRead, LPDWORD lpNumberOfBytesRead, LPOVERLAPPED lpOverlapped)
+{
+	DWORD OutSize = 0;
+
+	BOOL result = 1;
+
+	if (gDataPack.FileRead(hFile, lpBuffer, nNumberOfBytesToRead, &OutSize) != 0)
+	{
+		if (lpNumberOfBytesRead != 0)
+		{
+			*lpNumberOfBytesRead = OutSize;
+		}
+	}
+	else
+	{
+		result = ReadFile(hFile, lpBuffer, nNumberOfBytesToRead, lpNumberOfBytesRead, lpOverlapped);
+
+		OutSize = ((lpNumberOfBytesRead != 0) ? *lpNumberOfBytesRead : 0);
+	}
+
+	if (result != 0 && gFileTrace.IsActive() != 0)
+	{
+		gFileTrace.Read(hFile, OutSize);
+	}
+
+	return result;
+}
+
+static DWORD WINAPI DataPackSetFilePointer(HANDLE hFile, LONG lDistanceToMove, PLONG lpDistanceToMoveHigh, DWORD dwMoveMethod)
+{
+	DWORD result = 0;
+
+	if (gDataPack.IsFile(hFile) != 0)
+	{
+		// Pack entries are below 2 GB, a high part is only accepted when it is the sign of the low part
+		if (lpDistanceToMoveHigh != 0 && (*lpDistanceToMoveHigh) != ((lDistanceToMove < 0) ? -1 : 0))
+		{
+			SetLastError(ERROR_NEGATIVE_SEEK);
+			return INVALID_SET_FILE_POINTER;
+		}
+
+		result = gDataPack.FileSeek(hFile, lDistanceToMove, dwMoveMethod);
+
+		if (result != INVALID_SET_FILE_POINTER && lpDistanceToMoveHigh != 0)
+		{
+			*lpDistanceToMoveHigh = 0;
+		}
+	}
+	else
+	{
+		result = SetFilePointer(hFile, lDistanceToMove, lpDistanceToMoveHigh, dwMoveMethod);
+	}
+
+	if (result != INVALID_SET_FILE_POINTER && gFileTrace.IsActive() != 0)
+	{
+		gFileTrace.Seek(hFile, result);
+	}
+
+	return result;
+}
+
+static DWORD WINAPI DataPackGetFileSize(HANDLE hFile, LPDWORD lpFileSizeHigh)
+{
+	if (gDataPack.IsFile(hFile) != 0)
+	{
+		if (lpFileSizeHigh != 0)
+		{
+			*lpFileSizeHigh = 0;
+		}
+
+		return gDataPack.FileSize(hFile);
+	}
+
+	return GetFileSize(hFile, lpFileSizeHigh);
+}
+
+static BOOL WINAPI DataPackCloseHandle(HANDLE hObject)
+{
+	if (gFileTrace.IsActive() != 0)
+	{
+		gFileTrace.Close(hObject);
+	}
+
+	if (gDataPack.FileClose(hObject) != 0)
+	{
+		return 1;
+	}
+
+	return CloseHandle(hObject);
+}
+
+static DATA_PACK_HOOK DataPackHook[] =
+{
+	{ "CreateFileA", DataPackCreateFileA },
+	{ "ReadFile", DataPackReadFile },
+	{ "SetFilePointer", DataPackSetFilePointer },
+	{ "GetFileSize", DataPackGetFileSize },
+	{ "CloseHandle", DataPackCloseHandle },
+};
+
+static char* DataPackSkipName[] = { "Macro.txt" };
+
+static char* DataPackSkipExtension[] = { ".msc", ".bmc", ".btc", ".btp", ".bts", ".tmp" };
+
+static bool ReadPackSource(char* path, std::vector<BYTE>& data, FILETIME* lpTime)
+{
+	data.clear();
+
+	HANDLE handle = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	DWORD size = GetFileSize(handle, 0);
+
+	if (size == INVALID_FILE_SIZE)
+	{
+		CloseHandle(handle);
+		return false;
+	}
+
+	if (lpTime != 0 && GetFileTime(handle, 0, 0, lpTime) == 0)
+	{
+		CloseHandle(handle);
+		return false;
+	}
+
+	data.resize(size);
+
+	DWORD InSize = 0;
+
+	if (size != 0 && (ReadFile(handle, &data[0], size, &InSize, 0) == 0 || InSize != size))
+	{
+		CloseHandle(handle);
+		data.clear();
+		return false;
+	}
+
+	CloseHandle(handle);
+
+	return true;
+}
+
+static bool WritePackData(HANDLE handle, void* data, DWORD size)
+{
+	DWORD OutSize = 0;
+
+	return (size == 0 || (WriteFile(handle, data, size, &OutSize, 0) != 0 && OutSize == size));
+}
+
+static void WriteLzLength(std::vector<BYTE>& out, DWORD length)
+{
+	for (; length >= 255; length -= 255)
+	{
+		out.push_back(255);
+	}
+
+	out.push_back((BYTE)length);
+}
+
+static void WriteLzSequence(std::vector<BYTE>& out, BYTE* literal, DWORD LiteralSize, DWORD offset, DWORD length)
+{
+	// Token with both lengths, the literals, then the match, a sequence without match ends the stream
+	DWORD MatchSize = ((length == 0) ? 0 : (length - DATA_PACK_LZ_MIN_MATCH));
+
+	out.push_back((BYTE)((((LiteralSize < 15) ? LiteralSize : 15) << 4) | ((MatchSize < 15) ? MatchSize : 15)));
+
+	if (LiteralSize >= 15)
+	{
+		WriteLzLength(out, (LiteralSize - 15));
+	}
+
+	out.insert(out.end(), literal, (literal + LiteralSize));
+
+	if (length == 0)
+	{
+		return;
+	}
+
+	out.push_back((BYTE)offset);
+
+	out.push_back((BYTE)(offset >> 8));
+
+	if (MatchSize >= 15)
+	{
+		WriteLzLength(out, (MatchSize - 15));
+	}
+}
+
+static bool ReadLzLength(BYTE** lpData, BYTE* end, DWORD* lpLength)
+{
+	BYTE value = 255;
+
+	while (value == 255)
+	{
+		if ((*lpData) >= end)
+		{
+			return false;
+		}
+
+		value = *(*lpData)++;
+
+		*lpLength += value;
+	}
+
+	return true;
+}
+
+CDataPack::CDataPack()
+{
+	this->m_Handle = INVALID_HANDLE_VALUE;
+
+	this->m_Header = 0;
+
+	this->m_Seed = 0;
+
+	this->m_Slot = 0;
+
+	this->m_Name = 0;
+
+	InitializeCriticalSection(&this->m_Lock);
+}
+
+CDataPack::~CDataPack()
+{
+	this->Close();
+
+	DeleteCriticalSection(&this->m_Lock);
+}
+
+bool CDataPack::Open(char* path)
+{
+	this->Close();
+
+	if (this->m_File.Open(path) == 0)
+	{
+		return false;
+	}
+
+	BYTE* data = this->m_File.GetData();
+
+	DWORD size = this->m_File.GetSize();
+
+	DATA_PACK_HEADER* lpHeader = (DATA_PACK_HEADER*)data;
+
+	// Every offset is checked once here so lookups and views never have to
+	bool valid = (size >= sizeof(DATA_PACK_HEADER) && lpHeader->Magic == DATA_PACK_MAGIC && lpHeader->Version == DATA_PACK_VERSION && lpHeader->BucketCount != 0 && lpHeader->SlotCount != 0 && lpHeader->NameSize != 0);
+
+	valid = (valid != 0 && lpHeader->SeedOffset <= size && lpHeader->BucketCount <= ((size - lpHeader->SeedOffset) / sizeof(DWORD)));
+
+	valid = (valid != 0 && lpHeader->SlotOffset <= size && lpHeader->SlotCount <= ((size - lpHeader->SlotOffset) / sizeof(DATA_PACK_ENTRY)));
+
+	valid = (valid != 0 && lpHeader->NameOffset <= size && lpHeader->NameSize <= (size - lpHeader->NameOffset) && data[lpHeader->NameOffset + lpHeader->NameSize - 1] == 0);
+
+	for (DWORD n = 0; valid != 0 && n < lpHeader->SlotCount; n++)
+	{
+		DATA_PACK_ENTRY* lpEntry = &((DATA_PACK_ENTRY*)(data + lpHeader->SlotOffset))[n];
+
+		if (lpEntry->NameOffset == DATA_PACK_EMPTY)
+		{
+			continue;
+		}
+
+		valid = (lpEntry->NameOffset < lpHeader->NameSize && lpEntry->Offset <= size && lpEntry->PackedSize <= (size - lpEntry->Offset));
+
+		valid = (valid != 0 && ((lpEntry->Flags & DATA_PACK_FLAG_LZ) != 0 || lpEntry->PackedSize == lpEntry->Size));
+	}
+
+	if (valid == 0)
+	{
+		this->m_File.Close();
+		return false;
+	}
+
+	this->m_Handle = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_ARCHIVE, 0);
+
+	if (this->m_Handle == INVALID_HANDLE_VALUE)
+	{
+		this->m_File.Close();
+		return false;
+	}
+
+	this->m_Header = lpHeader;
+
+	this->m_Seed = (DWORD*)(data + lpHeader->SeedOffset);
+
+	this->m_Slot = (DATA_PACK_ENTRY*)(data + lpHeader->SlotOffset);
+
+	this->m_Name = (char*)(data + lpHeader->NameOffset);
+
+	this->CheckLoose();
+
+	return true;
+}
+
+void CDataPack::Close()
+{
+	EnterCriticalSection(&this->m_Lock);
+
+	for (std::map<HANDLE, DATA_PACK_FILE>::iterator it = this->m_OpenFile.begin(); it != this->m_OpenFile.end(); it++)
+	{
+		this->ReleaseView(&it->second.View);
+
+		CloseHandle(it->first);
+	}
+
+	this->m_OpenFile.clear();
+
+	LeaveCriticalSection(&this->m_Lock);
+
+	if (this->m_Handle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(this->m_Handle);
+
+		this->m_Handle = INVALID_HANDLE_VALUE;
+	}
+
+	this->m_File.Close();
+
+	this->m_Header = 0;
+
+	this->m_Seed = 0;
+
+	this->m_Slot = 0;
+
+	this->m_Name = 0;
+
+	this->m_Stale.clear();
+}
+
+bool CDataPack::IsOpen()
+{
+	return (this->m_Header != 0);
+}
+
+int CDataPack::Find(char* name)
+{
+	// The bucket seed sends the name straight to its slot, one compare tells a hit from a file the pack does not have
+	if (this->m_Header == 0)
+	{
+		return -1;
+	}
+
+	char key[MAX_PATH];
+
+	CDataPack::GetPackName(name, key);
+
+	if (key[0] == 0)
+	{
+		return -1;
+	}
+
+	DWORD seed = this->m_Seed[CDataPack::Hash(key, 0) % this->m_Header->BucketCount];
+
+	if (seed == 0)
+	{
+		return -1;
+	}
+
+	int index = CDataPack::Hash(key, seed) % this->m_Header->SlotCount;
+
+	DATA_PACK_ENTRY* lpEntry = &this->m_Slot[index];
+
+	if (lpEntry->NameOffset == DATA_PACK_EMPTY || strcmp(&this->m_Name[lpEntry->NameOffset], key) != 0)
+	{
+		return -1;
+	}
+
+	return index;
+}
+
+bool CDataPack::GetView(int index, DATA_PACK_VIEW* lpView)
+{
+	// Stored entries point into the mapping, only compressed ones get a buffer
+	DATA_PACK_ENTRY* lpEntry = this->GetEntry(index);
+
+	if (lpEntry == 0)
+	{
+		return false;
+	}
+
+	BYTE* data = this->m_File.GetData() + lpEntry->Offset;
+
+	lpView->Size = lpEntry->Size;
+
+	lpView->Buffer = 0;
+
+	if ((lpEntry->Flags & DATA_PACK_FLAG_LZ) == 0)
+	{
+		lpView->Data = data;
+
+		return true;
+	}
+
+	lpView->Buffer = new BYTE[(lpEntry->Size == 0) ? 1 : lpEntry->Size];
+
+	lpView->Data = lpView->Buffer;
+
+	if (CDataPack::Decompress(data, lpEntry->PackedSize, lpView->Buffer, lpEntry->Size) == 0)
+	{
+		this->ReleaseView(lpView);
+
+		return false;
+	}
+
+	return true;
+}
+
+void CDataPack::ReleaseView(DATA_PACK_VIEW* lpView)
+{
+	if (lpView->Buffer != 0)
+	{
+		delete[] lpView->Buffer;
+	}
+
+	lpView->Data = 0;
+
+	lpView->Size = 0;
+
+	lpView->Buffer = 0;
+}
+
+bool CDataPack::Verify(int index)
+{
+	DATA_PACK_VIEW view;
+
+	if (this->GetView(index, &view) == 0)
+	{
+		return false;
+	}
+
+	CCRC32 CRC32;
+
+	bool result = ((DWORD)CRC32.FullCRC(view.Data, view.Size) == this->m_Slot[index].Crc);
+
+	this->ReleaseView(&view);
+
+	return result;
+}
+
+bool CDataPack::IsCurrent(int index)
+{
+	return (this->GetEntry(index) != 0 && this->m_Stale[index] == 0);
+}
+
+void CDataPack::CheckLoose()
+{
+	// A loose file left next to the pack is only there when the pack is older, a launcher update or the game itself wrote it
+	// One listing per pack folder replaces a stat on every redirected open
+	this->m_Stale.assign(this->m_Header->SlotCount, 0);
+
+	std::map<std::string, std::map<std::string, DWORD>> folder;
+
+	for (DWORD n = 0; n < this->m_Header->SlotCount; n++)
+	{
+		if (this->m_Slot[n].NameOffset == DATA_PACK_EMPTY)
+		{
+			continue;
+		}
+
+		char* name = &this->m_Name[this->m_Slot[n].NameOffset];
+
+		char* slash = strrchr(name, '\\');
+
+		if (slash == 0)
+		{
+			folder["."][name] = n;
+		}
+		else
+		{
+			folder[std::string(name, (slash - name))][(slash + 1)] = n;
+		}
+	}
+
+	for (std::map<std::string, std::map<std::string, DWORD>>::iterator it = folder.begin(); it != folder.end(); it++)
+	{
+		char find[MAX_PATH];
+
+		if (_snprintf_s(find, sizeof(find), _TRUNCATE, "%s\\*", it->first.c_str()) < 0)
+		{
+			continue;
+		}
+
+		WIN32_FIND_DATA data;
+
+		HANDLE handle = FindFirstFile(find, &data);
+
+		if (handle == INVALID_HANDLE_VALUE)
+		{
+			continue;
+		}
+
+		do
+		{
+			char key[MAX_PATH];
+
+			CDataPack::GetPackName(data.cFileName, key);
+
+			std::map<std::string, DWORD>::iterator entry = it->second.find(key);
+
+			if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0 || entry == it->second.end())
+			{
+				continue;
+			}
+
+			DATA_PACK_ENTRY* lpEntry = &this->m_Slot[entry->second];
+
+			this->m_Stale[entry->second] = (data.nFileSizeHigh != 0 || data.nFileSizeLow != lpEntry->Size || CompareFileTime(&data.ftLastWriteTime, &lpEntry->Time) > 0);
+		}
+		while (FindNextFile(handle, &data) != 0);
+
+		FindClose(handle);
+	}
+}
+
+DATA_PACK_ENTRY* CDataPack::GetEntry(int index)
+{
+	if (this->m_Header == 0 || index < 0 || index >= (int)this->m_Header->SlotCount || this->m_Slot[index].NameOffset == DATA_PACK_EMPTY)
+	{
+		return 0;
+	}
+
+	return &this->m_Slot[index];
+}
+
+char* CDataPack::GetName(int index)
+{
+	DATA_PACK_ENTRY* lpEntry = this->GetEntry(index);
+
+	return ((lpEntry == 0) ? 0 : &this->m_Name[lpEntry->NameOffset]);
+}
+
+int CDataPack::GetSlotCount()
+{
+	return ((this->m_Header == 0) ? 0 : this->m_Header->SlotCount);
+}
+
+int CDataPack::GetEntryCount()
+{
+	return ((this->m_Header == 0) ? 0 : this->m_Header->EntryCount);
+}
+
+HANDLE CDataPack::OpenFile(char* name)
+{
+	// The handle is a real duplicate of the pack handle, so calls that are not redirected still see a valid disk file
+	int index = this->Find(name);
+
+	if (index == -1)
+	{
+		return INVALID_HANDLE_VALUE;
+	}
+
+	if (this->IsCurrent(index) == 0)
+	{
+		return INVALID_HANDLE_VALUE;
+	}
+
+	DATA_PACK_FILE file;
+
+	file.Position = 0;
+
+	if (this->GetView(index, &file.View) == 0)
+	{
+		return INVALID_HANDLE_VALUE;
+	}
+
+	HANDLE handle = INVALID_HANDLE_VALUE;
+
+	if (DuplicateHandle(GetCurrentProcess(), this->m_Handle, GetCurrentProcess(), &handle, 0, 0, DUPLICATE_SAME_ACCESS) == 0)
+	{
+		this->ReleaseView(&file.View);
+
+		return INVALID_HANDLE_VALUE;
+	}
+
+	EnterCriticalSection(&this->m_Lock);
+
+	this->m_OpenFile[handle] = file;
+
+	LeaveCriticalSection(&this->m_Lock);
+
+	return handle;
+}
+
+bool CDataPack::IsFile(HANDLE handle)
+{
+	EnterCriticalSection(&this->m_Lock);
+
+	bool result = (this->m_OpenFile.find(handle) != this->m_OpenFile.end());
+
+	LeaveCriticalSection(&this->m_Lock);
+
+	return result;
+}
+
+bool CDataPack::FileRead(HANDLE handle, void* buff, DWORD size, DWORD* OutSize)
+{
+	// False only when the handle is not from the pack, reading at the end gives zero bytes like a disk file
+	EnterCriticalSection(&this->m_Lock);
+
+	std::map<HANDLE, DATA_PACK_FILE>::iterator it = this->m_OpenFile.find(handle);
+
+	if (it == this->m_OpenFile.end())
+	{
+		LeaveCriticalSection(&this->m_Lock);
+		return false;
+	}
+
+	DATA_PACK_FILE* lpFile = &it->second;
+
+	DWORD position = ((lpFile->Position < lpFile->View.Size) ? lpFile->Position : lpFile->View.Size);
+
+	DWORD count = (((lpFile->View.Size - position) < size) ? (lpFile->View.Size - position) : size);
+
+	BYTE* data = lpFile->View.Data + position;
+
+	lpFile->Position = position + count;
+
+	LeaveCriticalSection(&this->m_Lock);
+
+	memcpy(buff, data, count);
+
+	*OutSize = count;
+
+	return true;
+}
+
+DWORD CDataPack::FileSeek(HANDLE handle, LONG distance, DWORD method)
+{
+	EnterCriticalSection(&this->m_Lock);
+
+	std::map<HANDLE, DATA_PACK_FILE>::iterator it = this->m_OpenFile.find(handle);
+
+	if (it == this->m_OpenFile.end())
+	{
+		LeaveCriticalSection(&this->m_Lock);
+		SetLastError(ERROR_INVALID_HANDLE);
+		return INVALID_SET_FILE_POINTER;
+	}
+
+	LONGLONG position = ((method == FILE_CURRENT) ? it->second.Position : ((method == FILE_END) ? it->second.View.Size : 0)) + (LONGLONG)distance;
+
+	if (position < 0 || position > 0x7FFFFFFF)
+	{
+		LeaveCriticalSection(&this->m_Lock);
+		SetLastError(ERROR_NEGATIVE_SEEK);
+		return INVALID_SET_FILE_POINTER;
+	}
+
+	it->second.Position = (DWORD)position;
+
+	LeaveCriticalSection(&this->m_Lock);
+
+	SetLastError(NO_ERROR);
+
+	return (DWORD)position;
+}
+
+DWORD CDataPack::FileSize(HANDLE handle)
+{
+	EnterCriticalSection(&this->m_Lock);
+
+	std::map<HANDLE, DATA_PACK_FILE>::iterator it = this->m_OpenFile.find(handle);
+
+	DWORD size = ((it == this->m_OpenFile.end()) ? INVALID_FILE_SIZE : it->second.View.Size);
+
+	LeaveCriticalSection(&this->m_Lock);
+
+	return size;
+}
+
+bool CDataPack::FileClose(HANDLE handle)
+{
+	EnterCriticalSection(&this->m_Lock);
+
+	std::map<HANDLE, DATA_PACK_FILE>::iterator it = this->m_OpenFile.find(handle);
+
+	if (it == this->m_OpenFile.end())
+	{
+		LeaveCriticalSection(&this->m_Lock);
+		return false;
+	}
+
+	DATA_PACK_VIEW view = it->second.View;
+
+	this->m_OpenFile.erase(it);
+
+	LeaveCriticalSection(&this->m_Lock);
+
+	this->ReleaseView(&view);
+
+	CloseHandle(handle);
+
+	return true;
+}
+
+bool CDataPack::Redirect()
+{
+	// The game's import table is patched in place, fopen in its static runtime ends up in the same CreateFileA entry
+	// Without a pack the hooks only feed the file trace and pass every call through
+	if (this->m_Header == 0 && gFileTrace.IsActive() == 0)
+	{
+		return false;
+	}
+
+	BYTE* base = (BYTE*)GetModuleHandle(0);
+
+	IMAGE_NT_HEADERS* lpNtHeader = (IMAGE_NT_HEADERS*)(base + ((IMAGE_DOS_HEADER*)base)->e_lfanew);
+
+	IMAGE_DATA_DIRECTORY* lpDirectory = &lpNtHeader->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT];
+
+	if (lpDirectory->VirtualAddress == 0)
+	{
+		return false;
+	}
+
+	HMODULE kernel = GetModuleHandle("kernel32.dll");
+
+	int count = 0;
+
+	for (IMAGE_IMPORT_DESCRIPTOR* lpImport = (IMAGE_IMPORT_DESCRIPTOR*)(base + lpDirectory->VirtualAddress); lpImport->Name != 0; lpImport++)
+	{
+		if (_stricmp((char*)(base + lpImport->Name), "kernel32.dll") != 0)
+		{
+			continue;
+		}
+
+		for (IMAGE_THUNK_DATA* lpThunk = (IMAGE_THUNK_DATA*)(base + lpImport->FirstThunk); lpThunk->u1.Function != 0; lpThunk++)
+		{
+			for (int n = 0; n < (sizeof(DataPackHook) / sizeof(DATA_PACK_HOOK)); n++)
+			{
+				if (lpThunk->u1.Function == (DWORD)GetProcAddress(kernel, DataPackHook[n].Name))
+				{
+					DWORD OldProtect;
+
+					VirtualProtect(&lpThunk->u1.Function, sizeof(DWORD), PAGE_READWRITE, &OldProtect);
+
+					lpThunk->u1.Function = (DWORD)DataPackHook[n].Function;
+
+					VirtualProtect(&lpThunk->u1.Function, sizeof(DWORD), OldProtect, &OldProtect);
+
+					count++;
+				}
+			}
+		}
+	}
+
+	return (count != 0);
+}
+
+bool CDataPack::Build(std::vector<std::string>& list, char* path, bool compress, DATA_PACK_BUILD_INFO* lpInfo)
+{
+	memset(lpInfo, 0, sizeof(DATA_PACK_BUILD_INFO));
+
+	std::vector<std::string> file;
+
+	for (size_t n = 0; n < list.size(); n++)
+	{
+		if (CDataPack::IsPackable((char*)list[n].c_str()) != 0)
+		{
+			file.push_back(list[n]);
+		}
+		else
+		{
+			lpInfo->SkippedCount++;
+		}
+	}
+
+	if (file.empty() != 0)
+	{
+		return false;
+	}
+
+	DATA_PACK_HEADER header;
+
+	memset(&header, 0, sizeof(header));
+
+	header.Magic = DATA_PACK_MAGIC;
+
+	header.Version = DATA_PACK_VERSION;
+
+	header.EntryCount = file.size();
+
+	header.SlotCount = header.EntryCount + (header.EntryCount / 16) + 1;
+
+	header.BucketCount = (header.EntryCount + DATA_PACK_BUCKET_SIZE - 1) / DATA_PACK_BUCKET_SIZE;
+
+	std::vector<std::string> name(header.EntryCount);
+
+	std::vector<std::vector<int>> bucket(header.BucketCount);
+
+	for (DWORD n = 0; n < header.EntryCount; n++)
+	{
+		char key[MAX_PATH];
+
+		CDataPack::GetPackName((char*)file[n].c_str(), key);
+
+		name[n] = key;
+
+		bucket[CDataPack::Hash(key, 0) % header.BucketCount].push_back(n);
+	}
+
+	// Hash and displace: the fullest buckets pick a seed first, while most slots are still free
+	std::vector<std::pair<int, int>> order(header.BucketCount);
+
+	for (DWORD n = 0; n < header.BucketCount; n++)
+	{
+		order[n] = std::make_pair(-(int)bucket[n].size(), (int)n);
+	}
+
+	std::sort(order.begin(), order.end());
+
+	std::vector<DWORD> seed(header.BucketCount, 0);
+
+	std::vector<int> slot(header.SlotCount, -1);
+
+	std::vector<DWORD> target;
+
+	for (DWORD n = 0; n < header.BucketCount && bucket[order[n].second].empty() == 0; n++)
+	{
+		std::vector<int>* lpBucket = &bucket[order[n].second];
+
+		DWORD value = 1;
+
+		for (; value < DATA_PACK_MAX_SEED; value++)
+		{
+			target.clear();
+
+			for (size_t i = 0; i < lpBucket->size(); i++)
+			{
+				DWORD index = CDataPack::Hash((char*)name[(*lpBucket)[i]].c_str(), value) % header.SlotCount;
+
+				if (slot[index] != -1 || std::find(target.begin(), target.end(), index) != target.end())
+				{
+					break;
+				}
+
+				target.push_back(index);
+			}
+
+			if (target.size() == lpBucket->size())
+			{
+				break;
+			}
+		}
+
+		if (value == DATA_PACK_MAX_SEED)
+		{
+			return false; // Only two equal names can get here
+		}
+
+		for (size_t i = 0; i < target.size(); i++)
+		{
+			slot[target[i]] = (*lpBucket)[i];
+		}
+
+		seed[order[n].second] = value;
+
+		lpInfo->MaxSeed = ((value > lpInfo->MaxSeed) ? value : lpInfo->MaxSeed);
+	}
+
+	std::vector<char> NameData;
+
+	std::vector<DWORD> NameOffset(header.EntryCount);
+
+	for (DWORD n = 0; n < header.EntryCount; n++)
+	{
+		NameOffset[n] = NameData.size();
+
+		NameData.insert(NameData.end(), name[n].begin(), name[n].end());
+
+		NameData.push_back(0);
+	}
+
+	header.SeedOffset = sizeof(DATA_PACK_HEADER);
+
+	header.SlotOffset = header.SeedOffset + (header.BucketCount * sizeof(DWORD));
+
+	header.NameOffset = header.SlotOffset + (header.SlotCount * sizeof(DATA_PACK_ENTRY));
+
+	header.NameSize = NameData.size();
+
+	std::vector<DATA_PACK_ENTRY> entry(header.SlotCount);
+
+	for (DWORD n = 0; n < header.SlotCount; n++)
+	{
+		memset(&entry[n], 0, sizeof(DATA_PACK_ENTRY));
+
+		entry[n].NameOffset = DATA_PACK_EMPTY;
+	}
+
+	char temp[MAX_PATH];
+
+	wsprintf(temp, "%s.tmp", path);
+
+	HANDLE handle = CreateFile(temp, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_ARCHIVE, 0);
+
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	// Data follows the tables in list order so a directory stays together on disk, the tables are written last
+	DWORD offset = header.NameOffset + header.NameSize;
+
+	std::vector<BYTE> pad(DATA_PACK_ALIGN, 0);
+
+	std::vector<BYTE> data;
+
+	std::vector<BYTE> packed;
+
+	std::vector<BYTE> other;
+
+	std::map<std::pair<DWORD, DWORD>, int> content;
+
+	std::vector<int> EntrySlot(header.EntryCount);
+
+	for (DWORD n = 0; n < header.SlotCount; n++)
+	{
+		if (slot[n] != -1)
+		{
+			EntrySlot[slot[n]] = n;
+		}
+	}
+
+	bool result = (SetFilePointer(handle, offset, 0, FILE_BEGIN) != INVALID_SET_FILE_POINTER);
+
+	CCRC32 CRC32;
+
+	for (DWORD n = 0; result != 0 && n < header.EntryCount; n++)
+	{
+		DATA_PACK_ENTRY* lpEntry = &entry[EntrySlot[n]];
+
+		if (ReadPackSource((char*)file[n].c_str(), data, &lpEntry->Time) == 0)
+		{
+			result = false;
+			break;
+		}
+
+		lpEntry->NameOffset = NameOffset[n];
+
+		lpEntry->Size = data.size();
+
+		lpEntry->Crc = (DWORD)CRC32.FullCRC((data.empty() ? (BYTE*)&pad[0] : &data[0]), data.size());
+
+		lpInfo->RawSize += lpEntry->Size;
+
+		// A copy of a blob already in the pack points at the same data, the checksum only picks the file to compare with
+		std::map<std::pair<DWORD, DWORD>, int>::iterator it = content.find(std::make_pair(lpEntry->Crc, lpEntry->Size));
+
+		if (it != content.end() && ReadPackSource((char*)file[it->second].c_str(), other, 0) != 0 && other == data)
+		{
+			DATA_PACK_ENTRY* lpOriginal = &entry[EntrySlot[it->second]];
+
+			lpEntry->Offset = lpOriginal->Offset;
+
+			lpEntry->PackedSize = lpOriginal->PackedSize;
+
+			lpEntry->Flags = lpOriginal->Flags;
+
+			lpInfo->SharedCount++;
+
+			lpInfo->SharedSize += lpEntry->Size;
+
+			continue;
+		}
+
+		content.insert(std::make_pair(std::make_pair(lpEntry->Crc, lpEntry->Size), (int)n));
+
+		DWORD align = ((offset + (DATA_PACK_ALIGN - 1)) & ~(DATA_PACK_ALIGN - 1)) - offset;
+
+		result = WritePackData(handle, &pad[0], align);
+
+		offset += align;
+
+		lpEntry->Offset = offset;
+
+		packed.clear();
+
+		if (compress != 0 && data.empty() == 0)
+		{
+			CDataPack::Compress(&data[0], data.size(), packed);
+		}
+
+		if (packed.empty() == 0 && packed.size() <= (data.size() - (data.size() / DATA_PACK_MIN_GAIN)))
+		{
+			lpEntry->Flags = DATA_PACK_FLAG_LZ;
+
+			lpEntry->PackedSize = packed.size();
+
+			result = (result != 0 && WritePackData(handle, &packed[0], packed.size()));
+
+			lpInfo->PackedCount++;
+		}
+		else
+		{
+			lpEntry->PackedSize = data.size();
+
+			result = (result != 0 && WritePackData(handle, (data.empty() ? (BYTE*)&pad[0] : &data[0]), data.size()));
+		}
+
+		offset += lpEntry->PackedSize;
+	}
+
+	result = (result != 0 && SetFilePointer(handle, 0, 0, FILE_BEGIN) != INVALID_SET_FILE_POINTER);
+
+	result = (result != 0 && WritePackData(handle, &header, sizeof(header)));
+
+	result = (result != 0 && WritePackData(handle, &seed[0], (seed.size() * sizeof(DWORD))));
+
+	result = (result != 0 && WritePackData(handle, &entry[0], (entry.size() * sizeof(DATA_PACK_ENTRY))));
+
+	result = (result != 0 && WritePackData(handle, &NameData[0], NameData.size()));
+
+	CloseHandle(handle);
+
+	if (result == 0 || MoveFileEx(temp, path, MOVEFILE_REPLACE_EXISTING) == 0)
+	{
+		DeleteFile(temp);
+		return false;
+	}
+
+	lpInfo->EntryCount = header.EntryCount;
+
+	lpInfo->FileSize = offset;
+
+	return true;
+}
+
+bool CDataPack::IsPackable(char* path)
+{
+	// Files the game rewrites and caches the tools regenerate must never be served from an older copy
+	char* name = strrchr(path, '\\');
+
+	name = ((name != 0) ? (name + 1) : path);
+
+	char* ext = strrchr(name, '.');
+
+	for (int n = 0; n < (sizeof(DataPackSkipName) / sizeof(DataPackSkipName[0])); n++)
+	{
+		if (_stricmp(name, DataPackSkipName[n]) == 0)
+		{
+			return false;
+		}
+	}
+
+	for (int n = 0; n < (sizeof(DataPackSkipExtension) / sizeof(DataPackSkipExtension[0])); n++)
+	{
+		if (ext != 0 && _stricmp(ext, DataPackSkipExtension[n]) == 0)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void CDataPack::Compress(BYTE* data, DWORD size, std::vector<BYTE>& out)
+{
+	// Greedy LZ with a 16 bit window, one hash probe per position keeps it cheap on JPEG data that never matches
+	out.clear();
+
+	out.reserve(size + (size / 255) + 16);
+
+	std::vector<int> table((1 << DATA_PACK_LZ_HASH_BITS), -1);
+
+	DWORD anchor = 0;
+
+	DWORD position = 0;
+
+	while ((position + DATA_PACK_LZ_MIN_MATCH) <= size)
+	{
+		DWORD value;
+
+		memcpy(&value, &data[position], sizeof(value));
+
+		DWORD hash = (value * 2654435761U) >> (32 - DATA_PACK_LZ_HASH_BITS);
+
+		int candidate = table[hash];
+
+		table[hash] = position;
+
+		if (candidate == -1 || (position - candidate) > DATA_PACK_LZ_MAX_OFFSET || memcmp(&data[candidate], &data[position], DATA_PACK_LZ_MIN_MATCH) != 0)
+		{
+			position++;
+			continue;
+		}
+
+		DWORD length = DATA_PACK_LZ_MIN_MATCH;
+
+		while ((position + length) < size && data[candidate + length] == data[position + length])
+		{
+			length++;
+		}
+
+		WriteLzSequence(out, &data[anchor], (position - anchor), (position - candidate), length);
+
+		position += length;
+
+		anchor = position;
+	}
+
+	WriteLzSequence(out, &data[anchor], (size - anchor), 0, 0);
+}
+
+bool CDataPack::Decompress(BYTE* data, DWORD PackedSize, BYTE* out, DWORD size)
+{
+	// Every length is checked against both ends, a damaged entry fails instead of writing past the buffer
+	BYTE* end = data + PackedSize;
+
+	BYTE* OutStart = out;
+
+	BYTE* OutEnd = out + size;
+
+	while (data < end)
+	{
+		BYTE token = *data++;
+
+		DWORD LiteralSize = token >> 4;
+
+		if (LiteralSize == 15 && ReadLzLength(&data, end, &LiteralSize) == 0)
+		{
+			return false;
+		}
+
+		if (LiteralSize > (DWORD)(end - data) || LiteralSize > (DWORD)(OutEnd - out))
+		{
+			return false;
+		}
+
+		// Short runs are copied as one 16 byte block while both buffers have room for it
+		if (LiteralSize <= 16 && (end - data) >= 16 && (OutEnd - out) >= 16)
+		{
+			memcpy(out, data, 16);
+		}
+		else
+		{
+			memcpy(out, data, LiteralSize);
+		}
+
+		data += LiteralSize;
+
+		out += LiteralSize;
+
+		if (data == end)
+		{
+			break;
+		}
+
+		if ((end - data) < 2)
+		{
+			return false;
+		}
+
+		DWORD offset = data[0] | (data[1] << 8);
+
+		data += 2;
+
+		DWORD length = token & 15;
+
+		if (length == 15 && ReadLzLength(&data, end, &length) == 0)
+		{
+			return false;
+		}
+
+		length += DATA_PACK_LZ_MIN_MATCH;
+
+		if (offset == 0 || offset > (DWORD)(out - OutStart) || length > (DWORD)(OutEnd - out))
+		{
+			return false;
+		}
+
+		BYTE* match = out - offset;
+
+		if (offset >= 8 && (DWORD)(OutEnd - out) >= (length + 8))
+		{
+			// 8 byte steps stay correct on overlapping matches as long as the step does not pass the offset
+			BYTE* stop = out + length;
+
+			for (; out < stop; out += 8, match += 8)
+			{
+				memcpy(out, match, 8);
+			}
+
+			out = stop;
+		}
+		else if (offset >= length)
+		{
+			memcpy(out, match, length);
+
+			out += length;
+		}
+		else
+		{
+			for (BYTE* stop = out + length; out < stop; out++, match++)
+			{
+				*out = *match;
+			}
+		}
+	}
+
+	return (out == OutEnd);
+}
+
+DWORD CDataPack::Hash(char* name, DWORD seed)
+{
+	// FNV-1a started from the seed, with a final mix so nearby seeds give unrelated slots
+	DWORD hash = 2166136261U ^ (seed * 0x9E3779B9U);
+
+	for (BYTE* p = (BYTE*)name; (*p) != 0; p++)
+	{
+		hash = (hash ^ (*p)) * 16777619U;
+	}
+
+	hash ^= hash >> 16;
+
+	hash *= 0x85EBCA6BU;
+
+	hash ^= hash >> 13;
+
+	hash *= 0xC2B2AE35U;
+
+	hash ^= hash >> 16;
+
+	return hash;
+}
+
+void CDataPack::GetPackName(char* name, char* out)
+{
+	// Names are kept as lower case paths from the client folder with backslashes, ".\Data\x" and "data/x" both become "data\x"
+	out[0] = 0;
+
+	char current[MAX_PATH];
+
+	DWORD CurrentSize = 0;
+
+	if (name[0] != 0 && (name[1] == ':' || (name[0] == '\\' && name[1] == '\\')))
+	{
+		CurrentSize = GetCurrentDirectory(sizeof(current), current);
+
+		if (CurrentSize == 0 || CurrentSize >= sizeof(current) || _strnicmp(name, current, CurrentSize) != 0 || (name[CurrentSize] != '\\' && name[CurrentSize] != '/'))
+		{
+			return;
+		}
+
+		name += CurrentSize + 1;
+	}
+
+	while (name[0] == '.' && (name[1] == '\\' || name[1] == '/'))
+	{
+		name += 2;
+	}
+
+	int length = 0;
+
+	for (; name[length] != 0 && length < (MAX_PATH - 1); length++)
+	{
+		char value = ((name[length] == '/') ? '\\' : name[length]);
+
+		out[length] = (((value >= 'A') && (value <= 'Z')) ? (value + ('a' - 'A')) : value);
+	}
+
+	out[((name[length] == 0) ? length : 0)] = 0;
+}
\ No newline at end of file
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#define DATA_PACK_MAGIC 0x4B504244 // "DBPK"
+#define DATA_PACK_VERSION 2
+#define DATA_PACK_NAME "Data.bpk"
+#define DATA_PACK_ALIGN 16
+#define DATA_PACK_BUCKET_SIZE 4 // Names per displacement bucket on average
+#define DATA_PACK_MAX_SEED 0x100000
+#define DATA_PACK_MIN_GAIN 8 // Entries are compressed only when it saves an eighth
+#define DATA_PACK_LZ_HASH_BITS 14
+#define DATA_PACK_LZ_MIN_MATCH 4
+#define DATA_PACK_LZ_MAX_OFFSET 65535
+#define DATA_PACK_EMPTY 0xFFFFFFFF
+
+enum eDataPackFlag
+{
+	DATA_PACK_FLAG_LZ = 0x01,
+};
+
+struct DATA_PACK_HEADER
+{
+	DWORD Magic;
+	WORD Version;
+	WORD Reserved;
+	DWORD EntryCount;
+	DWORD SlotCount;
+	DWORD BucketCount;
+	DWORD SeedOffset;
+	DWORD SlotOffset;
+	DWORD NameOffset;
+	DWORD NameSize;
+};
+
+struct DATA_PACK_ENTRY
+{
+	DWORD NameOffset; // DATA_PACK_EMPTY for a free slot
+	DWORD Offset; // Identical files share their data
+	DWORD Size;
+	DWORD PackedSize;
+	DWORD Crc; // CCRC32 of the unpacked data
+	DWORD Flags;
+	FILETIME Time; // Last write of the source file, a loose file found at Open that is newer or of another size wins over the entry
+};
+
+struct DATA_PACK_VIEW
+{
+	BYTE* Data;
+	DWORD Size;
+	BYTE* Buffer; // Set when the entry had to be unpacked, freed by ReleaseView
+};
+
+struct DATA_PACK_FILE
+{
+	DATA_PACK_VIEW View;
+	DWORD Position;
+};
+
+struct DATA_PACK_BUILD_INFO
+{
+	DWORD EntryCount;
+	DWORD SkippedCount; // Files the game writes or the tools generate, always read from the disk
+	DWORD PackedCount;
+	DWORD MaxSeed;
+	DWORD SharedCount; // Entries pointing at the data of an identical file
+	DWORD SharedSize;
+	DWORD RawSize;
+	DWORD FileSize;
+};
+
+class CDataPack
+{
+public:
+
+	CDataPack();
+
+	~CDataPack();
+
+	bool Open(char* path);
+
+	void Close();
+
+	bool IsOpen();
+
+	int Find(char* name);
+
+	bool GetView(int index, DATA_PACK_VIEW* lpView);
+
+	void ReleaseView(DATA_PACK_VIEW* lpView);
+
+	bool Verify(int index);
+
+	bool IsCurrent(int index);
+
+	DATA_PACK_ENTRY* GetEntry(int index);
+
+	char* GetName(int index);
+
+	int GetSlotCount();
+
+	int GetEntryCount();
+
+	HANDLE OpenFile(char* name);
+
+	bool IsFile(HANDLE handle);
+
+	bool FileRead(HANDLE handle, void* buff, DWORD size, DWORD* OutSize);
+
+	DWORD FileSeek(HANDLE handle, LONG distance, DWORD method);
+
+	DWORD FileSize(HANDLE handle);
+
+	bool FileClose(HANDLE handle);
+
+	bool Redirect();
+
+	static bool Build(std::vector<std::string>& list, char* path, bool compress, DATA_PACK_BUILD_INFO* lpInfo);
+
+	static bool IsPackable(char* path);
+
+	static void Compress(BYTE* data, DWORD size, std::vector<BYTE>& out);
+
+	static bool Decompress(BYTE* data, DWORD PackedSize, BYTE* out, DWORD size);
+
+	static DWORD Hash(char* name, DWORD seed);
+
+	static void GetPackName(char* name, char* out);
+
+private:
+
+	void CheckLoose();
+
+	CMappedFile m_File;
+
+	HANDLE m_Handle; // Second handle on the pack, duplicated for every redirected open
+
+	DATA_PACK_HEADER* m_Header;
+
+	DWORD* m_Seed;
+
+	DATA_PACK_ENTRY* m_Slot;
+
+	char* m_Name;
+
+	std::vector<BYTE> m_Stale; // Entries a loose file overrides, found once by Open
+
+	std::map<HANDLE, DATA_PACK_FILE> m_OpenFile;
+
+	CRITICAL_SECTION m_Lock;
+};
+
+extern CDataPack gDataPack;
\ No newline at end of file
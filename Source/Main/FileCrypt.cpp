@@ -0,0 +1,28 @@
+#include "stdafx.h"
+#include "FileCrypt.h"
+
+void MapFileDecrypt(BYTE* out_buff, BYTE* in_buff, DWORD size)
+{
+	BYTE XorTable[16] = { 0xD1, 0x73, 0x52, 0xF6, 0xD2, 0x9A, 0xCB, 0x27, 0x3E, 0xAF, 0x59, 0x31, 0x37, 0xB3, 0xE7, 0xA2 };
+
+	WORD key = 0x5E;
+
+	for (DWORD n = 0; n < size; n++)
+	{
+		BYTE value = in_buff[n];
+
+		out_buff[n] = (value ^ XorTable[n % 16]) - (BYTE)key;
+
+		key = value + 0x3D;
+	}
+}
+
+void BuxConvert(BYTE* buff, DWORD size)
+{
+	BYTE XorTable[3] = { 0xFC, 0xCF, 0xAB };
+
+	for (DWORD n = 0; n < size; n++)
+	{
+		buff[n] ^= XorTable[n % 3];
+	}
+}
\ No newline at end of file
@@ -0,0 +1,5 @@
+#pragma once
+
+void MapFileDecrypt(BYTE* out_buff, BYTE* in_buff, DWORD size);
+
+void BuxConvert(BYTE* buff, DWORD size);
\ No newline at end of file
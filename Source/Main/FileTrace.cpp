@@ -0,0 +1,439 @@
+#include "stdafx.h"
+#include "FileTrace.h"
+#include "DataPack.h"
+
+CFileTrace gFileTrace;
+
+CFileTrace::CFileTrace()
+{
+	this->m_Active = 0;
+
+	this->m_Path[0] = 0;
+
+	this->m_Scene = 0;
+
+	this->m_LastScene = 0;
+
+	this->m_World = FILE_TRACE_NO_WORLD;
+
+	this->m_MainThread = 0;
+
+	this->m_Start.QuadPart = 0;
+
+	this->m_Frequency.QuadPart = 1;
+
+	InitializeCriticalSection(&this->m_Lock);
+}
+
+CFileTrace::~CFileTrace()
+{
+	DeleteCriticalSection(&this->m_Lock);
+}
+
+bool CFileTrace::Start(char* path, int* lpScene)
+{
+	// The thread that starts the trace is the one whose terrain opens move it to another world
+	if (this->m_Active != 0)
+	{
+		return false;
+	}
+
+	strcpy_s(this->m_Path, path);
+
+	this->m_Scene = lpScene;
+
+	this->m_LastScene = ((lpScene != 0) ? *lpScene : 0);
+
+	this->m_World = FILE_TRACE_NO_WORLD;
+
+	this->m_MainThread = GetCurrentThreadId();
+
+	this->m_Event.clear();
+
+	this->m_Event.reserve(4096);
+
+	this->m_Name.clear();
+
+	this->m_NameIndex.clear();
+
+	this->m_Thread.clear();
+
+	this->m_File.clear();
+
+	QueryPerformanceFrequency(&this->m_Frequency);
+
+	QueryPerformanceCounter(&this->m_Start);
+
+	this->m_Active = 1;
+
+	EnterCriticalSection(&this->m_Lock);
+
+	this->AddEvent(0, FILE_TRACE_PHASE, this->m_LastScene, this->m_World);
+
+	LeaveCriticalSection(&this->m_Lock);
+
+	return true;
+}
+
+bool CFileTrace::Stop()
+{
+	if (this->m_Active == 0)
+	{
+		return false;
+	}
+
+	EnterCriticalSection(&this->m_Lock);
+
+	this->m_Active = 0;
+
+	LeaveCriticalSection(&this->m_Lock);
+
+	FILE_TRACE_HEADER header;
+
+	header.Magic = FILE_TRACE_MAGIC;
+
+	header.Version = FILE_TRACE_VERSION;
+
+	header.ThreadCount = this->m_Thread.size();
+
+	header.NameCount = this->m_Name.size();
+
+	header.NameSize = 0;
+
+	header.EventCount = this->m_Event.size();
+
+	std::vector<char> NameData;
+
+	for (size_t n = 0; n < this->m_Name.size(); n++)
+	{
+		NameData.insert(NameData.end(), this->m_Name[n].begin(), this->m_Name[n].end());
+
+		NameData.push_back(0);
+	}
+
+	header.NameSize = NameData.size();
+
+	HANDLE handle = CreateFile(this->m_Path, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_ARCHIVE, 0);
+
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	DWORD OutSize = 0;
+
+	bool result = (WriteFile(handle, &header, sizeof(header), &OutSize, 0) != 0 && OutSize == sizeof(header));
+
+	result = (result != 0 && (NameData.empty() != 0 || (WriteFile(handle, &NameData[0], NameData.size(), &OutSize, 0) != 0 && OutSize == NameData.size())));
+
+	result = (result != 0 && (this->m_Event.empty() != 0 || (WriteFile(handle, &this->m_Event[0], (this->m_Event.size() * sizeof(FILE_TRACE_EVENT)), &OutSize, 0) != 0 && OutSize == (this->m_Event.size() * sizeof(FILE_TRACE_EVENT)))));
+
+	CloseHandle(handle);
+
+	return result;
+}
+
+void CFileTrace::Detach()
+{
+	// Only stops recording, another thread may hold the lock when the process ends and nothing can be written here
+	this->m_Active = 0;
+}
+
+bool CFileTrace::IsActive()
+{
+	return (this->m_Active != 0);
+}
+
+void CFileTrace::Open(HANDLE handle, char* name, DWORD size)
+{
+	// Names are stored the way the pack keys them, so a trace lines up with a pack built from the same folder
+	char key[MAX_PATH];
+
+	CDataPack::GetPackName(name, key);
+
+	if (key[0] == 0)
+	{
+		return;
+	}
+
+	EnterCriticalSection(&this->m_Lock);
+
+	if (this->m_Active == 0)
+	{
+		LeaveCriticalSection(&this->m_Lock);
+		return;
+	}
+
+	std::map<std::string, WORD>::iterator it = this->m_NameIndex.find(key);
+
+	if (it == this->m_NameIndex.end())
+	{
+		if (this->m_Name.size() >= FILE_TRACE_MAX_NAME)
+		{
+			LeaveCriticalSection(&this->m_Lock);
+			return;
+		}
+
+		it = this->m_NameIndex.insert(std::make_pair(std::string(key), (WORD)this->m_Name.size())).first;
+
+		this->m_Name.push_back(key);
+	}
+
+	this->UpdatePhase(((GetCurrentThreadId() == this->m_MainThread) ? key : 0));
+
+	FILE_TRACE_FILE file;
+
+	file.Name = it->second;
+
+	file.Position = 0;
+
+	this->m_File[handle] = file;
+
+	this->AddEvent(file.Name, FILE_TRACE_OPEN, 0, size);
+
+	LeaveCriticalSection(&this->m_Lock);
+}
+
+void CFileTrace::Read(HANDLE handle, DWORD size)
+{
+	EnterCriticalSection(&this->m_Lock);
+
+	std::map<HANDLE, FILE_TRACE_FILE>::iterator it = this->m_File.find(handle);
+
+	if (this->m_Active != 0 && it != this->m_File.end())
+	{
+		this->UpdatePhase(0);
+
+		this->AddEvent(it->second.Name, FILE_TRACE_READ, it->second.Position, size);
+
+		it->second.Position += size;
+	}
+
+	LeaveCriticalSection(&this->m_Lock);
+}
+
+void CFileTrace::Seek(HANDLE handle, DWORD position)
+{
+	// Seeks are not events of their own, the next read carries the new offset
+	EnterCriticalSection(&this->m_Lock);
+
+	std::map<HANDLE, FILE_TRACE_FILE>::iterator it = this->m_File.find(handle);
+
+	if (it != this->m_File.end())
+	{
+		it->second.Position = position;
+	}
+
+	LeaveCriticalSection(&this->m_Lock);
+}
+
+void CFileTrace::Close(HANDLE handle)
+{
+	EnterCriticalSection(&this->m_Lock);
+
+	std::map<HANDLE, FILE_TRACE_FILE>::iterator it = this->m_File.find(handle);
+
+	if (it != this->m_File.end())
+	{
+		if (this->m_Active != 0)
+		{
+			this->AddEvent(it->second.Name, FILE_TRACE_CLOSE, it->second.Position, 0);
+		}
+
+		this->m_File.erase(it);
+	}
+
+	LeaveCriticalSection(&this->m_Lock);
+}
+
+bool CFileTrace::Load(char* path)
+{
+	this->m_Event.clear();
+
+	this->m_Name.clear();
+
+	this->m_NameIndex.clear();
+
+	this->m_Thread.clear();
+
+	HANDLE handle = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	FILE_TRACE_HEADER header;
+
+	DWORD InSize = 0;
+
+	std::vector<char> NameData;
+
+	bool result = (ReadFile(handle, &header, sizeof(header), &InSize, 0) != 0 && InSize == sizeof(header));
+
+	result = (result != 0 && header.Magic == FILE_TRACE_MAGIC && header.Version == FILE_TRACE_VERSION && header.NameCount <= FILE_TRACE_MAX_NAME && header.EventCount <= FILE_TRACE_MAX_EVENT);
+
+	if (result != 0)
+	{
+		NameData.resize(header.NameSize + 1, 0);
+
+		this->m_Event.resize(header.EventCount);
+
+		result = (header.NameSize == 0 || (ReadFile(handle, &NameData[0], header.NameSize, &InSize, 0) != 0 && InSize == header.NameSize));
+
+		result = (result != 0 && (header.EventCount == 0 || (ReadFile(handle, &this->m_Event[0], (header.EventCount * sizeof(FILE_TRACE_EVENT)), &InSize, 0) != 0 && InSize == (header.EventCount * sizeof(FILE_TRACE_EVENT)))));
+	}
+
+	CloseHandle(handle);
+
+	for (DWORD n = 0, offset = 0; result != 0 && n < header.NameCount; n++)
+	{
+		if (offset >= header.NameSize)
+		{
+			result = false;
+			break;
+		}
+
+		this->m_Name.push_back(&NameData[offset]);
+
+		offset += this->m_Name.back().size() + 1;
+	}
+
+	for (DWORD n = 0; result != 0 && n < header.EventCount; n++)
+	{
+		result = (this->m_Event[n].Type == FILE_TRACE_PHASE || this->m_Event[n].Name < this->m_Name.size());
+	}
+
+	if (result == 0)
+	{
+		this->m_Event.clear();
+
+		this->m_Name.clear();
+
+		return false;
+	}
+
+	this->m_Thread.resize(header.ThreadCount, 0);
+
+	return true;
+}
+
+int CFileTrace::GetEventCount()
+{
+	return this->m_Event.size();
+}
+
+FILE_TRACE_EVENT* CFileTrace::GetEvent(int index)
+{
+	return &this->m_Event[index];
+}
+
+char* CFileTrace::GetName(int index)
+{
+	return (char*)this->m_Name[index].c_str();
+}
+
+int CFileTrace::GetNameCount()
+{
+	return this->m_Name.size();
+}
+
+int CFileTrace::GetThreadCount()
+{
+	return this->m_Thread.size();
+}
+
+void CFileTrace::GetPhaseName(DWORD scene, DWORD world, char* out)
+{
+	static char* name[] = { "webzen", "server", "login", "loading", "character", "game", "movie" };
+
+	char SceneName[16];
+
+	if (scene < (sizeof(name) / sizeof(char*)))
+	{
+		strcpy_s(SceneName, name[scene]);
+	}
+	else
+	{
+		wsprintf(SceneName, "scene %d", scene);
+	}
+
+	if (world == FILE_TRACE_NO_WORLD)
+	{
+		wsprintf(out, "%s", SceneName);
+	}
+	else
+	{
+		wsprintf(out, "%s world%d", SceneName, world);
+	}
+}
+
+void CFileTrace::AddEvent(WORD name, BYTE type, DWORD offset, DWORD size)
+{
+	if (this->m_Event.size() >= FILE_TRACE_MAX_EVENT)
+	{
+		return;
+	}
+
+	DWORD thread = GetCurrentThreadId();
+
+	size_t index = 0;
+
+	for (; index < this->m_Thread.size() && this->m_Thread[index] != thread; index++)
+	{
+	}
+
+	if (index == this->m_Thread.size() && index < FILE_TRACE_MAX_THREAD)
+	{
+		this->m_Thread.push_back(thread);
+	}
+
+	LARGE_INTEGER counter;
+
+	QueryPerformanceCounter(&counter);
+
+	FILE_TRACE_EVENT event;
+
+	event.Time = (DWORD)(((counter.QuadPart - this->m_Start.QuadPart) * 1000000) / this->m_Frequency.QuadPart);
+
+	event.Name = name;
+
+	event.Thread = (BYTE)index;
+
+	event.Type = type;
+
+	event.Offset = offset;
+
+	event.Size = size;
+
+	this->m_Event.push_back(event);
+}
+
+void CFileTrace::UpdatePhase(char* name)
+{
+	// A scene change shows up on the first file touched after it, the world on the terrain map the game opens first when it enters one
+	DWORD scene = ((this->m_Scene != 0) ? *this->m_Scene : this->m_LastScene);
+
+	DWORD world = this->m_World;
+
+	if (name != 0 && strncmp(name, "data\\world", 10) == 0)
+	{
+		char* file = strchr(&name[10], '\\');
+
+		char* ext = strrchr(name, '.');
+
+		if (file != 0 && ext != 0 && strstr(file, "terrain") != 0 && strcmp(ext, ".map") == 0)
+		{
+			world = atoi(&name[10]);
+		}
+	}
+
+	if (scene != this->m_LastScene || world != this->m_World)
+	{
+		this->m_LastScene = scene;
+
+		this->m_World = world;
+
+		this->AddEvent(0, FILE_TRACE_PHASE, this->m_LastScene, this->m_World);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+
+#define FILE_TRACE_MAGIC 0x43525446 // "FTRC"
+#define FILE_TRACE_VERSION 1
+#define FILE_TRACE_NAME "FileTrace.bin"
+#define FILE_TRACE_MAX_EVENT 0x100000 // 16 MB of events, the rest of a longer session is dropped
+#define FILE_TRACE_MAX_NAME 0xFFFF
+#define FILE_TRACE_MAX_THREAD 0xFF
+#define FILE_TRACE_NO_WORLD 0xFFFFFFFF
+
+enum eFileTraceType
+{
+	FILE_TRACE_OPEN = 0,
+	FILE_TRACE_READ = 1,
+	FILE_TRACE_CLOSE = 2,
+	FILE_TRACE_PHASE = 3,
+};
+
+struct FILE_TRACE_HEADER
+{
+	DWORD Magic;
+	WORD Version;
+	WORD ThreadCount;
+	DWORD NameCount;
+	DWORD NameSize;
+	DWORD EventCount;
+};
+
+struct FILE_TRACE_EVENT
+{
+	DWORD Time; // Microseconds since the trace started, wraps after 71 minutes
+	WORD Name;
+	BYTE Thread; // Order in which the thread first touched a file
+	BYTE Type;
+	DWORD Offset; // Position of a read, the scene for a phase
+	DWORD Size; // Bytes read, the file size on open, the world folder for a phase
+};
+
+struct FILE_TRACE_FILE
+{
+	WORD Name;
+	DWORD Position;
+};
+
+class CFileTrace
+{
+public:
+
+	CFileTrace();
+
+	~CFileTrace();
+
+	bool Start(char* path, int* lpScene);
+
+	bool Stop();
+
+	void Detach();
+
+	bool IsActive();
+
+	void Open(HANDLE handle, char* name, DWORD size);
+
+	void Read(HANDLE handle, DWORD size);
+
+	void Seek(HANDLE handle, DWORD position);
+
+	void Close(HANDLE handle);
+
+	bool Load(char* path);
+
+	int GetEventCount();
+
+	FILE_TRACE_EVENT* GetEvent(int index);
+
+	char* GetName(int index);
+
+	int GetNameCount();
+
+	int GetThreadCount();
+
+	static void GetPhaseName(DWORD scene, DWORD world, char* out);
+
+private:
+
+	void AddEvent(WORD name, BYTE type, DWORD offset, DWORD size);
+
+	void UpdatePhase(char* name);
+
+	bool m_Active;
+
+	char m_Path[MAX_PATH];
+
+	int* m_Scene; // The game's scene number, read on every event
+
+	DWORD m_LastScene;
+
+	DWORD m_World; // Set when the main thread opens a world's terrain
+
+	DWORD m_MainThread;
+
+	LARGE_INTEGER m_Start;
+
+	LARGE_INTEGER m_Frequency;
+
+	std::vector<FILE_TRACE_EVENT> m_Event;
+
+	std::vector<std::string> m_Name;
+
+	std::map<std::string, WORD> m_NameIndex;
+
+	std::vector<DWORD> m_Thread;
+
+	std::map<HANDLE, FILE_TRACE_FILE> m_File;
+
+	CRITICAL_SECTION m_Lock;
+};
+
+extern CFileTrace gFileTrace;
\ No newline at end of file
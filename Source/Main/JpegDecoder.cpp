@@ -0,0 +1,1545 @@
+#include "stdafx.h"
+#include "JpegDecoder.h"
+#include <emmintrin.h>
+
+#define JPEG_CONST_BITS 13
+#define JPEG_PASS1_BITS 2
+
+#define JPEG_FIX_0_298631336 2446
+#define JPEG_FIX_0_390180644 3196
+#define JPEG_FIX_0_541196100 4433
+#define JPEG_FIX_0_765366865 6270
+#define JPEG_FIX_0_899976223 7373
+#define JPEG_FIX_1_175875602 9633
+#define JPEG_FIX_1_501321110 12299
+#define JPEG_FIX_1_847759065 15137
+#define JPEG_FIX_1_961570560 16069
+#define JPEG_FIX_2_053119869 16819
+#define JPEG_FIX_2_562915447 20995
+#define JPEG_FIX_3_072711026 25172
+
+#define JPEG_DESCALE(x,n) (((x) + (1 << ((n) - 1))) >> (n))
+
+// Paired constants for _mm_madd_epi16 on interleaved (a,b) words, every lane gives a*c1+b*c2
+#define JPEG_PAIR(c1,c2) _mm_set_epi16((short)(c2), (short)(c1), (short)(c2), (short)(c1), (short)(c2), (short)(c1), (short)(c2), (short)(c1))
+
+// Zigzag to natural order, the extra entries keep corrupt run lengths inside the block
+static const BYTE JpegNaturalOrder[80] =
+{
+	0, 1, 8, 16, 9, 2, 3, 10,
+	17, 24, 32, 25, 18, 11, 4, 5,
+	12, 19, 26, 33, 40, 48, 41, 34,
+	27, 20, 13, 6, 7, 14, 21, 28,
+	35, 42, 49, 56, 57, 50, 43, 36,
+	29, 22, 15, 23, 30, 37, 44, 51,
+	58, 59, 52, 45, 38, 31, 39, 46,
+	53, 60, 61, 54, 47, 55, 62, 63,
+	63, 63, 63, 63, 63, 63, 63, 63,
+	63, 63, 63, 63, 63, 63, 63, 63,
+};
+
+static BYTE JpegClamp(int value)
+{
+	return (BYTE)((value < 0) ? 0 : ((value > 255) ? 255 : value));
+}
+
+static __m128i JpegMultiply(__m128i lo, __m128i hi, __m128i constant)
+{
+	// The 16 bit fraction of a color factor, rounded like the libjpeg ONE_HALF tables
+	__m128i round = _mm_set1_epi32(1 << 15);
+
+	__m128i a = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(lo, constant), round), 16);
+
+	__m128i b = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(hi, constant), round), 16);
+
+	return _mm_packs_epi32(a, b);
+}
+
+static void JpegTranspose(__m128i* row)
+{
+	__m128i a0 = _mm_unpacklo_epi16(row[0], row[1]);
+	__m128i a1 = _mm_unpackhi_epi16(row[0], row[1]);
+	__m128i a2 = _mm_unpacklo_epi16(row[2], row[3]);
+	__m128i a3 = _mm_unpackhi_epi16(row[2], row[3]);
+	__m128i a4 = _mm_unpacklo_epi16(row[4], row[5]);
+	__m128i a5 = _mm_unpackhi_epi16(row[4], row[5]);
+	__m128i a6 = _mm_unpacklo_epi16(row[6], row[7]);
+	__m128i a7 = _mm_unpackhi_epi16(row[6], row[7]);
+
+	__m128i b0 = _mm_unpacklo_epi32(a0, a2);
+	__m128i b1 = _mm_unpackhi_epi32(a0, a2);
+	__m128i b2 = _mm_unpacklo_epi32(a1, a3);
+	__m128i b3 = _mm_unpackhi_epi32(a1, a3);
+	__m128i b4 = _mm_unpacklo_epi32(a4, a6);
+	__m128i b5 = _mm_unpackhi_epi32(a4, a6);
+	__m128i b6 = _mm_unpacklo_epi32(a5, a7);
+	__m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+	row[0] = _mm_unpacklo_epi64(b0, b4);
+	row[1] = _mm_unpackhi_epi64(b0, b4);
+	row[2] = _mm_unpacklo_epi64(b1, b5);
+	row[3] = _mm_unpackhi_epi64(b1, b5);
+	row[4] = _mm_unpacklo_epi64(b2, b6);
+	row[5] = _mm_unpackhi_epi64(b2, b6);
+	row[6] = _mm_unpacklo_epi64(b3, b7);
+	row[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+static void JpegTransformPass(__m128i* row, int shift, int bias)
+{
+	// One islow pass over eight lanes, every rotation is rewritten as a multiply add of a word pair
+	__m128i count = _mm_cvtsi32_si128(shift);
+
+	__m128i round = _mm_set1_epi32(bias);
+
+	__m128i lo = _mm_unpacklo_epi16(row[2], row[6]);
+	__m128i hi = _mm_unpackhi_epi16(row[2], row[6]);
+
+	__m128i c = JPEG_PAIR(JPEG_FIX_0_541196100 + JPEG_FIX_0_765366865, JPEG_FIX_0_541196100);
+
+	__m128i tmp3l = _mm_madd_epi16(lo, c);
+	__m128i tmp3h = _mm_madd_epi16(hi, c);
+
+	c = JPEG_PAIR(JPEG_FIX_0_541196100, JPEG_FIX_0_541196100 - JPEG_FIX_1_847759065);
+
+	__m128i tmp2l = _mm_madd_epi16(lo, c);
+	__m128i tmp2h = _mm_madd_epi16(hi, c);
+
+	lo = _mm_unpacklo_epi16(row[0], row[4]);
+	hi = _mm_unpackhi_epi16(row[0], row[4]);
+
+	c = JPEG_PAIR(1 << JPEG_CONST_BITS, 1 << JPEG_CONST_BITS);
+
+	__m128i tmp0l = _mm_madd_epi16(lo, c);
+	__m128i tmp0h = _mm_madd_epi16(hi, c);
+
+	c = JPEG_PAIR(1 << JPEG_CONST_BITS, -(1 << JPEG_CONST_BITS));
+
+	__m128i tmp1l = _mm_madd_epi16(lo, c);
+	__m128i tmp1h = _mm_madd_epi16(hi, c);
+
+	__m128i tmp10l = _mm_add_epi32(_mm_add_epi32(tmp0l, tmp3l), round);
+	__m128i tmp10h = _mm_add_epi32(_mm_add_epi32(tmp0h, tmp3h), round);
+	__m128i tmp13l = _mm_add_epi32(_mm_sub_epi32(tmp0l, tmp3l), round);
+	__m128i tmp13h = _mm_add_epi32(_mm_sub_epi32(tmp0h, tmp3h), round);
+	__m128i tmp11l = _mm_add_epi32(_mm_add_epi32(tmp1l, tmp2l), round);
+	__m128i tmp11h = _mm_add_epi32(_mm_add_epi32(tmp1h, tmp2h), round);
+	__m128i tmp12l = _mm_add_epi32(_mm_sub_epi32(tmp1l, tmp2l), round);
+	__m128i tmp12h = _mm_add_epi32(_mm_sub_epi32(tmp1h, tmp2h), round);
+
+	// Odd part, z5 is distributed into the z3 and z4 pairs
+	__m128i z3 = _mm_add_epi16(row[7], row[3]);
+	__m128i z4 = _mm_add_epi16(row[5], row[1]);
+
+	lo = _mm_unpacklo_epi16(z3, z4);
+	hi = _mm_unpackhi_epi16(z3, z4);
+
+	c = JPEG_PAIR(JPEG_FIX_1_175875602 - JPEG_FIX_1_961570560, JPEG_FIX_1_175875602);
+
+	__m128i z3l = _mm_madd_epi16(lo, c);
+	__m128i z3h = _mm_madd_epi16(hi, c);
+
+	c = JPEG_PAIR(JPEG_FIX_1_175875602, JPEG_FIX_1_175875602 - JPEG_FIX_0_390180644);
+
+	__m128i z4l = _mm_madd_epi16(lo, c);
+	__m128i z4h = _mm_madd_epi16(hi, c);
+
+	lo = _mm_unpacklo_epi16(row[7], row[1]);
+	hi = _mm_unpackhi_epi16(row[7], row[1]);
+
+	c = JPEG_PAIR(JPEG_FIX_0_298631336 - JPEG_FIX_0_899976223, -JPEG_FIX_0_899976223);
+
+	tmp0l = _mm_add_epi32(_mm_madd_epi16(lo, c), z3l);
+	tmp0h = _mm_add_epi32(_mm_madd_epi16(hi, c), z3h);
+
+	c = JPEG_PAIR(-JPEG_FIX_0_899976223, JPEG_FIX_1_501321110 - JPEG_FIX_0_899976223);
+
+	tmp3l = _mm_add_epi32(_mm_madd_epi16(lo, c), z4l);
+	tmp3h = _mm_add_epi32(_mm_madd_epi16(hi, c), z4h);
+
+	lo = _mm_unpacklo_epi16(row[5], row[3]);
+	hi = _mm_unpackhi_epi16(row[5], row[3]);
+
+	c = JPEG_PAIR(JPEG_FIX_2_053119869 - JPEG_FIX_2_562915447, -JPEG_FIX_2_562915447);
+
+	tmp1l = _mm_add_epi32(_mm_madd_epi16(lo, c), z4l);
+	tmp1h = _mm_add_epi32(_mm_madd_epi16(hi, c), z4h);
+
+	c = JPEG_PAIR(-JPEG_FIX_2_562915447, JPEG_FIX_3_072711026 - JPEG_FIX_2_562915447);
+
+	tmp2l = _mm_add_epi32(_mm_madd_epi16(lo, c), z3l);
+	tmp2h = _mm_add_epi32(_mm_madd_epi16(hi, c), z3h);
+
+	row[0] = _mm_packs_epi32(_mm_sra_epi32(_mm_add_epi32(tmp10l, tmp3l), count), _mm_sra_epi32(_mm_add_epi32(tmp10h, tmp3h), count));
+	row[7] = _mm_packs_epi32(_mm_sra_epi32(_mm_sub_epi32(tmp10l, tmp3l), count), _mm_sra_epi32(_mm_sub_epi32(tmp10h, tmp3h), count));
+	row[1] = _mm_packs_epi32(_mm_sra_epi32(_mm_add_epi32(tmp11l, tmp2l), count), _mm_sra_epi32(_mm_add_epi32(tmp11h, tmp2h), count));
+	row[6] = _mm_packs_epi32(_mm_sra_epi32(_mm_sub_epi32(tmp11l, tmp2l), count), _mm_sra_epi32(_mm_sub_epi32(tmp11h, tmp2h), count));
+	row[2] = _mm_packs_epi32(_mm_sra_epi32(_mm_add_epi32(tmp12l, tmp1l), count), _mm_sra_epi32(_mm_add_epi32(tmp12h, tmp1h), count));
+	row[5] = _mm_packs_epi32(_mm_sra_epi32(_mm_sub_epi32(tmp12l, tmp1l), count), _mm_sra_epi32(_mm_sub_epi32(tmp12h, tmp1h), count));
+	row[3] = _mm_packs_epi32(_mm_sra_epi32(_mm_add_epi32(tmp13l, tmp0l), count), _mm_sra_epi32(_mm_add_epi32(tmp13h, tmp0h), count));
+	row[4] = _mm_packs_epi32(_mm_sra_epi32(_mm_sub_epi32(tmp13l, tmp0l), count), _mm_sra_epi32(_mm_sub_epi32(tmp13h, tmp0h), count));
+}
+
+CJpegDecoder::CJpegDecoder()
+{
+	this->m_Data = 0;
+
+	this->m_Size = 0;
+
+	this->m_Offset = 0;
+
+	this->m_Width = 0;
+
+	this->m_Height = 0;
+
+	this->m_Progressive = 0;
+
+	this->m_ComponentCount = 0;
+
+	this->m_Reference = 0;
+}
+
+CJpegDecoder::~CJpegDecoder()
+{
+
+}
+
+bool CJpegDecoder::ReadHeader(BYTE* data, DWORD size, int* width, int* height)
+{
+	this->m_Data = data;
+
+	this->m_Size = size;
+
+	this->m_Offset = 0;
+
+	this->m_Width = 0;
+
+	this->m_Height = 0;
+
+	this->m_Progressive = 0;
+
+	this->m_ComponentCount = 0;
+
+	this->m_RestartInterval = 0;
+
+	this->m_ScanCount = 0;
+
+	for (int n = 0; n < JPEG_MAX_TABLE; n++)
+	{
+		this->m_DcTable[n].Used = 0;
+
+		this->m_AcTable[n].Used = 0;
+	}
+
+	memset(this->m_Quant, 0, sizeof(this->m_Quant));
+
+	if (size < 4 || data[0] != 0xFF || data[1] != 0xD8)
+	{
+		return false;
+	}
+
+	this->m_Offset = 2;
+
+	BYTE marker;
+
+	while (this->ReadMarker(&marker) != 0)
+	{
+		if (marker == 0xD9 || marker == 0xDA || (this->m_Offset + 2) > this->m_Size)
+		{
+			return false;
+		}
+
+		DWORD length = (this->m_Data[this->m_Offset] << 8) | this->m_Data[this->m_Offset + 1];
+
+		if (length < 2 || (this->m_Offset + length) > this->m_Size)
+		{
+			return false;
+		}
+
+		bool result = 1;
+
+		switch (marker)
+		{
+			case 0xC0:
+			case 0xC1:
+				result = this->ReadFrame(length, 0);
+				break;
+			case 0xC2:
+				result = this->ReadFrame(length, 1);
+				break;
+			case 0xC3:
+			case 0xC5:
+			case 0xC6:
+			case 0xC7:
+			case 0xC9:
+			case 0xCA:
+			case 0xCB:
+			case 0xCD:
+			case 0xCE:
+			case 0xCF:
+				return false;
+			case 0xC4:
+				result = this->ReadHuffmanTable(length);
+				break;
+			case 0xDB:
+				result = this->ReadQuantTable(length);
+				break;
+			case 0xDD:
+				this->m_RestartInterval = (length >= 4) ? ((this->m_Data[this->m_Offset + 2] << 8) | this->m_Data[this->m_Offset + 3]) : 0;
+				break;
+		}
+
+		this->m_Offset += length;
+
+		if (result == 0)
+		{
+			return false;
+		}
+
+		if (this->m_ComponentCount != 0)
+		{
+			*width = this->m_Width;
+
+			*height = this->m_Height;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool CJpegDecoder::Decode(BYTE* output)
+{
+	if (this->m_ComponentCount == 0)
+	{
+		return false;
+	}
+
+	BYTE marker;
+
+	while (this->ReadMarker(&marker) != 0)
+	{
+		if (marker == 0xD9)
+		{
+			break;
+		}
+
+		if ((this->m_Offset + 2) > this->m_Size)
+		{
+			return false;
+		}
+
+		DWORD length = (this->m_Data[this->m_Offset] << 8) | this->m_Data[this->m_Offset + 1];
+
+		if (length < 2 || (this->m_Offset + length) > this->m_Size)
+		{
+			return false;
+		}
+
+		bool result = 1;
+
+		switch (marker)
+		{
+			case 0xC4:
+				result = this->ReadHuffmanTable(length);
+				break;
+			case 0xDB:
+				result = this->ReadQuantTable(length);
+				break;
+			case 0xDD:
+				this->m_RestartInterval = (length >= 4) ? ((this->m_Data[this->m_Offset + 2] << 8) | this->m_Data[this->m_Offset + 3]) : 0;
+				break;
+			case 0xDA:
+				// The scan reads its own header and leaves the offset behind the entropy coded data
+				if (this->ReadScan(length) == 0)
+				{
+					return false;
+				}
+				continue;
+		}
+
+		this->m_Offset += length;
+
+		if (result == 0)
+		{
+			return false;
+		}
+	}
+
+	if (this->m_ScanCount == 0)
+	{
+		return false;
+	}
+
+	for (int n = 0; n < this->m_ComponentCount; n++)
+	{
+		JPEG_COMPONENT* lpComponent = &this->m_Component[n];
+
+		int stride = lpComponent->BlockWidth * 8;
+
+		for (int by = 0; by < lpComponent->BlockHeight; by++)
+		{
+			for (int bx = 0; bx < lpComponent->BlockWidth; bx++)
+			{
+				short* coef = &lpComponent->Coef[((by * lpComponent->BlockWidth) + bx) * 64];
+
+				if (this->m_Reference == 0)
+				{
+					this->InverseTransformSimd(coef, this->m_Quant[lpComponent->Quant], &lpComponent->Plane[(by * 8 * stride) + (bx * 8)], stride);
+				}
+				else
+				{
+					this->InverseTransform(coef, this->m_Quant[lpComponent->Quant], &lpComponent->Plane[(by * 8 * stride) + (bx * 8)], stride);
+				}
+			}
+		}
+	}
+
+	this->ConvertColor(output);
+
+	return true;
+}
+
+bool CJpegDecoder::IsProgressive()
+{
+	return this->m_Progressive;
+}
+
+void CJpegDecoder::SetReference(bool reference)
+{
+	this->m_Reference = reference;
+}
+
+bool CJpegDecoder::ReadMarker(BYTE* marker)
+{
+	// Skips whatever is left of the previous segment or scan up to the next real marker
+	while ((this->m_Offset + 1) < this->m_Size)
+	{
+		if (this->m_Data[this->m_Offset] == 0xFF)
+		{
+			BYTE value = this->m_Data[this->m_Offset + 1];
+
+			if (value != 0x00 && value != 0xFF && (value < 0xD0 || value > 0xD7))
+			{
+				*marker = value;
+
+				this->m_Offset += 2;
+
+				return true;
+			}
+		}
+
+		this->m_Offset++;
+	}
+
+	return false;
+}
+
+bool CJpegDecoder::ReadFrame(DWORD length, bool progressive)
+{
+	BYTE* data = &this->m_Data[this->m_Offset + 2];
+
+	if (length < 8 || data[0] != 8)
+	{
+		return false;
+	}
+
+	this->m_Height = (data[1] << 8) | data[2];
+
+	this->m_Width = (data[3] << 8) | data[4];
+
+	this->m_ComponentCount = data[5];
+
+	this->m_Progressive = progressive;
+
+	if (this->m_Width == 0 || this->m_Height == 0 || this->m_Width > JPEG_MAX_SIZE || this->m_Height > JPEG_MAX_SIZE || (this->m_ComponentCount != 1 && this->m_ComponentCount != 3) || length < (DWORD)(8 + (this->m_ComponentCount * 3)))
+	{
+		this->m_ComponentCount = 0;
+		return false;
+	}
+
+	this->m_MaxH = 1;
+
+	this->m_MaxV = 1;
+
+	for (int n = 0; n < this->m_ComponentCount; n++)
+	{
+		JPEG_COMPONENT* lpComponent = &this->m_Component[n];
+
+		lpComponent->Id = data[6 + (n * 3)];
+
+		lpComponent->H = data[7 + (n * 3)] >> 4;
+
+		lpComponent->V = data[7 + (n * 3)] & 15;
+
+		lpComponent->Quant = data[8 + (n * 3)];
+
+		if (lpComponent->H < 1 || lpComponent->H > 4 || lpComponent->V < 1 || lpComponent->V > 4 || lpComponent->Quant >= JPEG_MAX_TABLE)
+		{
+			this->m_ComponentCount = 0;
+			return false;
+		}
+
+		this->m_MaxH = ((lpComponent->H > this->m_MaxH) ? lpComponent->H : this->m_MaxH);
+
+		this->m_MaxV = ((lpComponent->V > this->m_MaxV) ? lpComponent->V : this->m_MaxV);
+	}
+
+	this->m_McuWidth = (this->m_Width + ((this->m_MaxH * 8) - 1)) / (this->m_MaxH * 8);
+
+	this->m_McuHeight = (this->m_Height + ((this->m_MaxV * 8) - 1)) / (this->m_MaxV * 8);
+
+	for (int n = 0; n < this->m_ComponentCount; n++)
+	{
+		JPEG_COMPONENT* lpComponent = &this->m_Component[n];
+
+		lpComponent->BlockWidth = this->m_McuWidth * lpComponent->H;
+
+		lpComponent->BlockHeight = this->m_McuHeight * lpComponent->V;
+
+		lpComponent->RealBlockWidth = ((((this->m_Width * lpComponent->H) + (this->m_MaxH - 1)) / this->m_MaxH) + 7) / 8;
+
+		lpComponent->RealBlockHeight = ((((this->m_Height * lpComponent->V) + (this->m_MaxV - 1)) / this->m_MaxV) + 7) / 8;
+
+		lpComponent->Coef.assign((lpComponent->BlockWidth * lpComponent->BlockHeight * 64), 0);
+
+		lpComponent->Plane.resize(lpComponent->BlockWidth * lpComponent->BlockHeight * 64);
+	}
+
+	return true;
+}
+
+bool CJpegDecoder::ReadHuffmanTable(DWORD length)
+{
+	DWORD offset = this->m_Offset + 2;
+
+	DWORD end = this->m_Offset + length;
+
+	while (offset < end)
+	{
+		if ((offset + 17) > end)
+		{
+			return false;
+		}
+
+		BYTE info = this->m_Data[offset];
+
+		BYTE* count = &this->m_Data[offset + 1];
+
+		DWORD total = 0;
+
+		for (int n = 0; n < 16; n++)
+		{
+			total += count[n];
+		}
+
+		if ((info & 15) >= JPEG_MAX_TABLE || (info >> 4) > 1 || total > 256 || (offset + 17 + total) > end)
+		{
+			return false;
+		}
+
+		JPEG_HUFFMAN* lpTable = (((info >> 4) == 0) ? &this->m_DcTable[info & 15] : &this->m_AcTable[info & 15]);
+
+		if (this->BuildHuffman(lpTable, count, &this->m_Data[offset + 17]) == 0)
+		{
+			return false;
+		}
+
+		offset += 17 + total;
+	}
+
+	return true;
+}
+
+bool CJpegDecoder::ReadQuantTable(DWORD length)
+{
+	DWORD offset = this->m_Offset + 2;
+
+	DWORD end = this->m_Offset + length;
+
+	while (offset < end)
+	{
+		BYTE info = this->m_Data[offset++];
+
+		int precision = info >> 4;
+
+		if ((info & 15) >= JPEG_MAX_TABLE || precision > 1 || (offset + (precision + 1) * 64) > end)
+		{
+			return false;
+		}
+
+		for (int n = 0; n < 64; n++)
+		{
+			this->m_Quant[info & 15][JpegNaturalOrder[n]] = ((precision == 0) ? this->m_Data[offset + n] : ((this->m_Data[offset + (n * 2)] << 8) | this->m_Data[offset + (n * 2) + 1]));
+		}
+
+		offset += (precision + 1) * 64;
+	}
+
+	return true;
+}
+
+bool CJpegDecoder::BuildHuffman(JPEG_HUFFMAN* lpTable, BYTE* count, BYTE* value)
+{
+	memset(lpTable->Fast, 0, sizeof(lpTable->Fast));
+
+	memset(lpTable->FastAc, 0, sizeof(lpTable->FastAc));
+
+	int code = 0;
+
+	int k = 0;
+
+	for (int len = 1; len <= 16; len++)
+	{
+		lpTable->ValueOffset[len] = k - code;
+
+		for (int n = 0; n < count[len - 1]; n++)
+		{
+			if (len <= JPEG_FAST_BITS)
+			{
+				int shift = JPEG_FAST_BITS - len;
+
+				for (int i = 0; i < (1 << shift); i++)
+				{
+					lpTable->Fast[(code << shift) + i] = (WORD)((len << 8) | value[k]);
+				}
+			}
+
+			lpTable->Value[k] = value[k];
+
+			k++;
+
+			code++;
+		}
+
+		if (code > (1 << len))
+		{
+			return false;
+		}
+
+		lpTable->MaxCode[len] = code;
+
+		code <<= 1;
+	}
+
+	lpTable->MaxCode[17] = 0x7FFFFFFF;
+
+	// AC symbols whose code and magnitude bits both fit the lookahead decode as value, run and length in one probe
+	for (int n = 0; n < (1 << JPEG_FAST_BITS); n++)
+	{
+		int fast = lpTable->Fast[n];
+
+		if (fast == 0)
+		{
+			continue;
+		}
+
+		int len = fast >> 8;
+
+		int run = (fast >> 4) & 15;
+
+		int s = fast & 15;
+
+		if (s == 0 || (len + s) > JPEG_FAST_BITS)
+		{
+			continue;
+		}
+
+		int value = ((n << len) & ((1 << JPEG_FAST_BITS) - 1)) >> (JPEG_FAST_BITS - s);
+
+		value = ((value < (1 << (s - 1))) ? (value - (1 << s) + 1) : value);
+
+		if (value >= -128 && value <= 127)
+		{
+			lpTable->FastAc[n] = (short)((value * 256) + (run * 16) + (len + s));
+		}
+	}
+
+	lpTable->Used = 1;
+
+	return true;
+}
+
+void CJpegDecoder::ResetBits()
+{
+	this->m_BitBuffer = 0;
+
+	this->m_BitCount = 0;
+
+	this->m_Marker = 0;
+}
+
+void CJpegDecoder::FillBits()
+{
+	// Bits are kept left aligned, once a marker shows up the stream is padded with zero bits
+	while (this->m_BitCount <= 56)
+	{
+		DWORD value = 0;
+
+		if (this->m_Marker == 0 && this->m_Offset < this->m_Size)
+		{
+			value = this->m_Data[this->m_Offset];
+
+			if (value != 0xFF)
+			{
+				this->m_Offset++;
+			}
+			else if ((this->m_Offset + 1) < this->m_Size && this->m_Data[this->m_Offset + 1] == 0x00)
+			{
+				this->m_Offset += 2;
+			}
+			else
+			{
+				value = 0;
+
+				this->m_Marker = 1;
+			}
+		}
+
+		this->m_BitBuffer |= (QWORD)value << (56 - this->m_BitCount);
+
+		this->m_BitCount += 8;
+	}
+}
+
+int CJpegDecoder::GetBits(int count)
+{
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	if (this->m_BitCount < count)
+	{
+		this->FillBits();
+	}
+
+	int value = (int)(this->m_BitBuffer >> (64 - count));
+
+	this->m_BitBuffer <<= count;
+
+	this->m_BitCount -= count;
+
+	return value;
+}
+
+int CJpegDecoder::GetBit()
+{
+	return this->GetBits(1);
+}
+
+int CJpegDecoder::ReceiveExtend(int count)
+{
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	int value = this->GetBits(count);
+
+	return ((value < (1 << (count - 1))) ? (value - (1 << count) + 1) : value);
+}
+
+int CJpegDecoder::DecodeHuffman(JPEG_HUFFMAN* lpTable)
+{
+	if (this->m_BitCount < 16)
+	{
+		this->FillBits();
+	}
+
+	int fast = lpTable->Fast[this->m_BitBuffer >> (64 - JPEG_FAST_BITS)];
+
+	if (fast != 0)
+	{
+		this->m_BitBuffer <<= (fast >> 8);
+
+		this->m_BitCount -= (fast >> 8);
+
+		return (fast & 0xFF);
+	}
+
+	for (int len = JPEG_FAST_BITS + 1; len <= 16; len++)
+	{
+		int code = (int)(this->m_BitBuffer >> (64 - len));
+
+		if (code < lpTable->MaxCode[len])
+		{
+			this->m_BitBuffer <<= len;
+
+			this->m_BitCount -= len;
+
+			return lpTable->Value[code + lpTable->ValueOffset[len]];
+		}
+	}
+
+	// Corrupt code, drop the rest of the interval the same way libjpeg does
+	this->m_BitBuffer = 0;
+
+	return 0;
+}
+
+bool CJpegDecoder::ProcessRestart()
+{
+	this->ResetBits();
+
+	while ((this->m_Offset + 1) < this->m_Size)
+	{
+		if (this->m_Data[this->m_Offset] == 0xFF && this->m_Data[this->m_Offset + 1] >= 0xD0 && this->m_Data[this->m_Offset + 1] <= 0xD7)
+		{
+			this->m_Offset += 2;
+			break;
+		}
+
+		if (this->m_Data[this->m_Offset] == 0xFF && this->m_Data[this->m_Offset + 1] != 0x00)
+		{
+			// Another marker instead of the expected restart, leave it for the marker loop
+			break;
+		}
+
+		this->m_Offset++;
+	}
+
+	for (int n = 0; n < this->m_ComponentCount; n++)
+	{
+		this->m_Component[n].DcPred = 0;
+	}
+
+	this->m_EobRun = 0;
+
+	return true;
+}
+
+bool CJpegDecoder::ReadScan(DWORD length)
+{
+	BYTE* data = &this->m_Data[this->m_Offset + 2];
+
+	int count = data[0];
+
+	if (count < 1 || count > this->m_ComponentCount || length != (DWORD)(6 + (count * 2)))
+	{
+		return false;
+	}
+
+	for (int n = 0; n < count; n++)
+	{
+		int id = data[1 + (n * 2)];
+
+		int table = data[2 + (n * 2)];
+
+		int index = -1;
+
+		for (int i = 0; i < this->m_ComponentCount; i++)
+		{
+			index = ((this->m_Component[i].Id == id) ? i : index);
+		}
+
+		if (index < 0 || (table >> 4) >= JPEG_MAX_TABLE || (table & 15) >= JPEG_MAX_TABLE)
+		{
+			return false;
+		}
+
+		this->m_ScanComponent[n] = index;
+
+		this->m_Component[index].DcTable = table >> 4;
+
+		this->m_Component[index].AcTable = table & 15;
+
+		this->m_Component[index].DcPred = 0;
+	}
+
+	this->m_SpectralStart = data[1 + (count * 2)];
+
+	this->m_SpectralEnd = data[2 + (count * 2)];
+
+	this->m_ApproxHigh = data[3 + (count * 2)] >> 4;
+
+	this->m_ApproxLow = data[3 + (count * 2)] & 15;
+
+	if (this->m_Progressive == 0)
+	{
+		this->m_SpectralStart = 0;
+
+		this->m_SpectralEnd = 63;
+
+		this->m_ApproxHigh = 0;
+
+		this->m_ApproxLow = 0;
+	}
+	else if (this->m_SpectralStart > this->m_SpectralEnd || this->m_SpectralEnd > 63 || (this->m_SpectralStart == 0 && this->m_SpectralEnd != 0) || (this->m_SpectralStart != 0 && count != 1) || this->m_ApproxLow > 13)
+	{
+		return false;
+	}
+
+	for (int n = 0; n < count; n++)
+	{
+		JPEG_COMPONENT* lpComponent = &this->m_Component[this->m_ScanComponent[n]];
+
+		bool dc = (this->m_SpectralStart == 0 && this->m_ApproxHigh == 0);
+
+		bool ac = (this->m_SpectralEnd != 0);
+
+		if ((dc != 0 && this->m_DcTable[lpComponent->DcTable].Used == 0) || (ac != 0 && this->m_AcTable[lpComponent->AcTable].Used == 0))
+		{
+			return false;
+		}
+	}
+
+	this->m_Offset += length;
+
+	this->m_ScanCount++;
+
+	this->m_EobRun = 0;
+
+	this->ResetBits();
+
+	int todo = this->m_RestartInterval;
+
+	if (count == 1)
+	{
+		// Non interleaved scans only cover the blocks that hold real pixels
+		JPEG_COMPONENT* lpComponent = &this->m_Component[this->m_ScanComponent[0]];
+
+		int total = lpComponent->RealBlockWidth * lpComponent->RealBlockHeight;
+
+		for (int by = 0; by < lpComponent->RealBlockHeight; by++)
+		{
+			for (int bx = 0; bx < lpComponent->RealBlockWidth; bx++)
+			{
+				this->DecodeScanBlock(lpComponent, &lpComponent->Coef[((by * lpComponent->BlockWidth) + bx) * 64]);
+
+				if (this->m_RestartInterval != 0 && --todo == 0 && ((by * lpComponent->RealBlockWidth) + bx + 1) < total)
+				{
+					this->ProcessRestart();
+
+					todo = this->m_RestartInterval;
+				}
+			}
+		}
+	}
+	else
+	{
+		int total = this->m_McuWidth * this->m_McuHeight;
+
+		for (int my = 0; my < this->m_McuHeight; my++)
+		{
+			for (int mx = 0; mx < this->m_McuWidth; mx++)
+			{
+				for (int n = 0; n < count; n++)
+				{
+					JPEG_COMPONENT* lpComponent = &this->m_Component[this->m_ScanComponent[n]];
+
+					for (int v = 0; v < lpComponent->V; v++)
+					{
+						for (int h = 0; h < lpComponent->H; h++)
+						{
+							int block = ((((my * lpComponent->V) + v) * lpComponent->BlockWidth) + (mx * lpComponent->H) + h);
+
+							this->DecodeScanBlock(lpComponent, &lpComponent->Coef[block * 64]);
+						}
+					}
+				}
+
+				if (this->m_RestartInterval != 0 && --todo == 0 && ((my * this->m_McuWidth) + mx + 1) < total)
+				{
+					this->ProcessRestart();
+
+					todo = this->m_RestartInterval;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+void CJpegDecoder::DecodeScanBlock(JPEG_COMPONENT* lpComponent, short* coef)
+{
+	if (this->m_Progressive == 0)
+	{
+		if (this->m_Reference == 0)
+		{
+			this->DecodeBlockFast(lpComponent, coef);
+		}
+		else
+		{
+			this->DecodeBlock(lpComponent, coef);
+		}
+	}
+	else if (this->m_SpectralStart == 0)
+	{
+		if (this->m_ApproxHigh == 0)
+		{
+			this->DecodeBlockDcFirst(lpComponent, coef);
+		}
+		else
+		{
+			this->DecodeBlockDcRefine(coef);
+		}
+	}
+	else
+	{
+		if (this->m_ApproxHigh == 0)
+		{
+			this->DecodeBlockAcFirst(lpComponent, coef);
+		}
+		else
+		{
+			this->DecodeBlockAcRefine(lpComponent, coef);
+		}
+	}
+}
+
+void CJpegDecoder::DecodeBlock(JPEG_COMPONENT* lpComponent, short* coef)
+{
+	int s = this->DecodeHuffman(&this->m_DcTable[lpComponent->DcTable]);
+
+	lpComponent->DcPred += this->ReceiveExtend(s);
+
+	coef[0] = (short)lpComponent->DcPred;
+
+	JPEG_HUFFMAN* lpTable = &this->m_AcTable[lpComponent->AcTable];
+
+	for (int k = 1; k < 64; k++)
+	{
+		int rs = this->DecodeHuffman(lpTable);
+
+		int r = rs >> 4;
+
+		s = rs & 15;
+
+		if (s != 0)
+		{
+			k += r;
+
+			coef[JpegNaturalOrder[k]] = (short)this->ReceiveExtend(s);
+		}
+		else if (r == 15)
+		{
+			k += 15;
+		}
+		else
+		{
+			break;
+		}
+	}
+}
+
+void CJpegDecoder::DecodeBlockFast(JPEG_COMPONENT* lpComponent, short* coef)
+{
+	int s = this->DecodeHuffman(&this->m_DcTable[lpComponent->DcTable]);
+
+	lpComponent->DcPred += this->ReceiveExtend(s);
+
+	coef[0] = (short)lpComponent->DcPred;
+
+	JPEG_HUFFMAN* lpTable = &this->m_AcTable[lpComponent->AcTable];
+
+	for (int k = 1; k < 64; k++)
+	{
+		if (this->m_BitCount < 16)
+		{
+			this->FillBits();
+		}
+
+		int fast = lpTable->FastAc[this->m_BitBuffer >> (64 - JPEG_FAST_BITS)];
+
+		if (fast != 0)
+		{
+			k += (fast >> 4) & 15;
+
+			this->m_BitBuffer <<= (fast & 15);
+
+			this->m_BitCount -= (fast & 15);
+
+			coef[JpegNaturalOrder[k]] = (short)(fast >> 8);
+
+			continue;
+		}
+
+		int rs = this->DecodeHuffman(lpTable);
+
+		int r = rs >> 4;
+
+		s = rs & 15;
+
+		if (s != 0)
+		{
+			k += r;
+
+			coef[JpegNaturalOrder[k]] = (short)this->ReceiveExtend(s);
+		}
+		else if (r == 15)
+		{
+			k += 15;
+		}
+		else
+		{
+			break;
+		}
+	}
+}
+
+void CJpegDecoder::DecodeBlockDcFirst(JPEG_COMPONENT* lpComponent, short* coef)
+{
+	int s = this->DecodeHuffman(&this->m_DcTable[lpComponent->DcTable]);
+
+	lpComponent->DcPred += this->ReceiveExtend(s);
+
+	coef[0] = (short)(lpComponent->DcPred * (1 << this->m_ApproxLow));
+}
+
+void CJpegDecoder::DecodeBlockDcRefine(short* coef)
+{
+	if (this->GetBit() != 0)
+	{
+		coef[0] |= (short)(1 << this->m_ApproxLow);
+	}
+}
+
+void CJpegDecoder::DecodeBlockAcFirst(JPEG_COMPONENT* lpComponent, short* coef)
+{
+	if (this->m_EobRun > 0)
+	{
+		this->m_EobRun--;
+		return;
+	}
+
+	JPEG_HUFFMAN* lpTable = &this->m_AcTable[lpComponent->AcTable];
+
+	for (int k = this->m_SpectralStart; k <= this->m_SpectralEnd; k++)
+	{
+		int rs = this->DecodeHuffman(lpTable);
+
+		int r = rs >> 4;
+
+		int s = rs & 15;
+
+		if (s != 0)
+		{
+			k += r;
+
+			coef[JpegNaturalOrder[k]] = (short)(this->ReceiveExtend(s) * (1 << this->m_ApproxLow));
+		}
+		else if (r == 15)
+		{
+			k += 15;
+		}
+		else
+		{
+			this->m_EobRun = (1 << r) - 1;
+
+			if (r != 0)
+			{
+				this->m_EobRun += this->GetBits(r);
+			}
+
+			break;
+		}
+	}
+}
+
+void CJpegDecoder::DecodeBlockAcRefine(JPEG_COMPONENT* lpComponent, short* coef)
+{
+	int p1 = 1 << this->m_ApproxLow;
+
+	int m1 = -1 * p1;
+
+	int k = this->m_SpectralStart;
+
+	if (this->m_EobRun == 0)
+	{
+		JPEG_HUFFMAN* lpTable = &this->m_AcTable[lpComponent->AcTable];
+
+		for (; k <= this->m_SpectralEnd; k++)
+		{
+			int rs = this->DecodeHuffman(lpTable);
+
+			int r = rs >> 4;
+
+			int s = rs & 15;
+
+			if (s != 0)
+			{
+				s = ((this->GetBit() != 0) ? p1 : m1);
+			}
+			else if (r != 15)
+			{
+				this->m_EobRun = 1 << r;
+
+				if (r != 0)
+				{
+					this->m_EobRun += this->GetBits(r);
+				}
+
+				break;
+			}
+
+			// Correction bits for coefficients that are already non zero, then skip r zero coefficients
+			do
+			{
+				short* lpCoef = &coef[JpegNaturalOrder[k]];
+
+				if (*lpCoef != 0)
+				{
+					if (this->GetBit() != 0 && ((*lpCoef) & p1) == 0)
+					{
+						*lpCoef += (short)(((*lpCoef) >= 0) ? p1 : m1);
+					}
+				}
+				else
+				{
+					if (--r < 0)
+					{
+						break;
+					}
+				}
+
+				k++;
+			}
+			while (k <= this->m_SpectralEnd);
+
+			if (s != 0 && k <= 63)
+			{
+				coef[JpegNaturalOrder[k]] = (short)s;
+			}
+		}
+	}
+
+	if (this->m_EobRun > 0)
+	{
+		for (; k <= this->m_SpectralEnd; k++)
+		{
+			short* lpCoef = &coef[JpegNaturalOrder[k]];
+
+			if (*lpCoef != 0 && this->GetBit() != 0 && ((*lpCoef) & p1) == 0)
+			{
+				*lpCoef += (short)(((*lpCoef) >= 0) ? p1 : m1);
+			}
+		}
+
+		this->m_EobRun--;
+	}
+}
+
+void CJpegDecoder::InverseTransform(short* coef, WORD* quant, BYTE* output, int stride)
+{
+	// Integer islow transform, the same arithmetic as the libjpeg build inside main.exe
+	int workspace[64];
+
+	for (int n = 0; n < 8; n++)
+	{
+		short* in = &coef[n];
+
+		WORD* q = &quant[n];
+
+		int* ws = &workspace[n];
+
+		if (in[8] == 0 && in[16] == 0 && in[24] == 0 && in[32] == 0 && in[40] == 0 && in[48] == 0 && in[56] == 0)
+		{
+			int dc = (in[0] * q[0]) << JPEG_PASS1_BITS;
+
+			for (int i = 0; i < 8; i++)
+			{
+				ws[i * 8] = dc;
+			}
+
+			continue;
+		}
+
+		int z2 = in[16] * q[16];
+		int z3 = in[48] * q[48];
+
+		int z1 = (z2 + z3) * JPEG_FIX_0_541196100;
+		int tmp2 = z1 + (z3 * -JPEG_FIX_1_847759065);
+		int tmp3 = z1 + (z2 * JPEG_FIX_0_765366865);
+
+		z2 = in[0] * q[0];
+		z3 = in[32] * q[32];
+
+		int tmp0 = (z2 + z3) << JPEG_CONST_BITS;
+		int tmp1 = (z2 - z3) << JPEG_CONST_BITS;
+
+		int tmp10 = tmp0 + tmp3;
+		int tmp13 = tmp0 - tmp3;
+		int tmp11 = tmp1 + tmp2;
+		int tmp12 = tmp1 - tmp2;
+
+		tmp0 = in[56] * q[56];
+		tmp1 = in[40] * q[40];
+		tmp2 = in[24] * q[24];
+		tmp3 = in[8] * q[8];
+
+		z1 = tmp0 + tmp3;
+		z2 = tmp1 + tmp2;
+		z3 = tmp0 + tmp2;
+		int z4 = tmp1 + tmp3;
+		int z5 = (z3 + z4) * JPEG_FIX_1_175875602;
+
+		tmp0 = tmp0 * JPEG_FIX_0_298631336;
+		tmp1 = tmp1 * JPEG_FIX_2_053119869;
+		tmp2 = tmp2 * JPEG_FIX_3_072711026;
+		tmp3 = tmp3 * JPEG_FIX_1_501321110;
+		z1 = z1 * -JPEG_FIX_0_899976223;
+		z2 = z2 * -JPEG_FIX_2_562915447;
+		z3 = (z3 * -JPEG_FIX_1_961570560) + z5;
+		z4 = (z4 * -JPEG_FIX_0_390180644) + z5;
+
+		tmp0 += z1 + z3;
+		tmp1 += z2 + z4;
+		tmp2 += z2 + z3;
+		tmp3 += z1 + z4;
+
+		ws[0] = JPEG_DESCALE(tmp10 + tmp3, JPEG_CONST_BITS - JPEG_PASS1_BITS);
+		ws[56] = JPEG_DESCALE(tmp10 - tmp3, JPEG_CONST_BITS - JPEG_PASS1_BITS);
+		ws[8] = JPEG_DESCALE(tmp11 + tmp2, JPEG_CONST_BITS - JPEG_PASS1_BITS);
+		ws[48] = JPEG_DESCALE(tmp11 - tmp2, JPEG_CONST_BITS - JPEG_PASS1_BITS);
+		ws[16] = JPEG_DESCALE(tmp12 + tmp1, JPEG_CONST_BITS - JPEG_PASS1_BITS);
+		ws[40] = JPEG_DESCALE(tmp12 - tmp1, JPEG_CONST_BITS - JPEG_PASS1_BITS);
+		ws[24] = JPEG_DESCALE(tmp13 + tmp0, JPEG_CONST_BITS - JPEG_PASS1_BITS);
+		ws[32] = JPEG_DESCALE(tmp13 - tmp0, JPEG_CONST_BITS - JPEG_PASS1_BITS);
+	}
+
+	for (int n = 0; n < 8; n++)
+	{
+		int* ws = &workspace[n * 8];
+
+		BYTE* out = &output[n * stride];
+
+		int z2 = ws[2];
+		int z3 = ws[6];
+
+		int z1 = (z2 + z3) * JPEG_FIX_0_541196100;
+		int tmp2 = z1 + (z3 * -JPEG_FIX_1_847759065);
+		int tmp3 = z1 + (z2 * JPEG_FIX_0_765366865);
+
+		int tmp0 = (ws[0] + ws[4]) << JPEG_CONST_BITS;
+		int tmp1 = (ws[0] - ws[4]) << JPEG_CONST_BITS;
+
+		int tmp10 = tmp0 + tmp3;
+		int tmp13 = tmp0 - tmp3;
+		int tmp11 = tmp1 + tmp2;
+		int tmp12 = tmp1 - tmp2;
+
+		tmp0 = ws[7];
+		tmp1 = ws[5];
+		tmp2 = ws[3];
+		tmp3 = ws[1];
+
+		z1 = tmp0 + tmp3;
+		z2 = tmp1 + tmp2;
+		z3 = tmp0 + tmp2;
+		int z4 = tmp1 + tmp3;
+		int z5 = (z3 + z4) * JPEG_FIX_1_175875602;
+
+		tmp0 = tmp0 * JPEG_FIX_0_298631336;
+		tmp1 = tmp1 * JPEG_FIX_2_053119869;
+		tmp2 = tmp2 * JPEG_FIX_3_072711026;
+		tmp3 = tmp3 * JPEG_FIX_1_501321110;
+		z1 = z1 * -JPEG_FIX_0_899976223;
+		z2 = z2 * -JPEG_FIX_2_562915447;
+		z3 = (z3 * -JPEG_FIX_1_961570560) + z5;
+		z4 = (z4 * -JPEG_FIX_0_390180644) + z5;
+
+		tmp0 += z1 + z3;
+		tmp1 += z2 + z4;
+		tmp2 += z2 + z3;
+		tmp3 += z1 + z4;
+
+		int shift = JPEG_CONST_BITS + JPEG_PASS1_BITS + 3;
+
+		out[0] = JpegClamp(JPEG_DESCALE(tmp10 + tmp3, shift) + 128);
+		out[7] = JpegClamp(JPEG_DESCALE(tmp10 - tmp3, shift) + 128);
+		out[1] = JpegClamp(JPEG_DESCALE(tmp11 + tmp2, shift) + 128);
+		out[6] = JpegClamp(JPEG_DESCALE(tmp11 - tmp2, shift) + 128);
+		out[2] = JpegClamp(JPEG_DESCALE(tmp12 + tmp1, shift) + 128);
+		out[5] = JpegClamp(JPEG_DESCALE(tmp12 - tmp1, shift) + 128);
+		out[3] = JpegClamp(JPEG_DESCALE(tmp13 + tmp0, shift) + 128);
+		out[4] = JpegClamp(JPEG_DESCALE(tmp13 - tmp0, shift) + 128);
+	}
+}
+
+void CJpegDecoder::InverseTransformSimd(short* coef, WORD* quant, BYTE* output, int stride)
+{
+	// Same islow arithmetic on eight columns at once, bit exact with InverseTransform for in range coefficients
+	__m128i row[8];
+
+	for (int n = 0; n < 8; n++)
+	{
+		row[n] = _mm_mullo_epi16(_mm_loadu_si128((__m128i*)&coef[n * 8]), _mm_loadu_si128((__m128i*)&quant[n * 8]));
+	}
+
+	JpegTransformPass(row, (JPEG_CONST_BITS - JPEG_PASS1_BITS), (1 << (JPEG_CONST_BITS - JPEG_PASS1_BITS - 1)));
+
+	JpegTranspose(row);
+
+	// The level shift of 128 is folded into the rounding bias of the second pass
+	JpegTransformPass(row, (JPEG_CONST_BITS + JPEG_PASS1_BITS + 3), ((1 << (JPEG_CONST_BITS + JPEG_PASS1_BITS + 2)) + (128 << (JPEG_CONST_BITS + JPEG_PASS1_BITS + 3))));
+
+	JpegTranspose(row);
+
+	for (int n = 0; n < 8; n += 2)
+	{
+		__m128i pixel = _mm_packus_epi16(row[n], row[n + 1]);
+
+		_mm_storel_epi64((__m128i*)&output[n * stride], pixel);
+
+		_mm_storel_epi64((__m128i*)&output[(n + 1) * stride], _mm_srli_si128(pixel, 8));
+	}
+}
+
+void CJpegDecoder::ConvertColor(BYTE* output)
+{
+	// Chroma is replicated (no fancy upsampling), YCbCr to RGB uses the libjpeg fixed point factors
+	for (int y = 0; y < this->m_Height; y++)
+	{
+		BYTE* row[JPEG_MAX_COMPONENT];
+
+		for (int n = 0; n < this->m_ComponentCount; n++)
+		{
+			JPEG_COMPONENT* lpComponent = &this->m_Component[n];
+
+			row[n] = &lpComponent->Plane[((y * lpComponent->V) / this->m_MaxV) * lpComponent->BlockWidth * 8];
+		}
+
+		BYTE* out = &output[y * this->m_Width * 4];
+
+		int start = ((this->m_Reference == 0) ? this->ConvertRowSimd(row, out) : 0);
+
+		out += start * 4;
+
+		if (this->m_ComponentCount == 1)
+		{
+			for (int x = start; x < this->m_Width; x++)
+			{
+				out[0] = row[0][x];
+				out[1] = row[0][x];
+				out[2] = row[0][x];
+				out[3] = 0xFF;
+				out += 4;
+			}
+
+			continue;
+		}
+
+		for (int x = start; x < this->m_Width; x++)
+		{
+			int Y = row[0][(x * this->m_Component[0].H) / this->m_MaxH];
+
+			int Cb = row[1][(x * this->m_Component[1].H) / this->m_MaxH] - 128;
+
+			int Cr = row[2][(x * this->m_Component[2].H) / this->m_MaxH] - 128;
+
+			out[0] = JpegClamp(Y + ((91881 * Cr + 32768) >> 16));
+			out[1] = JpegClamp(Y + ((-22554 * Cb - 46802 * Cr + 32768) >> 16));
+			out[2] = JpegClamp(Y + ((116130 * Cb + 32768) >> 16));
+			out[3] = 0xFF;
+			out += 4;
+		}
+	}
+}
+
+int CJpegDecoder::ConvertRowSimd(BYTE** row, BYTE* output)
+{
+	// Converts whole groups of eight pixels, full and half width chroma are upsampled while loading
+	int count = this->m_Width & ~7;
+
+	__m128i zero = _mm_setzero_si128();
+
+	__m128i alpha = _mm_set1_epi8((char)0xFF);
+
+	if (this->m_ComponentCount == 1)
+	{
+		for (int x = 0; x < count; x += 8)
+		{
+			__m128i Y = _mm_loadl_epi64((__m128i*)&row[0][x]);
+
+			__m128i yy = _mm_unpacklo_epi8(Y, Y);
+
+			__m128i ya = _mm_unpacklo_epi8(Y, alpha);
+
+			_mm_storeu_si128((__m128i*)&output[x * 4], _mm_unpacklo_epi16(yy, ya));
+
+			_mm_storeu_si128((__m128i*)&output[(x * 4) + 16], _mm_unpackhi_epi16(yy, ya));
+		}
+
+		return count;
+	}
+
+	if (this->m_Component[0].H != this->m_MaxH || this->m_Component[1].H != this->m_Component[2].H)
+	{
+		return 0;
+	}
+
+	bool half = ((this->m_Component[1].H * 2) == this->m_MaxH);
+
+	if (half == 0 && this->m_Component[1].H != this->m_MaxH)
+	{
+		return 0;
+	}
+
+	__m128i center = _mm_set1_epi16(128);
+
+	// 1.402, -0.34414/-0.71414 and 1.772 split into a whole part and a 16 bit fraction that fits a signed word
+	__m128i FactorR = JPEG_PAIR(0, 91881 - 65536);
+
+	__m128i FactorG = JPEG_PAIR(-22554, 65536 - 46802);
+
+	__m128i FactorB = JPEG_PAIR(116130 - 131072, 0);
+
+	for (int x = 0; x < count; x += 8)
+	{
+		__m128i Y = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)&row[0][x]), zero);
+
+		__m128i Cb;
+
+		__m128i Cr;
+
+		if (half != 0)
+		{
+			Cb = _mm_cvtsi32_si128(*(int*)&row[1][x / 2]);
+
+			Cr = _mm_cvtsi32_si128(*(int*)&row[2][x / 2]);
+
+			Cb = _mm_unpacklo_epi8(Cb, Cb);
+
+			Cr = _mm_unpacklo_epi8(Cr, Cr);
+		}
+		else
+		{
+			Cb = _mm_loadl_epi64((__m128i*)&row[1][x]);
+
+			Cr = _mm_loadl_epi64((__m128i*)&row[2][x]);
+		}
+
+		Cb = _mm_sub_epi16(_mm_unpacklo_epi8(Cb, zero), center);
+
+		Cr = _mm_sub_epi16(_mm_unpacklo_epi8(Cr, zero), center);
+
+		__m128i lo = _mm_unpacklo_epi16(Cb, Cr);
+
+		__m128i hi = _mm_unpackhi_epi16(Cb, Cr);
+
+		__m128i R = _mm_add_epi16(_mm_add_epi16(Y, Cr), JpegMultiply(lo, hi, FactorR));
+
+		__m128i G = _mm_add_epi16(_mm_sub_epi16(Y, Cr), JpegMultiply(lo, hi, FactorG));
+
+		__m128i B = _mm_add_epi16(_mm_add_epi16(Y, _mm_add_epi16(Cb, Cb)), JpegMultiply(lo, hi, FactorB));
+
+		R = _mm_packus_epi16(R, R);
+
+		G = _mm_packus_epi16(G, G);
+
+		B = _mm_packus_epi16(B, B);
+
+		__m128i rg = _mm_unpacklo_epi8(R, G);
+
+		__m128i ba = _mm_unpacklo_epi8(B, alpha);
+
+		_mm_storeu_si128((__m128i*)&output[x * 4], _mm_unpacklo_epi16(rg, ba));
+
+		_mm_storeu_si128((__m128i*)&output[(x * 4) + 16], _mm_unpackhi_epi16(rg, ba));
+	}
+
+	return count;
+}
\ No newline at end of file
@@ -0,0 +1,156 @@
+#pragma once
+
+#define JPEG_MAX_COMPONENT 4
+#define JPEG_MAX_TABLE 4
+#define JPEG_FAST_BITS 9
+#define JPEG_MAX_SIZE 4096 // Larger frames only come from a corrupt header, the client has none near it
+
+struct JPEG_HUFFMAN
+{
+	WORD Fast[1 << JPEG_FAST_BITS];
+	short FastAc[1 << JPEG_FAST_BITS];
+	int MaxCode[18];
+	int ValueOffset[17];
+	BYTE Value[256];
+	bool Used;
+};
+
+struct JPEG_COMPONENT
+{
+	int Id;
+	int H;
+	int V;
+	int Quant;
+	int DcTable;
+	int AcTable;
+	int DcPred;
+	int BlockWidth;
+	int BlockHeight;
+	int RealBlockWidth;
+	int RealBlockHeight;
+	std::vector<short> Coef;
+	std::vector<BYTE> Plane;
+};
+
+class CJpegDecoder
+{
+public:
+
+	CJpegDecoder();
+
+	~CJpegDecoder();
+
+	bool ReadHeader(BYTE* data, DWORD size, int* width, int* height);
+
+	bool Decode(BYTE* output);
+
+	bool IsProgressive();
+
+	void SetReference(bool reference);
+
+private:
+
+	bool ReadMarker(BYTE* marker);
+
+	bool ReadFrame(DWORD length, bool progressive);
+
+	bool ReadHuffmanTable(DWORD length);
+
+	bool ReadQuantTable(DWORD length);
+
+	bool ReadScan(DWORD length);
+
+	bool BuildHuffman(JPEG_HUFFMAN* lpTable, BYTE* count, BYTE* value);
+
+	void ResetBits();
+
+	void FillBits();
+
+	int GetBits(int count);
+
+	int GetBit();
+
+	int ReceiveExtend(int count);
+
+	int DecodeHuffman(JPEG_HUFFMAN* lpTable);
+
+	bool ProcessRestart();
+
+	void DecodeBlock(JPEG_COMPONENT* lpComponent, short* coef);
+
+	void DecodeBlockFast(JPEG_COMPONENT* lpComponent, short* coef);
+
+	void DecodeBlockDcFirst(JPEG_COMPONENT* lpComponent, short* coef);
+
+	void DecodeBlockDcRefine(short* coef);
+
+	void DecodeBlockAcFirst(JPEG_COMPONENT* lpComponent, short* coef);
+
+	void DecodeBlockAcRefine(JPEG_COMPONENT* lpComponent, short* coef);
+
+	void DecodeScanBlock(JPEG_COMPONENT* lpComponent, short* coef);
+
+	void InverseTransform(short* coef, WORD* quant, BYTE* output, int stride);
+
+	void InverseTransformSimd(short* coef, WORD* quant, BYTE* output, int stride);
+
+	void ConvertColor(BYTE* output);
+
+	int ConvertRowSimd(BYTE** row, BYTE* output);
+
+private:
+
+	BYTE* m_Data;
+
+	DWORD m_Size;
+
+	DWORD m_Offset;
+
+	int m_Width;
+
+	int m_Height;
+
+	bool m_Progressive;
+
+	int m_ComponentCount;
+
+	int m_MaxH;
+
+	int m_MaxV;
+
+	int m_McuWidth;
+
+	int m_McuHeight;
+
+	int m_RestartInterval;
+
+	JPEG_COMPONENT m_Component[JPEG_MAX_COMPONENT];
+
+	JPEG_HUFFMAN m_DcTable[JPEG_MAX_TABLE];
+
+	JPEG_HUFFMAN m_AcTable[JPEG_MAX_TABLE];
+
+	WORD m_Quant[JPEG_MAX_TABLE][64];
+
+	int m_ScanCount;
+
+	int m_ScanComponent[JPEG_MAX_COMPONENT];
+
+	int m_SpectralStart;
+
+	int m_SpectralEnd;
+
+	int m_ApproxHigh;
+
+	int m_ApproxLow;
+
+	int m_EobRun;
+
+	QWORD m_BitBuffer;
+
+	int m_BitCount;
+
+	bool m_Marker;
+
+	bool m_Reference;
+};
\ No newline at end of file
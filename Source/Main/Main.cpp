@@ -1,5 +1,9 @@
 #include "stdafx.h"
+#include "AssetLoader.h"
 #include "Controller.h"
+#include "DataPack.h"
+#include "FileTrace.h"
+#include "Offset.h"
 #include "Patchs.h"
 #include "Protect.h"
 #include "Resolution.h"
@@ -31,6 +35,26 @@ extern "C" _declspec(dllexport) void _cdecl EntryProc()
 	InitPatchs();
 
 	InitResolution();
+
+	// FileTrace=1 records every file the game reads and in which scene and world, FileTrace.bin is written when the window closes
+	if (GetPrivateProfileInt("Antilag", "FileTrace", 0, ".\\Config.ini") != 0)
+	{
+		gFileTrace.Start(FILE_TRACE_NAME, &SceneFlag);
+	}
+
+	// Without Data.bpk the game keeps reading the loose files
+	if (gDataPack.Open(DATA_PACK_NAME) != 0 || gFileTrace.IsActive() != 0)
+	{
+		gDataPack.Redirect();
+	}
+
+	// AssetLoader=1 starts the loader threads and the per-frame dispatch, nothing in the game requests assets through it yet
+	if (GetPrivateProfileInt("Antilag", "AssetLoader", 0, ".\\Config.ini") != 0)
+	{
+		gAssetLoader.Start(ASSET_LOAD_DEFAULT_THREAD, ASSET_LOAD_DEFAULT_IO);
+
+		InitMainFrame();
+	}
 }
 
 BOOL APIENTRY DllMain(HMODULE hModule,DWORD ul_reason_for_call,LPVOID lpReserved)
@@ -52,6 +76,8 @@ BOOL APIENTRY DllMain(HMODULE hModule,DWORD ul_reason_for_call,LPVOID lpReserved
 
 		case DLL_PROCESS_DETACH:
 		{
+			gFileTrace.Detach();
+
 			break;
 		}
 
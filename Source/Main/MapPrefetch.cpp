@@ -0,0 +1,701 @@
+#include "stdafx.h"
+#include "MapPrefetch.h"
+#include "MappedFile.h"
+#include "FileCrypt.h"
+#include "TextureQuality.h"
+
+CMapPrefetch::CMapPrefetch()
+{
+	memset(this->m_Gate, 0, sizeof(this->m_Gate));
+
+	this->m_GateCount = 0;
+
+	this->m_BucketStart.assign((MAP_PREFETCH_BUCKET_TOTAL + 1), 0);
+
+	memset(this->m_Directory, 0, sizeof(this->m_Directory));
+
+	this->m_Budget = MAP_PREFETCH_DEFAULT_BUDGET;
+
+	this->m_DecodedSize = 0;
+
+	this->m_Stamp = 0;
+
+	for (int n = 0; n < TERRAIN_MAX_WORLD; n++)
+	{
+		this->m_World[n].State = MAP_PREFETCH_NONE;
+
+		this->m_World[n].Stamp = 0;
+
+		this->m_World[n].FileSize = 0;
+
+		this->m_World[n].DecodedSize = 0;
+
+		this->m_World[n].HasTerrain = 0;
+	}
+
+	InitializeCriticalSection(&this->m_Lock);
+
+	this->m_Thread = 0;
+
+	this->m_StopEvent = 0;
+
+	this->m_JobSemaphore = 0;
+}
+
+CMapPrefetch::~CMapPrefetch()
+{
+	this->Stop();
+
+	DeleteCriticalSection(&this->m_Lock);
+}
+
+bool CMapPrefetch::Load(char* path)
+{
+	// Gate.bmd: 9 byte records, the gate number is the record number
+	CMappedFile file;
+
+	if (file.Open(path) == 0)
+	{
+		return false;
+	}
+
+	this->m_GateCount = file.GetSize() / MAP_PREFETCH_GATE_SIZE;
+
+	this->m_GateCount = ((this->m_GateCount > MAP_PREFETCH_MAX_GATE) ? MAP_PREFETCH_MAX_GATE : this->m_GateCount);
+
+	for (int n = 0; n < this->m_GateCount; n++)
+	{
+		memcpy(&this->m_Gate[n], file.GetData() + (n * MAP_PREFETCH_GATE_SIZE), MAP_PREFETCH_GATE_SIZE);
+
+		BuxConvert((BYTE*)&this->m_Gate[n], MAP_PREFETCH_GATE_SIZE);
+	}
+
+	// Only entrances into another map are indexed, each one lands in every bucket its area plus the radius touches
+	std::vector<std::vector<WORD>> bucket(MAP_PREFETCH_BUCKET_TOTAL);
+
+	for (int n = 0; n < this->m_GateCount; n++)
+	{
+		GATE_INFO* lpGate = &this->m_Gate[n];
+
+		int destination = this->GetDestination(n);
+
+		if (destination == -1 || destination == lpGate->Map || lpGate->Map >= TERRAIN_MAX_WORLD)
+		{
+			continue;
+		}
+
+		int x1 = (((lpGate->X1 < lpGate->X2) ? lpGate->X1 : lpGate->X2) - MAP_PREFETCH_RADIUS) / MAP_PREFETCH_BUCKET;
+
+		int y1 = (((lpGate->Y1 < lpGate->Y2) ? lpGate->Y1 : lpGate->Y2) - MAP_PREFETCH_RADIUS) / MAP_PREFETCH_BUCKET;
+
+		int x2 = (((lpGate->X1 > lpGate->X2) ? lpGate->X1 : lpGate->X2) + MAP_PREFETCH_RADIUS) / MAP_PREFETCH_BUCKET;
+
+		int y2 = (((lpGate->Y1 > lpGate->Y2) ? lpGate->Y1 : lpGate->Y2) + MAP_PREFETCH_RADIUS) / MAP_PREFETCH_BUCKET;
+
+		for (int y = ((y1 < 0) ? 0 : y1); y <= y2 && y < MAP_PREFETCH_BUCKET_COUNT; y++)
+		{
+			for (int x = ((x1 < 0) ? 0 : x1); x <= x2 && x < MAP_PREFETCH_BUCKET_COUNT; x++)
+			{
+				bucket[(lpGate->Map * MAP_PREFETCH_BUCKET_COUNT * MAP_PREFETCH_BUCKET_COUNT) + (y * MAP_PREFETCH_BUCKET_COUNT) + x].push_back(n);
+			}
+		}
+	}
+
+	this->m_BucketGate.clear();
+
+	for (int n = 0; n < MAP_PREFETCH_BUCKET_TOTAL; n++)
+	{
+		this->m_BucketStart[n] = this->m_BucketGate.size();
+
+		this->m_BucketGate.insert(this->m_BucketGate.end(), bucket[n].begin(), bucket[n].end());
+	}
+
+	this->m_BucketStart[MAP_PREFETCH_BUCKET_TOTAL] = this->m_BucketGate.size();
+
+	return true;
+}
+
+bool CMapPrefetch::Start(char* directory, DWORD budget)
+{
+	this->Stop();
+
+	if (strlen(directory) >= (sizeof(this->m_Directory) - MAP_PREFETCH_PATH_RESERVE))
+	{
+		return false;
+	}
+
+	strcpy_s(this->m_Directory, directory);
+
+	this->m_Budget = budget;
+
+	this->m_StopEvent = CreateEvent(0, 1, 0, 0);
+
+	this->m_JobSemaphore = CreateSemaphore(0, 0, 0x7FFFFFFF, 0);
+
+	if (this->m_StopEvent == 0 || this->m_JobSemaphore == 0)
+	{
+		this->Stop();
+		return false;
+	}
+
+	this->m_Thread = CreateThread(0, 0, CMapPrefetch::WorkerThread, this, 0, 0);
+
+	if (this->m_Thread == 0)
+	{
+		this->Stop();
+		return false;
+	}
+
+	return true;
+}
+
+void CMapPrefetch::Stop()
+{
+	if (this->m_StopEvent != 0)
+	{
+		SetEvent(this->m_StopEvent);
+	}
+
+	if (this->m_Thread != 0)
+	{
+		WaitForSingleObject(this->m_Thread, INFINITE);
+
+		CloseHandle(this->m_Thread);
+	}
+
+	if (this->m_StopEvent != 0)
+	{
+		CloseHandle(this->m_StopEvent);
+	}
+
+	if (this->m_JobSemaphore != 0)
+	{
+		CloseHandle(this->m_JobSemaphore);
+	}
+
+	this->m_Thread = 0;
+
+	this->m_StopEvent = 0;
+
+	this->m_JobSemaphore = 0;
+
+	this->m_Queue.clear();
+
+	for (int n = 0; n < TERRAIN_MAX_WORLD; n++)
+	{
+		this->ReleaseWorld(&this->m_World[n]);
+	}
+
+	this->m_Pool.Clear();
+}
+
+int CMapPrefetch::Update(int map, int x, int y)
+{
+	// Called with the hero position, walking near an entrance starts warming the map behind it
+	int gate = this->FindGate(map, x, y);
+
+	if (gate == -1)
+	{
+		return -1;
+	}
+
+	int world = CMapPrefetch::GetWorld(this->GetDestination(gate));
+
+	this->Prefetch(world);
+
+	return world;
+}
+
+int CMapPrefetch::FindGate(int map, int x, int y)
+{
+	if (map < 0 || map >= TERRAIN_MAX_WORLD || x < 0 || y < 0 || x >= TERRAIN_SIZE || y >= TERRAIN_SIZE)
+	{
+		return -1;
+	}
+
+	int index = (map * MAP_PREFETCH_BUCKET_COUNT * MAP_PREFETCH_BUCKET_COUNT) + ((y / MAP_PREFETCH_BUCKET) * MAP_PREFETCH_BUCKET_COUNT) + (x / MAP_PREFETCH_BUCKET);
+
+	int result = -1;
+
+	int best = MAP_PREFETCH_RADIUS + 1;
+
+	for (int n = this->m_BucketStart[index]; n < this->m_BucketStart[index + 1]; n++)
+	{
+		GATE_INFO* lpGate = &this->m_Gate[this->m_BucketGate[n]];
+
+		int dx = ((x < lpGate->X1 && x < lpGate->X2) ? (((lpGate->X1 < lpGate->X2) ? lpGate->X1 : lpGate->X2) - x) : ((x > lpGate->X1 && x > lpGate->X2) ? (x - ((lpGate->X1 > lpGate->X2) ? lpGate->X1 : lpGate->X2)) : 0));
+
+		int dy = ((y < lpGate->Y1 && y < lpGate->Y2) ? (((lpGate->Y1 < lpGate->Y2) ? lpGate->Y1 : lpGate->Y2) - y) : ((y > lpGate->Y1 && y > lpGate->Y2) ? (y - ((lpGate->Y1 > lpGate->Y2) ? lpGate->Y1 : lpGate->Y2)) : 0));
+
+		int distance = ((dx > dy) ? dx : dy);
+
+		if (distance < best)
+		{
+			best = distance;
+
+			result = this->m_BucketGate[n];
+		}
+	}
+
+	return result;
+}
+
+bool CMapPrefetch::Prefetch(int world)
+{
+	if (world <= 0 || world >= TERRAIN_MAX_WORLD || this->m_Thread == 0)
+	{
+		return false;
+	}
+
+	EnterCriticalSection(&this->m_Lock);
+
+	MAP_PREFETCH_WORLD* lpWorld = &this->m_World[world];
+
+	lpWorld->Stamp = ++this->m_Stamp;
+
+	bool queue = (lpWorld->State == MAP_PREFETCH_NONE);
+
+	if (queue != 0)
+	{
+		lpWorld->State = MAP_PREFETCH_QUEUED;
+
+		this->m_Queue.push_back(world);
+	}
+
+	LeaveCriticalSection(&this->m_Lock);
+
+	if (queue != 0)
+	{
+		ReleaseSemaphore(this->m_JobSemaphore, 1, 0);
+	}
+
+	return true;
+}
+
+bool CMapPrefetch::IsReady(int world)
+{
+	if (world <= 0 || world >= TERRAIN_MAX_WORLD)
+	{
+		return false;
+	}
+
+	EnterCriticalSection(&this->m_Lock);
+
+	bool result = (this->m_World[world].State == MAP_PREFETCH_READY);
+
+	LeaveCriticalSection(&this->m_Lock);
+
+	return result;
+}
+
+bool CMapPrefetch::TakeTerrain(int world, TERRAIN_DATA* lpData)
+{
+	// The decoded chunks move to the caller, the world loader then skips LoadSource
+	if (world <= 0 || world >= TERRAIN_MAX_WORLD)
+	{
+		return false;
+	}
+
+	EnterCriticalSection(&this->m_Lock);
+
+	MAP_PREFETCH_WORLD* lpWorld = &this->m_World[world];
+
+	bool result = (lpWorld->State == MAP_PREFETCH_READY && lpWorld->HasTerrain != 0);
+
+	if (result != 0)
+	{
+		for (int n = 0; n < TERRAIN_CHUNK_MAX; n++)
+		{
+			lpWorld->DecodedSize -= lpWorld->Terrain.Chunk[n].size();
+
+			this->m_DecodedSize -= lpWorld->Terrain.Chunk[n].size();
+
+			lpData->Chunk[n].swap(lpWorld->Terrain.Chunk[n]);
+
+			std::vector<BYTE>().swap(lpWorld->Terrain.Chunk[n]);
+		}
+
+		lpWorld->HasTerrain = 0;
+	}
+
+	LeaveCriticalSection(&this->m_Lock);
+
+	return result;
+}
+
+bool CMapPrefetch::TakeImage(int world, char* name, TEXTURE_IMAGE* lpImage)
+{
+	// The image belongs to the caller afterwards, it goes back through FreeImage once uploaded
+	if (world <= 0 || world >= TERRAIN_MAX_WORLD)
+	{
+		return false;
+	}
+
+	char key[MAX_PATH];
+
+	strcpy_s(key, name);
+
+	_strlwr_s(key);
+
+	EnterCriticalSection(&this->m_Lock);
+
+	MAP_PREFETCH_WORLD* lpWorld = &this->m_World[world];
+
+	std::map<std::string, TEXTURE_IMAGE>::iterator it = lpWorld->Image.find(key);
+
+	bool result = (lpWorld->State == MAP_PREFETCH_READY && it != lpWorld->Image.end());
+
+	if (result != 0)
+	{
+		*lpImage = it->second;
+
+		lpWorld->DecodedSize -= lpImage->Capacity;
+
+		this->m_DecodedSize -= lpImage->Capacity;
+
+		lpWorld->Image.erase(it);
+	}
+
+	LeaveCriticalSection(&this->m_Lock);
+
+	return result;
+}
+
+void CMapPrefetch::FreeImage(TEXTURE_IMAGE* lpImage)
+{
+	this->m_Pool.Free(lpImage->Data, lpImage->Capacity);
+
+	lpImage->Data = 0;
+
+	lpImage->Capacity = 0;
+}
+
+void CMapPrefetch::Release(int world)
+{
+	// After the warp whatever was not taken is dropped, the gates can queue the world again later
+	if (world <= 0 || world >= TERRAIN_MAX_WORLD)
+	{
+		return;
+	}
+
+	EnterCriticalSection(&this->m_Lock);
+
+	if (this->m_World[world].State == MAP_PREFETCH_READY)
+	{
+		this->ReleaseWorld(&this->m_World[world]);
+	}
+
+	LeaveCriticalSection(&this->m_Lock);
+}
+
+GATE_INFO* CMapPrefetch::GetGate(int index)
+{
+	return (((index < 0) || (index >= this->m_GateCount)) ? 0 : &this->m_Gate[index]);
+}
+
+int CMapPrefetch::GetGateCount()
+{
+	return this->m_GateCount;
+}
+
+int CMapPrefetch::GetDestination(int index)
+{
+	GATE_INFO* lpGate = this->GetGate(index);
+
+	if (lpGate == 0 || lpGate->Flag != GATE_FLAG_ENTRANCE)
+	{
+		return -1;
+	}
+
+	GATE_INFO* lpTarget = this->GetGate(lpGate->Target);
+
+	return ((lpTarget == 0) ? -1 : lpTarget->Map);
+}
+
+DWORD CMapPrefetch::GetDecodedSize()
+{
+	EnterCriticalSection(&this->m_Lock);
+
+	DWORD size = this->m_DecodedSize;
+
+	LeaveCriticalSection(&this->m_Lock);
+
+	return size;
+}
+
+DWORD CMapPrefetch::GetFileSize(int world)
+{
+	return (((world <= 0) || (world >= TERRAIN_MAX_WORLD)) ? 0 : this->m_World[world].FileSize);
+}
+
+int CMapPrefetch::GetWorld(int map)
+{
+	// Map numbers start at 0 for Lorencia, its data is in World1
+	return ((map < 0) ? -1 : (map + 1));
+}
+
+DWORD WINAPI CMapPrefetch::WorkerThread(LPVOID lpParam)
+{
+	CMapPrefetch* lpPrefetch = (CMapPrefetch*)lpParam;
+
+	// Background mode also lowers the disk and memory priority, older systems only get the lowest thread priority
+	if (SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN) == 0)
+	{
+		SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+	}
+
+	HANDLE handle[2] = { lpPrefetch->m_StopEvent, lpPrefetch->m_JobSemaphore };
+
+	while (WaitForMultipleObjects(2, handle, 0, INFINITE) == (WAIT_OBJECT_0 + 1))
+	{
+		EnterCriticalSection(&lpPrefetch->m_Lock);
+
+		int world = lpPrefetch->m_Queue.front();
+
+		lpPrefetch->m_Queue.pop_front();
+
+		LeaveCriticalSection(&lpPrefetch->m_Lock);
+
+		lpPrefetch->Warm(world);
+	}
+
+	return 0;
+}
+
+void CMapPrefetch::Warm(int world)
+{
+	// Terrain first, then the world textures, then the object models which only go through the page cache
+	MAP_PREFETCH_WORLD local;
+
+	local.FileSize = 0;
+
+	local.DecodedSize = 0;
+
+	char path[MAX_PATH];
+
+	wsprintf(path, "%s\\World%d", this->m_Directory, world);
+
+	local.HasTerrain = CTerrainPackage::LoadSource(path, world, &this->m_Decoder, &this->m_Pool, &local.Terrain);
+
+	for (int n = 0; n < TERRAIN_CHUNK_MAX; n++)
+	{
+		local.DecodedSize += local.Terrain.Chunk[n].size();
+	}
+
+	EnterCriticalSection(&this->m_Lock);
+
+	this->MakeRoom(local.DecodedSize, world);
+
+	bool fit = ((this->m_DecodedSize + local.DecodedSize) <= this->m_Budget);
+
+	LeaveCriticalSection(&this->m_Lock);
+
+	if (fit == 0)
+	{
+		for (int n = 0; n < TERRAIN_CHUNK_MAX; n++)
+		{
+			std::vector<BYTE>().swap(local.Terrain.Chunk[n]);
+		}
+
+		local.HasTerrain = 0;
+
+		local.DecodedSize = 0;
+	}
+
+	if (WaitForSingleObject(this->m_StopEvent, 0) != WAIT_OBJECT_0)
+	{
+		local.FileSize += this->ReadDirectory(path, world, &local.Image, local.DecodedSize);
+
+		for (std::map<std::string, TEXTURE_IMAGE>::iterator it = local.Image.begin(); it != local.Image.end(); it++)
+		{
+			local.DecodedSize += it->second.Capacity;
+		}
+	}
+
+	if (WaitForSingleObject(this->m_StopEvent, 0) != WAIT_OBJECT_0)
+	{
+		wsprintf(path, "%s\\Object%d", this->m_Directory, world);
+
+		local.FileSize += this->ReadDirectory(path, world, 0, 0);
+	}
+
+	EnterCriticalSection(&this->m_Lock);
+
+	MAP_PREFETCH_WORLD* lpWorld = &this->m_World[world];
+
+	for (int n = 0; n < TERRAIN_CHUNK_MAX; n++)
+	{
+		lpWorld->Terrain.Chunk[n].swap(local.Terrain.Chunk[n]);
+	}
+
+	lpWorld->Image.swap(local.Image);
+
+	lpWorld->HasTerrain = local.HasTerrain;
+
+	lpWorld->FileSize = local.FileSize;
+
+	lpWorld->DecodedSize = local.DecodedSize;
+
+	lpWorld->State = MAP_PREFETCH_READY;
+
+	this->m_DecodedSize += local.DecodedSize;
+
+	LeaveCriticalSection(&this->m_Lock);
+}
+
+DWORD CMapPrefetch::ReadDirectory(char* path, int world, std::map<std::string, TEXTURE_IMAGE>* lpImage, DWORD budget)
+{
+	// Every file is read through once so the warp finds it in the page cache, with an image list textures are also decoded while they fit the budget
+	char find[MAX_PATH];
+
+	if (_snprintf_s(find, sizeof(find), _TRUNCATE, "%s\\*", path) < 0)
+	{
+		return 0;
+	}
+
+	WIN32_FIND_DATA data;
+
+	HANDLE handle = FindFirstFile(find, &data);
+
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return 0;
+	}
+
+	std::vector<BYTE> buff(MAP_PREFETCH_READ_SIZE);
+
+	DWORD total = 0;
+
+	DWORD decoded = budget;
+
+	do
+	{
+		if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0 || WaitForSingleObject(this->m_StopEvent, 0) == WAIT_OBJECT_0)
+		{
+			continue;
+		}
+
+		if (lpImage != 0 && _strnicmp(data.cFileName, "Terrain", 7) == 0)
+		{
+			continue; // Already read by LoadSource
+		}
+
+		char name[MAX_PATH];
+
+		if (_snprintf_s(name, sizeof(name), _TRUNCATE, "%s\\%s", path, data.cFileName) < 0)
+		{
+			continue; // Longer than MAX_PATH
+		}
+
+		DWORD prefix = 0;
+
+		if (lpImage != 0 && CTextureDecoder::GetType(name, &prefix) != TEXTURE_TYPE_NONE)
+		{
+			TEXTURE_IMAGE image;
+
+			if (this->m_Decoder.Decode(name, &this->m_Pool, &image) != 0)
+			{
+				gTextureQuality.Apply(name, &image, &this->m_Pool);
+
+				EnterCriticalSection(&this->m_Lock);
+
+				this->MakeRoom((decoded + image.Capacity), world);
+
+				bool fit = ((this->m_DecodedSize + decoded + image.Capacity) <= this->m_Budget);
+
+				LeaveCriticalSection(&this->m_Lock);
+
+				if (fit != 0)
+				{
+					char key[MAX_PATH];
+
+					strcpy_s(key, data.cFileName);
+
+					_strlwr_s(key);
+
+					(*lpImage)[key] = image;
+
+					decoded += image.Capacity;
+				}
+				else
+				{
+					this->FreeImage(&image);
+				}
+			}
+
+			total += data.nFileSizeLow;
+
+			continue;
+		}
+
+		HANDLE file = CreateFile(name, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			continue;
+		}
+
+		DWORD OutSize = 0;
+
+		while (ReadFile(file, &buff[0], MAP_PREFETCH_READ_SIZE, &OutSize, 0) != 0 && OutSize != 0)
+		{
+			total += OutSize;
+		}
+
+		CloseHandle(file);
+	}
+	while (FindNextFile(handle, &data) != 0);
+
+	FindClose(handle);
+
+	return total;
+}
+
+void CMapPrefetch::MakeRoom(DWORD size, int keep)
+{
+	// Ready worlds nobody asked for the longest are dropped until the new data fits, the lock is held by the caller
+	while ((this->m_DecodedSize + size) > this->m_Budget)
+	{
+		int oldest = -1;
+
+		for (int n = 0; n < TERRAIN_MAX_WORLD; n++)
+		{
+			if (n != keep && this->m_World[n].State == MAP_PREFETCH_READY && this->m_World[n].DecodedSize != 0 && (oldest == -1 || this->m_World[n].Stamp < this->m_World[oldest].Stamp))
+			{
+				oldest = n;
+			}
+		}
+
+		if (oldest == -1)
+		{
+			return;
+		}
+
+		this->ReleaseWorld(&this->m_World[oldest]);
+	}
+}
+
+void CMapPrefetch::ReleaseWorld(MAP_PREFETCH_WORLD* lpWorld)
+{
+	for (int n = 0; n < TERRAIN_CHUNK_MAX; n++)
+	{
+		std::vector<BYTE>().swap(lpWorld->Terrain.Chunk[n]);
+	}
+
+	for (std::map<std::string, TEXTURE_IMAGE>::iterator it = lpWorld->Image.begin(); it != lpWorld->Image.end(); it++)
+	{
+		this->m_Pool.Free(it->second.Data, it->second.Capacity);
+	}
+
+	lpWorld->Image.clear();
+
+	this->m_DecodedSize -= ((lpWorld->DecodedSize > this->m_DecodedSize) ? this->m_DecodedSize : lpWorld->DecodedSize);
+
+	lpWorld->DecodedSize = 0;
+
+	lpWorld->FileSize = 0;
+
+	lpWorld->HasTerrain = 0;
+
+	lpWorld->State = MAP_PREFETCH_NONE;
+}
\ No newline at end of file
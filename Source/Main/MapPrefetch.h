@@ -0,0 +1,140 @@
+#pragma once
+
+#include "TerrainPackage.h"
+
+#define MAP_PREFETCH_GATE_SIZE 9
+#define MAP_PREFETCH_MAX_GATE 512
+#define MAP_PREFETCH_RADIUS 12 // Cells around a gate that start the prefetch
+#define MAP_PREFETCH_BUCKET 16 // Cells per bucket side
+#define MAP_PREFETCH_BUCKET_COUNT (TERRAIN_SIZE / MAP_PREFETCH_BUCKET)
+#define MAP_PREFETCH_BUCKET_TOTAL (TERRAIN_MAX_WORLD * MAP_PREFETCH_BUCKET_COUNT * MAP_PREFETCH_BUCKET_COUNT)
+#define MAP_PREFETCH_READ_SIZE 262144
+#define MAP_PREFETCH_DEFAULT_BUDGET (32 * 1024 * 1024)
+#define MAP_PREFETCH_PATH_RESERVE 16 // Room for "\\Object255" after the data directory
+
+enum eGateFlag
+{
+	GATE_FLAG_AREA = 0,
+	GATE_FLAG_ENTRANCE = 1,
+	GATE_FLAG_EXIT = 2,
+};
+
+enum eMapPrefetchState
+{
+	MAP_PREFETCH_NONE = 0,
+	MAP_PREFETCH_QUEUED = 1,
+	MAP_PREFETCH_READY = 2,
+};
+
+struct GATE_INFO
+{
+	BYTE Flag;
+	BYTE Map;
+	BYTE X1;
+	BYTE Y1;
+	BYTE X2;
+	BYTE Y2;
+	BYTE Target;
+	BYTE Dir;
+	BYTE Level;
+};
+
+struct MAP_PREFETCH_WORLD
+{
+	int State;
+	DWORD Stamp; // Last time a gate asked for it, the oldest ready world is dropped first
+	DWORD FileSize; // Bytes read through the page cache
+	DWORD DecodedSize; // Bytes held in Terrain and Image
+	bool HasTerrain;
+	TERRAIN_DATA Terrain;
+	std::map<std::string, TEXTURE_IMAGE> Image; // Lower case file name
+};
+
+class CMapPrefetch
+{
+public:
+
+	CMapPrefetch();
+
+	~CMapPrefetch();
+
+	bool Load(char* path);
+
+	bool Start(char* directory, DWORD budget);
+
+	void Stop();
+
+	int Update(int map, int x, int y);
+
+	int FindGate(int map, int x, int y);
+
+	bool Prefetch(int world);
+
+	bool IsReady(int world);
+
+	bool TakeTerrain(int world, TERRAIN_DATA* lpData);
+
+	bool TakeImage(int world, char* name, TEXTURE_IMAGE* lpImage);
+
+	void FreeImage(TEXTURE_IMAGE* lpImage);
+
+	void Release(int world);
+
+	GATE_INFO* GetGate(int index);
+
+	int GetGateCount();
+
+	int GetDestination(int index);
+
+	DWORD GetDecodedSize();
+
+	DWORD GetFileSize(int world);
+
+	static int GetWorld(int map);
+
+private:
+
+	static DWORD WINAPI WorkerThread(LPVOID lpParam);
+
+	void Warm(int world);
+
+	DWORD ReadDirectory(char* path, int world, std::map<std::string, TEXTURE_IMAGE>* lpImage, DWORD budget);
+
+	void MakeRoom(DWORD size, int keep);
+
+	void ReleaseWorld(MAP_PREFETCH_WORLD* lpWorld);
+
+private:
+
+	GATE_INFO m_Gate[MAP_PREFETCH_MAX_GATE];
+
+	int m_GateCount;
+
+	std::vector<WORD> m_BucketStart; // Buckets of every map in one flat list, MAP_PREFETCH_BUCKET_TOTAL + 1 entries
+
+	std::vector<WORD> m_BucketGate;
+
+	char m_Directory[MAX_PATH];
+
+	DWORD m_Budget;
+
+	DWORD m_DecodedSize;
+
+	DWORD m_Stamp;
+
+	MAP_PREFETCH_WORLD m_World[TERRAIN_MAX_WORLD];
+
+	std::deque<int> m_Queue;
+
+	CRITICAL_SECTION m_Lock;
+
+	HANDLE m_Thread;
+
+	HANDLE m_StopEvent;
+
+	HANDLE m_JobSemaphore;
+
+	CTextureDecoder m_Decoder;
+
+	CTextureBufferPool m_Pool;
+};
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "stdafx.h"
+#include "MappedFile.h"
+
+CMappedFile::CMappedFile()
+{
+	this->m_File = INVALID_HANDLE_VALUE;
+
+	this->m_Mapping = 0;
+
+	this->m_Data = 0;
+
+	this->m_Size = 0;
+}
+
+CMappedFile::~CMappedFile()
+{
+	this->Close();
+}
+
+bool CMappedFile::Open(char* path)
+{
+	this->Close();
+
+	this->m_File = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_ARCHIVE, 0);
+
+	if (this->m_File == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	this->m_Size = GetFileSize(this->m_File, 0);
+
+	if (this->m_Size == 0 || this->m_Size == INVALID_FILE_SIZE)
+	{
+		this->Close();
+
+		return false;
+	}
+
+	this->m_Mapping = CreateFileMapping(this->m_File, 0, PAGE_READONLY, 0, 0, 0);
+
+	if (this->m_Mapping == 0)
+	{
+		this->Close();
+
+		return false;
+	}
+
+	this->m_Data = (BYTE*)MapViewOfFile(this->m_Mapping, FILE_MAP_READ, 0, 0, 0);
+
+	if (this->m_Data == 0)
+	{
+		this->Close();
+
+		return false;
+	}
+
+	return true;
+}
+
+void CMappedFile::Close()
+{
+	if (this->m_Data != 0)
+	{
+		UnmapViewOfFile(this->m_Data);
+
+		this->m_Data = 0;
+	}
+
+	if (this->m_Mapping != 0)
+	{
+		CloseHandle(this->m_Mapping);
+
+		this->m_Mapping = 0;
+	}
+
+	if (this->m_File != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(this->m_File);
+
+		this->m_File = INVALID_HANDLE_VALUE;
+	}
+
+	this->m_Size = 0;
+}
+
+bool CMappedFile::IsOpen()
+{
+	return (this->m_Data != 0);
+}
+
+BYTE* CMappedFile::GetData()
+{
+	return this->m_Data;
+}
+
+DWORD CMappedFile::GetSize()
+{
+	return this->m_Size;
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+
+class CMappedFile
+{
+public:
+
+	CMappedFile();
+
+	~CMappedFile();
+
+	bool Open(char* path);
+
+	void Close();
+
+	bool IsOpen();
+
+	BYTE* GetData();
+
+	DWORD GetSize();
+
+private:
+
+	HANDLE m_File;
+
+	HANDLE m_Mapping;
+
+	BYTE* m_Data;
+
+	DWORD m_Size;
+};
\ No newline at end of file
@@ -1,8 +1,15 @@
 #include "stdafx.h"
 #include "Patchs.h"
+#include "AssetLoader.h"
 #include "Protect.h"
 #include "Util.h"
 
+void MainFrame()
+{
+	// Once a frame on the main thread, the sync point where finished loads are handed to their callbacks
+	gAssetLoader.Dispatch(ASSET_LOAD_DISPATCH_TIME);
+}
+
 __declspec(naked) void ReduceCPU()
 {
 	static DWORD JmpBack = 0x00526A60;
@@ -19,6 +26,34 @@ __declspec(naked) void ReduceCPU()
 	}
 }
 
+__declspec(naked) void ReduceCPUFrame()
+{
+	static DWORD JmpBack = 0x00526A60;
+
+	__asm
+	{
+		Push 1;
+
+		Call Dword Ptr Ds : [0x00552128] ; //Sleep
+
+		Pushad;
+
+		Call MainFrame;
+
+		Popad;
+
+		Call Dword Ptr Ds : [0x00552198] ; //GetTickCount
+
+		Jmp[JmpBack];
+	}
+}
+
+void InitMainFrame()
+{
+	// Takes the place of the ReduceCPU hook, only installed when something needs the per-frame call
+	SetCompleteHook(0xE9, 0x00526A5A, &ReduceCPUFrame);
+}
+
 void ReduceRam(LPVOID lpThreadParameter)
 {
 	HANDLE v1;
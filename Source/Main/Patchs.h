@@ -4,4 +4,10 @@ void InitPatchs();
 
 void ReduceRam(LPVOID lpThreadParameter);
 
-void ReduceCPU();
\ No newline at end of file
+void InitMainFrame();
+
+void MainFrame();
+
+void ReduceCPU();
+
+void ReduceCPUFrame();
\ No newline at end of file
@@ -0,0 +1,502 @@
+#include "stdafx.h"
+#include "SharedCache.h"
+#include "CCRC32.H"
+
+CSharedCache gSharedCache;
+
+CSharedCache::CSharedCache()
+{
+	this->m_Name[0] = 0;
+
+	this->m_Mutex = 0;
+
+	this->m_Index = 0;
+
+	this->m_Header = 0;
+
+	this->m_Entry = 0;
+
+	this->m_MappedCount = 0;
+
+	this->m_MappedSize = 0;
+
+	this->m_PublishedCount = 0;
+
+	this->m_PublishedSize = 0;
+}
+
+CSharedCache::~CSharedCache()
+{
+	this->Close();
+}
+
+bool CSharedCache::Open(char* name)
+{
+	// The index lives in a named mapping next to a named mutex, the first client to start creates both
+	this->Close();
+
+	strcpy_s(this->m_Name, name);
+
+	char buff[128];
+
+	wsprintf(buff, "%s_Lock", this->m_Name);
+
+	this->m_Mutex = CreateMutex(0, 0, buff);
+
+	if (this->m_Mutex == 0)
+	{
+		return false;
+	}
+
+	wsprintf(buff, "%s_Index", this->m_Name);
+
+	DWORD size = sizeof(SHARED_CACHE_HEADER) + (SHARED_CACHE_SLOT_COUNT * sizeof(SHARED_CACHE_ENTRY));
+
+	this->m_Index = CreateFileMapping(INVALID_HANDLE_VALUE, 0, PAGE_READWRITE, 0, size, buff);
+
+	this->m_Header = ((this->m_Index != 0) ? (SHARED_CACHE_HEADER*)MapViewOfFile(this->m_Index, FILE_MAP_WRITE, 0, 0, size) : 0);
+
+	if (this->m_Header == 0)
+	{
+		this->Close();
+		return false;
+	}
+
+	// Mapped before the lock is taken, so an abandoned mutex can already rebuild it
+	this->m_Entry = (SHARED_CACHE_ENTRY*)(this->m_Header + 1);
+
+	this->Lock();
+
+	if (this->m_Header->Magic == 0)
+	{
+		this->m_Header->Magic = SHARED_CACHE_MAGIC;
+
+		this->m_Header->Version = SHARED_CACHE_VERSION;
+
+		this->m_Header->SlotCount = SHARED_CACHE_SLOT_COUNT;
+
+		this->m_Header->EntryCount = 0;
+
+		this->m_Header->NextSerial = 0;
+	}
+
+	bool result = (this->m_Header->Magic == SHARED_CACHE_MAGIC && this->m_Header->Version == SHARED_CACHE_VERSION && this->m_Header->SlotCount == SHARED_CACHE_SLOT_COUNT);
+
+	this->Unlock();
+
+	if (result == 0)
+	{
+		this->Close();
+		return false;
+	}
+
+	return true;
+}
+
+void CSharedCache::Close()
+{
+	if (this->m_Header != 0)
+	{
+		UnmapViewOfFile(this->m_Header);
+	}
+
+	if (this->m_Index != 0)
+	{
+		CloseHandle(this->m_Index);
+	}
+
+	if (this->m_Mutex != 0)
+	{
+		CloseHandle(this->m_Mutex);
+	}
+
+	this->m_Mutex = 0;
+
+	this->m_Index = 0;
+
+	this->m_Header = 0;
+
+	this->m_Entry = 0;
+}
+
+bool CSharedCache::IsOpen()
+{
+	return (this->m_Header != 0);
+}
+
+bool CSharedCache::Acquire(SHARED_CACHE_KEY* lpKey, SHARED_CACHE_DATA* lpData)
+{
+	memset(lpData, 0, sizeof(SHARED_CACHE_DATA));
+
+	if (this->m_Header == 0)
+	{
+		return false;
+	}
+
+	this->Lock();
+
+	int slot = this->FindSlot(lpKey, 0);
+
+	SHARED_CACHE_ENTRY* lpEntry = ((slot != -1) ? &this->m_Entry[slot] : 0);
+
+	if (lpEntry == 0 || lpEntry->RefCount <= 0)
+	{
+		this->Unlock();
+		return false;
+	}
+
+	char name[128];
+
+	this->GetDataName(lpEntry->Serial, name);
+
+	HANDLE mapping = OpenFileMapping(FILE_MAP_READ, 0, name);
+
+	BYTE* data = ((mapping != 0) ? (BYTE*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, lpEntry->DataSize) : 0);
+
+	if (data == 0)
+	{
+		// Every process that held it is gone without a release, the next publish starts it over
+		if (mapping != 0)
+		{
+			CloseHandle(mapping);
+		}
+
+		this->DeleteSlot(slot);
+
+		this->Unlock();
+		return false;
+	}
+
+	lpEntry->RefCount++;
+
+	lpData->Data = data;
+
+	lpData->Size = lpEntry->DataSize;
+
+	lpData->Info[0] = lpEntry->Info[0];
+
+	lpData->Info[1] = lpEntry->Info[1];
+
+	lpData->Mapping = mapping;
+
+	lpData->Key = *lpKey;
+
+	lpData->Serial = lpEntry->Serial;
+
+	DWORD hash = lpEntry->Hash;
+
+	this->Unlock();
+
+	// The mapping stays while the count is held, so the check runs outside the lock
+	CCRC32 CRC32;
+
+	if ((DWORD)CRC32.FullCRC(lpData->Data, lpData->Size) != hash)
+	{
+		this->Release(lpData);
+		return false;
+	}
+
+	this->m_MappedCount++;
+
+	this->m_MappedSize += lpData->Size;
+
+	return true;
+}
+
+bool CSharedCache::Publish(SHARED_CACHE_KEY* lpKey, BYTE* data, DWORD size, int* info, SHARED_CACHE_DATA* lpData)
+{
+	// Decoded data is copied into its own named mapping, another process that got there first wins
+	memset(lpData, 0, sizeof(SHARED_CACHE_DATA));
+
+	if (this->m_Header == 0 || size == 0)
+	{
+		return false;
+	}
+
+	CCRC32 CRC32;
+
+	DWORD hash = (DWORD)CRC32.FullCRC(data, size);
+
+	this->Lock();
+
+	int slot = this->FindSlot(lpKey, 1);
+
+	if (slot == -1)
+	{
+		this->Unlock();
+		return false;
+	}
+
+	if (this->m_Entry[slot].Used != 0)
+	{
+		this->Unlock();
+
+		if (this->Acquire(lpKey, lpData) != 0)
+		{
+			return true;
+		}
+
+		// Acquire drops an entry whose clients are all gone, the slot is free again unless another client published meanwhile
+		this->Lock();
+
+		slot = this->FindSlot(lpKey, 1);
+
+		if (slot == -1 || this->m_Entry[slot].Used != 0)
+		{
+			this->Unlock();
+			return false;
+		}
+	}
+
+	SHARED_CACHE_ENTRY* lpEntry = &this->m_Entry[slot];
+
+	DWORD serial = ++this->m_Header->NextSerial;
+
+	char name[128];
+
+	this->GetDataName(serial, name);
+
+	HANDLE mapping = CreateFileMapping(INVALID_HANDLE_VALUE, 0, PAGE_READWRITE, 0, size, name);
+
+	BYTE* view = ((mapping != 0) ? (BYTE*)MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size) : 0);
+
+	if (view == 0)
+	{
+		if (mapping != 0)
+		{
+			CloseHandle(mapping);
+		}
+
+		this->Unlock();
+		return false;
+	}
+
+	memcpy(view, data, size);
+
+	this->m_Header->EntryCount++;
+
+	lpEntry->Key = *lpKey;
+
+	lpEntry->Used = 1;
+
+	lpEntry->Serial = serial;
+
+	lpEntry->DataSize = size;
+
+	lpEntry->Hash = hash;
+
+	lpEntry->Info[0] = ((info != 0) ? info[0] : 0);
+
+	lpEntry->Info[1] = ((info != 0) ? info[1] : 0);
+
+	lpEntry->RefCount = 1;
+
+	this->Unlock();
+
+	lpData->Data = view;
+
+	lpData->Size = size;
+
+	lpData->Info[0] = lpEntry->Info[0];
+
+	lpData->Info[1] = lpEntry->Info[1];
+
+	lpData->Mapping = mapping;
+
+	lpData->Key = *lpKey;
+
+	lpData->Serial = serial;
+
+	this->m_PublishedCount++;
+
+	this->m_PublishedSize += size;
+
+	return true;
+}
+
+void CSharedCache::Release(SHARED_CACHE_DATA* lpData)
+{
+	// The system frees the data with the last handle, the entry goes with the last count
+	if (lpData->Mapping == 0)
+	{
+		return;
+	}
+
+	UnmapViewOfFile(lpData->Data);
+
+	CloseHandle(lpData->Mapping);
+
+	if (this->m_Header != 0)
+	{
+		this->Lock();
+
+		int slot = this->FindSlot(&lpData->Key, 0);
+
+		if (slot != -1 && this->m_Entry[slot].Serial == lpData->Serial && (--this->m_Entry[slot].RefCount) <= 0)
+		{
+			this->DeleteSlot(slot);
+		}
+
+		this->Unlock();
+	}
+
+	memset(lpData, 0, sizeof(SHARED_CACHE_DATA));
+}
+
+int CSharedCache::GetEntryCount()
+{
+	return ((this->m_Header != 0) ? this->m_Header->EntryCount : 0);
+}
+
+DWORD CSharedCache::GetLiveSize()
+{
+	if (this->m_Header == 0)
+	{
+		return 0;
+	}
+
+	DWORD size = 0;
+
+	this->Lock();
+
+	for (DWORD n = 0; n < this->m_Header->SlotCount; n++)
+	{
+		size += ((this->m_Entry[n].Used != 0 && this->m_Entry[n].RefCount > 0) ? this->m_Entry[n].DataSize : 0);
+	}
+
+	this->Unlock();
+
+	return size;
+}
+
+DWORD CSharedCache::GetMappedCount()
+{
+	return this->m_MappedCount;
+}
+
+DWORD CSharedCache::GetMappedSize()
+{
+	return this->m_MappedSize;
+}
+
+DWORD CSharedCache::GetPublishedCount()
+{
+	return this->m_PublishedCount;
+}
+
+DWORD CSharedCache::GetPublishedSize()
+{
+	return this->m_PublishedSize;
+}
+
+void CSharedCache::Lock()
+{
+	// A client that died holding the lock may have left DeleteSlot halfway through a shift, the index is rebuilt before anyone probes it
+	if (WaitForSingleObject(this->m_Mutex, INFINITE) == WAIT_ABANDONED && this->m_Entry != 0)
+	{
+		this->RebuildIndex();
+	}
+}
+
+void CSharedCache::Unlock()
+{
+	ReleaseMutex(this->m_Mutex);
+}
+
+int CSharedCache::FindSlot(SHARED_CACHE_KEY* lpKey, bool insert)
+{
+	// Open addressing, removals shift the chain back so a free slot still ends every probe
+	DWORD mask = this->m_Header->SlotCount - 1;
+
+	DWORD index = this->GetHome(lpKey);
+
+	for (DWORD n = 0; n <= mask; n++, index = (index + 1) & mask)
+	{
+		SHARED_CACHE_ENTRY* lpEntry = &this->m_Entry[index];
+
+		if (lpEntry->Used == 0)
+		{
+			return ((insert != 0) ? index : -1);
+		}
+
+		if (lpEntry->Key.Crc == lpKey->Crc && lpEntry->Key.Size == lpKey->Size && lpEntry->Key.Kind == lpKey->Kind && lpEntry->Key.Param == lpKey->Param)
+		{
+			return index;
+		}
+	}
+
+	return -1;
+}
+
+void CSharedCache::DeleteSlot(int slot)
+{
+	// Backward shift: every later entry of the chain that the gap does not cut off from its home moves into it
+	DWORD mask = this->m_Header->SlotCount - 1;
+
+	DWORD gap = slot;
+
+	memset(&this->m_Entry[gap], 0, sizeof(SHARED_CACHE_ENTRY));
+
+	for (DWORD index = ((gap + 1) & mask); this->m_Entry[index].Used != 0; index = ((index + 1) & mask))
+	{
+		DWORD home = this->GetHome(&this->m_Entry[index].Key);
+
+		if (((index - home) & mask) >= ((index - gap) & mask))
+		{
+			this->m_Entry[gap] = this->m_Entry[index];
+
+			memset(&this->m_Entry[index], 0, sizeof(SHARED_CACHE_ENTRY));
+
+			gap = index;
+		}
+	}
+
+	this->m_Header->EntryCount--;
+}
+
+void CSharedCache::RebuildIndex()
+{
+	// Every entry still held goes back in through FindSlot, which drops a copy a torn shift left behind and recounts the table
+	if (this->m_Header->Magic != SHARED_CACHE_MAGIC || this->m_Header->SlotCount != SHARED_CACHE_SLOT_COUNT)
+	{
+		return;
+	}
+
+	std::vector<SHARED_CACHE_ENTRY> entry;
+
+	for (DWORD n = 0; n < this->m_Header->SlotCount; n++)
+	{
+		if (this->m_Entry[n].Used != 0 && this->m_Entry[n].RefCount > 0)
+		{
+			entry.push_back(this->m_Entry[n]);
+		}
+	}
+
+	memset(this->m_Entry, 0, (this->m_Header->SlotCount * sizeof(SHARED_CACHE_ENTRY)));
+
+	this->m_Header->EntryCount = 0;
+
+	for (size_t n = 0; n < entry.size(); n++)
+	{
+		int slot = this->FindSlot(&entry[n].Key, 1);
+
+		if (slot == -1 || this->m_Entry[slot].Used != 0)
+		{
+			continue;
+		}
+
+		this->m_Entry[slot] = entry[n];
+
+		this->m_Header->EntryCount++;
+	}
+}
+
+DWORD CSharedCache::GetHome(SHARED_CACHE_KEY* lpKey)
+{
+	return ((lpKey->Crc ^ (lpKey->Size * 0x9E3779B1) ^ (lpKey->Kind << 24) ^ lpKey->Param) & (this->m_Header->SlotCount - 1));
+}
+
+void CSharedCache::GetDataName(DWORD serial, char* out)
+{
+	wsprintf(out, "%s_%u", this->m_Name, serial);
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma once
+
+#define SHARED_CACHE_MAGIC 0x48435342 // "BSCH"
+#define SHARED_CACHE_VERSION 1
+#define SHARED_CACHE_NAME "MuSharedCache"
+#define SHARED_CACHE_SLOT_COUNT 8192 // Power of two, far above the assets the clients hold at once
+
+enum eSharedCacheKind
+{
+	SHARED_CACHE_TEXTURE = 0,
+	SHARED_CACHE_MODEL = 1,
+	SHARED_CACHE_TEXT = 2,
+};
+
+struct SHARED_CACHE_KEY
+{
+	DWORD Crc; // CCRC32 of the source file, the same content shares whatever folder it is in
+	DWORD Size;
+	WORD Kind;
+	WORD Param; // Texture quality tier
+};
+
+struct SHARED_CACHE_ENTRY
+{
+	SHARED_CACHE_KEY Key;
+	DWORD Used;
+	DWORD Serial; // Names the data mapping, every publish gets a new one
+	DWORD DataSize;
+	DWORD Hash; // CCRC32 of the data, checked by every process that maps it
+	int Info[2]; // Width and height for a texture
+	LONG RefCount; // Processes with the data mapped
+};
+
+struct SHARED_CACHE_HEADER
+{
+	DWORD Magic;
+	DWORD Version;
+	DWORD SlotCount;
+	DWORD EntryCount;
+	DWORD NextSerial;
+	DWORD Reserved[3];
+};
+
+struct SHARED_CACHE_DATA
+{
+	BYTE* Data; // Read only for everyone but the process that published it
+	DWORD Size;
+	int Info[2];
+	HANDLE Mapping;
+	SHARED_CACHE_KEY Key; // Slots move when another entry is removed, the release finds it again by key
+	DWORD Serial;
+};
+
+class CSharedCache
+{
+public:
+
+	CSharedCache();
+
+	~CSharedCache();
+
+	bool Open(char* name);
+
+	void Close();
+
+	bool IsOpen();
+
+	bool Acquire(SHARED_CACHE_KEY* lpKey, SHARED_CACHE_DATA* lpData);
+
+	bool Publish(SHARED_CACHE_KEY* lpKey, BYTE* data, DWORD size, int* info, SHARED_CACHE_DATA* lpData);
+
+	void Release(SHARED_CACHE_DATA* lpData);
+
+	int GetEntryCount();
+
+	DWORD GetLiveSize();
+
+	DWORD GetMappedCount();
+
+	DWORD GetMappedSize();
+
+	DWORD GetPublishedCount();
+
+	DWORD GetPublishedSize();
+
+private:
+
+	void Lock();
+
+	void Unlock();
+
+	int FindSlot(SHARED_CACHE_KEY* lpKey, bool insert);
+
+	void DeleteSlot(int slot);
+
+	void RebuildIndex();
+
+	DWORD GetHome(SHARED_CACHE_KEY* lpKey);
+
+	void GetDataName(DWORD serial, char* out);
+
+	char m_Name[64];
+
+	HANDLE m_Mutex;
+
+	HANDLE m_Index;
+
+	SHARED_CACHE_HEADER* m_Header;
+
+	SHARED_CACHE_ENTRY* m_Entry;
+
+	DWORD m_MappedCount; // Taken from another process instead of decoded here
+
+	DWORD m_MappedSize;
+
+	DWORD m_PublishedCount;
+
+	DWORD m_PublishedSize;
+};
+
+extern CSharedCache gSharedCache;
\ No newline at end of file
@@ -0,0 +1,447 @@
+#include "stdafx.h"
+#include "StringTable.h"
+#include "FileCrypt.h"
+
+static char* LanguageSuffix[LOCAL_TEXT_MAX_LANGUAGE] = { "", "_Eng", "_Por", "_Spn" };
+
+static char EmptyString[1] = { 0 };
+
+static DWORD HashString(char* text)
+{
+	DWORD hash = 0x811C9DC5;
+
+	for (; (*text) != 0; text++)
+	{
+		hash = (hash ^ (BYTE)(*text)) * 0x01000193;
+	}
+
+	return hash;
+}
+
+CStringArena::CStringArena()
+{
+	this->m_Used = 0;
+
+	this->m_Count = 0;
+
+	this->m_UsedSize = 0;
+
+	this->Clear();
+}
+
+CStringArena::~CStringArena()
+{
+	for (size_t n = 0; n < this->m_Block.size(); n++)
+	{
+		delete[] this->m_Block[n];
+	}
+}
+
+void CStringArena::Clear()
+{
+	for (size_t n = 0; n < this->m_Block.size(); n++)
+	{
+		delete[] this->m_Block[n];
+	}
+
+	this->m_Block.clear();
+
+	this->m_Hash.assign(1024, STRING_TABLE_NONE);
+
+	this->m_Count = 0;
+
+	this->m_UsedSize = 0;
+
+	this->m_Used = STRING_ARENA_BLOCK_SIZE;
+
+	// Offset 0 is the empty string every blank record shares
+	this->Append("", 0);
+}
+
+DWORD CStringArena::Intern(char* text, int length)
+{
+	if (length == 0)
+	{
+		return 0;
+	}
+
+	char buff[DIALOG_RECORD_SIZE + 1];
+
+	length = ((length > DIALOG_RECORD_SIZE) ? DIALOG_RECORD_SIZE : length);
+
+	memcpy(buff, text, length);
+
+	buff[length] = 0;
+
+	DWORD mask = this->m_Hash.size() - 1;
+
+	for (DWORD slot = HashString(buff) & mask;; slot = (slot + 1) & mask)
+	{
+		if (this->m_Hash[slot] == STRING_TABLE_NONE)
+		{
+			DWORD offset = this->Append(buff, length);
+
+			this->m_Hash[slot] = offset;
+
+			this->m_Count++;
+
+			if ((this->m_Count * 2) > this->m_Hash.size())
+			{
+				this->Rehash();
+			}
+
+			return offset;
+		}
+
+		if (strcmp(this->GetString(this->m_Hash[slot]), buff) == 0)
+		{
+			return this->m_Hash[slot];
+		}
+	}
+}
+
+char* CStringArena::GetString(DWORD offset)
+{
+	return &this->m_Block[offset / STRING_ARENA_BLOCK_SIZE][offset % STRING_ARENA_BLOCK_SIZE];
+}
+
+DWORD CStringArena::GetCount()
+{
+	return this->m_Count;
+}
+
+DWORD CStringArena::GetUsedSize()
+{
+	return this->m_UsedSize;
+}
+
+DWORD CStringArena::GetMemorySize()
+{
+	return (this->m_Block.size() * STRING_ARENA_BLOCK_SIZE) + (this->m_Hash.size() * sizeof(DWORD));
+}
+
+DWORD CStringArena::Append(char* text, int length)
+{
+	// Strings never straddle blocks so the pointers handed out stay valid until Clear
+	if ((this->m_Used + length + 1) > STRING_ARENA_BLOCK_SIZE)
+	{
+		this->m_Block.push_back(new char[STRING_ARENA_BLOCK_SIZE]);
+
+		this->m_Used = 0;
+	}
+
+	DWORD offset = ((this->m_Block.size() - 1) * STRING_ARENA_BLOCK_SIZE) + this->m_Used;
+
+	memcpy(&this->m_Block.back()[this->m_Used], text, length);
+
+	this->m_Block.back()[this->m_Used + length] = 0;
+
+	this->m_Used += length + 1;
+
+	this->m_UsedSize += length + 1;
+
+	return offset;
+}
+
+void CStringArena::Rehash()
+{
+	std::vector<DWORD> hash(this->m_Hash.size() * 2, STRING_TABLE_NONE);
+
+	DWORD mask = hash.size() - 1;
+
+	for (size_t n = 0; n < this->m_Hash.size(); n++)
+	{
+		if (this->m_Hash[n] == STRING_TABLE_NONE)
+		{
+			continue;
+		}
+
+		DWORD slot = HashString(this->GetString(this->m_Hash[n])) & mask;
+
+		while (hash[slot] != STRING_TABLE_NONE)
+		{
+			slot = (slot + 1) & mask;
+		}
+
+		hash[slot] = this->m_Hash[n];
+	}
+
+	this->m_Hash.swap(hash);
+}
+
+CStringTable::CStringTable()
+{
+	this->m_RecordSize = 0;
+
+	this->m_Arena = 0;
+
+	this->m_Count = 0;
+
+	this->m_DecodedCount = 0;
+}
+
+CStringTable::~CStringTable()
+{
+
+}
+
+bool CStringTable::Open(char* path, int RecordSize, STRING_TABLE_FIELD* lpField, int FieldCount, CStringArena* lpArena)
+{
+	// Only the mapping and the offset index are set up here, records are decoded the first time they are asked for
+	this->Close();
+
+	if (this->m_File.Open(path) == 0)
+	{
+		return false;
+	}
+
+	if (RecordSize <= 0 || (this->m_File.GetSize() % RecordSize) != 0)
+	{
+		this->Close();
+
+		return false;
+	}
+
+	this->m_RecordSize = RecordSize;
+
+	this->m_Field.assign(lpField, (lpField + FieldCount));
+
+	this->m_Arena = lpArena;
+
+	this->m_Count = this->m_File.GetSize() / RecordSize;
+
+	this->m_Index.assign((this->m_Count * FieldCount), STRING_TABLE_NONE);
+
+	return true;
+}
+
+void CStringTable::Close()
+{
+	this->m_File.Close();
+
+	this->m_Field.clear();
+
+	std::vector<DWORD>().swap(this->m_Index);
+
+	this->m_Count = 0;
+
+	this->m_DecodedCount = 0;
+}
+
+bool CStringTable::IsOpen()
+{
+	return this->m_File.IsOpen();
+}
+
+char* CStringTable::GetString(int index, int field)
+{
+	if (index < 0 || index >= this->m_Count || field < 0 || field >= (int)this->m_Field.size())
+	{
+		return ((this->m_Arena != 0) ? this->m_Arena->GetString(0) : EmptyString);
+	}
+
+	DWORD* lpOffset = &this->m_Index[(index * this->m_Field.size()) + field];
+
+	if ((*lpOffset) == STRING_TABLE_NONE)
+	{
+		// Each record is FC CF AB encrypted on its own, so decoding starts at the key boundary before the field
+		STRING_TABLE_FIELD* lpField = &this->m_Field[field];
+
+		int skip = lpField->Offset % 3;
+
+		int size = ((lpField->Size > DIALOG_RECORD_SIZE) ? DIALOG_RECORD_SIZE : lpField->Size);
+
+		BYTE buff[DIALOG_RECORD_SIZE + 3];
+
+		memcpy(buff, this->m_File.GetData() + (index * this->m_RecordSize) + lpField->Offset - skip, skip + size);
+
+		BuxConvert(buff, skip + size);
+
+		char* text = (char*)&buff[skip];
+
+		*lpOffset = this->m_Arena->Intern(text, (int)strnlen(text, size));
+
+		this->m_DecodedCount++;
+	}
+
+	return this->m_Arena->GetString(*lpOffset);
+}
+
+int CStringTable::GetInteger(int index, int offset)
+{
+	if (index < 0 || index >= this->m_Count || offset < 0 || (offset + (int)sizeof(int)) > this->m_RecordSize)
+	{
+		return 0;
+	}
+
+	int skip = offset % 3;
+
+	BYTE buff[sizeof(int) + 3];
+
+	memcpy(buff, this->m_File.GetData() + (index * this->m_RecordSize) + offset - skip, skip + sizeof(int));
+
+	BuxConvert(buff, skip + sizeof(int));
+
+	return *(int*)&buff[skip];
+}
+
+int CStringTable::GetCount()
+{
+	return this->m_Count;
+}
+
+DWORD CStringTable::GetDecodedCount()
+{
+	return this->m_DecodedCount;
+}
+
+DWORD CStringTable::GetMemorySize()
+{
+	return (this->m_Index.capacity() * sizeof(DWORD)) + (this->m_Field.capacity() * sizeof(STRING_TABLE_FIELD));
+}
+
+CLocalText::CLocalText()
+{
+	this->m_Language = -1;
+}
+
+CLocalText::~CLocalText()
+{
+
+}
+
+bool CLocalText::SetLanguage(char* directory, char* language)
+{
+	// Tables of a language stay mapped once opened, switching back only flips the index and reuses what was decoded
+	int target = ((language == 0 || language[0] == 0) ? 0 : -1);
+
+	for (int n = 1; n < LOCAL_TEXT_MAX_LANGUAGE && target == -1; n++)
+	{
+		if (_stricmp(&LanguageSuffix[n][1], language) == 0)
+		{
+			target = n;
+		}
+	}
+
+	if (target == -1)
+	{
+		return false;
+	}
+
+	if (this->m_Text[target].IsOpen() == 0 || this->m_Dialog[target].IsOpen() == 0)
+	{
+		char path[MAX_PATH];
+
+		STRING_TABLE_FIELD text = { 0, TEXT_RECORD_SIZE };
+
+		wsprintf(path, "%s\\Text%s.bmd", directory, LanguageSuffix[target]);
+
+		if (this->m_Text[target].Open(path, TEXT_RECORD_SIZE, &text, 1, &this->m_Arena) == 0)
+		{
+			return false;
+		}
+
+		STRING_TABLE_FIELD dialog[DIALOG_MAX_ANSWER + 1];
+
+		dialog[0].Offset = 0;
+
+		dialog[0].Size = DIALOG_TEXT_SIZE;
+
+		for (int n = 0; n < DIALOG_MAX_ANSWER; n++)
+		{
+			dialog[n + 1].Offset = DIALOG_ANSWER_OFFSET + (n * DIALOG_ANSWER_SIZE);
+
+			dialog[n + 1].Size = DIALOG_ANSWER_SIZE;
+		}
+
+		wsprintf(path, "%s\\Dialog%s.bmd", directory, LanguageSuffix[target]);
+
+		if (this->m_Dialog[target].Open(path, DIALOG_RECORD_SIZE, dialog, (DIALOG_MAX_ANSWER + 1), &this->m_Arena) == 0)
+		{
+			this->m_Text[target].Close();
+
+			return false;
+		}
+	}
+
+	this->m_Language = target;
+
+	return true;
+}
+
+char* CLocalText::GetLanguage()
+{
+	return ((this->m_Language == -1) ? EmptyString : &LanguageSuffix[this->m_Language][(this->m_Language == 0) ? 0 : 1]);
+}
+
+char* CLocalText::GetText(int index)
+{
+	return ((this->m_Language == -1) ? this->m_Arena.GetString(0) : this->m_Text[this->m_Language].GetString(index, 0));
+}
+
+char* CLocalText::GetDialog(int index)
+{
+	return ((this->m_Language == -1) ? this->m_Arena.GetString(0) : this->m_Dialog[this->m_Language].GetString(index, 0));
+}
+
+char* CLocalText::GetAnswer(int index, int answer)
+{
+	if (this->m_Language == -1 || answer < 0 || answer >= DIALOG_MAX_ANSWER)
+	{
+		return this->m_Arena.GetString(0);
+	}
+
+	return this->m_Dialog[this->m_Language].GetString(index, (answer + 1));
+}
+
+int CLocalText::GetAnswerCount(int index)
+{
+	return ((this->m_Language == -1) ? 0 : this->m_Dialog[this->m_Language].GetInteger(index, DIALOG_ANSWER_COUNT_OFFSET));
+}
+
+int CLocalText::GetAnswerLink(int index, int answer)
+{
+	if (this->m_Language == -1 || answer < 0 || answer >= DIALOG_MAX_ANSWER)
+	{
+		return 0;
+	}
+
+	return this->m_Dialog[this->m_Language].GetInteger(index, (DIALOG_ANSWER_LINK_OFFSET + (answer * sizeof(int))));
+}
+
+int CLocalText::GetAnswerReturn(int index, int answer)
+{
+	if (this->m_Language == -1 || answer < 0 || answer >= DIALOG_MAX_ANSWER)
+	{
+		return 0;
+	}
+
+	return this->m_Dialog[this->m_Language].GetInteger(index, (DIALOG_ANSWER_RETURN_OFFSET + (answer * sizeof(int))));
+}
+
+DWORD CLocalText::GetMemorySize()
+{
+	DWORD size = this->m_Arena.GetMemorySize();
+
+	for (int n = 0; n < LOCAL_TEXT_MAX_LANGUAGE; n++)
+	{
+		size += this->m_Text[n].GetMemorySize() + this->m_Dialog[n].GetMemorySize();
+	}
+
+	return size;
+}
+
+CStringTable* CLocalText::GetTextTable()
+{
+	return ((this->m_Language == -1) ? 0 : &this->m_Text[this->m_Language]);
+}
+
+CStringTable* CLocalText::GetDialogTable()
+{
+	return ((this->m_Language == -1) ? 0 : &this->m_Dialog[this->m_Language]);
+}
+
+char* CLocalText::GetLanguageSuffix(int language)
+{
+	return (((language < 0) || (language >= LOCAL_TEXT_MAX_LANGUAGE)) ? EmptyString : LanguageSuffix[language]);
+}
\ No newline at end of file
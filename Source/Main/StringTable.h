@@ -0,0 +1,145 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#define STRING_TABLE_NONE 0xFFFFFFFF
+#define STRING_ARENA_BLOCK_SIZE 16384
+#define TEXT_RECORD_SIZE 300
+#define DIALOG_RECORD_SIZE 1024
+#define DIALOG_TEXT_SIZE 300
+#define DIALOG_ANSWER_OFFSET 384
+#define DIALOG_ANSWER_SIZE 64
+#define DIALOG_MAX_ANSWER 10
+#define DIALOG_ANSWER_COUNT_OFFSET 300
+#define DIALOG_ANSWER_LINK_OFFSET 304
+#define DIALOG_ANSWER_RETURN_OFFSET 344
+#define LOCAL_TEXT_MAX_LANGUAGE 4
+
+struct STRING_TABLE_FIELD
+{
+	int Offset;
+	int Size;
+};
+
+class CStringArena
+{
+public:
+
+	CStringArena();
+
+	~CStringArena();
+
+	void Clear();
+
+	DWORD Intern(char* text, int length);
+
+	char* GetString(DWORD offset);
+
+	DWORD GetCount();
+
+	DWORD GetUsedSize();
+
+	DWORD GetMemorySize();
+
+private:
+
+	DWORD Append(char* text, int length);
+
+	void Rehash();
+
+private:
+
+	std::vector<char*> m_Block;
+
+	DWORD m_Used; // Bytes used in the last block
+
+	std::vector<DWORD> m_Hash; // Open addressing over arena offsets, STRING_TABLE_NONE when empty
+
+	DWORD m_Count;
+
+	DWORD m_UsedSize;
+};
+
+class CStringTable
+{
+public:
+
+	CStringTable();
+
+	~CStringTable();
+
+	bool Open(char* path, int RecordSize, STRING_TABLE_FIELD* lpField, int FieldCount, CStringArena* lpArena);
+
+	void Close();
+
+	bool IsOpen();
+
+	char* GetString(int index, int field);
+
+	int GetInteger(int index, int offset);
+
+	int GetCount();
+
+	DWORD GetDecodedCount();
+
+	DWORD GetMemorySize();
+
+private:
+
+	CMappedFile m_File;
+
+	int m_RecordSize;
+
+	std::vector<STRING_TABLE_FIELD> m_Field;
+
+	std::vector<DWORD> m_Index; // Arena offset per record and field, STRING_TABLE_NONE until first access
+
+	CStringArena* m_Arena;
+
+	int m_Count;
+
+	DWORD m_DecodedCount;
+};
+
+class CLocalText
+{
+public:
+
+	CLocalText();
+
+	~CLocalText();
+
+	bool SetLanguage(char* directory, char* language);
+
+	char* GetLanguage();
+
+	char* GetText(int index);
+
+	char* GetDialog(int index);
+
+	char* GetAnswer(int index, int answer);
+
+	int GetAnswerCount(int index);
+
+	int GetAnswerLink(int index, int answer);
+
+	int GetAnswerReturn(int index, int answer);
+
+	DWORD GetMemorySize();
+
+	CStringTable* GetTextTable();
+
+	CStringTable* GetDialogTable();
+
+	static char* GetLanguageSuffix(int language);
+
+private:
+
+	CStringArena m_Arena;
+
+	CStringTable m_Text[LOCAL_TEXT_MAX_LANGUAGE];
+
+	CStringTable m_Dialog[LOCAL_TEXT_MAX_LANGUAGE];
+
+	int m_Language;
+};
\ No newline at end of file
@@ -0,0 +1,540 @@
+#include "stdafx.h"
+#include "TerrainCull.h"
+#include <algorithm>
+
+static bool CompareBlockOrder(const TERRAIN_CULL_BLOCK_ORDER& a, const TERRAIN_CULL_BLOCK_ORDER& b)
+{
+	return (a.Distance < b.Distance);
+}
+
+static float DotVector(float* a, float* b)
+{
+	return ((a[0] * b[0]) + (a[1] * b[1]) + (a[2] * b[2]));
+}
+
+static void SetPlane(TERRAIN_CULL_PLANE* lpPlane, float* normal, float* point)
+{
+	lpPlane->Normal[0] = normal[0];
+	lpPlane->Normal[1] = normal[1];
+	lpPlane->Normal[2] = normal[2];
+	lpPlane->Distance = -DotVector(normal, point);
+}
+
+CTerrainCull::CTerrainCull()
+{
+	this->m_Height = 0;
+
+	memset(&this->m_Camera, 0, sizeof(this->m_Camera));
+
+	memset(this->m_Target, 0, sizeof(this->m_Target));
+
+	memset(this->m_Eye, 0, sizeof(this->m_Eye));
+
+	memset(this->m_Plane, 0, sizeof(this->m_Plane));
+
+	this->m_TanX = 0;
+
+	this->m_TanY = 0;
+
+	this->m_TestCount = 0;
+
+	this->m_Visible.reserve(TERRAIN_CULL_BLOCK_COUNT * TERRAIN_CULL_BLOCK_COUNT);
+
+	this->m_Order.reserve(TERRAIN_CULL_BLOCK_COUNT * TERRAIN_CULL_BLOCK_COUNT);
+}
+
+CTerrainCull::~CTerrainCull()
+{
+
+}
+
+void CTerrainCull::Build(BYTE* height)
+{
+	// The height grid has to stay alive while the world is loaded, the mapped terrain package does
+	this->m_Height = height;
+
+	this->m_Node[0].resize(TERRAIN_CULL_BLOCK_COUNT * TERRAIN_CULL_BLOCK_COUNT);
+
+	for (int by = 0; by < TERRAIN_CULL_BLOCK_COUNT; by++)
+	{
+		for (int bx = 0; bx < TERRAIN_CULL_BLOCK_COUNT; bx++)
+		{
+			// A block of tiles spans one vertex more than its tile count
+			TERRAIN_CULL_NODE* lpNode = &this->m_Node[0][(by * TERRAIN_CULL_BLOCK_COUNT) + bx];
+
+			lpNode->Min = 0xFF;
+
+			lpNode->Max = 0;
+
+			for (int y = (by * TERRAIN_CULL_BLOCK); y <= ((by + 1) * TERRAIN_CULL_BLOCK) && y < TERRAIN_SIZE; y++)
+			{
+				for (int x = (bx * TERRAIN_CULL_BLOCK); x <= ((bx + 1) * TERRAIN_CULL_BLOCK) && x < TERRAIN_SIZE; x++)
+				{
+					BYTE value = height[(y * TERRAIN_SIZE) + x];
+
+					lpNode->Min = ((value < lpNode->Min) ? value : lpNode->Min);
+
+					lpNode->Max = ((value > lpNode->Max) ? value : lpNode->Max);
+				}
+			}
+		}
+	}
+
+	for (int level = 1; level < TERRAIN_CULL_LEVEL; level++)
+	{
+		int count = TERRAIN_CULL_BLOCK_COUNT >> level;
+
+		this->m_Node[level].resize(count * count);
+
+		for (int y = 0; y < count; y++)
+		{
+			for (int x = 0; x < count; x++)
+			{
+				TERRAIN_CULL_NODE* lpNode = &this->m_Node[level][(y * count) + x];
+
+				lpNode->Min = 0xFF;
+
+				lpNode->Max = 0;
+
+				for (int n = 0; n < 4; n++)
+				{
+					TERRAIN_CULL_NODE* lpChild = &this->m_Node[level - 1][((((y * 2) + (n / 2)) * (count * 2)) + ((x * 2) + (n % 2)))];
+
+					lpNode->Min = ((lpChild->Min < lpNode->Min) ? lpChild->Min : lpNode->Min);
+
+					lpNode->Max = ((lpChild->Max > lpNode->Max) ? lpChild->Max : lpNode->Max);
+				}
+			}
+		}
+	}
+}
+
+void CTerrainCull::SetCamera(CAMERA_INFO* lpCamera, float TargetX, float TargetY, float aspect)
+{
+	// The eye orbits the hero: RotX is the yaw, RotY the pitch below the horizon, Zoom the vertical field of view,
+	// PosZ lifts the eye and ClipGL is the far plane
+	this->m_Camera = (*lpCamera);
+
+	this->m_Target[0] = TargetX;
+
+	this->m_Target[1] = TargetY;
+
+	this->m_Target[2] = this->GetHeight(TargetX, TargetY);
+
+	float yaw = lpCamera->RotX * 0.01745329f;
+
+	float pitch = ((lpCamera->RotY < 1.0f) ? 1.0f : ((lpCamera->RotY > 89.0f) ? 89.0f : lpCamera->RotY)) * 0.01745329f;
+
+	this->m_Forward[0] = -sin(yaw) * cos(pitch);
+	this->m_Forward[1] = cos(yaw) * cos(pitch);
+	this->m_Forward[2] = -sin(pitch);
+
+	this->m_Right[0] = cos(yaw);
+	this->m_Right[1] = sin(yaw);
+	this->m_Right[2] = 0.0f;
+
+	this->m_Up[0] = (this->m_Right[1] * this->m_Forward[2]) - (this->m_Right[2] * this->m_Forward[1]);
+	this->m_Up[1] = (this->m_Right[2] * this->m_Forward[0]) - (this->m_Right[0] * this->m_Forward[2]);
+	this->m_Up[2] = (this->m_Right[0] * this->m_Forward[1]) - (this->m_Right[1] * this->m_Forward[0]);
+
+	for (int n = 0; n < 3; n++)
+	{
+		this->m_Eye[n] = this->m_Target[n] - (this->m_Forward[n] * TERRAIN_CULL_CAMERA_DISTANCE);
+	}
+
+	this->m_Eye[2] += lpCamera->PosZ;
+
+	this->m_TanY = tan(lpCamera->Zoom * 0.5f * 0.01745329f);
+
+	this->m_TanX = this->m_TanY * aspect;
+
+	float normal[3];
+
+	float point[3];
+
+	for (int n = 0; n < 3; n++)
+	{
+		point[n] = this->m_Eye[n] + (this->m_Forward[n] * TERRAIN_CULL_NEAR);
+	}
+
+	SetPlane(&this->m_Plane[0], this->m_Forward, point);
+
+	for (int n = 0; n < 3; n++)
+	{
+		point[n] = this->m_Eye[n] + (this->m_Forward[n] * lpCamera->ClipGL);
+
+		normal[n] = -this->m_Forward[n];
+	}
+
+	SetPlane(&this->m_Plane[1], normal, point);
+
+	// Side planes pass through the eye, inside is where the lateral offset stays under the view slope
+	for (int side = 0; side < 4; side++)
+	{
+		float* axis = ((side < 2) ? this->m_Right : this->m_Up);
+
+		float slope = ((side < 2) ? this->m_TanX : this->m_TanY);
+
+		float sign = (((side % 2) == 0) ? 1.0f : -1.0f);
+
+		for (int n = 0; n < 3; n++)
+		{
+			normal[n] = (axis[n] * sign) + (this->m_Forward[n] * slope);
+		}
+
+		SetPlane(&this->m_Plane[2 + side], normal, this->m_Eye);
+	}
+}
+
+void CTerrainCull::Cull(bool horizon)
+{
+	this->m_Visible.clear();
+
+	this->m_Order.clear();
+
+	this->m_TestCount = 0;
+
+	if (this->m_Height == 0)
+	{
+		return;
+	}
+
+	this->CullNode((TERRAIN_CULL_LEVEL - 1), 0, 0, 0x3F);
+
+	if (horizon != 0)
+	{
+		this->CullHorizon();
+
+		return;
+	}
+
+	for (size_t n = 0; n < this->m_Order.size(); n++)
+	{
+		this->m_Visible.push_back(this->m_Order[n].Block);
+	}
+}
+
+void CTerrainCull::CullRectangle()
+{
+	// What the client draws today: block centers inside the ClipX/ClipY/ClipZ trapezoid turned by the camera yaw
+	this->m_Visible.clear();
+
+	float ForwardX = -this->m_Right[1];
+
+	float ForwardY = this->m_Right[0];
+
+	float Far = this->m_Camera.ClipX[0];
+
+	float Near = this->m_Camera.ClipY[0];
+
+	for (int by = 0; by < TERRAIN_CULL_BLOCK_COUNT; by++)
+	{
+		for (int bx = 0; bx < TERRAIN_CULL_BLOCK_COUNT; bx++)
+		{
+			float dx = (((bx * TERRAIN_CULL_BLOCK) + (TERRAIN_CULL_BLOCK / 2)) * TERRAIN_CULL_SCALE) - this->m_Target[0];
+
+			float dy = (((by * TERRAIN_CULL_BLOCK) + (TERRAIN_CULL_BLOCK / 2)) * TERRAIN_CULL_SCALE) - this->m_Target[1];
+
+			float x = (dx * this->m_Right[0]) + (dy * this->m_Right[1]);
+
+			float y = (dx * ForwardX) + (dy * ForwardY);
+
+			if (y < Near || y > Far || Far <= Near)
+			{
+				continue;
+			}
+
+			float width = TERRAIN_CULL_NEAR_WIDTH + ((this->m_Camera.ClipZ - TERRAIN_CULL_NEAR_WIDTH) * ((y - Near) / (Far - Near)));
+
+			if (fabs(x) <= width)
+			{
+				this->m_Visible.push_back((by * TERRAIN_CULL_BLOCK_COUNT) + bx);
+			}
+		}
+	}
+}
+
+DWORD CTerrainCull::GetVisibleCount()
+{
+	return this->m_Visible.size();
+}
+
+WORD* CTerrainCull::GetVisible()
+{
+	return ((this->m_Visible.empty() == 0) ? &this->m_Visible[0] : 0);
+}
+
+DWORD CTerrainCull::GetTestCount()
+{
+	return this->m_TestCount;
+}
+
+float CTerrainCull::GetHeight(float x, float y)
+{
+	if (this->m_Height == 0)
+	{
+		return 0.0f;
+	}
+
+	float fx = x / TERRAIN_CULL_SCALE;
+
+	float fy = y / TERRAIN_CULL_SCALE;
+
+	fx = ((fx < 0.0f) ? 0.0f : ((fx > (TERRAIN_SIZE - 1)) ? (TERRAIN_SIZE - 1) : fx));
+
+	fy = ((fy < 0.0f) ? 0.0f : ((fy > (TERRAIN_SIZE - 1)) ? (TERRAIN_SIZE - 1) : fy));
+
+	int x1 = (int)fx;
+
+	int y1 = (int)fy;
+
+	int x2 = ((x1 < (TERRAIN_SIZE - 1)) ? (x1 + 1) : x1);
+
+	int y2 = ((y1 < (TERRAIN_SIZE - 1)) ? (y1 + 1) : y1);
+
+	float tx = fx - x1;
+
+	float ty = fy - y1;
+
+	float h1 = this->m_Height[(y1 * TERRAIN_SIZE) + x1] + ((this->m_Height[(y1 * TERRAIN_SIZE) + x2] - this->m_Height[(y1 * TERRAIN_SIZE) + x1]) * tx);
+
+	float h2 = this->m_Height[(y2 * TERRAIN_SIZE) + x1] + ((this->m_Height[(y2 * TERRAIN_SIZE) + x2] - this->m_Height[(y2 * TERRAIN_SIZE) + x1]) * tx);
+
+	return ((h1 + ((h2 - h1) * ty)) * TERRAIN_CULL_HEIGHT_SCALE);
+}
+
+void CTerrainCull::GetRay(float ScreenX, float ScreenY, float* origin, float* direction)
+{
+	// Screen coordinates go from -1 to 1 with y pointing up
+	float length = 0.0f;
+
+	for (int n = 0; n < 3; n++)
+	{
+		origin[n] = this->m_Eye[n];
+
+		direction[n] = this->m_Forward[n] + (this->m_Right[n] * ScreenX * this->m_TanX) + (this->m_Up[n] * ScreenY * this->m_TanY);
+
+		length += direction[n] * direction[n];
+	}
+
+	length = sqrt(length);
+
+	for (int n = 0; n < 3; n++)
+	{
+		direction[n] /= length;
+	}
+}
+
+void CTerrainCull::CullNode(int level, int x, int y, int mask)
+{
+	float min[3];
+
+	float max[3];
+
+	this->GetNodeBox(level, x, y, min, max);
+
+	if (mask != 0)
+	{
+		this->m_TestCount++;
+
+		for (int n = 0; n < 6; n++)
+		{
+			if ((mask & (1 << n)) == 0)
+			{
+				continue;
+			}
+
+			TERRAIN_CULL_PLANE* lpPlane = &this->m_Plane[n];
+
+			float inside[3];
+
+			float outside[3];
+
+			for (int i = 0; i < 3; i++)
+			{
+				inside[i] = ((lpPlane->Normal[i] >= 0.0f) ? max[i] : min[i]);
+
+				outside[i] = ((lpPlane->Normal[i] >= 0.0f) ? min[i] : max[i]);
+			}
+
+			if ((DotVector(lpPlane->Normal, inside) + lpPlane->Distance) < 0.0f)
+			{
+				return;
+			}
+
+			// Fully in front of this plane, the children skip it
+			if ((DotVector(lpPlane->Normal, outside) + lpPlane->Distance) >= 0.0f)
+			{
+				mask &= ~(1 << n);
+			}
+		}
+	}
+
+	if (level == 0)
+	{
+		TERRAIN_CULL_BLOCK_ORDER order;
+
+		float dx = ((min[0] + max[0]) * 0.5f) - this->m_Eye[0];
+
+		float dy = ((min[1] + max[1]) * 0.5f) - this->m_Eye[1];
+
+		order.Distance = (dx * dx) + (dy * dy);
+
+		order.Block = (y * TERRAIN_CULL_BLOCK_COUNT) + x;
+
+		this->m_Order.push_back(order);
+
+		return;
+	}
+
+	for (int n = 0; n < 4; n++)
+	{
+		this->CullNode((level - 1), ((x * 2) + (n % 2)), ((y * 2) + (n / 2)), mask);
+	}
+}
+
+void CTerrainCull::CullHorizon()
+{
+	// Front to back over the frustum survivors, a block hides when its highest point stays under the horizon
+	// left by the solid ground in front of it, its lowest top corner only raises the horizon where it covers whole columns
+	std::sort(this->m_Order.begin(), this->m_Order.end(), CompareBlockOrder);
+
+	for (int n = 0; n < TERRAIN_CULL_HORIZON; n++)
+	{
+		this->m_Horizon[n] = -1.0e30f;
+	}
+
+	for (size_t n = 0; n < this->m_Order.size(); n++)
+	{
+		WORD block = this->m_Order[n].Block;
+
+		float min[3];
+
+		float max[3];
+
+		this->GetNodeBox(0, (block % TERRAIN_CULL_BLOCK_COUNT), (block / TERRAIN_CULL_BLOCK_COUNT), min, max);
+
+		float left = 1.0e30f;
+
+		float right = -1.0e30f;
+
+		float top = -1.0e30f;
+
+		float OccluderLeft = 1.0e30f;
+
+		float OccluderRight = -1.0e30f;
+
+		float OccluderTop = 1.0e30f;
+
+		bool clipped = 0;
+
+		for (int i = 0; i < 8 && clipped == 0; i++)
+		{
+			float point[3] = { (((i & 1) != 0) ? max[0] : min[0]), (((i & 2) != 0) ? max[1] : min[1]), (((i & 4) != 0) ? max[2] : min[2]) };
+
+			float ScreenX;
+
+			float ScreenY;
+
+			if (this->ProjectPoint(point, &ScreenX, &ScreenY) == 0)
+			{
+				clipped = 1;
+				break;
+			}
+
+			left = ((ScreenX < left) ? ScreenX : left);
+
+			right = ((ScreenX > right) ? ScreenX : right);
+
+			top = ((ScreenY > top) ? ScreenY : top);
+
+			if ((i & 4) == 0)
+			{
+				OccluderLeft = ((ScreenX < OccluderLeft) ? ScreenX : OccluderLeft);
+
+				OccluderRight = ((ScreenX > OccluderRight) ? ScreenX : OccluderRight);
+
+				OccluderTop = ((ScreenY < OccluderTop) ? ScreenY : OccluderTop);
+			}
+		}
+
+		// Blocks crossing the near plane are always drawn and never occlude
+		if (clipped != 0)
+		{
+			this->m_Visible.push_back(block);
+			continue;
+		}
+
+		int first = (int)floor(((left + 1.0f) * 0.5f) * TERRAIN_CULL_HORIZON);
+
+		int last = (int)floor(((right + 1.0f) * 0.5f) * TERRAIN_CULL_HORIZON);
+
+		first = ((first < 0) ? 0 : first);
+
+		last = ((last >= TERRAIN_CULL_HORIZON) ? (TERRAIN_CULL_HORIZON - 1) : last);
+
+		bool visible = (first > last);
+
+		for (int i = first; i <= last && visible == 0; i++)
+		{
+			visible = (top >= this->m_Horizon[i]);
+		}
+
+		if (visible == 0)
+		{
+			continue;
+		}
+
+		this->m_Visible.push_back(block);
+
+		first = (int)ceil(((OccluderLeft + 1.0f) * 0.5f) * TERRAIN_CULL_HORIZON);
+
+		last = (int)floor(((OccluderRight + 1.0f) * 0.5f) * TERRAIN_CULL_HORIZON) - 1;
+
+		first = ((first < 0) ? 0 : first);
+
+		last = ((last >= TERRAIN_CULL_HORIZON) ? (TERRAIN_CULL_HORIZON - 1) : last);
+
+		for (int i = first; i <= last; i++)
+		{
+			this->m_Horizon[i] = ((OccluderTop > this->m_Horizon[i]) ? OccluderTop : this->m_Horizon[i]);
+		}
+	}
+}
+
+bool CTerrainCull::ProjectPoint(float* point, float* ScreenX, float* ScreenY)
+{
+	float offset[3] = { (point[0] - this->m_Eye[0]), (point[1] - this->m_Eye[1]), (point[2] - this->m_Eye[2]) };
+
+	float depth = DotVector(offset, this->m_Forward);
+
+	if (depth <= TERRAIN_CULL_NEAR)
+	{
+		return false;
+	}
+
+	(*ScreenX) = DotVector(offset, this->m_Right) / (depth * this->m_TanX);
+
+	(*ScreenY) = DotVector(offset, this->m_Up) / (depth * this->m_TanY);
+
+	return true;
+}
+
+void CTerrainCull::GetNodeBox(int level, int x, int y, float* min, float* max)
+{
+	int size = TERRAIN_CULL_BLOCK << level;
+
+	TERRAIN_CULL_NODE* lpNode = &this->m_Node[level][(y * (TERRAIN_CULL_BLOCK_COUNT >> level)) + x];
+
+	min[0] = (x * size) * TERRAIN_CULL_SCALE;
+
+	min[1] = (y * size) * TERRAIN_CULL_SCALE;
+
+	min[2] = lpNode->Min * TERRAIN_CULL_HEIGHT_SCALE;
+
+	max[0] = ((x + 1) * size) * TERRAIN_CULL_SCALE;
+
+	max[1] = ((y + 1) * size) * TERRAIN_CULL_SCALE;
+
+	max[2] = lpNode->Max * TERRAIN_CULL_HEIGHT_SCALE;
+}
\ No newline at end of file
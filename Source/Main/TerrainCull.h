@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Camera.h"
+#include "TerrainPackage.h"
+
+#define TERRAIN_CULL_BLOCK 4
+#define TERRAIN_CULL_BLOCK_COUNT (TERRAIN_SIZE / TERRAIN_CULL_BLOCK)
+#define TERRAIN_CULL_LEVEL 7
+#define TERRAIN_CULL_SCALE 100.0f
+#define TERRAIN_CULL_HEIGHT_SCALE 1.5f
+#define TERRAIN_CULL_CAMERA_DISTANCE 1000.0f
+#define TERRAIN_CULL_NEAR 20.0f
+#define TERRAIN_CULL_NEAR_WIDTH 540.0f
+#define TERRAIN_CULL_HORIZON 320
+
+struct TERRAIN_CULL_NODE
+{
+	BYTE Min;
+	BYTE Max;
+};
+
+struct TERRAIN_CULL_PLANE
+{
+	float Normal[3];
+	float Distance;
+};
+
+struct TERRAIN_CULL_BLOCK_ORDER
+{
+	float Distance;
+	WORD Block;
+};
+
+class CTerrainCull
+{
+public:
+
+	CTerrainCull();
+
+	~CTerrainCull();
+
+	void Build(BYTE* height);
+
+	void SetCamera(CAMERA_INFO* lpCamera, float TargetX, float TargetY, float aspect);
+
+	void Cull(bool horizon);
+
+	void CullRectangle();
+
+	DWORD GetVisibleCount();
+
+	WORD* GetVisible();
+
+	DWORD GetTestCount();
+
+	float GetHeight(float x, float y);
+
+	void GetRay(float ScreenX, float ScreenY, float* origin, float* direction);
+
+private:
+
+	void CullNode(int level, int x, int y, int mask);
+
+	void CullHorizon();
+
+	bool ProjectPoint(float* point, float* ScreenX, float* ScreenY);
+
+	void GetNodeBox(int level, int x, int y, float* min, float* max);
+
+private:
+
+	std::vector<TERRAIN_CULL_NODE> m_Node[TERRAIN_CULL_LEVEL]; // Level 0 holds one node per 4x4 tile block
+
+	BYTE* m_Height;
+
+	CAMERA_INFO m_Camera;
+
+	float m_Target[3];
+
+	float m_Eye[3];
+
+	float m_Forward[3];
+
+	float m_Right[3];
+
+	float m_Up[3];
+
+	float m_TanX;
+
+	float m_TanY;
+
+	TERRAIN_CULL_PLANE m_Plane[6];
+
+	std::vector<WORD> m_Visible;
+
+	std::vector<TERRAIN_CULL_BLOCK_ORDER> m_Order;
+
+	float m_Horizon[TERRAIN_CULL_HORIZON];
+
+	DWORD m_TestCount;
+};
\ No newline at end of file
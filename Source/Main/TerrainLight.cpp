@@ -0,0 +1,430 @@
+#include "stdafx.h"
+#include "TerrainLight.h"
+#include <emmintrin.h>
+
+static void ClipLightRect(TERRAIN_LIGHT_RECT* lpRect, TERRAIN_LIGHT_RECT* lpClip, TERRAIN_LIGHT_RECT* lpOutput)
+{
+	lpOutput->MinX = ((lpRect->MinX > lpClip->MinX) ? lpRect->MinX : lpClip->MinX);
+	lpOutput->MinY = ((lpRect->MinY > lpClip->MinY) ? lpRect->MinY : lpClip->MinY);
+	lpOutput->MaxX = ((lpRect->MaxX < lpClip->MaxX) ? lpRect->MaxX : lpClip->MaxX);
+	lpOutput->MaxY = ((lpRect->MaxY < lpClip->MaxY) ? lpRect->MaxY : lpClip->MaxY);
+}
+
+CTerrainLight::CTerrainLight()
+{
+	this->m_Height = 0;
+
+	this->m_Light = 0;
+
+	this->m_Simd = 1;
+
+	memset(this->m_Dirty, 0, sizeof(this->m_Dirty));
+}
+
+CTerrainLight::~CTerrainLight()
+{
+
+}
+
+void CTerrainLight::Build(BYTE* height, BYTE* light, bool simd)
+{
+	// Both grids have to stay alive while the world is loaded, the mapped terrain package does
+	this->m_Height = height;
+
+	this->m_Light = light;
+
+	this->m_Simd = simd;
+
+	for (int n = 0; n < 3; n++)
+	{
+		this->m_Normal[n].resize(TERRAIN_CELL_COUNT);
+
+		this->m_Static[n].resize(TERRAIN_CELL_COUNT);
+
+		this->m_Color[n].resize(TERRAIN_CELL_COUNT);
+	}
+
+	this->m_Source.clear();
+
+	TERRAIN_LIGHT_RECT rect = { 0, 0, TERRAIN_SIZE, TERRAIN_SIZE };
+
+	this->BuildRect(&rect);
+}
+
+void CTerrainLight::BuildRect(TERRAIN_LIGHT_RECT* lpRect)
+{
+	// Normals read the next row and column, so a height edit at (x,y) also needs the cells at x-1 and y-1 rebuilt
+	TERRAIN_LIGHT_RECT grid = { 0, 0, TERRAIN_SIZE, TERRAIN_SIZE };
+
+	TERRAIN_LIGHT_RECT rect;
+
+	ClipLightRect(lpRect, &grid, &rect);
+
+	for (int y = rect.MinY; y < rect.MaxY; y++)
+	{
+		this->BuildRow(y, rect.MinX, rect.MaxX);
+	}
+
+	this->MarkRect(&rect);
+}
+
+void CTerrainLight::SetLights(TERRAIN_LIGHT_SOURCE* lpSource, int count)
+{
+	// Only lights that appeared, vanished or changed dirty their blocks, a static scene costs nothing
+	int OldCount = this->m_Source.size();
+
+	int MaxCount = ((count > OldCount) ? count : OldCount);
+
+	for (int n = 0; n < MaxCount; n++)
+	{
+		TERRAIN_LIGHT_RECT rect;
+
+		if (n < OldCount && (n >= count || memcmp(&this->m_Source[n], &lpSource[n], sizeof(TERRAIN_LIGHT_SOURCE)) != 0))
+		{
+			CTerrainLight::GetSourceRect(&this->m_Source[n], &rect);
+
+			this->MarkRect(&rect);
+		}
+
+		if (n < count && (n >= OldCount || memcmp(&this->m_Source[n], &lpSource[n], sizeof(TERRAIN_LIGHT_SOURCE)) != 0))
+		{
+			CTerrainLight::GetSourceRect(&lpSource[n], &rect);
+
+			this->MarkRect(&rect);
+		}
+	}
+
+	this->m_Source.assign(lpSource, (lpSource + count));
+}
+
+DWORD CTerrainLight::Update()
+{
+	DWORD CellCount = 0;
+
+	for (int by = 0; by < TERRAIN_LIGHT_BLOCK_COUNT; by++)
+	{
+		for (int bx = 0; bx < TERRAIN_LIGHT_BLOCK_COUNT; bx++)
+		{
+			if (this->m_Dirty[(by * TERRAIN_LIGHT_BLOCK_COUNT) + bx] == 0)
+			{
+				continue;
+			}
+
+			TERRAIN_LIGHT_RECT rect = { (bx * TERRAIN_LIGHT_BLOCK), (by * TERRAIN_LIGHT_BLOCK), ((bx + 1) * TERRAIN_LIGHT_BLOCK), ((by + 1) * TERRAIN_LIGHT_BLOCK) };
+
+			this->UpdateRect(&rect);
+
+			CellCount += TERRAIN_LIGHT_BLOCK * TERRAIN_LIGHT_BLOCK;
+		}
+	}
+
+	return CellCount;
+}
+
+void CTerrainLight::UpdateAll()
+{
+	TERRAIN_LIGHT_RECT rect = { 0, 0, TERRAIN_SIZE, TERRAIN_SIZE };
+
+	this->UpdateRect(&rect);
+}
+
+void CTerrainLight::UpdateRect(TERRAIN_LIGHT_RECT* lpRect)
+{
+	// Same result as the client's per frame copy of the static light followed by every AddTerrainLight, limited to the rectangle
+	TERRAIN_LIGHT_RECT grid = { 0, 0, TERRAIN_SIZE, TERRAIN_SIZE };
+
+	TERRAIN_LIGHT_RECT rect;
+
+	ClipLightRect(lpRect, &grid, &rect);
+
+	if (rect.MinX >= rect.MaxX || rect.MinY >= rect.MaxY)
+	{
+		return;
+	}
+
+	for (int y = rect.MinY; y < rect.MaxY; y++)
+	{
+		for (int n = 0; n < 3; n++)
+		{
+			memcpy(&this->m_Color[n][(y * TERRAIN_SIZE) + rect.MinX], &this->m_Static[n][(y * TERRAIN_SIZE) + rect.MinX], ((rect.MaxX - rect.MinX) * sizeof(float)));
+		}
+	}
+
+	for (size_t n = 0; n < this->m_Source.size(); n++)
+	{
+		TERRAIN_LIGHT_RECT source;
+
+		CTerrainLight::GetSourceRect(&this->m_Source[n], &source);
+
+		TERRAIN_LIGHT_RECT clip;
+
+		ClipLightRect(&source, &rect, &clip);
+
+		if (clip.MinX < clip.MaxX && clip.MinY < clip.MaxY)
+		{
+			this->AddSource(&this->m_Source[n], &clip);
+		}
+	}
+
+	for (int by = (rect.MinY / TERRAIN_LIGHT_BLOCK); by <= ((rect.MaxY - 1) / TERRAIN_LIGHT_BLOCK); by++)
+	{
+		for (int bx = (rect.MinX / TERRAIN_LIGHT_BLOCK); bx <= ((rect.MaxX - 1) / TERRAIN_LIGHT_BLOCK); bx++)
+		{
+			// A block is clean only once all of it has been rebuilt
+			if ((bx * TERRAIN_LIGHT_BLOCK) >= rect.MinX && ((bx + 1) * TERRAIN_LIGHT_BLOCK) <= rect.MaxX && (by * TERRAIN_LIGHT_BLOCK) >= rect.MinY && ((by + 1) * TERRAIN_LIGHT_BLOCK) <= rect.MaxY)
+			{
+				this->m_Dirty[(by * TERRAIN_LIGHT_BLOCK_COUNT) + bx] = 0;
+			}
+		}
+	}
+}
+
+void CTerrainLight::GetNormal(int x, int y, float* normal)
+{
+	int index = ((y & (TERRAIN_SIZE - 1)) * TERRAIN_SIZE) + (x & (TERRAIN_SIZE - 1));
+
+	normal[0] = this->m_Normal[0][index];
+	normal[1] = this->m_Normal[1][index];
+	normal[2] = this->m_Normal[2][index];
+}
+
+void CTerrainLight::GetColor(int x, int y, float* color)
+{
+	int index = ((y & (TERRAIN_SIZE - 1)) * TERRAIN_SIZE) + (x & (TERRAIN_SIZE - 1));
+
+	color[0] = this->m_Color[0][index];
+	color[1] = this->m_Color[1][index];
+	color[2] = this->m_Color[2][index];
+}
+
+float* CTerrainLight::GetChannel(int channel)
+{
+	return ((channel >= 0 && channel < 3 && this->m_Color[channel].empty() == 0) ? &this->m_Color[channel][0] : 0);
+}
+
+void CTerrainLight::GetSourceRect(TERRAIN_LIGHT_SOURCE* lpSource, TERRAIN_LIGHT_RECT* lpRect)
+{
+	int range = ((lpSource->Range > TERRAIN_LIGHT_MAX_RANGE) ? TERRAIN_LIGHT_MAX_RANGE : lpSource->Range);
+
+	int x = (int)(lpSource->X / TERRAIN_LIGHT_SCALE);
+
+	int y = (int)(lpSource->Y / TERRAIN_LIGHT_SCALE);
+
+	lpRect->MinX = x - range;
+	lpRect->MinY = y - range;
+	lpRect->MaxX = x + range + 1;
+	lpRect->MaxY = y + range + 1;
+}
+
+void CTerrainLight::BuildRow(int y, int MinX, int MaxX)
+{
+	// Face normal of the (x+1,y) (x+1,y+1) (x,y+1) triangle like CreateTerrainNormal, which reduces to two height deltas
+	BYTE* row0 = &this->m_Height[y * TERRAIN_SIZE];
+
+	BYTE* row1 = &this->m_Height[((y + 1) & (TERRAIN_SIZE - 1)) * TERRAIN_SIZE];
+
+	float* nx = &this->m_Normal[0][y * TERRAIN_SIZE];
+
+	float* ny = &this->m_Normal[1][y * TERRAIN_SIZE];
+
+	float* nz = &this->m_Normal[2][y * TERRAIN_SIZE];
+
+	float* sr = &this->m_Static[0][y * TERRAIN_SIZE];
+
+	float* sg = &this->m_Static[1][y * TERRAIN_SIZE];
+
+	float* sb = &this->m_Static[2][y * TERRAIN_SIZE];
+
+	BYTE* light = ((this->m_Light != 0) ? &this->m_Light[y * TERRAIN_SIZE * 3] : 0);
+
+	float scale = TERRAIN_LIGHT_HEIGHT_SCALE * TERRAIN_LIGHT_SCALE;
+
+	int x = MinX;
+
+	if (this->m_Simd != 0)
+	{
+		__m128i zero = _mm_setzero_si128();
+
+		__m128 vscale = _mm_set1_ps(scale);
+
+		__m128 vz = _mm_set1_ps(TERRAIN_LIGHT_SCALE * TERRAIN_LIGHT_SCALE);
+
+		__m128 half = _mm_set1_ps(0.5f);
+
+		__m128 one = _mm_set1_ps(1.0f);
+
+		__m128 inv = _mm_set1_ps(1.0f / 255.0f);
+
+		// The x+1 loads must stay inside the row, the wrapped last column goes to the scalar tail
+		for (; (x + 4) <= MaxX && (x + 5) <= TERRAIN_SIZE; x += 4)
+		{
+			__m128 h10 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(*(int*)&row0[x + 1]), zero), zero));
+
+			__m128 h01 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(*(int*)&row1[x]), zero), zero));
+
+			__m128 h11 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(*(int*)&row1[x + 1]), zero), zero));
+
+			__m128 ax = _mm_mul_ps(_mm_sub_ps(h01, h11), vscale);
+
+			__m128 ay = _mm_mul_ps(_mm_sub_ps(h10, h11), vscale);
+
+			__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, ax), _mm_mul_ps(ay, ay)), _mm_mul_ps(vz, vz)));
+
+			ax = _mm_div_ps(ax, length);
+
+			ay = _mm_div_ps(ay, length);
+
+			__m128 az = _mm_div_ps(vz, length);
+
+			_mm_storeu_ps(&nx[x], ax);
+
+			_mm_storeu_ps(&ny[x], ay);
+
+			_mm_storeu_ps(&nz[x], az);
+
+			// Sun at (0.5, -0.5, 0.5) plus the 0.5 ambient, clamped to [0,1]
+			__m128 lum = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_sub_ps(ax, ay), az), half), half);
+
+			lum = _mm_min_ps(_mm_max_ps(lum, _mm_setzero_ps()), one);
+
+			if (light == 0)
+			{
+				_mm_storeu_ps(&sr[x], lum);
+
+				_mm_storeu_ps(&sg[x], lum);
+
+				_mm_storeu_ps(&sb[x], lum);
+
+				continue;
+			}
+
+			BYTE* in = &light[x * 3];
+
+			_mm_storeu_ps(&sr[x], _mm_mul_ps(_mm_mul_ps(_mm_set_ps(in[9], in[6], in[3], in[0]), inv), lum));
+
+			_mm_storeu_ps(&sg[x], _mm_mul_ps(_mm_mul_ps(_mm_set_ps(in[10], in[7], in[4], in[1]), inv), lum));
+
+			_mm_storeu_ps(&sb[x], _mm_mul_ps(_mm_mul_ps(_mm_set_ps(in[11], in[8], in[5], in[2]), inv), lum));
+		}
+	}
+
+	for (; x < MaxX; x++)
+	{
+		int x1 = (x + 1) & (TERRAIN_SIZE - 1);
+
+		float ax = (row1[x] - (float)row1[x1]) * scale;
+
+		float ay = (row0[x1] - (float)row1[x1]) * scale;
+
+		float az = TERRAIN_LIGHT_SCALE * TERRAIN_LIGHT_SCALE;
+
+		float length = sqrtf((ax * ax) + (ay * ay) + (az * az));
+
+		nx[x] = ax / length;
+
+		ny[x] = ay / length;
+
+		nz[x] = az / length;
+
+		float lum = (((nx[x] - ny[x]) + nz[x]) * 0.5f) + 0.5f;
+
+		lum = ((lum < 0.0f) ? 0.0f : ((lum > 1.0f) ? 1.0f : lum));
+
+		sr[x] = ((light != 0) ? ((light[(x * 3) + 0] * (1.0f / 255.0f)) * lum) : lum);
+
+		sg[x] = ((light != 0) ? ((light[(x * 3) + 1] * (1.0f / 255.0f)) * lum) : lum);
+
+		sb[x] = ((light != 0) ? ((light[(x * 3) + 2] * (1.0f / 255.0f)) * lum) : lum);
+	}
+}
+
+void CTerrainLight::AddSource(TERRAIN_LIGHT_SOURCE* lpSource, TERRAIN_LIGHT_RECT* lpRect)
+{
+	// AddTerrainLight: linear falloff from the light cell over Range cells, clipped at the map border instead of wrapping
+	float range = (float)((lpSource->Range > TERRAIN_LIGHT_MAX_RANGE) ? TERRAIN_LIGHT_MAX_RANGE : lpSource->Range);
+
+	float xf = lpSource->X / TERRAIN_LIGHT_SCALE;
+
+	float yf = lpSource->Y / TERRAIN_LIGHT_SCALE;
+
+	for (int y = lpRect->MinY; y < lpRect->MaxY; y++)
+	{
+		float yl = yf - (float)y;
+
+		float* cr = &this->m_Color[0][y * TERRAIN_SIZE];
+
+		float* cg = &this->m_Color[1][y * TERRAIN_SIZE];
+
+		float* cb = &this->m_Color[2][y * TERRAIN_SIZE];
+
+		int x = lpRect->MinX;
+
+		if (this->m_Simd != 0)
+		{
+			__m128 vyl = _mm_set1_ps(yl * yl);
+
+			__m128 vrange = _mm_set1_ps(range);
+
+			__m128 vr = _mm_set1_ps(lpSource->Color[0]);
+
+			__m128 vg = _mm_set1_ps(lpSource->Color[1]);
+
+			__m128 vb = _mm_set1_ps(lpSource->Color[2]);
+
+			__m128 vxf = _mm_set1_ps(xf);
+
+			__m128i offset = _mm_set_epi32(3, 2, 1, 0);
+
+			for (; (x + 4) <= lpRect->MaxX; x += 4)
+			{
+				__m128 xl = _mm_sub_ps(vxf, _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(x), offset)));
+
+				__m128 lf = _mm_div_ps(_mm_sub_ps(vrange, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(xl, xl), vyl))), vrange);
+
+				lf = _mm_max_ps(lf, _mm_setzero_ps());
+
+				_mm_storeu_ps(&cr[x], _mm_add_ps(_mm_loadu_ps(&cr[x]), _mm_mul_ps(vr, lf)));
+
+				_mm_storeu_ps(&cg[x], _mm_add_ps(_mm_loadu_ps(&cg[x]), _mm_mul_ps(vg, lf)));
+
+				_mm_storeu_ps(&cb[x], _mm_add_ps(_mm_loadu_ps(&cb[x]), _mm_mul_ps(vb, lf)));
+			}
+		}
+
+		for (; x < lpRect->MaxX; x++)
+		{
+			float xl = xf - (float)x;
+
+			float lf = (range - sqrtf((xl * xl) + (yl * yl))) / range;
+
+			if (lf > 0.0f)
+			{
+				cr[x] += lpSource->Color[0] * lf;
+				cg[x] += lpSource->Color[1] * lf;
+				cb[x] += lpSource->Color[2] * lf;
+			}
+		}
+	}
+}
+
+void CTerrainLight::MarkRect(TERRAIN_LIGHT_RECT* lpRect)
+{
+	TERRAIN_LIGHT_RECT grid = { 0, 0, TERRAIN_SIZE, TERRAIN_SIZE };
+
+	TERRAIN_LIGHT_RECT rect;
+
+	ClipLightRect(lpRect, &grid, &rect);
+
+	if (rect.MinX >= rect.MaxX || rect.MinY >= rect.MaxY)
+	{
+		return;
+	}
+
+	for (int by = (rect.MinY / TERRAIN_LIGHT_BLOCK); by <= ((rect.MaxY - 1) / TERRAIN_LIGHT_BLOCK); by++)
+	{
+		for (int bx = (rect.MinX / TERRAIN_LIGHT_BLOCK); bx <= ((rect.MaxX - 1) / TERRAIN_LIGHT_BLOCK); bx++)
+		{
+			this->m_Dirty[(by * TERRAIN_LIGHT_BLOCK_COUNT) + bx] = 1;
+		}
+	}
+}
\ No newline at end of file
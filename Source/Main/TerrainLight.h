@@ -0,0 +1,80 @@
+#pragma once
+
+#include "TerrainPackage.h"
+
+#define TERRAIN_LIGHT_BLOCK 16
+#define TERRAIN_LIGHT_BLOCK_COUNT (TERRAIN_SIZE / TERRAIN_LIGHT_BLOCK)
+#define TERRAIN_LIGHT_SCALE 100.0f
+#define TERRAIN_LIGHT_HEIGHT_SCALE 1.5f
+#define TERRAIN_LIGHT_MAX_RANGE 32
+
+struct TERRAIN_LIGHT_SOURCE
+{
+	float X; // World units
+	float Y;
+	float Color[3];
+	int Range; // Cells
+};
+
+struct TERRAIN_LIGHT_RECT
+{
+	int MinX;
+	int MinY;
+	int MaxX; // Exclusive
+	int MaxY;
+};
+
+class CTerrainLight
+{
+public:
+
+	CTerrainLight();
+
+	~CTerrainLight();
+
+	void Build(BYTE* height, BYTE* light, bool simd);
+
+	void BuildRect(TERRAIN_LIGHT_RECT* lpRect);
+
+	void SetLights(TERRAIN_LIGHT_SOURCE* lpSource, int count);
+
+	DWORD Update();
+
+	void UpdateAll();
+
+	void UpdateRect(TERRAIN_LIGHT_RECT* lpRect);
+
+	void GetNormal(int x, int y, float* normal);
+
+	void GetColor(int x, int y, float* color);
+
+	float* GetChannel(int channel);
+
+	static void GetSourceRect(TERRAIN_LIGHT_SOURCE* lpSource, TERRAIN_LIGHT_RECT* lpRect);
+
+private:
+
+	void BuildRow(int y, int MinX, int MaxX);
+
+	void AddSource(TERRAIN_LIGHT_SOURCE* lpSource, TERRAIN_LIGHT_RECT* lpRect);
+
+	void MarkRect(TERRAIN_LIGHT_RECT* lpRect);
+
+private:
+
+	BYTE* m_Height;
+
+	BYTE* m_Light; // RGB, 0 when the world has no light map
+
+	bool m_Simd;
+
+	std::vector<float> m_Normal[3];
+
+	std::vector<float> m_Static[3];
+
+	std::vector<float> m_Color[3];
+
+	std::vector<TERRAIN_LIGHT_SOURCE> m_Source;
+
+	BYTE m_Dirty[TERRAIN_LIGHT_BLOCK_COUNT * TERRAIN_LIGHT_BLOCK_COUNT];
+};
\ No newline at end of file
@@ -0,0 +1,375 @@
+#include "stdafx.h"
+#include "TerrainPackage.h"
+#include "FileCrypt.h"
+
+static DWORD AlignTerrainOffset(DWORD offset)
+{
+	return ((offset + (TERRAIN_PACKAGE_ALIGN - 1)) & ~(TERRAIN_PACKAGE_ALIGN - 1));
+}
+
+CTerrainPackage::CTerrainPackage()
+{
+	this->m_Header = 0;
+}
+
+CTerrainPackage::~CTerrainPackage()
+{
+	this->Close();
+}
+
+bool CTerrainPackage::Open(char* directory, int world)
+{
+	this->Close();
+
+	char path[MAX_PATH];
+
+	wsprintf(path, "%s\\%s", directory, TERRAIN_PACKAGE_NAME);
+
+	if (this->m_File.Open(path) == 0)
+	{
+		return false;
+	}
+
+	DWORD FileSize = this->m_File.GetSize();
+
+	this->m_Header = (TERRAIN_PACKAGE_HEADER*)this->m_File.GetData();
+
+	if (FileSize < sizeof(TERRAIN_PACKAGE_HEADER) || this->m_Header->Magic != TERRAIN_PACKAGE_MAGIC || this->m_Header->Version != TERRAIN_PACKAGE_VERSION || this->m_Header->Size != TERRAIN_SIZE)
+	{
+		this->Close();
+
+		return false;
+	}
+
+	// Size and write time of the sources are enough to catch a patched world without reading the files again
+	TERRAIN_PACKAGE_SOURCE source[TERRAIN_SOURCE_MAX];
+
+	CTerrainPackage::GetSourceStamp(directory, world, source);
+
+	if (memcmp(source, this->m_Header->Source, sizeof(source)) != 0)
+	{
+		this->Close();
+
+		return false;
+	}
+
+	for (int n = 0; n < TERRAIN_CHUNK_MAX; n++)
+	{
+		TERRAIN_PACKAGE_CHUNK* lpChunk = &this->m_Header->Chunk[n];
+
+		if ((lpChunk->Size != 0 && lpChunk->Size != CTerrainPackage::GetChunkCapacity(n)) || lpChunk->Offset > FileSize || lpChunk->Size > (FileSize - lpChunk->Offset))
+		{
+			this->Close();
+
+			return false;
+		}
+	}
+
+	if (this->m_Header->Chunk[TERRAIN_CHUNK_ATTRIBUTE].Size == 0 || this->m_Header->Chunk[TERRAIN_CHUNK_HEIGHT].Size == 0)
+	{
+		this->Close();
+
+		return false;
+	}
+
+	return true;
+}
+
+bool CTerrainPackage::Load(char* directory, int world, CTextureDecoder* lpDecoder, CTextureBufferPool* lpPool)
+{
+	if (this->Open(directory, world) != 0)
+	{
+		return true;
+	}
+
+	// First visit or patched sources, the package is rebuilt once and mapped from then on
+	if (CTerrainPackage::Cook(directory, world, lpDecoder, lpPool) == 0)
+	{
+		return false;
+	}
+
+	return this->Open(directory, world);
+}
+
+void CTerrainPackage::Close()
+{
+	this->m_File.Close();
+
+	this->m_Header = 0;
+}
+
+bool CTerrainPackage::IsOpen()
+{
+	return (this->m_Header != 0);
+}
+
+BYTE* CTerrainPackage::GetChunk(int chunk)
+{
+	if (this->m_Header == 0 || chunk < 0 || chunk >= TERRAIN_CHUNK_MAX || this->m_Header->Chunk[chunk].Size == 0)
+	{
+		return 0;
+	}
+
+	return (this->m_File.GetData() + this->m_Header->Chunk[chunk].Offset);
+}
+
+DWORD CTerrainPackage::GetChunkSize(int chunk)
+{
+	if (this->m_Header == 0 || chunk < 0 || chunk >= TERRAIN_CHUNK_MAX)
+	{
+		return 0;
+	}
+
+	return this->m_Header->Chunk[chunk].Size;
+}
+
+DWORD CTerrainPackage::GetFileSize()
+{
+	return ((this->m_Header != 0) ? this->m_File.GetSize() : 0);
+}
+
+bool CTerrainPackage::Cook(char* directory, int world, CTextureDecoder* lpDecoder, CTextureBufferPool* lpPool)
+{
+	TERRAIN_PACKAGE_HEADER header;
+
+	memset(&header, 0, sizeof(header));
+
+	header.Magic = TERRAIN_PACKAGE_MAGIC;
+
+	header.Version = TERRAIN_PACKAGE_VERSION;
+
+	header.Size = TERRAIN_SIZE;
+
+	// The stamp is taken before reading so a file patched meanwhile leaves the package stale instead of wrong
+	CTerrainPackage::GetSourceStamp(directory, world, header.Source);
+
+	TERRAIN_DATA source;
+
+	if (CTerrainPackage::LoadSource(directory, world, lpDecoder, lpPool, &source) == 0)
+	{
+		return false;
+	}
+
+	DWORD offset = AlignTerrainOffset(sizeof(TERRAIN_PACKAGE_HEADER));
+
+	for (int n = 0; n < TERRAIN_CHUNK_MAX; n++)
+	{
+		header.Chunk[n].Offset = ((source.Chunk[n].empty() == 0) ? offset : 0);
+
+		header.Chunk[n].Size = source.Chunk[n].size();
+
+		offset = AlignTerrainOffset(offset + header.Chunk[n].Size);
+	}
+
+	std::vector<BYTE> data(offset, 0);
+
+	memcpy(&data[0], &header, sizeof(header));
+
+	for (int n = 0; n < TERRAIN_CHUNK_MAX; n++)
+	{
+		if (source.Chunk[n].empty() == 0)
+		{
+			memcpy(&data[header.Chunk[n].Offset], &source.Chunk[n][0], header.Chunk[n].Size);
+		}
+	}
+
+	char path[MAX_PATH];
+
+	wsprintf(path, "%s\\%s", directory, TERRAIN_PACKAGE_NAME);
+
+	char temp[MAX_PATH];
+
+	wsprintf(temp, "%s.tmp", path);
+
+	HANDLE handle = CreateFile(temp, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_ARCHIVE, 0);
+
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	DWORD OutSize = 0;
+
+	if (WriteFile(handle, &data[0], data.size(), &OutSize, 0) == 0 || OutSize != data.size())
+	{
+		CloseHandle(handle);
+		DeleteFile(temp);
+		return false;
+	}
+
+	CloseHandle(handle);
+
+	if (MoveFileEx(temp, path, MOVEFILE_REPLACE_EXISTING) == 0)
+	{
+		DeleteFile(temp);
+		return false;
+	}
+
+	return true;
+}
+
+bool CTerrainPackage::LoadSource(char* directory, int world, CTextureDecoder* lpDecoder, CTextureBufferPool* lpPool, TERRAIN_DATA* lpData)
+{
+	// Same work the client does on every map change, one read and decode per file
+	for (int n = 0; n < TERRAIN_CHUNK_MAX; n++)
+	{
+		lpData->Chunk[n].clear();
+	}
+
+	char path[MAX_PATH];
+
+	std::vector<BYTE> file;
+
+	CTerrainPackage::GetSourcePath(directory, world, TERRAIN_SOURCE_ATTRIBUTE, path);
+
+	if (CTerrainPackage::ReadSource(path, file) == 0 || file.size() < (TERRAIN_ATT_PREFIX + TERRAIN_CELL_COUNT))
+	{
+		return false;
+	}
+
+	BuxConvert(&file[0], file.size());
+
+	if (file[1] != (TERRAIN_SIZE - 1) || file[2] != (TERRAIN_SIZE - 1))
+	{
+		return false;
+	}
+
+	lpData->Chunk[TERRAIN_CHUNK_ATTRIBUTE].assign((file.begin() + TERRAIN_ATT_PREFIX), (file.begin() + TERRAIN_ATT_PREFIX + TERRAIN_CELL_COUNT));
+
+	CTerrainPackage::GetSourcePath(directory, world, TERRAIN_SOURCE_HEIGHT, path);
+
+	// Heights sit at the fixed offset of a 256 color bitmap, some worlds ship with a blank bitmap header so it is not parsed
+	if (CTerrainPackage::ReadSource(path, file) == 0 || file.size() < (TERRAIN_OZB_OFFSET + TERRAIN_CELL_COUNT))
+	{
+		return false;
+	}
+
+	BYTE* height = &file[TERRAIN_OZB_OFFSET];
+
+	lpData->Chunk[TERRAIN_CHUNK_HEIGHT].assign(height, (height + TERRAIN_CELL_COUNT));
+
+	// Some worlds ship without a tile map or a light map, the client keeps its defaults for them
+	CTerrainPackage::GetSourcePath(directory, world, TERRAIN_SOURCE_MAP, path);
+
+	if (CTerrainPackage::ReadSource(path, file) != 0 && file.size() >= (TERRAIN_MAP_PREFIX + (TERRAIN_CELL_COUNT * 3)))
+	{
+		for (int n = 0; n < 3; n++)
+		{
+			BYTE* layer = &file[TERRAIN_MAP_PREFIX + (TERRAIN_CELL_COUNT * n)];
+
+			lpData->Chunk[TERRAIN_CHUNK_LAYER1 + n].assign(layer, (layer + TERRAIN_CELL_COUNT));
+		}
+	}
+
+	CTerrainPackage::GetSourcePath(directory, world, TERRAIN_SOURCE_LIGHT, path);
+
+	TEXTURE_IMAGE image;
+
+	if (lpDecoder->Decode(path, lpPool, &image) != 0)
+	{
+		if (image.Width == TERRAIN_SIZE && image.Height == TERRAIN_SIZE)
+		{
+			std::vector<BYTE>* lpLight = &lpData->Chunk[TERRAIN_CHUNK_LIGHT];
+
+			lpLight->resize(TERRAIN_CELL_COUNT * 3);
+
+			for (int n = 0; n < TERRAIN_CELL_COUNT; n++)
+			{
+				(*lpLight)[(n * 3) + 0] = image.Data[(n * 4) + 0];
+				(*lpLight)[(n * 3) + 1] = image.Data[(n * 4) + 1];
+				(*lpLight)[(n * 3) + 2] = image.Data[(n * 4) + 2];
+			}
+		}
+
+		lpPool->Free(image.Data, image.Capacity);
+	}
+
+	return true;
+}
+
+void CTerrainPackage::GetSourcePath(char* directory, int world, int source, char* path)
+{
+	switch (source)
+	{
+		case TERRAIN_SOURCE_ATTRIBUTE:
+			wsprintf(path, "%s\\Terrain%d.att", directory, world);
+			break;
+		case TERRAIN_SOURCE_MAP:
+			wsprintf(path, "%s\\Terrain%d.map", directory, world);
+			if (GetFileAttributes(path) == INVALID_FILE_ATTRIBUTES)
+			{
+				wsprintf(path, "%s\\Terrain.map", directory);
+			}
+			break;
+		case TERRAIN_SOURCE_HEIGHT:
+			wsprintf(path, "%s\\TerrainHeight.OZB", directory);
+			break;
+		case TERRAIN_SOURCE_LIGHT:
+			wsprintf(path, "%s\\TerrainLight.OZJ", directory);
+			break;
+		default:
+			path[0] = 0;
+			break;
+	}
+}
+
+DWORD CTerrainPackage::GetChunkCapacity(int chunk)
+{
+	return ((chunk == TERRAIN_CHUNK_LIGHT) ? (TERRAIN_CELL_COUNT * 3) : TERRAIN_CELL_COUNT);
+}
+
+void CTerrainPackage::GetSourceStamp(char* directory, int world, TERRAIN_PACKAGE_SOURCE* lpSource)
+{
+	memset(lpSource, 0, (sizeof(TERRAIN_PACKAGE_SOURCE) * TERRAIN_SOURCE_MAX));
+
+	for (int n = 0; n < TERRAIN_SOURCE_MAX; n++)
+	{
+		char path[MAX_PATH];
+
+		CTerrainPackage::GetSourcePath(directory, world, n, path);
+
+		WIN32_FILE_ATTRIBUTE_DATA data;
+
+		if (GetFileAttributesEx(path, GetFileExInfoStandard, &data) != 0)
+		{
+			lpSource[n].Size = data.nFileSizeLow;
+
+			lpSource[n].WriteTime = data.ftLastWriteTime;
+		}
+	}
+}
+
+bool CTerrainPackage::ReadSource(char* path, std::vector<BYTE>& data)
+{
+	data.clear();
+
+	HANDLE handle = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_ARCHIVE, 0);
+
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	DWORD size = ::GetFileSize(handle, 0);
+
+	if (size == 0 || size == INVALID_FILE_SIZE)
+	{
+		CloseHandle(handle);
+		return false;
+	}
+
+	data.resize(size);
+
+	DWORD InSize = 0;
+
+	if (ReadFile(handle, &data[0], size, &InSize, 0) == 0 || InSize != size)
+	{
+		CloseHandle(handle);
+		data.clear();
+		return false;
+	}
+
+	CloseHandle(handle);
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "TextureDecoder.h"
+
+#define TERRAIN_SIZE 256
+#define TERRAIN_CELL_COUNT (TERRAIN_SIZE * TERRAIN_SIZE)
+#define TERRAIN_MAX_WORLD 64
+#define TERRAIN_PACKAGE_MAGIC 0x4E525442 // "BTRN"
+#define TERRAIN_PACKAGE_VERSION 1
+#define TERRAIN_PACKAGE_NAME "Terrain.btp"
+#define TERRAIN_PACKAGE_ALIGN 16
+#define TERRAIN_ATT_PREFIX 3
+#define TERRAIN_MAP_PREFIX 1
+#define TERRAIN_OZB_OFFSET (4 + 14 + 40 + 1024)
+
+enum eTerrainSource
+{
+	TERRAIN_SOURCE_ATTRIBUTE = 0,
+	TERRAIN_SOURCE_MAP = 1,
+	TERRAIN_SOURCE_HEIGHT = 2,
+	TERRAIN_SOURCE_LIGHT = 3,
+	TERRAIN_SOURCE_MAX = 4,
+};
+
+enum eTerrainChunk
+{
+	TERRAIN_CHUNK_ATTRIBUTE = 0,
+	TERRAIN_CHUNK_HEIGHT = 1,
+	TERRAIN_CHUNK_LAYER1 = 2,
+	TERRAIN_CHUNK_LAYER2 = 3,
+	TERRAIN_CHUNK_ALPHA = 4,
+	TERRAIN_CHUNK_LIGHT = 5,
+	TERRAIN_CHUNK_MAX = 6,
+};
+
+struct TERRAIN_PACKAGE_SOURCE
+{
+	DWORD Size;
+	FILETIME WriteTime;
+};
+
+struct TERRAIN_PACKAGE_CHUNK
+{
+	DWORD Offset;
+	DWORD Size;
+};
+
+struct TERRAIN_PACKAGE_HEADER
+{
+	DWORD Magic;
+	WORD Version;
+	WORD Size;
+	TERRAIN_PACKAGE_SOURCE Source[TERRAIN_SOURCE_MAX];
+	TERRAIN_PACKAGE_CHUNK Chunk[TERRAIN_CHUNK_MAX];
+};
+
+struct TERRAIN_DATA
+{
+	std::vector<BYTE> Chunk[TERRAIN_CHUNK_MAX]; // Empty when the world has no such file
+};
+
+class CTerrainPackage
+{
+public:
+
+	CTerrainPackage();
+
+	~CTerrainPackage();
+
+	bool Open(char* directory, int world);
+
+	bool Load(char* directory, int world, CTextureDecoder* lpDecoder, CTextureBufferPool* lpPool);
+
+	void Close();
+
+	bool IsOpen();
+
+	BYTE* GetChunk(int chunk);
+
+	DWORD GetChunkSize(int chunk);
+
+	DWORD GetFileSize();
+
+	static bool Cook(char* directory, int world, CTextureDecoder* lpDecoder, CTextureBufferPool* lpPool);
+
+	static bool LoadSource(char* directory, int world, CTextureDecoder* lpDecoder, CTextureBufferPool* lpPool, TERRAIN_DATA* lpData);
+
+	static void GetSourcePath(char* directory, int world, int source, char* path);
+
+	static DWORD GetChunkCapacity(int chunk);
+
+private:
+
+	static void GetSourceStamp(char* directory, int world, TERRAIN_PACKAGE_SOURCE* lpSource);
+
+	static bool ReadSource(char* path, std::vector<BYTE>& data);
+
+private:
+
+	CMappedFile m_File;
+
+	TERRAIN_PACKAGE_HEADER* m_Header;
+};
\ No newline at end of file
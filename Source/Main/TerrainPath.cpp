@@ -0,0 +1,888 @@
+#include "stdafx.h"
+#include "TerrainPath.h"
+#include <intrin.h>
+
+static int PathDirection[8][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 }, { 1, 1 }, { -1, 1 }, { 1, -1 }, { -1, -1 } };
+
+static bool TestBit(QWORD* row, int x)
+{
+	return (((row[x >> 6] >> (x & 63)) & 1) != 0);
+}
+
+static void SetBit(QWORD* row, int x)
+{
+	row[x >> 6] |= ((QWORD)1 << (x & 63));
+}
+
+static int GetSign(int value)
+{
+	return ((value > 0) ? 1 : ((value < 0) ? -1 : 0));
+}
+
+CTerrainPath::CTerrainPath()
+{
+	memset(&this->m_Walkable, 0, sizeof(this->m_Walkable));
+
+	memset(&this->m_SafeZone, 0, sizeof(this->m_SafeZone));
+
+	memset(&this->m_NoMove, 0, sizeof(this->m_NoMove));
+
+	memset(&this->m_WalkableColumn, 0, sizeof(this->m_WalkableColumn));
+
+	memset(this->m_ForcedRow, 0, sizeof(this->m_ForcedRow));
+
+	memset(this->m_ForcedColumn, 0, sizeof(this->m_ForcedColumn));
+
+	// Arenas are sized for the whole map once, a search only bumps the generation counter
+	TERRAIN_PATH_NODE node;
+
+	memset(&node, 0, sizeof(node));
+
+	this->m_Node.assign(TERRAIN_CELL_COUNT, node);
+
+	this->m_Heap.assign(TERRAIN_CELL_COUNT, 0);
+
+	this->m_HeapSize = 0;
+
+	this->m_Search = 0;
+
+	this->m_Expanded = 0;
+
+	this->m_LastCost = -1;
+}
+
+CTerrainPath::~CTerrainPath()
+{
+
+}
+
+void CTerrainPath::Build(BYTE* attribute)
+{
+	memset(&this->m_Walkable, 0, sizeof(this->m_Walkable));
+
+	memset(&this->m_SafeZone, 0, sizeof(this->m_SafeZone));
+
+	memset(&this->m_NoMove, 0, sizeof(this->m_NoMove));
+
+	memset(&this->m_WalkableColumn, 0, sizeof(this->m_WalkableColumn));
+
+	for (int y = 0; y < TERRAIN_SIZE; y++)
+	{
+		for (int x = 0; x < TERRAIN_SIZE; x++)
+		{
+			BYTE value = attribute[(y * TERRAIN_SIZE) + x];
+
+			if ((value & TERRAIN_ATTRIBUTE_SAFEZONE) != 0)
+			{
+				SetBit(this->m_SafeZone.Row[y], x);
+			}
+
+			if ((value & TERRAIN_ATTRIBUTE_NOMOVE) != 0)
+			{
+				SetBit(this->m_NoMove.Row[y], x);
+			}
+
+			if ((value & (TERRAIN_ATTRIBUTE_NOMOVE | TERRAIN_ATTRIBUTE_NOGROUND)) == 0)
+			{
+				SetBit(this->m_Walkable.Row[y], x);
+
+				SetBit(this->m_WalkableColumn.Row[x], y);
+			}
+		}
+	}
+
+	CTerrainPath::BuildForced(&this->m_Walkable, &this->m_ForcedRow[0], &this->m_ForcedRow[1]);
+
+	CTerrainPath::BuildForced(&this->m_WalkableColumn, &this->m_ForcedColumn[0], &this->m_ForcedColumn[1]);
+
+	this->m_LastCost = -1;
+}
+
+bool CTerrainPath::IsWalkable(int x, int y)
+{
+	if (x < 0 || x >= TERRAIN_SIZE || y < 0 || y >= TERRAIN_SIZE)
+	{
+		return false;
+	}
+
+	return TestBit(this->m_Walkable.Row[y], x);
+}
+
+bool CTerrainPath::IsSafeZone(int x, int y)
+{
+	if (x < 0 || x >= TERRAIN_SIZE || y < 0 || y >= TERRAIN_SIZE)
+	{
+		return false;
+	}
+
+	return TestBit(this->m_SafeZone.Row[y], x);
+}
+
+bool CTerrainPath::IsNoMove(int x, int y)
+{
+	if (x < 0 || x >= TERRAIN_SIZE || y < 0 || y >= TERRAIN_SIZE)
+	{
+		return true;
+	}
+
+	return TestBit(this->m_NoMove.Row[y], x);
+}
+
+bool CTerrainPath::FindPath(int x1, int y1, int x2, int y2, std::vector<TERRAIN_PATH_POINT>& path)
+{
+	// Jump point search with the no corner cutting rule, straight runs are resolved with bit scans over the row and column boards
+	if (this->BeginSearch(x1, y1, x2, y2) == 0)
+	{
+		path.clear();
+
+		return (this->m_LastCost == 0);
+	}
+
+	int goal = (y2 * TERRAIN_SIZE) + x2;
+
+	int index;
+
+	while ((index = this->PopNode()) >= 0)
+	{
+		TERRAIN_PATH_NODE* lpNode = &this->m_Node[index];
+
+		lpNode->Closed = 1;
+
+		this->m_Expanded++;
+
+		if (index == goal)
+		{
+			this->m_LastCost = lpNode->Cost;
+
+			return this->BuildPath(x1, y1, x2, y2, path);
+		}
+
+		int x = index % TERRAIN_SIZE;
+
+		int y = index / TERRAIN_SIZE;
+
+		int direction[8][2];
+
+		int count = 0;
+
+		if (lpNode->Parent == index)
+		{
+			for (int n = 0; n < 8; n++)
+			{
+				direction[count][0] = PathDirection[n][0];
+				direction[count][1] = PathDirection[n][1];
+				count++;
+			}
+		}
+		else
+		{
+			int dx = GetSign(x - (lpNode->Parent % TERRAIN_SIZE));
+
+			int dy = GetSign(y - (lpNode->Parent / TERRAIN_SIZE));
+
+			if (dx != 0 && dy != 0)
+			{
+				direction[count][0] = 0; direction[count][1] = dy; count++;
+				direction[count][0] = dx; direction[count][1] = 0; count++;
+				direction[count][0] = dx; direction[count][1] = dy; count++;
+			}
+			else if (dx != 0)
+			{
+				direction[count][0] = dx; direction[count][1] = 0; count++;
+				direction[count][0] = 0; direction[count][1] = 1; count++;
+				direction[count][0] = 0; direction[count][1] = -1; count++;
+				direction[count][0] = dx; direction[count][1] = 1; count++;
+				direction[count][0] = dx; direction[count][1] = -1; count++;
+			}
+			else
+			{
+				direction[count][0] = 0; direction[count][1] = dy; count++;
+				direction[count][0] = 1; direction[count][1] = 0; count++;
+				direction[count][0] = -1; direction[count][1] = 0; count++;
+				direction[count][0] = 1; direction[count][1] = dy; count++;
+				direction[count][0] = -1; direction[count][1] = dy; count++;
+			}
+		}
+
+		for (int n = 0; n < count; n++)
+		{
+			int dx = direction[n][0];
+
+			int dy = direction[n][1];
+
+			if (dx != 0 && dy != 0 && (this->IsWalkable((x + dx), y) == 0 || this->IsWalkable(x, (y + dy)) == 0))
+			{
+				continue;
+			}
+
+			int jump = this->Jump((x + dx), (y + dy), dx, dy, x2, y2);
+
+			if (jump < 0)
+			{
+				continue;
+			}
+
+			int cost = lpNode->Cost + CTerrainPath::GetHeuristic(x, y, (jump % TERRAIN_SIZE), (jump / TERRAIN_SIZE));
+
+			this->OpenNode(jump, index, cost, x2, y2);
+		}
+	}
+
+	path.clear();
+
+	return false;
+}
+
+bool CTerrainPath::FindPathReference(int x1, int y1, int x2, int y2, std::vector<TERRAIN_PATH_POINT>& path)
+{
+	// Plain A* over the eight neighbours, kept to check the jump point search against
+	if (this->BeginSearch(x1, y1, x2, y2) == 0)
+	{
+		path.clear();
+
+		return (this->m_LastCost == 0);
+	}
+
+	int goal = (y2 * TERRAIN_SIZE) + x2;
+
+	int index;
+
+	while ((index = this->PopNode()) >= 0)
+	{
+		TERRAIN_PATH_NODE* lpNode = &this->m_Node[index];
+
+		lpNode->Closed = 1;
+
+		this->m_Expanded++;
+
+		if (index == goal)
+		{
+			this->m_LastCost = lpNode->Cost;
+
+			return this->BuildPath(x1, y1, x2, y2, path);
+		}
+
+		int x = index % TERRAIN_SIZE;
+
+		int y = index / TERRAIN_SIZE;
+
+		for (int n = 0; n < 8; n++)
+		{
+			int dx = PathDirection[n][0];
+
+			int dy = PathDirection[n][1];
+
+			if (this->IsWalkable((x + dx), (y + dy)) == 0)
+			{
+				continue;
+			}
+
+			if (dx != 0 && dy != 0 && (this->IsWalkable((x + dx), y) == 0 || this->IsWalkable(x, (y + dy)) == 0))
+			{
+				continue;
+			}
+
+			int cost = lpNode->Cost + ((dx != 0 && dy != 0) ? TERRAIN_PATH_COST_DIAGONAL : TERRAIN_PATH_COST_STRAIGHT);
+
+			this->OpenNode((((y + dy) * TERRAIN_SIZE) + (x + dx)), index, cost, x2, y2);
+		}
+	}
+
+	path.clear();
+
+	return false;
+}
+
+bool CTerrainPath::LineOfSight(int x1, int y1, int x2, int y2)
+{
+	if (this->IsWalkable(x1, y1) == 0 || this->IsWalkable(x2, y2) == 0)
+	{
+		return false;
+	}
+
+	if (y1 == y2)
+	{
+		return this->IsRowClear(y1, ((x1 < x2) ? x1 : x2), ((x1 < x2) ? x2 : x1));
+	}
+
+	if (x1 == x2)
+	{
+		return this->IsColumnClear(x1, ((y1 < y2) ? y1 : y2), ((y1 < y2) ? y2 : y1));
+	}
+
+	int dx = abs(x2 - x1);
+
+	int dy = abs(y2 - y1);
+
+	int sx = GetSign(x2 - x1);
+
+	int sy = GetSign(y2 - y1);
+
+	int error = dx - dy;
+
+	int x = x1;
+
+	int y = y1;
+
+	while (x != x2 || y != y2)
+	{
+		int nx = x;
+
+		int ny = y;
+
+		int e2 = error * 2;
+
+		if (e2 > -dy)
+		{
+			error -= dy;
+			nx += sx;
+		}
+
+		if (e2 < dx)
+		{
+			error += dx;
+			ny += sy;
+		}
+
+		if (this->IsWalkable(nx, ny) == 0)
+		{
+			return false;
+		}
+
+		// Diagonal steps follow the same corner rule as movement
+		if (nx != x && ny != y && (this->IsWalkable(nx, y) == 0 || this->IsWalkable(x, ny) == 0))
+		{
+			return false;
+		}
+
+		x = nx;
+
+		y = ny;
+	}
+
+	return true;
+}
+
+int CTerrainPath::GetLastCost()
+{
+	return this->m_LastCost;
+}
+
+DWORD CTerrainPath::GetLastExpanded()
+{
+	return this->m_Expanded;
+}
+
+bool CTerrainPath::BeginSearch(int x1, int y1, int x2, int y2)
+{
+	this->m_HeapSize = 0;
+
+	this->m_Expanded = 0;
+
+	this->m_LastCost = -1;
+
+	if (this->IsWalkable(x1, y1) == 0 || this->IsWalkable(x2, y2) == 0)
+	{
+		return false;
+	}
+
+	if (x1 == x2 && y1 == y2)
+	{
+		this->m_LastCost = 0;
+
+		return false;
+	}
+
+	this->m_Search++;
+
+	if (this->m_Search == 0)
+	{
+		for (size_t n = 0; n < this->m_Node.size(); n++)
+		{
+			this->m_Node[n].Search = 0;
+		}
+
+		this->m_Search = 1;
+	}
+
+	int start = (y1 * TERRAIN_SIZE) + x1;
+
+	this->OpenNode(start, start, 0, x2, y2);
+
+	return true;
+}
+
+bool CTerrainPath::BuildPath(int x1, int y1, int x2, int y2, std::vector<TERRAIN_PATH_POINT>& path)
+{
+	path.clear();
+
+	int start = (y1 * TERRAIN_SIZE) + x1;
+
+	int index = (y2 * TERRAIN_SIZE) + x2;
+
+	// Jump points are walked back from the goal, the straight runs between them are filled in going forward
+	std::vector<int> jump;
+
+	jump.push_back(index);
+
+	while (index != start)
+	{
+		index = this->m_Node[index].Parent;
+
+		jump.push_back(index);
+	}
+
+	TERRAIN_PATH_POINT point;
+
+	point.X = x1;
+
+	point.Y = y1;
+
+	path.push_back(point);
+
+	for (int n = (int)jump.size() - 2; n >= 0; n--)
+	{
+		int x = jump[n] % TERRAIN_SIZE;
+
+		int y = jump[n] / TERRAIN_SIZE;
+
+		int sx = GetSign(x - point.X);
+
+		int sy = GetSign(y - point.Y);
+
+		while (point.X != x || point.Y != y)
+		{
+			point.X += sx;
+
+			point.Y += sy;
+
+			path.push_back(point);
+		}
+	}
+
+	return true;
+}
+
+void CTerrainPath::OpenNode(int index, int parent, int cost, int x2, int y2)
+{
+	TERRAIN_PATH_NODE* lpNode = &this->m_Node[index];
+
+	if (lpNode->Search != this->m_Search)
+	{
+		lpNode->Search = this->m_Search;
+
+		lpNode->Closed = 0;
+
+		lpNode->Cost = cost;
+
+		lpNode->Score = cost + CTerrainPath::GetHeuristic((index % TERRAIN_SIZE), (index / TERRAIN_SIZE), x2, y2);
+
+		lpNode->Parent = parent;
+
+		lpNode->HeapIndex = this->m_HeapSize;
+
+		this->m_Heap[this->m_HeapSize++] = index;
+
+		this->HeapUp(lpNode->HeapIndex);
+
+		return;
+	}
+
+	if (lpNode->Closed != 0 || cost >= lpNode->Cost)
+	{
+		return;
+	}
+
+	lpNode->Score -= (lpNode->Cost - cost);
+
+	lpNode->Cost = cost;
+
+	lpNode->Parent = parent;
+
+	this->HeapUp(lpNode->HeapIndex);
+}
+
+int CTerrainPath::PopNode()
+{
+	if (this->m_HeapSize == 0)
+	{
+		return -1;
+	}
+
+	int index = this->m_Heap[0];
+
+	this->m_HeapSize--;
+
+	if (this->m_HeapSize > 0)
+	{
+		this->m_Heap[0] = this->m_Heap[this->m_HeapSize];
+
+		this->m_Node[this->m_Heap[0]].HeapIndex = 0;
+
+		this->HeapDown(0);
+	}
+
+	return index;
+}
+
+void CTerrainPath::HeapUp(DWORD position)
+{
+	DWORD index = this->m_Heap[position];
+
+	TERRAIN_PATH_NODE* lpNode = &this->m_Node[index];
+
+	while (position > 0)
+	{
+		DWORD parent = (position - 1) / 2;
+
+		TERRAIN_PATH_NODE* lpParent = &this->m_Node[this->m_Heap[parent]];
+
+		// Ties go to the deeper node so searches run straight at the goal
+		if (lpParent->Score < lpNode->Score || (lpParent->Score == lpNode->Score && lpParent->Cost >= lpNode->Cost))
+		{
+			break;
+		}
+
+		this->m_Heap[position] = this->m_Heap[parent];
+
+		lpParent->HeapIndex = position;
+
+		position = parent;
+	}
+
+	this->m_Heap[position] = index;
+
+	lpNode->HeapIndex = position;
+}
+
+void CTerrainPath::HeapDown(DWORD position)
+{
+	DWORD index = this->m_Heap[position];
+
+	TERRAIN_PATH_NODE* lpNode = &this->m_Node[index];
+
+	while (true)
+	{
+		DWORD child = (position * 2) + 1;
+
+		if (child >= this->m_HeapSize)
+		{
+			break;
+		}
+
+		TERRAIN_PATH_NODE* lpChild = &this->m_Node[this->m_Heap[child]];
+
+		if ((child + 1) < this->m_HeapSize)
+		{
+			TERRAIN_PATH_NODE* lpRight = &this->m_Node[this->m_Heap[child + 1]];
+
+			if (lpRight->Score < lpChild->Score || (lpRight->Score == lpChild->Score && lpRight->Cost > lpChild->Cost))
+			{
+				child++;
+
+				lpChild = lpRight;
+			}
+		}
+
+		if (lpNode->Score < lpChild->Score || (lpNode->Score == lpChild->Score && lpNode->Cost >= lpChild->Cost))
+		{
+			break;
+		}
+
+		this->m_Heap[position] = this->m_Heap[child];
+
+		lpChild->HeapIndex = position;
+
+		position = child;
+	}
+
+	this->m_Heap[position] = index;
+
+	lpNode->HeapIndex = position;
+}
+
+int CTerrainPath::JumpRow(int x, int y, int dx, int x2, int y2)
+{
+	// The run ends on the first wall, forced neighbour or the goal, whichever bit comes first
+	QWORD stop[TERRAIN_PATH_WORD];
+
+	TERRAIN_PATH_BOARD* lpForced = &this->m_ForcedRow[((dx > 0) ? 0 : 1)];
+
+	for (int n = 0; n < TERRAIN_PATH_WORD; n++)
+	{
+		stop[n] = ~this->m_Walkable.Row[y][n] | lpForced->Row[y][n];
+	}
+
+	if (y == y2)
+	{
+		SetBit(stop, x2);
+	}
+
+	int found = ((dx > 0) ? CTerrainPath::ScanForward(stop, x) : CTerrainPath::ScanReverse(stop, x));
+
+	if (found < 0 || found >= TERRAIN_SIZE || TestBit(this->m_Walkable.Row[y], found) == 0)
+	{
+		return -1;
+	}
+
+	return found;
+}
+
+int CTerrainPath::JumpColumn(int x, int y, int dy, int x2, int y2)
+{
+	QWORD stop[TERRAIN_PATH_WORD];
+
+	TERRAIN_PATH_BOARD* lpForced = &this->m_ForcedColumn[((dy > 0) ? 0 : 1)];
+
+	for (int n = 0; n < TERRAIN_PATH_WORD; n++)
+	{
+		stop[n] = ~this->m_WalkableColumn.Row[x][n] | lpForced->Row[x][n];
+	}
+
+	if (x == x2)
+	{
+		SetBit(stop, y2);
+	}
+
+	int found = ((dy > 0) ? CTerrainPath::ScanForward(stop, y) : CTerrainPath::ScanReverse(stop, y));
+
+	if (found < 0 || found >= TERRAIN_SIZE || TestBit(this->m_WalkableColumn.Row[x], found) == 0)
+	{
+		return -1;
+	}
+
+	return found;
+}
+
+int CTerrainPath::Jump(int x, int y, int dx, int dy, int x2, int y2)
+{
+	if (dx != 0 && dy != 0)
+	{
+		while (true)
+		{
+			if (this->IsWalkable(x, y) == 0)
+			{
+				return -1;
+			}
+
+			if (x == x2 && y == y2)
+			{
+				return ((y * TERRAIN_SIZE) + x);
+			}
+
+			// A diagonal cell is a jump point when one of its straight runs finds something
+			if (this->IsWalkable((x + dx), y) != 0 && this->JumpRow((x + dx), y, dx, x2, y2) >= 0)
+			{
+				return ((y * TERRAIN_SIZE) + x);
+			}
+
+			if (this->IsWalkable(x, (y + dy)) != 0 && this->JumpColumn(x, (y + dy), dy, x2, y2) >= 0)
+			{
+				return ((y * TERRAIN_SIZE) + x);
+			}
+
+			if (this->IsWalkable((x + dx), y) == 0 || this->IsWalkable(x, (y + dy)) == 0)
+			{
+				return -1;
+			}
+
+			x += dx;
+
+			y += dy;
+		}
+	}
+
+	if (x < 0 || x >= TERRAIN_SIZE || y < 0 || y >= TERRAIN_SIZE)
+	{
+		return -1;
+	}
+
+	if (dx != 0)
+	{
+		int found = this->JumpRow(x, y, dx, x2, y2);
+
+		return ((found < 0) ? -1 : ((y * TERRAIN_SIZE) + found));
+	}
+
+	int found = this->JumpColumn(x, y, dy, x2, y2);
+
+	return ((found < 0) ? -1 : ((found * TERRAIN_SIZE) + x));
+}
+
+bool CTerrainPath::IsRowClear(int y, int x1, int x2)
+{
+	QWORD* row = this->m_Walkable.Row[y];
+
+	for (int n = (x1 >> 6); n <= (x2 >> 6); n++)
+	{
+		int low = ((x1 > (n * 64)) ? (x1 - (n * 64)) : 0);
+
+		int high = ((x2 < ((n * 64) + 63)) ? (x2 - (n * 64)) : 63);
+
+		QWORD mask = ((~(QWORD)0) >> (63 - high)) & ((~(QWORD)0) << low);
+
+		if ((row[n] & mask) != mask)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool CTerrainPath::IsColumnClear(int x, int y1, int y2)
+{
+	QWORD* row = this->m_WalkableColumn.Row[x];
+
+	for (int n = (y1 >> 6); n <= (y2 >> 6); n++)
+	{
+		int low = ((y1 > (n * 64)) ? (y1 - (n * 64)) : 0);
+
+		int high = ((y2 < ((n * 64) + 63)) ? (y2 - (n * 64)) : 63);
+
+		QWORD mask = ((~(QWORD)0) >> (63 - high)) & ((~(QWORD)0) << low);
+
+		if ((row[n] & mask) != mask)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int CTerrainPath::GetHeuristic(int x1, int y1, int x2, int y2)
+{
+	int dx = abs(x2 - x1);
+
+	int dy = abs(y2 - y1);
+
+	return ((dx > dy) ? ((TERRAIN_PATH_COST_STRAIGHT * (dx - dy)) + (TERRAIN_PATH_COST_DIAGONAL * dy)) : ((TERRAIN_PATH_COST_STRAIGHT * (dy - dx)) + (TERRAIN_PATH_COST_DIAGONAL * dx)));
+}
+
+int CTerrainPath::ScanForward(QWORD* row, int x)
+{
+	if (x < 0)
+	{
+		x = 0;
+	}
+
+	for (int n = (x >> 6); n < TERRAIN_PATH_WORD; n++)
+	{
+		QWORD bits = row[n];
+
+		if (n == (x >> 6))
+		{
+			bits &= ((~(QWORD)0) << (x & 63));
+		}
+
+		if (bits == 0)
+		{
+			continue;
+		}
+
+		// 32-bit scans, the client is built for x86
+		DWORD index;
+
+		if (_BitScanForward(&index, (DWORD)bits) != 0)
+		{
+			return ((n * 64) + index);
+		}
+
+		_BitScanForward(&index, (DWORD)(bits >> 32));
+
+		return ((n * 64) + 32 + index);
+	}
+
+	return TERRAIN_SIZE;
+}
+
+int CTerrainPath::ScanReverse(QWORD* row, int x)
+{
+	if (x >= TERRAIN_SIZE)
+	{
+		x = TERRAIN_SIZE - 1;
+	}
+
+	for (int n = (x >> 6); n >= 0; n--)
+	{
+		QWORD bits = row[n];
+
+		if (n == (x >> 6))
+		{
+			bits &= ((~(QWORD)0) >> (63 - (x & 63)));
+		}
+
+		if (bits == 0)
+		{
+			continue;
+		}
+
+		DWORD index;
+
+		if (_BitScanReverse(&index, (DWORD)(bits >> 32)) != 0)
+		{
+			return ((n * 64) + 32 + index);
+		}
+
+		_BitScanReverse(&index, (DWORD)bits);
+
+		return ((n * 64) + index);
+	}
+
+	return -1;
+}
+
+void CTerrainPath::ShiftLeft(QWORD* in, QWORD* out)
+{
+	// Bit x of the output is bit x-1 of the input
+	for (int n = (TERRAIN_PATH_WORD - 1); n >= 0; n--)
+	{
+		out[n] = (in[n] << 1) | ((n > 0) ? (in[n - 1] >> 63) : 0);
+	}
+}
+
+void CTerrainPath::ShiftRight(QWORD* in, QWORD* out)
+{
+	// Bit x of the output is bit x+1 of the input
+	for (int n = 0; n < TERRAIN_PATH_WORD; n++)
+	{
+		out[n] = (in[n] >> 1) | ((n < (TERRAIN_PATH_WORD - 1)) ? (in[n + 1] << 63) : 0);
+	}
+}
+
+void CTerrainPath::BuildForced(TERRAIN_PATH_BOARD* lpWalkable, TERRAIN_PATH_BOARD* lpForward, TERRAIN_PATH_BOARD* lpBackward)
+{
+	// Moving forward a cell is a jump point when a side neighbour is open but the one behind it is not
+	memset(lpForward, 0, sizeof(TERRAIN_PATH_BOARD));
+
+	memset(lpBackward, 0, sizeof(TERRAIN_PATH_BOARD));
+
+	for (int row = 0; row < TERRAIN_SIZE; row++)
+	{
+		for (int side = -1; side <= 1; side += 2)
+		{
+			if ((row + side) < 0 || (row + side) >= TERRAIN_SIZE)
+			{
+				continue;
+			}
+
+			QWORD* open = lpWalkable->Row[row + side];
+
+			QWORD behind[TERRAIN_PATH_WORD];
+
+			QWORD ahead[TERRAIN_PATH_WORD];
+
+			CTerrainPath::ShiftLeft(open, behind);
+
+			CTerrainPath::ShiftRight(open, ahead);
+
+			for (int n = 0; n < TERRAIN_PATH_WORD; n++)
+			{
+				lpForward->Row[row][n] |= open[n] & ~behind[n];
+
+				lpBackward->Row[row][n] |= open[n] & ~ahead[n];
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "TerrainPackage.h"
+
+#define TERRAIN_ATTRIBUTE_SAFEZONE 0x01
+#define TERRAIN_ATTRIBUTE_CHARACTER 0x02
+#define TERRAIN_ATTRIBUTE_NOMOVE 0x04
+#define TERRAIN_ATTRIBUTE_NOGROUND 0x08
+
+#define TERRAIN_PATH_WORD (TERRAIN_SIZE / 64)
+#define TERRAIN_PATH_COST_STRAIGHT 10
+#define TERRAIN_PATH_COST_DIAGONAL 14
+
+struct TERRAIN_PATH_POINT
+{
+	short X;
+	short Y;
+};
+
+struct TERRAIN_PATH_BOARD
+{
+	QWORD Row[TERRAIN_SIZE][TERRAIN_PATH_WORD]; // Bit x of row y is cell (x,y)
+};
+
+struct TERRAIN_PATH_NODE
+{
+	DWORD Search;
+	DWORD HeapIndex;
+	int Cost;
+	int Score;
+	WORD Parent;
+	BYTE Closed;
+};
+
+class CTerrainPath
+{
+public:
+
+	CTerrainPath();
+
+	~CTerrainPath();
+
+	void Build(BYTE* attribute);
+
+	bool IsWalkable(int x, int y);
+
+	bool IsSafeZone(int x, int y);
+
+	bool IsNoMove(int x, int y);
+
+	bool FindPath(int x1, int y1, int x2, int y2, std::vector<TERRAIN_PATH_POINT>& path);
+
+	bool FindPathReference(int x1, int y1, int x2, int y2, std::vector<TERRAIN_PATH_POINT>& path);
+
+	bool LineOfSight(int x1, int y1, int x2, int y2);
+
+	int GetLastCost();
+
+	DWORD GetLastExpanded();
+
+private:
+
+	bool BeginSearch(int x1, int y1, int x2, int y2);
+
+	bool BuildPath(int x1, int y1, int x2, int y2, std::vector<TERRAIN_PATH_POINT>& path);
+
+	void OpenNode(int index, int parent, int cost, int x2, int y2);
+
+	int PopNode();
+
+	void HeapUp(DWORD position);
+
+	void HeapDown(DWORD position);
+
+	int JumpRow(int x, int y, int dx, int x2, int y2);
+
+	int JumpColumn(int x, int y, int dy, int x2, int y2);
+
+	int Jump(int x, int y, int dx, int dy, int x2, int y2);
+
+	bool IsRowClear(int y, int x1, int x2);
+
+	bool IsColumnClear(int x, int y1, int y2);
+
+	static int GetHeuristic(int x1, int y1, int x2, int y2);
+
+	static int ScanForward(QWORD* row, int x);
+
+	static int ScanReverse(QWORD* row, int x);
+
+	static void ShiftLeft(QWORD* in, QWORD* out);
+
+	static void ShiftRight(QWORD* in, QWORD* out);
+
+	static void BuildForced(TERRAIN_PATH_BOARD* lpWalkable, TERRAIN_PATH_BOARD* lpForward, TERRAIN_PATH_BOARD* lpBackward);
+
+private:
+
+	TERRAIN_PATH_BOARD m_Walkable;
+
+	TERRAIN_PATH_BOARD m_SafeZone;
+
+	TERRAIN_PATH_BOARD m_NoMove;
+
+	TERRAIN_PATH_BOARD m_WalkableColumn; // Transposed, bit y of row x is cell (x,y)
+
+	TERRAIN_PATH_BOARD m_ForcedRow[2]; // Jump points when moving +x and -x along a row
+
+	TERRAIN_PATH_BOARD m_ForcedColumn[2]; // Jump points when moving +y and -y along a column
+
+	std::vector<TERRAIN_PATH_NODE> m_Node;
+
+	std::vector<DWORD> m_Heap;
+
+	DWORD m_HeapSize;
+
+	DWORD m_Search;
+
+	DWORD m_Expanded;
+
+	int m_LastCost;
+};
\ No newline at end of file
@@ -0,0 +1,394 @@
+#include "stdafx.h"
+#include "TerrainPick.h"
+
+#define TERRAIN_PICK_EPSILON 0.0001
+
+CTerrainPick::CTerrainPick()
+{
+	this->m_Height = 0;
+
+	this->m_Attribute = 0;
+
+	this->m_StepCount = 0;
+}
+
+CTerrainPick::~CTerrainPick()
+{
+
+}
+
+void CTerrainPick::Build(BYTE* height, BYTE* attribute)
+{
+	// Both grids have to stay alive while the world is loaded, the mapped terrain package does
+	this->m_Height = height;
+
+	this->m_Attribute = attribute;
+
+	this->m_Level[0].resize(TERRAIN_CELL_COUNT);
+
+	for (int y = 0; y < TERRAIN_SIZE; y++)
+	{
+		for (int x = 0; x < TERRAIN_SIZE; x++)
+		{
+			// The last row and column have no cell past them, they can never be hit
+			if (x == (TERRAIN_SIZE - 1) || y == (TERRAIN_SIZE - 1))
+			{
+				this->m_Level[0][(y * TERRAIN_SIZE) + x] = TERRAIN_PICK_NONE;
+				continue;
+			}
+
+			BYTE top = height[(y * TERRAIN_SIZE) + x];
+
+			top = ((height[(y * TERRAIN_SIZE) + x + 1] > top) ? height[(y * TERRAIN_SIZE) + x + 1] : top);
+
+			top = ((height[((y + 1) * TERRAIN_SIZE) + x] > top) ? height[((y + 1) * TERRAIN_SIZE) + x] : top);
+
+			top = ((height[((y + 1) * TERRAIN_SIZE) + x + 1] > top) ? height[((y + 1) * TERRAIN_SIZE) + x + 1] : top);
+
+			this->m_Level[0][(y * TERRAIN_SIZE) + x] = top * TERRAIN_PICK_HEIGHT_SCALE;
+		}
+	}
+
+	for (int level = 1; level < TERRAIN_PICK_LEVEL; level++)
+	{
+		int size = TERRAIN_SIZE >> level;
+
+		std::vector<float>* lpChild = &this->m_Level[level - 1];
+
+		this->m_Level[level].resize(size * size);
+
+		for (int y = 0; y < size; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				float* row0 = &(*lpChild)[((y * 2) * (size * 2)) + (x * 2)];
+
+				float* row1 = row0 + (size * 2);
+
+				float top = ((row0[0] > row0[1]) ? row0[0] : row0[1]);
+
+				top = ((row1[0] > top) ? row1[0] : top);
+
+				top = ((row1[1] > top) ? row1[1] : top);
+
+				this->m_Level[level][(y * size) + x] = top;
+			}
+		}
+	}
+}
+
+bool CTerrainPick::Pick(float* origin, float* direction, float MaxDistance, TERRAIN_PICK_RESULT* lpResult)
+{
+	// Hierarchical DDA over the max pyramid: a node the ray passes above is skipped whole, only leaf cells get the exact triangle test
+	this->m_StepCount = 0;
+
+	if (this->m_Height == 0)
+	{
+		return false;
+	}
+
+	double o[3] = { origin[0], origin[1], origin[2] };
+
+	double d[3] = { direction[0], direction[1], direction[2] };
+
+	double MinT = 0.0;
+
+	double MaxT = MaxDistance;
+
+	for (int n = 0; n < 2; n++)
+	{
+		if (d[n] == 0.0)
+		{
+			if (o[n] < 0.0 || o[n] >= TERRAIN_PICK_LIMIT)
+			{
+				return false;
+			}
+
+			continue;
+		}
+
+		double t0 = (0.0 - o[n]) / d[n];
+
+		double t1 = (TERRAIN_PICK_LIMIT - o[n]) / d[n];
+
+		double enter = ((t0 < t1) ? t0 : t1);
+
+		double leave = ((t0 > t1) ? t0 : t1);
+
+		MinT = ((enter > MinT) ? enter : MinT);
+
+		MaxT = ((leave < MaxT) ? leave : MaxT);
+	}
+
+	// Nothing above the highest corner of the map can be hit
+	double top = this->m_Level[TERRAIN_PICK_LEVEL - 1][0];
+
+	if (o[2] > top)
+	{
+		if (d[2] >= 0.0)
+		{
+			return false;
+		}
+
+		double t = (o[2] - top) / -d[2];
+
+		MinT = ((t > MinT) ? t : MinT);
+	}
+
+	int level = TERRAIN_PICK_LEVEL - 1;
+
+	double t = MinT;
+
+	while (t <= MaxT && this->m_StepCount < TERRAIN_PICK_MAX_STEP)
+	{
+		this->m_StepCount++;
+
+		int size = TERRAIN_SIZE >> level;
+
+		double extent = TERRAIN_PICK_SCALE * (1 << level);
+
+		// The cell is taken a hair past t so a ray sitting on a border picks the cell it is entering
+		double probe = t + TERRAIN_PICK_EPSILON;
+
+		int cx = (int)((o[0] + (d[0] * probe)) / extent);
+
+		int cy = (int)((o[1] + (d[1] * probe)) / extent);
+
+		cx = ((cx < 0) ? 0 : ((cx >= size) ? (size - 1) : cx));
+
+		cy = ((cy < 0) ? 0 : ((cy >= size) ? (size - 1) : cy));
+
+		double ExitX = ((d[0] > 0.0) ? ((((cx + 1) * extent) - o[0]) / d[0]) : ((d[0] < 0.0) ? (((cx * extent) - o[0]) / d[0]) : MaxT));
+
+		double ExitY = ((d[1] > 0.0) ? ((((cy + 1) * extent) - o[1]) / d[1]) : ((d[1] < 0.0) ? (((cy * extent) - o[1]) / d[1]) : MaxT));
+
+		double exit = ((ExitX < ExitY) ? ExitX : ExitY);
+
+		exit = ((exit < MaxT) ? exit : MaxT);
+
+		exit = ((exit > probe) ? exit : probe);
+
+		double z0 = o[2] + (d[2] * t);
+
+		double z1 = o[2] + (d[2] * exit);
+
+		if (((z0 < z1) ? z0 : z1) > this->m_Level[level][(cy * size) + cx])
+		{
+			t = exit;
+
+			level = ((level < (TERRAIN_PICK_LEVEL - 1)) ? (level + 1) : level);
+
+			continue;
+		}
+
+		if (level > 0)
+		{
+			level--;
+
+			continue;
+		}
+
+		double hit;
+
+		if (this->TestCell(cx, cy, o, d, t, exit, &hit) != 0)
+		{
+			this->SetResult(o, d, hit, lpResult);
+
+			return true;
+		}
+
+		t = exit;
+
+		level = 1;
+	}
+
+	return false;
+}
+
+bool CTerrainPick::PickStep(float* origin, float* direction, float MaxDistance, float step, TERRAIN_PICK_RESULT* lpResult)
+{
+	// Reference: fixed steps along the ray until it dips under the surface, then bisection, the way a brute force pick does
+	this->m_StepCount = 0;
+
+	if (this->m_Height == 0 || step <= 0.0f)
+	{
+		return false;
+	}
+
+	double o[3] = { origin[0], origin[1], origin[2] };
+
+	double d[3] = { direction[0], direction[1], direction[2] };
+
+	double last = 0.0;
+
+	for (double t = 0.0; t <= MaxDistance; t += step)
+	{
+		this->m_StepCount++;
+
+		double x = o[0] + (d[0] * t);
+
+		double y = o[1] + (d[1] * t);
+
+		if (x < 0.0 || y < 0.0 || x >= TERRAIN_PICK_LIMIT || y >= TERRAIN_PICK_LIMIT || (o[2] + (d[2] * t)) > this->GetHeight((float)x, (float)y))
+		{
+			last = t;
+			continue;
+		}
+
+		double low = last;
+
+		double high = t;
+
+		for (int n = 0; n < TERRAIN_PICK_BISECT; n++)
+		{
+			double mid = (low + high) * 0.5;
+
+			double mx = o[0] + (d[0] * mid);
+
+			double my = o[1] + (d[1] * mid);
+
+			if (mx >= 0.0 && my >= 0.0 && mx < TERRAIN_PICK_LIMIT && my < TERRAIN_PICK_LIMIT && (o[2] + (d[2] * mid)) <= this->GetHeight((float)mx, (float)my))
+			{
+				high = mid;
+			}
+			else
+			{
+				low = mid;
+			}
+		}
+
+		this->SetResult(o, d, high, lpResult);
+
+		return true;
+	}
+
+	return false;
+}
+
+float CTerrainPick::GetHeight(float x, float y)
+{
+	// The surface the client draws: each cell is fanned from (x,y) into (x,y)(x+1,y)(x+1,y+1) and (x,y)(x+1,y+1)(x,y+1)
+	float fx = x / TERRAIN_PICK_SCALE;
+
+	float fy = y / TERRAIN_PICK_SCALE;
+
+	int cx = (int)fx;
+
+	int cy = (int)fy;
+
+	cx = ((cx < 0) ? 0 : ((cx > (TERRAIN_SIZE - 2)) ? (TERRAIN_SIZE - 2) : cx));
+
+	cy = ((cy < 0) ? 0 : ((cy > (TERRAIN_SIZE - 2)) ? (TERRAIN_SIZE - 2) : cy));
+
+	float s = fx - cx;
+
+	float u = fy - cy;
+
+	float h00 = this->GetVertex(cx, cy);
+
+	float h10 = this->GetVertex((cx + 1), cy);
+
+	float h01 = this->GetVertex(cx, (cy + 1));
+
+	float h11 = this->GetVertex((cx + 1), (cy + 1));
+
+	return ((s >= u) ? (h00 + (s * (h10 - h00)) + (u * (h11 - h10))) : (h00 + (u * (h01 - h00)) + (s * (h11 - h01))));
+}
+
+DWORD CTerrainPick::GetLastStepCount()
+{
+	return this->m_StepCount;
+}
+
+bool CTerrainPick::TestCell(int x, int y, double* origin, double* direction, double MinT, double MaxT, double* hit)
+{
+	double h00 = this->GetVertex(x, y);
+
+	double h10 = this->GetVertex((x + 1), y);
+
+	double h01 = this->GetVertex(x, (y + 1));
+
+	double h11 = this->GetVertex((x + 1), (y + 1));
+
+	// Cell local coordinates along the ray, s across x and u across y
+	double s0 = (origin[0] - (x * TERRAIN_PICK_SCALE)) / TERRAIN_PICK_SCALE;
+
+	double u0 = (origin[1] - (y * TERRAIN_PICK_SCALE)) / TERRAIN_PICK_SCALE;
+
+	double ds = direction[0] / TERRAIN_PICK_SCALE;
+
+	double du = direction[1] / TERRAIN_PICK_SCALE;
+
+	double tolerance = 0.00001;
+
+	bool result = 0;
+
+	for (int n = 0; n < 2; n++)
+	{
+		// Each triangle is the plane z = a + b * s + c * u over its half of the cell
+		double b = ((n == 0) ? (h10 - h00) : (h11 - h01));
+
+		double c = ((n == 0) ? (h11 - h10) : (h01 - h00));
+
+		double denominator = direction[2] - (ds * b) - (du * c);
+
+		if (denominator == 0.0)
+		{
+			continue;
+		}
+
+		double t = (h00 + (s0 * b) + (u0 * c) - origin[2]) / denominator;
+
+		if (t < (MinT - TERRAIN_PICK_EPSILON) || t > (MaxT + TERRAIN_PICK_EPSILON) || (result != 0 && t >= (*hit)))
+		{
+			continue;
+		}
+
+		double s = s0 + (ds * t);
+
+		double u = u0 + (du * t);
+
+		if (s < -tolerance || u < -tolerance || s > (1.0 + tolerance) || u > (1.0 + tolerance))
+		{
+			continue;
+		}
+
+		if ((n == 0 && s < (u - tolerance)) || (n == 1 && s > (u + tolerance)))
+		{
+			continue;
+		}
+
+		*hit = t;
+
+		result = 1;
+	}
+
+	return result;
+}
+
+void CTerrainPick::SetResult(double* origin, double* direction, double t, TERRAIN_PICK_RESULT* lpResult)
+{
+	for (int n = 0; n < 3; n++)
+	{
+		lpResult->Position[n] = (float)(origin[n] + (direction[n] * t));
+	}
+
+	int x = (int)(lpResult->Position[0] / TERRAIN_PICK_SCALE);
+
+	int y = (int)(lpResult->Position[1] / TERRAIN_PICK_SCALE);
+
+	lpResult->X = ((x < 0) ? 0 : ((x > (TERRAIN_SIZE - 2)) ? (TERRAIN_SIZE - 2) : x));
+
+	lpResult->Y = ((y < 0) ? 0 : ((y > (TERRAIN_SIZE - 2)) ? (TERRAIN_SIZE - 2) : y));
+
+	lpResult->Height = this->GetHeight(lpResult->Position[0], lpResult->Position[1]);
+
+	lpResult->Distance = (float)t;
+
+	lpResult->Attribute = ((this->m_Attribute != 0) ? this->m_Attribute[(lpResult->Y * TERRAIN_SIZE) + lpResult->X] : 0);
+}
+
+float CTerrainPick::GetVertex(int x, int y)
+{
+	return this->m_Height[(y * TERRAIN_SIZE) + x] * TERRAIN_PICK_HEIGHT_SCALE;
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "TerrainPackage.h"
+
+#define TERRAIN_PICK_LEVEL 9
+#define TERRAIN_PICK_SCALE 100.0f
+#define TERRAIN_PICK_HEIGHT_SCALE 1.5f
+#define TERRAIN_PICK_LIMIT ((TERRAIN_SIZE - 1) * TERRAIN_PICK_SCALE)
+#define TERRAIN_PICK_NONE -1.0e30f
+#define TERRAIN_PICK_MAX_STEP 4096
+#define TERRAIN_PICK_BISECT 20
+
+struct TERRAIN_PICK_RESULT
+{
+	int X;
+	int Y;
+	float Position[3];
+	float Height;
+	float Distance;
+	BYTE Attribute;
+};
+
+class CTerrainPick
+{
+public:
+
+	CTerrainPick();
+
+	~CTerrainPick();
+
+	void Build(BYTE* height, BYTE* attribute);
+
+	bool Pick(float* origin, float* direction, float MaxDistance, TERRAIN_PICK_RESULT* lpResult);
+
+	bool PickStep(float* origin, float* direction, float MaxDistance, float step, TERRAIN_PICK_RESULT* lpResult);
+
+	float GetHeight(float x, float y);
+
+	DWORD GetLastStepCount();
+
+private:
+
+	bool TestCell(int x, int y, double* origin, double* direction, double MinT, double MaxT, double* hit);
+
+	void SetResult(double* origin, double* direction, double t, TERRAIN_PICK_RESULT* lpResult);
+
+	float GetVertex(int x, int y);
+
+private:
+
+	BYTE* m_Height;
+
+	BYTE* m_Attribute;
+
+	std::vector<float> m_Level[TERRAIN_PICK_LEVEL]; // Level 0 keeps the highest corner of every cell, each level up the max of four
+
+	DWORD m_StepCount;
+};
\ No newline at end of file
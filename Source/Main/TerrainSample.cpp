@@ -0,0 +1,308 @@
+#include "stdafx.h"
+#include "TerrainSample.h"
+#include <emmintrin.h>
+
+#define TERRAIN_SAMPLE_MAX_COORD 255.9999f
+
+static float ClampSampleCoord(float value)
+{
+	return ((value < 0.0f) ? 0.0f : ((value > TERRAIN_SAMPLE_MAX_COORD) ? TERRAIN_SAMPLE_MAX_COORD : value));
+}
+
+CTerrainSample::CTerrainSample()
+{
+	this->m_Height = 0;
+}
+
+CTerrainSample::~CTerrainSample()
+{
+
+}
+
+void CTerrainSample::Build(BYTE* height)
+{
+	this->m_Height = height;
+
+	// Heights are widened to world units once, the extra row and column repeat the first ones like TERRAIN_INDEX_REPEAT
+	this->m_Grid.resize(TERRAIN_SAMPLE_STRIDE * TERRAIN_SAMPLE_STRIDE);
+
+	for (int y = 0; y < TERRAIN_SAMPLE_STRIDE; y++)
+	{
+		for (int x = 0; x < TERRAIN_SAMPLE_STRIDE; x++)
+		{
+			this->m_Grid[(y * TERRAIN_SAMPLE_STRIDE) + x] = height[((y & (TERRAIN_SIZE - 1)) * TERRAIN_SIZE) + (x & (TERRAIN_SIZE - 1))] * TERRAIN_SAMPLE_HEIGHT_SCALE;
+		}
+	}
+
+	this->m_Tile.resize(TERRAIN_SAMPLE_TILE_COUNT * TERRAIN_SAMPLE_TILE_COUNT * TERRAIN_SAMPLE_TILE_SIZE);
+
+	for (int tile = 0; tile < (TERRAIN_SAMPLE_TILE_COUNT * TERRAIN_SAMPLE_TILE_COUNT); tile++)
+	{
+		int BaseX = (tile % TERRAIN_SAMPLE_TILE_COUNT) * TERRAIN_SAMPLE_TILE;
+
+		int BaseY = (tile / TERRAIN_SAMPLE_TILE_COUNT) * TERRAIN_SAMPLE_TILE;
+
+		float* out = &this->m_Tile[tile * TERRAIN_SAMPLE_TILE_SIZE];
+
+		for (int y = 0; y < TERRAIN_SAMPLE_TILE_STRIDE; y++)
+		{
+			memcpy(&out[y * TERRAIN_SAMPLE_TILE_STRIDE], &this->m_Grid[((BaseY + y) * TERRAIN_SAMPLE_STRIDE) + BaseX], (TERRAIN_SAMPLE_TILE_STRIDE * sizeof(float)));
+		}
+	}
+}
+
+void CTerrainSample::Sample(TERRAIN_SAMPLE_BATCH* lpBatch)
+{
+	int n = 0;
+
+	for (; (n + 4) <= lpBatch->Count; n += 4)
+	{
+		this->SampleFour(lpBatch, n, 0);
+	}
+
+	this->SampleTail(lpBatch, n);
+}
+
+void CTerrainSample::SampleSorted(TERRAIN_SAMPLE_BATCH* lpBatch)
+{
+	// Inputs ordered by GetTile keep most groups of four inside one tile, those read its contiguous 1 KB block
+	int n = 0;
+
+	for (; (n + 4) <= lpBatch->Count; n += 4)
+	{
+		this->SampleFour(lpBatch, n, 1);
+	}
+
+	this->SampleTail(lpBatch, n);
+}
+
+void CTerrainSample::Sort(TERRAIN_SAMPLE_BATCH* lpBatch, std::vector<int>& order)
+{
+	// Counting sort on the tile index, stable so entities keep their relative order inside a tile
+	int TileCount = TERRAIN_SAMPLE_TILE_COUNT * TERRAIN_SAMPLE_TILE_COUNT;
+
+	this->m_Count.assign((TileCount + 1), 0);
+
+	order.resize(lpBatch->Count);
+
+	for (int n = 0; n < lpBatch->Count; n++)
+	{
+		this->m_Count[CTerrainSample::GetTile(lpBatch->X[n], lpBatch->Y[n]) + 1]++;
+	}
+
+	for (int n = 0; n < TileCount; n++)
+	{
+		this->m_Count[n + 1] += this->m_Count[n];
+	}
+
+	for (int n = 0; n < lpBatch->Count; n++)
+	{
+		order[this->m_Count[CTerrainSample::GetTile(lpBatch->X[n], lpBatch->Y[n])]++] = n;
+	}
+}
+
+float CTerrainSample::GetHeight(float x, float y)
+{
+	// RequestTerrainHeight: bilinear over the four corners of the cell
+	float fx = ClampSampleCoord(x / TERRAIN_SAMPLE_SCALE);
+
+	float fy = ClampSampleCoord(y / TERRAIN_SAMPLE_SCALE);
+
+	int xi = (int)fx;
+
+	int yi = (int)fy;
+
+	float xd = fx - (float)xi;
+
+	float yd = fy - (float)yi;
+
+	int x1 = (xi + 1) & (TERRAIN_SIZE - 1);
+
+	int y1 = (yi + 1) & (TERRAIN_SIZE - 1);
+
+	float h00 = this->m_Height[(yi * TERRAIN_SIZE) + xi] * TERRAIN_SAMPLE_HEIGHT_SCALE;
+
+	float h10 = this->m_Height[(yi * TERRAIN_SIZE) + x1] * TERRAIN_SAMPLE_HEIGHT_SCALE;
+
+	float h01 = this->m_Height[(y1 * TERRAIN_SIZE) + xi] * TERRAIN_SAMPLE_HEIGHT_SCALE;
+
+	float h11 = this->m_Height[(y1 * TERRAIN_SIZE) + x1] * TERRAIN_SAMPLE_HEIGHT_SCALE;
+
+	float left = h00 + ((h01 - h00) * yd);
+
+	float right = h10 + ((h11 - h10) * yd);
+
+	return left + ((right - left) * xd);
+}
+
+void CTerrainSample::GetNormal(float x, float y, float* normal)
+{
+	// Normal of the bilinear patch at the point, from its two slopes
+	float fx = ClampSampleCoord(x / TERRAIN_SAMPLE_SCALE);
+
+	float fy = ClampSampleCoord(y / TERRAIN_SAMPLE_SCALE);
+
+	int xi = (int)fx;
+
+	int yi = (int)fy;
+
+	float xd = fx - (float)xi;
+
+	float yd = fy - (float)yi;
+
+	int x1 = (xi + 1) & (TERRAIN_SIZE - 1);
+
+	int y1 = (yi + 1) & (TERRAIN_SIZE - 1);
+
+	float h00 = this->m_Height[(yi * TERRAIN_SIZE) + xi] * TERRAIN_SAMPLE_HEIGHT_SCALE;
+
+	float h10 = this->m_Height[(yi * TERRAIN_SIZE) + x1] * TERRAIN_SAMPLE_HEIGHT_SCALE;
+
+	float h01 = this->m_Height[(y1 * TERRAIN_SIZE) + xi] * TERRAIN_SAMPLE_HEIGHT_SCALE;
+
+	float h11 = this->m_Height[(y1 * TERRAIN_SIZE) + x1] * TERRAIN_SAMPLE_HEIGHT_SCALE;
+
+	float dx = ((h10 + ((h11 - h10) * yd)) - (h00 + ((h01 - h00) * yd))) / TERRAIN_SAMPLE_SCALE;
+
+	float dy = ((h01 + ((h11 - h01) * xd)) - (h00 + ((h10 - h00) * xd))) / TERRAIN_SAMPLE_SCALE;
+
+	float length = sqrtf((dx * dx) + (dy * dy) + 1.0f);
+
+	normal[0] = (0.0f - dx) / length;
+
+	normal[1] = (0.0f - dy) / length;
+
+	normal[2] = 1.0f / length;
+}
+
+int CTerrainSample::GetTile(float x, float y)
+{
+	int xi = (int)ClampSampleCoord(x / TERRAIN_SAMPLE_SCALE);
+
+	int yi = (int)ClampSampleCoord(y / TERRAIN_SAMPLE_SCALE);
+
+	return (((yi / TERRAIN_SAMPLE_TILE) * TERRAIN_SAMPLE_TILE_COUNT) + (xi / TERRAIN_SAMPLE_TILE));
+}
+
+void CTerrainSample::SampleFour(TERRAIN_SAMPLE_BATCH* lpBatch, int n, bool tiled)
+{
+	// SSE2 has no gather, the corner loads go through the stored indices
+	bool normal = (lpBatch->NormalX != 0 && lpBatch->NormalY != 0 && lpBatch->NormalZ != 0);
+
+	__m128 scale = _mm_set1_ps(TERRAIN_SAMPLE_SCALE);
+
+	__m128 zero = _mm_setzero_ps();
+
+	__m128 one = _mm_set1_ps(1.0f);
+
+	__m128 limit = _mm_set1_ps(TERRAIN_SAMPLE_MAX_COORD);
+
+	__m128 fx = _mm_min_ps(_mm_max_ps(_mm_div_ps(_mm_loadu_ps(&lpBatch->X[n]), scale), zero), limit);
+
+	__m128 fy = _mm_min_ps(_mm_max_ps(_mm_div_ps(_mm_loadu_ps(&lpBatch->Y[n]), scale), zero), limit);
+
+	__m128i xi = _mm_cvttps_epi32(fx);
+
+	__m128i yi = _mm_cvttps_epi32(fy);
+
+	__m128 xd = _mm_sub_ps(fx, _mm_cvtepi32_ps(xi));
+
+	__m128 yd = _mm_sub_ps(fy, _mm_cvtepi32_ps(yi));
+
+	float* grid = &this->m_Grid[0];
+
+	int stride = TERRAIN_SAMPLE_STRIDE;
+
+	int index[4];
+
+	// Row offsets as (y << 8) + y and (y << 4) + y, SSE2 has no 32 bit multiply
+	_mm_storeu_si128((__m128i*)index, _mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(yi, 8), yi), xi));
+
+	if (tiled != 0)
+	{
+		__m128i tile = _mm_add_epi32(_mm_slli_epi32(_mm_srli_epi32(yi, 4), 4), _mm_srli_epi32(xi, 4));
+
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(tile, _mm_shuffle_epi32(tile, 0))) == 0xFFFF)
+		{
+			__m128i mask = _mm_set1_epi32(TERRAIN_SAMPLE_TILE - 1);
+
+			__m128i lx = _mm_and_si128(xi, mask);
+
+			__m128i ly = _mm_and_si128(yi, mask);
+
+			grid = &this->m_Tile[_mm_cvtsi128_si32(tile) * TERRAIN_SAMPLE_TILE_SIZE];
+
+			stride = TERRAIN_SAMPLE_TILE_STRIDE;
+
+			_mm_storeu_si128((__m128i*)index, _mm_add_epi32(_mm_add_epi32(_mm_slli_epi32(ly, 4), ly), lx));
+		}
+	}
+
+	float* p0 = &grid[index[0]];
+
+	float* p1 = &grid[index[1]];
+
+	float* p2 = &grid[index[2]];
+
+	float* p3 = &grid[index[3]];
+
+	__m128 h00 = _mm_set_ps(p3[0], p2[0], p1[0], p0[0]);
+
+	__m128 h10 = _mm_set_ps(p3[1], p2[1], p1[1], p0[1]);
+
+	__m128 h01 = _mm_set_ps(p3[stride], p2[stride], p1[stride], p0[stride]);
+
+	__m128 h11 = _mm_set_ps(p3[stride + 1], p2[stride + 1], p1[stride + 1], p0[stride + 1]);
+
+	__m128 left = _mm_add_ps(h00, _mm_mul_ps(_mm_sub_ps(h01, h00), yd));
+
+	__m128 right = _mm_add_ps(h10, _mm_mul_ps(_mm_sub_ps(h11, h10), yd));
+
+	__m128 dx = _mm_sub_ps(right, left);
+
+	_mm_storeu_ps(&lpBatch->Height[n], _mm_add_ps(left, _mm_mul_ps(dx, xd)));
+
+	if (normal == 0)
+	{
+		return;
+	}
+
+	__m128 top = _mm_add_ps(h00, _mm_mul_ps(_mm_sub_ps(h10, h00), xd));
+
+	__m128 bottom = _mm_add_ps(h01, _mm_mul_ps(_mm_sub_ps(h11, h01), xd));
+
+	dx = _mm_div_ps(dx, scale);
+
+	__m128 dy = _mm_div_ps(_mm_sub_ps(bottom, top), scale);
+
+	__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), one));
+
+	_mm_storeu_ps(&lpBatch->NormalX[n], _mm_div_ps(_mm_sub_ps(zero, dx), length));
+
+	_mm_storeu_ps(&lpBatch->NormalY[n], _mm_div_ps(_mm_sub_ps(zero, dy), length));
+
+	_mm_storeu_ps(&lpBatch->NormalZ[n], _mm_div_ps(one, length));
+}
+
+void CTerrainSample::SampleTail(TERRAIN_SAMPLE_BATCH* lpBatch, int n)
+{
+	bool normal = (lpBatch->NormalX != 0 && lpBatch->NormalY != 0 && lpBatch->NormalZ != 0);
+
+	for (; n < lpBatch->Count; n++)
+	{
+		lpBatch->Height[n] = this->GetHeight(lpBatch->X[n], lpBatch->Y[n]);
+
+		if (normal != 0)
+		{
+			float value[3];
+
+			this->GetNormal(lpBatch->X[n], lpBatch->Y[n], value);
+
+			lpBatch->NormalX[n] = value[0];
+
+			lpBatch->NormalY[n] = value[1];
+
+			lpBatch->NormalZ[n] = value[2];
+		}
+	}
+}
\ No newline at end of file
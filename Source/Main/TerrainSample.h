@@ -0,0 +1,61 @@
+#pragma once
+
+#include "TerrainPackage.h"
+
+#define TERRAIN_SAMPLE_SCALE 100.0f
+#define TERRAIN_SAMPLE_HEIGHT_SCALE 1.5f
+#define TERRAIN_SAMPLE_STRIDE (TERRAIN_SIZE + 1)
+#define TERRAIN_SAMPLE_TILE 16
+#define TERRAIN_SAMPLE_TILE_COUNT (TERRAIN_SIZE / TERRAIN_SAMPLE_TILE)
+#define TERRAIN_SAMPLE_TILE_STRIDE (TERRAIN_SAMPLE_TILE + 1)
+#define TERRAIN_SAMPLE_TILE_SIZE (TERRAIN_SAMPLE_TILE_STRIDE * TERRAIN_SAMPLE_TILE_STRIDE)
+
+struct TERRAIN_SAMPLE_BATCH
+{
+	int Count;
+	float* X; // World units
+	float* Y;
+	float* Height;
+	float* NormalX; // The three normal arrays may be 0 when only heights are needed
+	float* NormalY;
+	float* NormalZ;
+};
+
+class CTerrainSample
+{
+public:
+
+	CTerrainSample();
+
+	~CTerrainSample();
+
+	void Build(BYTE* height);
+
+	void Sample(TERRAIN_SAMPLE_BATCH* lpBatch);
+
+	void SampleSorted(TERRAIN_SAMPLE_BATCH* lpBatch);
+
+	void Sort(TERRAIN_SAMPLE_BATCH* lpBatch, std::vector<int>& order);
+
+	float GetHeight(float x, float y);
+
+	void GetNormal(float x, float y, float* normal);
+
+	static int GetTile(float x, float y);
+
+private:
+
+	void SampleFour(TERRAIN_SAMPLE_BATCH* lpBatch, int n, bool tiled);
+
+	void SampleTail(TERRAIN_SAMPLE_BATCH* lpBatch, int n);
+
+private:
+
+	BYTE* m_Height;
+
+	std::vector<float> m_Grid; // Row major with the first row and column repeated past the edge
+
+	std::vector<float> m_Tile; // The same heights in 17x17 tiles, one contiguous block per 16x16 cells
+
+	std::vector<int> m_Count;
+};
\ No newline at end of file
@@ -0,0 +1,521 @@
+#include "stdafx.h"
+#include "TerrainSplat.h"
+#include "TextureCook.h"
+
+static char* TerrainSplatTileName[] = { "TileGrass01", "TileGrass02", "TileGround01", "TileGround02", "TileGround03", "TileWater01", "TileWood01", "TileRock01", "TileRock02", "TileRock03", "TileRock04", "TileRock05", "TileRock06", "TileRock07" };
+
+static DWORD AlignSplatOffset(DWORD offset)
+{
+	return ((offset + (TERRAIN_SPLAT_ALIGN - 1)) & ~(TERRAIN_SPLAT_ALIGN - 1));
+}
+
+static void GetSplatStamp(char* path, TERRAIN_PACKAGE_SOURCE* lpSource)
+{
+	memset(lpSource, 0, sizeof(TERRAIN_PACKAGE_SOURCE));
+
+	WIN32_FILE_ATTRIBUTE_DATA data;
+
+	if (GetFileAttributesEx(path, GetFileExInfoStandard, &data) != 0)
+	{
+		lpSource->Size = data.nFileSizeLow;
+
+		lpSource->WriteTime = data.ftLastWriteTime;
+	}
+}
+
+CTerrainSplat::CTerrainSplat()
+{
+	this->m_Header = 0;
+}
+
+CTerrainSplat::~CTerrainSplat()
+{
+	this->Close();
+}
+
+bool CTerrainSplat::Open(char* directory, int world)
+{
+	this->Close();
+
+	char path[MAX_PATH];
+
+	wsprintf(path, "%s\\%s", directory, TERRAIN_SPLAT_NAME);
+
+	if (this->m_File.Open(path) == 0)
+	{
+		return false;
+	}
+
+	DWORD FileSize = this->m_File.GetSize();
+
+	this->m_Header = (TERRAIN_SPLAT_HEADER*)this->m_File.GetData();
+
+	if (FileSize < sizeof(TERRAIN_SPLAT_HEADER) || this->m_Header->Magic != TERRAIN_SPLAT_MAGIC || this->m_Header->Version != TERRAIN_SPLAT_VERSION || this->m_Header->ChunkTiles != TERRAIN_SPLAT_CHUNK_TILES)
+	{
+		this->Close();
+
+		return false;
+	}
+
+	if (CTerrainSplat::IsValidDensity(this->m_Header->Density) == 0 || this->m_Header->LevelCount == 0 || this->m_Header->LevelCount > TERRAIN_SPLAT_MAX_LEVEL)
+	{
+		this->Close();
+
+		return false;
+	}
+
+	// A patched map or tile texture makes the bake stale, checked the same way as the terrain package
+	TERRAIN_SPLAT_HEADER stamp;
+
+	CTerrainSplat::GetSourceStamp(directory, world, &stamp);
+
+	if (memcmp(&stamp.Map, &this->m_Header->Map, sizeof(stamp.Map)) != 0 || memcmp(stamp.Tile, this->m_Header->Tile, sizeof(stamp.Tile)) != 0)
+	{
+		this->Close();
+
+		return false;
+	}
+
+	for (DWORD n = 0; n < this->m_Header->LevelCount; n++)
+	{
+		TERRAIN_SPLAT_LEVEL* lpLevel = &this->m_Header->Level[n];
+
+		if (lpLevel->Size != CBcEncoder::GetImageSize(lpLevel->Width, lpLevel->Height, 0) || lpLevel->Offset > this->m_Header->ChunkSize || lpLevel->Size > (this->m_Header->ChunkSize - lpLevel->Offset))
+		{
+			this->Close();
+
+			return false;
+		}
+	}
+
+	for (int n = 0; n < TERRAIN_SPLAT_CHUNK_COUNT; n++)
+	{
+		TERRAIN_SPLAT_CHUNK* lpChunk = &this->m_Header->Chunk[n];
+
+		if (lpChunk->Offset > FileSize || this->m_Header->ChunkSize > (FileSize - lpChunk->Offset))
+		{
+			this->Close();
+
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool CTerrainSplat::Load(char* directory, int world, int density, CTextureDecoder* lpDecoder, CTextureBufferPool* lpPool)
+{
+	if (this->Open(directory, world) != 0 && this->m_Header->Density == density)
+	{
+		return true;
+	}
+
+	this->Close();
+
+	TERRAIN_SPLAT_INFO info;
+
+	if (CTerrainSplat::Bake(directory, world, density, lpDecoder, lpPool, &info) == 0)
+	{
+		return false;
+	}
+
+	return this->Open(directory, world);
+}
+
+void CTerrainSplat::Close()
+{
+	this->m_File.Close();
+
+	this->m_Header = 0;
+}
+
+bool CTerrainSplat::IsOpen()
+{
+	return (this->m_Header != 0);
+}
+
+int CTerrainSplat::GetDensity()
+{
+	return ((this->m_Header != 0) ? this->m_Header->Density : 0);
+}
+
+TERRAIN_SPLAT_CHUNK* CTerrainSplat::GetChunk(int index)
+{
+	if (this->m_Header == 0 || index < 0 || index >= TERRAIN_SPLAT_CHUNK_COUNT)
+	{
+		return 0;
+	}
+
+	return &this->m_Header->Chunk[index];
+}
+
+bool CTerrainSplat::Upload(int index, DWORD FirstLevel)
+{
+	static PFNGLCOMPRESSEDTEXIMAGE2DARBPROC glCompressedTexImage2DARB = (PFNGLCOMPRESSEDTEXIMAGE2DARBPROC)wglGetProcAddress("glCompressedTexImage2DARB");
+
+	TERRAIN_SPLAT_CHUNK* lpChunk = this->GetChunk(index);
+
+	if (lpChunk == 0 || glCompressedTexImage2DARB == 0 || CTextureCookedImage::IsSupported() == 0 || FirstLevel >= this->m_Header->LevelCount)
+	{
+		return false;
+	}
+
+	// One texture per chunk replaces the per cell layer binds, clamped so neighbour chunks do not bleed into each other
+	BYTE* data = this->m_File.GetData() + lpChunk->Offset;
+
+	for (DWORD n = FirstLevel; n < this->m_Header->LevelCount; n++)
+	{
+		TERRAIN_SPLAT_LEVEL* lpLevel = &this->m_Header->Level[n];
+
+		glCompressedTexImage2DARB(GL_TEXTURE_2D, (n - FirstLevel), GL_COMPRESSED_RGB_S3TC_DXT1_EXT, lpLevel->Width, lpLevel->Height, 0, lpLevel->Size, (data + lpLevel->Offset));
+	}
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (((this->m_Header->LevelCount - FirstLevel) > 1) ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR));
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	return true;
+}
+
+bool CTerrainSplat::Bake(char* directory, int world, int density, CTextureDecoder* lpDecoder, CTextureBufferPool* lpPool, TERRAIN_SPLAT_INFO* lpInfo)
+{
+	memset(lpInfo, 0, sizeof(TERRAIN_SPLAT_INFO));
+
+	if (CTerrainSplat::IsValidDensity(density) == 0)
+	{
+		return false;
+	}
+
+	TERRAIN_SPLAT_HEADER header;
+
+	memset(&header, 0, sizeof(header));
+
+	header.Magic = TERRAIN_SPLAT_MAGIC;
+
+	header.Version = TERRAIN_SPLAT_VERSION;
+
+	header.Density = (WORD)density;
+
+	header.ChunkTiles = TERRAIN_SPLAT_CHUNK_TILES;
+
+	// The stamp is taken before reading so a file patched meanwhile leaves the bake stale instead of wrong
+	CTerrainSplat::GetSourceStamp(directory, world, &header);
+
+	TERRAIN_DATA source;
+
+	if (CTerrainPackage::LoadSource(directory, world, lpDecoder, lpPool, &source) == 0 || source.Chunk[TERRAIN_CHUNK_LAYER1].empty() != 0)
+	{
+		return false;
+	}
+
+	std::vector<TERRAIN_SPLAT_TILE> tile(TERRAIN_SPLAT_TILE_COUNT);
+
+	for (int n = 0; n < TERRAIN_SPLAT_TILE_COUNT; n++)
+	{
+		char path[MAX_PATH];
+
+		CTerrainSplat::GetTilePath(directory, n, path);
+
+		lpInfo->TileCount += CTerrainSplat::LoadTile(path, density, lpDecoder, lpPool, &tile[n]);
+	}
+
+	int size = TERRAIN_SPLAT_CHUNK_TILES * density;
+
+	TEXTURE_FILTER_OPTION option;
+
+	option.Filter = TEXTURE_FILTER_KAISER;
+
+	option.Gamma = 1;
+
+	option.Premultiply = 0;
+
+	option.Coverage = 0.0f;
+
+	option.Simd = 1;
+
+	std::vector<BYTE> rgba(size * size * 4);
+
+	std::vector<BYTE> decoded(size * size * 4);
+
+	std::vector<TEXTURE_MIP_LEVEL> chain;
+
+	std::vector<BYTE> data(AlignSplatOffset(sizeof(TERRAIN_SPLAT_HEADER)), 0);
+
+	for (int n = 0; n < TERRAIN_SPLAT_CHUNK_COUNT; n++)
+	{
+		CTerrainSplat::BakeChunk(&source, &tile[0], density, n, &rgba[0], &header.Chunk[n]);
+
+		lpInfo->WaterCount += header.Chunk[n].WaterCount;
+
+		lpInfo->MissingCount += header.Chunk[n].MissingCount;
+
+		int LevelCount = CTextureFilter::BuildMipChain(&rgba[0], size, size, &option, chain);
+
+		LevelCount = ((LevelCount > TERRAIN_SPLAT_MAX_LEVEL) ? TERRAIN_SPLAT_MAX_LEVEL : LevelCount);
+
+		if (n == 0)
+		{
+			// Every chunk has the same size, so the level table is shared and a chunk is a plain block of compressed levels
+			header.LevelCount = (WORD)LevelCount;
+
+			for (int i = 0; i < LevelCount; i++)
+			{
+				header.Level[i].Width = (WORD)chain[i].Width;
+
+				header.Level[i].Height = (WORD)chain[i].Height;
+
+				header.Level[i].Offset = header.ChunkSize;
+
+				header.Level[i].Size = CBcEncoder::GetImageSize(chain[i].Width, chain[i].Height, 0);
+
+				header.ChunkSize = AlignSplatOffset(header.ChunkSize + header.Level[i].Size);
+			}
+		}
+
+		DWORD offset = data.size();
+
+		data.resize(offset + header.ChunkSize, 0);
+
+		header.Chunk[n].Offset = offset;
+
+		for (int i = 0; i < LevelCount; i++)
+		{
+			CBcEncoder::EncodeImage(&chain[i].Data[0], chain[i].Width, chain[i].Height, 0, &data[offset + header.Level[i].Offset]);
+		}
+
+		BC_ERROR error;
+
+		memset(&error, 0, sizeof(error));
+
+		CBcEncoder::DecodeImage(&data[offset], size, size, 0, &decoded[0]);
+
+		CBcEncoder::GetError(&rgba[0], &decoded[0], size, size, &error);
+
+		lpInfo->Error.Color += error.Color;
+
+		lpInfo->Error.PixelCount += error.PixelCount;
+	}
+
+	memcpy(&data[0], &header, sizeof(header));
+
+	char path[MAX_PATH];
+
+	wsprintf(path, "%s\\%s", directory, TERRAIN_SPLAT_NAME);
+
+	char temp[MAX_PATH];
+
+	wsprintf(temp, "%s.tmp", path);
+
+	HANDLE handle = CreateFile(temp, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_ARCHIVE, 0);
+
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	DWORD OutSize = 0;
+
+	if (WriteFile(handle, &data[0], data.size(), &OutSize, 0) == 0 || OutSize != data.size())
+	{
+		CloseHandle(handle);
+		DeleteFile(temp);
+		return false;
+	}
+
+	CloseHandle(handle);
+
+	if (MoveFileEx(temp, path, MOVEFILE_REPLACE_EXISTING) == 0)
+	{
+		DeleteFile(temp);
+		return false;
+	}
+
+	lpInfo->FileSize = data.size();
+
+	return true;
+}
+
+void CTerrainSplat::BakeChunk(TERRAIN_DATA* lpData, TERRAIN_SPLAT_TILE* lpTile, int density, int index, BYTE* rgba, TERRAIN_SPLAT_CHUNK* lpChunk)
+{
+	BYTE* layer1 = &lpData->Chunk[TERRAIN_CHUNK_LAYER1][0];
+
+	BYTE* layer2 = &lpData->Chunk[TERRAIN_CHUNK_LAYER2][0];
+
+	BYTE* alpha = &lpData->Chunk[TERRAIN_CHUNK_ALPHA][0];
+
+	int size = TERRAIN_SPLAT_CHUNK_TILES * density;
+
+	int BaseX = (index % TERRAIN_SPLAT_CHUNK_SIDE) * TERRAIN_SPLAT_CHUNK_TILES;
+
+	int BaseY = (index / TERRAIN_SPLAT_CHUNK_SIDE) * TERRAIN_SPLAT_CHUNK_TILES;
+
+	lpChunk->WaterCount = 0;
+
+	lpChunk->MissingCount = 0;
+
+	for (int ty = 0; ty < TERRAIN_SPLAT_CHUNK_TILES; ty++)
+	{
+		for (int tx = 0; tx < TERRAIN_SPLAT_CHUNK_TILES; tx++)
+		{
+			int x = BaseX + tx;
+
+			int y = BaseY + ty;
+
+			int cell = (y * TERRAIN_SIZE) + x;
+
+			int x1 = (x + 1) & (TERRAIN_SIZE - 1);
+
+			int y1 = (y + 1) & (TERRAIN_SIZE - 1);
+
+			// Corner alphas in the order the client fans the quad: (x,y) (x+1,y) (x+1,y+1) (x,y+1)
+			float a0 = alpha[cell] / 255.0f;
+
+			float a1 = alpha[(y * TERRAIN_SIZE) + x1] / 255.0f;
+
+			float a2 = alpha[(y1 * TERRAIN_SIZE) + x1] / 255.0f;
+
+			float a3 = alpha[(y1 * TERRAIN_SIZE) + x] / 255.0f;
+
+			TERRAIN_SPLAT_TILE* lpBase = ((layer1[cell] < TERRAIN_SPLAT_TILE_COUNT) ? &lpTile[layer1[cell]] : 0);
+
+			TERRAIN_SPLAT_TILE* lpBlend = ((layer2[cell] < TERRAIN_SPLAT_TILE_COUNT && (a0 + a1 + a2 + a3) > 0.0f) ? &lpTile[layer2[cell]] : 0);
+
+			lpChunk->MissingCount += ((lpBase == 0 || lpBase->Data.empty() != 0) || (lpBlend != 0 && lpBlend->Data.empty() != 0));
+
+			lpChunk->WaterCount += (layer1[cell] == TERRAIN_SPLAT_TILE_WATER || (lpBlend != 0 && layer2[cell] == TERRAIN_SPLAT_TILE_WATER));
+
+			lpBlend = ((lpBlend != 0 && lpBlend->Data.empty() == 0) ? lpBlend : 0);
+
+			for (int v = 0; v < density; v++)
+			{
+				int gy = (y * density) + v;
+
+				float t = (v + 0.5f) / density;
+
+				BYTE* out = &rgba[((((ty * density) + v) * size) + (tx * density)) * 4];
+
+				for (int u = 0; u < density; u++, out += 4)
+				{
+					int gx = (x * density) + u;
+
+					// Tile textures repeat over the whole map, the same texel the client would pick at this density
+					if (lpBase != 0 && lpBase->Data.empty() == 0)
+					{
+						BYTE* in = &lpBase->Data[(((gy % lpBase->Height) * lpBase->Width) + (gx % lpBase->Width)) * 4];
+
+						out[0] = in[0];
+						out[1] = in[1];
+						out[2] = in[2];
+					}
+					else
+					{
+						out[0] = out[1] = out[2] = 0x80;
+					}
+
+					out[3] = 0xFF;
+
+					if (lpBlend == 0)
+					{
+						continue;
+					}
+
+					// Gouraud alpha across the two triangles of the fan, which is what the layer2 pass blends with
+					float s = (u + 0.5f) / density;
+
+					float a = ((s >= t) ? (a0 + (s * (a1 - a0)) + (t * (a2 - a1))) : (a0 + (t * (a3 - a0)) + (s * (a2 - a3))));
+
+					BYTE* in = &lpBlend->Data[(((gy % lpBlend->Height) * lpBlend->Width) + (gx % lpBlend->Width)) * 4];
+
+					out[0] = (BYTE)(out[0] + ((in[0] - out[0]) * a) + 0.5f);
+					out[1] = (BYTE)(out[1] + ((in[1] - out[1]) * a) + 0.5f);
+					out[2] = (BYTE)(out[2] + ((in[2] - out[2]) * a) + 0.5f);
+				}
+			}
+		}
+	}
+}
+
+bool CTerrainSplat::IsValidDensity(int density)
+{
+	return (density >= TERRAIN_SPLAT_MIN_DENSITY && density <= TERRAIN_SPLAT_SOURCE_DENSITY && (density & (density - 1)) == 0);
+}
+
+int CTerrainSplat::GetChunkIndex(int x, int y)
+{
+	return (((y / TERRAIN_SPLAT_CHUNK_TILES) * TERRAIN_SPLAT_CHUNK_SIDE) + (x / TERRAIN_SPLAT_CHUNK_TILES));
+}
+
+void CTerrainSplat::GetTilePath(char* directory, int tile, char* path)
+{
+	// Same order as the BITMAP_MAPTILE slots, the extended tiles follow the fixed ones
+	if (tile < (sizeof(TerrainSplatTileName) / sizeof(TerrainSplatTileName[0])))
+	{
+		wsprintf(path, "%s\\%s.OZJ", directory, TerrainSplatTileName[tile]);
+	}
+	else
+	{
+		wsprintf(path, "%s\\ExtTile%02d.OZJ", directory, (tile - (sizeof(TerrainSplatTileName) / sizeof(TerrainSplatTileName[0])) + 1));
+	}
+}
+
+void CTerrainSplat::GetSourceStamp(char* directory, int world, TERRAIN_SPLAT_HEADER* lpHeader)
+{
+	char path[MAX_PATH];
+
+	CTerrainPackage::GetSourcePath(directory, world, TERRAIN_SOURCE_MAP, path);
+
+	GetSplatStamp(path, &lpHeader->Map);
+
+	for (int n = 0; n < TERRAIN_SPLAT_TILE_COUNT; n++)
+	{
+		CTerrainSplat::GetTilePath(directory, n, path);
+
+		GetSplatStamp(path, &lpHeader->Tile[n]);
+	}
+}
+
+bool CTerrainSplat::LoadTile(char* path, int density, CTextureDecoder* lpDecoder, CTextureBufferPool* lpPool, TERRAIN_SPLAT_TILE* lpTile)
+{
+	lpTile->Width = 0;
+
+	lpTile->Height = 0;
+
+	lpTile->Data.clear();
+
+	TEXTURE_IMAGE image;
+
+	if (GetFileAttributes(path) == INVALID_FILE_ATTRIBUTES || lpDecoder->Decode(path, lpPool, &image) == 0)
+	{
+		return false;
+	}
+
+	// The client maps 64 texels of every tile texture onto one cell, filtered down to the baked density first
+	int steps = 0;
+
+	while ((TERRAIN_SPLAT_SOURCE_DENSITY >> steps) > density)
+	{
+		steps++;
+	}
+
+	TEXTURE_FILTER_OPTION option;
+
+	option.Filter = TEXTURE_FILTER_KAISER;
+
+	option.Gamma = 1;
+
+	option.Premultiply = 0;
+
+	option.Coverage = 0.0f;
+
+	option.Simd = 1;
+
+	CTextureFilter::Downsample(image.Data, image.Width, image.Height, steps, &option, lpTile->Data, &lpTile->Width, &lpTile->Height);
+
+	lpPool->Free(image.Data, image.Capacity);
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "BcEncoder.h"
+#include "TerrainPackage.h"
+#include "TextureFilter.h"
+
+#define TERRAIN_SPLAT_MAGIC 0x4C505342 // "BSPL"
+#define TERRAIN_SPLAT_VERSION 1
+#define TERRAIN_SPLAT_NAME "TerrainSplat.bts"
+#define TERRAIN_SPLAT_ALIGN 16
+#define TERRAIN_SPLAT_CHUNK_TILES 16
+#define TERRAIN_SPLAT_CHUNK_SIDE (TERRAIN_SIZE / TERRAIN_SPLAT_CHUNK_TILES)
+#define TERRAIN_SPLAT_CHUNK_COUNT (TERRAIN_SPLAT_CHUNK_SIDE * TERRAIN_SPLAT_CHUNK_SIDE)
+#define TERRAIN_SPLAT_SOURCE_DENSITY 64 // Texels per tile the client maps from every tile texture
+#define TERRAIN_SPLAT_MIN_DENSITY 4
+#define TERRAIN_SPLAT_DEFAULT_DENSITY 16
+#define TERRAIN_SPLAT_MAX_LEVEL 12
+#define TERRAIN_SPLAT_TILE_COUNT 30
+#define TERRAIN_SPLAT_TILE_NONE 0xFF
+#define TERRAIN_SPLAT_TILE_WATER 5
+
+#define GL_CLAMP_TO_EDGE 0x812F
+
+struct TERRAIN_SPLAT_LEVEL
+{
+	WORD Width;
+	WORD Height;
+	DWORD Offset; // From the start of the chunk
+	DWORD Size;
+};
+
+struct TERRAIN_SPLAT_CHUNK
+{
+	DWORD Offset;
+	WORD WaterCount; // Cells that still need the scrolling water pass
+	WORD MissingCount; // Cells that use a tile texture the world does not have
+};
+
+struct TERRAIN_SPLAT_HEADER
+{
+	DWORD Magic;
+	WORD Version;
+	WORD Density;
+	WORD ChunkTiles;
+	WORD LevelCount;
+	DWORD ChunkSize;
+	TERRAIN_PACKAGE_SOURCE Map;
+	TERRAIN_PACKAGE_SOURCE Tile[TERRAIN_SPLAT_TILE_COUNT];
+	TERRAIN_SPLAT_LEVEL Level[TERRAIN_SPLAT_MAX_LEVEL];
+	TERRAIN_SPLAT_CHUNK Chunk[TERRAIN_SPLAT_CHUNK_COUNT];
+};
+
+struct TERRAIN_SPLAT_INFO
+{
+	DWORD FileSize;
+	DWORD TileCount; // Tile textures found in the world directory
+	DWORD WaterCount;
+	DWORD MissingCount;
+	BC_ERROR Error;
+};
+
+struct TERRAIN_SPLAT_TILE
+{
+	int Width;
+	int Height;
+	std::vector<BYTE> Data; // RGBA at the baked density, empty when the texture is missing
+};
+
+class CTerrainSplat
+{
+public:
+
+	CTerrainSplat();
+
+	~CTerrainSplat();
+
+	bool Open(char* directory, int world);
+
+	bool Load(char* directory, int world, int density, CTextureDecoder* lpDecoder, CTextureBufferPool* lpPool);
+
+	void Close();
+
+	bool IsOpen();
+
+	int GetDensity();
+
+	TERRAIN_SPLAT_CHUNK* GetChunk(int index);
+
+	bool Upload(int index, DWORD FirstLevel);
+
+	static bool Bake(char* directory, int world, int density, CTextureDecoder* lpDecoder, CTextureBufferPool* lpPool, TERRAIN_SPLAT_INFO* lpInfo);
+
+	static void BakeChunk(TERRAIN_DATA* lpData, TERRAIN_SPLAT_TILE* lpTile, int density, int index, BYTE* rgba, TERRAIN_SPLAT_CHUNK* lpChunk);
+
+	static bool IsValidDensity(int density);
+
+	static int GetChunkIndex(int x, int y);
+
+	static void GetTilePath(char* directory, int tile, char* path);
+
+private:
+
+	static void GetSourceStamp(char* directory, int world, TERRAIN_SPLAT_HEADER* lpHeader);
+
+	static bool LoadTile(char* path, int density, CTextureDecoder* lpDecoder, CTextureBufferPool* lpPool, TERRAIN_SPLAT_TILE* lpTile);
+
+private:
+
+	CMappedFile m_File;
+
+	TERRAIN_SPLAT_HEADER* m_Header;
+};
\ No newline at end of file
@@ -0,0 +1,278 @@
+#include "stdafx.h"
+#include "TextureCache.h"
+#include "CCRC32.H"
+#include "DataPack.h"
+#include "MappedFile.h"
+#include "TextureQuality.h"
+
+CTextureCache gTextureCache;
+
+CTextureCache::CTextureCache()
+{
+	this->m_RefCount = 0;
+
+	this->m_Size = 0;
+
+	this->m_SharedSize = 0;
+
+	InitializeCriticalSection(&this->m_Lock);
+}
+
+CTextureCache::~CTextureCache()
+{
+	this->Clear();
+
+	DeleteCriticalSection(&this->m_Lock);
+}
+
+TEXTURE_CACHE_ENTRY* CTextureCache::Load(char* path, CTextureDecoder* lpDecoder)
+{
+	// Identical files in other folders get the image already decoded for the first one
+	DWORD prefix = 0;
+
+	int type = CTextureDecoder::GetType(path, &prefix);
+
+	if (type == TEXTURE_TYPE_NONE)
+	{
+		return 0;
+	}
+
+	TEXTURE_CACHE_KEY key;
+
+	DATA_PACK_VIEW view;
+
+	CMappedFile file;
+
+	int index = gDataPack.Find(path);
+
+	if (index != -1 && gDataPack.IsCurrent(index) != 0 && gDataPack.GetView(index, &view) != 0)
+	{
+		key.Crc = gDataPack.GetEntry(index)->Crc;
+	}
+	else if (file.Open(path) != 0)
+	{
+		view.Data = file.GetData();
+
+		view.Size = file.GetSize();
+
+		view.Buffer = 0;
+
+		// Loose files are hashed here, still far cheaper than the decode it can save
+		CCRC32 CRC32;
+
+		key.Crc = (DWORD)CRC32.FullCRC(view.Data, view.Size);
+	}
+	else
+	{
+		return 0;
+	}
+
+	key.Size = view.Size;
+
+	key.Quality = gTextureQuality.GetPathQuality(path);
+
+	EnterCriticalSection(&this->m_Lock);
+
+	std::map<TEXTURE_CACHE_KEY, TEXTURE_CACHE_ENTRY>::iterator it = this->m_Entry.find(key);
+
+	if (it != this->m_Entry.end())
+	{
+		it->second.RefCount++;
+
+		this->m_RefCount++;
+
+		this->m_SharedSize += it->second.Image.Capacity;
+
+		LeaveCriticalSection(&this->m_Lock);
+
+		gDataPack.ReleaseView(&view);
+
+		return &it->second;
+	}
+
+	LeaveCriticalSection(&this->m_Lock);
+
+	TEXTURE_IMAGE image;
+
+	SHARED_CACHE_DATA shared;
+
+	if (this->LoadShared(&key, &image, &shared) == 0)
+	{
+		bool result = (view.Size > prefix && lpDecoder->Decode((view.Data + prefix), (view.Size - prefix), type, &this->m_Pool, &image) != 0);
+
+		gDataPack.ReleaseView(&view);
+
+		if (result == 0)
+		{
+			return 0;
+		}
+
+		CTextureQuality::Apply(key.Quality, &image, &this->m_Pool);
+
+		SHARED_CACHE_KEY SharedKey = { key.Crc, key.Size, SHARED_CACHE_TEXTURE, (WORD)key.Quality };
+
+		int info[2] = { image.Width, image.Height };
+
+		// Other clients map the published copy, this one swaps to it too so the pixels are held once
+		if (gSharedCache.Publish(&SharedKey, image.Data, (image.Width * image.Height * 4), info, &shared) != 0)
+		{
+			this->m_Pool.Free(image.Data, image.Capacity);
+
+			image.Width = shared.Info[0];
+
+			image.Height = shared.Info[1];
+
+			image.Data = shared.Data;
+
+			image.Capacity = shared.Size;
+		}
+	}
+	else
+	{
+		gDataPack.ReleaseView(&view);
+	}
+
+	EnterCriticalSection(&this->m_Lock);
+
+	// Another thread may have decoded the same content meanwhile, the first image in stays
+	std::pair<std::map<TEXTURE_CACHE_KEY, TEXTURE_CACHE_ENTRY>::iterator, bool> insert = this->m_Entry.insert(std::make_pair(key, TEXTURE_CACHE_ENTRY()));
+
+	TEXTURE_CACHE_ENTRY* lpEntry = &insert.first->second;
+
+	if (insert.second != 0)
+	{
+		lpEntry->Key = key;
+
+		lpEntry->RefCount = 0;
+
+		lpEntry->Image = image;
+
+		lpEntry->Shared = shared;
+
+		this->m_Size += image.Capacity;
+	}
+	else
+	{
+		this->m_SharedSize += lpEntry->Image.Capacity;
+	}
+
+	lpEntry->RefCount++;
+
+	this->m_RefCount++;
+
+	LeaveCriticalSection(&this->m_Lock);
+
+	if (insert.second == 0)
+	{
+		this->FreeImage(&image, &shared);
+	}
+
+	return lpEntry;
+}
+
+void CTextureCache::Release(TEXTURE_CACHE_ENTRY* lpEntry)
+{
+	EnterCriticalSection(&this->m_Lock);
+
+	this->m_RefCount--;
+
+	if ((--lpEntry->RefCount) > 0)
+	{
+		this->m_SharedSize -= lpEntry->Image.Capacity;
+
+		LeaveCriticalSection(&this->m_Lock);
+		return;
+	}
+
+	TEXTURE_IMAGE image = lpEntry->Image;
+
+	SHARED_CACHE_DATA shared = lpEntry->Shared;
+
+	this->m_Size -= image.Capacity;
+
+	this->m_Entry.erase(lpEntry->Key);
+
+	LeaveCriticalSection(&this->m_Lock);
+
+	this->FreeImage(&image, &shared);
+}
+
+void CTextureCache::Clear()
+{
+	EnterCriticalSection(&this->m_Lock);
+
+	for (std::map<TEXTURE_CACHE_KEY, TEXTURE_CACHE_ENTRY>::iterator it = this->m_Entry.begin(); it != this->m_Entry.end(); it++)
+	{
+		this->FreeImage(&it->second.Image, &it->second.Shared);
+	}
+
+	this->m_Entry.clear();
+
+	this->m_RefCount = 0;
+
+	this->m_Size = 0;
+
+	this->m_SharedSize = 0;
+
+	LeaveCriticalSection(&this->m_Lock);
+
+	this->m_Pool.Clear();
+}
+
+int CTextureCache::GetCount()
+{
+	return this->m_Entry.size();
+}
+
+int CTextureCache::GetRefCount()
+{
+	return this->m_RefCount;
+}
+
+DWORD CTextureCache::GetSize()
+{
+	return this->m_Size;
+}
+
+DWORD CTextureCache::GetSharedSize()
+{
+	return this->m_SharedSize;
+}
+
+bool CTextureCache::LoadShared(TEXTURE_CACHE_KEY* lpKey, TEXTURE_IMAGE* lpImage, SHARED_CACHE_DATA* lpShared)
+{
+	SHARED_CACHE_KEY key = { lpKey->Crc, lpKey->Size, SHARED_CACHE_TEXTURE, (WORD)lpKey->Quality };
+
+	if (gSharedCache.Acquire(&key, lpShared) == 0)
+	{
+		return false;
+	}
+
+	if (lpShared->Info[0] <= 0 || lpShared->Info[1] <= 0 || lpShared->Size != (DWORD)(lpShared->Info[0] * lpShared->Info[1] * 4))
+	{
+		gSharedCache.Release(lpShared);
+		return false;
+	}
+
+	lpImage->Width = lpShared->Info[0];
+
+	lpImage->Height = lpShared->Info[1];
+
+	lpImage->Data = lpShared->Data;
+
+	lpImage->Capacity = lpShared->Size;
+
+	return true;
+}
+
+void CTextureCache::FreeImage(TEXTURE_IMAGE* lpImage, SHARED_CACHE_DATA* lpShared)
+{
+	if (lpShared->Mapping != 0)
+	{
+		gSharedCache.Release(lpShared);
+	}
+	else
+	{
+		this->m_Pool.Free(lpImage->Data, lpImage->Capacity);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "SharedCache.h"
+#include "TextureDecoder.h"
+
+struct TEXTURE_CACHE_KEY
+{
+	DWORD Crc; // CCRC32 of the file as stored, from the pack index when the file is packed
+	DWORD Size;
+	int Quality; // The same file can be decoded at another tier for another category
+
+	bool operator<(const TEXTURE_CACHE_KEY& other) const
+	{
+		return ((this->Crc != other.Crc) ? (this->Crc < other.Crc) : ((this->Size != other.Size) ? (this->Size < other.Size) : (this->Quality < other.Quality)));
+	}
+};
+
+struct TEXTURE_CACHE_ENTRY
+{
+	TEXTURE_CACHE_KEY Key;
+	int RefCount;
+	TEXTURE_IMAGE Image;
+	SHARED_CACHE_DATA Shared; // Image.Data points into it when another client decoded the file first
+};
+
+class CTextureCache
+{
+public:
+
+	CTextureCache();
+
+	~CTextureCache();
+
+	TEXTURE_CACHE_ENTRY* Load(char* path, CTextureDecoder* lpDecoder);
+
+	void Release(TEXTURE_CACHE_ENTRY* lpEntry);
+
+	void Clear();
+
+	int GetCount();
+
+	int GetRefCount();
+
+	DWORD GetSize();
+
+	DWORD GetSharedSize();
+
+private:
+
+	bool LoadShared(TEXTURE_CACHE_KEY* lpKey, TEXTURE_IMAGE* lpImage, SHARED_CACHE_DATA* lpShared);
+
+	void FreeImage(TEXTURE_IMAGE* lpImage, SHARED_CACHE_DATA* lpShared);
+
+private:
+
+	std::map<TEXTURE_CACHE_KEY, TEXTURE_CACHE_ENTRY> m_Entry;
+
+	int m_RefCount;
+
+	DWORD m_Size; // Decoded bytes held
+
+	DWORD m_SharedSize; // Decoded bytes that would be held twice without the cache
+
+	CTextureBufferPool m_Pool;
+
+	CRITICAL_SECTION m_Lock;
+};
+
+extern CTextureCache gTextureCache;
\ No newline at end of file
@@ -0,0 +1,383 @@
+#include "stdafx.h"
+#include "TextureCook.h"
+
+static DWORD AlignTextureOffset(DWORD offset)
+{
+	return ((offset + (TEXTURE_COOK_ALIGN - 1)) & ~(TEXTURE_COOK_ALIGN - 1));
+}
+
+bool CTextureCook::CookFile(char* path, CTextureDecoder* lpDecoder, CTextureBufferPool* lpPool, TEXTURE_COOK_INFO* lpInfo)
+{
+	DWORD prefix = 0;
+
+	int type = CTextureDecoder::GetType(path, &prefix);
+
+	CMappedFile file;
+
+	if (type == TEXTURE_TYPE_NONE || file.Open(path) == 0 || file.GetSize() <= prefix)
+	{
+		return false;
+	}
+
+	TEXTURE_IMAGE image;
+
+	if (lpDecoder->Decode((file.GetData() + prefix), (file.GetSize() - prefix), type, lpPool, &image) == 0)
+	{
+		return false;
+	}
+
+	CCRC32 CRC32;
+
+	DWORD crc = CRC32.FullCRC(file.GetData(), file.GetSize());
+
+	std::vector<BYTE> data;
+
+	bool result = CTextureCook::Cook(&image, crc, file.GetSize(), data, lpInfo);
+
+	lpPool->Free(image.Data, image.Capacity);
+
+	if (result == 0)
+	{
+		return false;
+	}
+
+	char CookPath[MAX_PATH];
+
+	wsprintf(CookPath, "%s%s", path, TEXTURE_COOK_EXTENSION);
+
+	char temp[MAX_PATH];
+
+	wsprintf(temp, "%s.tmp", CookPath);
+
+	HANDLE handle = CreateFile(temp, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_ARCHIVE, 0);
+
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	DWORD OutSize = 0;
+
+	if (WriteFile(handle, &data[0], data.size(), &OutSize, 0) == 0 || OutSize != data.size())
+	{
+		CloseHandle(handle);
+		DeleteFile(temp);
+		return false;
+	}
+
+	CloseHandle(handle);
+
+	if (MoveFileEx(temp, CookPath, MOVEFILE_REPLACE_EXISTING) == 0)
+	{
+		DeleteFile(temp);
+		return false;
+	}
+
+	return true;
+}
+
+bool CTextureCook::Cook(TEXTURE_IMAGE* lpImage, DWORD crc, DWORD size, std::vector<BYTE>& data, TEXTURE_COOK_INFO* lpInfo)
+{
+	memset(lpInfo, 0, sizeof(TEXTURE_COOK_INFO));
+
+	if (lpImage->Width <= 0 || lpImage->Height <= 0 || lpImage->Width > 0xFFFF || lpImage->Height > 0xFFFF)
+	{
+		return false;
+	}
+
+	bool alpha = CTextureCook::HasAlpha(lpImage);
+
+	// Gamma correct Kaiser chain down to 1x1, alpha tested textures keep their coverage at the usual 0.5 reference
+	TEXTURE_FILTER_OPTION option;
+
+	option.Filter = TEXTURE_FILTER_KAISER;
+
+	option.Gamma = 1;
+
+	option.Premultiply = 0;
+
+	option.Coverage = ((CTextureFilter::IsCutout(lpImage->Data, (lpImage->Width * lpImage->Height)) != 0) ? TEXTURE_COOK_ALPHA_REFERENCE : 0.0f);
+
+	option.Simd = 1;
+
+	std::vector<TEXTURE_MIP_LEVEL> chain;
+
+	int LevelCount = CTextureFilter::BuildMipChain(lpImage->Data, lpImage->Width, lpImage->Height, &option, chain);
+
+	LevelCount = ((LevelCount > TEXTURE_COOK_MAX_LEVEL) ? TEXTURE_COOK_MAX_LEVEL : LevelCount);
+
+	// Every level starts on an aligned offset so it can be uploaded straight from the mapping
+	TEXTURE_COOK_LEVEL level[TEXTURE_COOK_MAX_LEVEL];
+
+	DWORD offset = AlignTextureOffset(sizeof(TEXTURE_COOK_HEADER) + (TEXTURE_COOK_MAX_LEVEL * sizeof(TEXTURE_COOK_LEVEL)));
+
+	for (int n = 0; n < LevelCount; n++)
+	{
+		level[n].Width = (WORD)chain[n].Width;
+
+		level[n].Height = (WORD)chain[n].Height;
+
+		level[n].Offset = offset;
+
+		level[n].Size = CBcEncoder::GetImageSize(chain[n].Width, chain[n].Height, alpha);
+
+		offset = AlignTextureOffset(offset + level[n].Size);
+
+		lpInfo->DecodedSize += chain[n].Width * chain[n].Height * 4;
+	}
+
+	data.assign(offset, 0);
+
+	TEXTURE_COOK_HEADER* lpHeader = (TEXTURE_COOK_HEADER*)&data[0];
+
+	lpHeader->Magic = TEXTURE_COOK_MAGIC;
+
+	lpHeader->Version = TEXTURE_COOK_VERSION;
+
+	lpHeader->LevelCount = (WORD)LevelCount;
+
+	lpHeader->SourceCRC = crc;
+
+	lpHeader->SourceSize = size;
+
+	lpHeader->Width = (WORD)lpImage->Width;
+
+	lpHeader->Height = (WORD)lpImage->Height;
+
+	lpHeader->Format = ((alpha != 0) ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT);
+
+	memcpy(&data[sizeof(TEXTURE_COOK_HEADER)], level, (LevelCount * sizeof(TEXTURE_COOK_LEVEL)));
+
+	for (int n = 0; n < LevelCount; n++)
+	{
+		CBcEncoder::EncodeImage(&chain[n].Data[0], level[n].Width, level[n].Height, alpha, &data[level[n].Offset]);
+	}
+
+	// Quality is reported on the top level, the one that is on screen most of the time
+	std::vector<BYTE> decoded(lpImage->Width * lpImage->Height * 4);
+
+	CBcEncoder::DecodeImage(&data[level[0].Offset], lpImage->Width, lpImage->Height, alpha, &decoded[0]);
+
+	CBcEncoder::GetError(lpImage->Data, &decoded[0], lpImage->Width, lpImage->Height, &lpInfo->Error);
+
+	lpInfo->SourceCRC = crc;
+
+	lpInfo->SourceSize = size;
+
+	lpInfo->CookedSize = data.size();
+
+	lpInfo->Width = lpImage->Width;
+
+	lpInfo->Height = lpImage->Height;
+
+	lpInfo->LevelCount = LevelCount;
+
+	lpInfo->Alpha = alpha;
+
+	return true;
+}
+
+bool CTextureCook::HasAlpha(TEXTURE_IMAGE* lpImage)
+{
+	for (int n = 0; n < (lpImage->Width * lpImage->Height); n++)
+	{
+		if (lpImage->Data[(n * 4) + 3] != 0xFF)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+CTextureCookedImage::CTextureCookedImage()
+{
+	this->m_Header = 0;
+
+	this->m_Level = 0;
+}
+
+CTextureCookedImage::~CTextureCookedImage()
+{
+	this->Close();
+}
+
+bool CTextureCookedImage::Open(char* path, DWORD crc, DWORD size)
+{
+	this->Close();
+
+	if (this->m_File.Open(path) == 0)
+	{
+		return false;
+	}
+
+	BYTE* data = this->m_File.GetData();
+
+	DWORD FileSize = this->m_File.GetSize();
+
+	this->m_Header = (TEXTURE_COOK_HEADER*)data;
+
+	if (FileSize < (sizeof(TEXTURE_COOK_HEADER) + (TEXTURE_COOK_MAX_LEVEL * sizeof(TEXTURE_COOK_LEVEL))) || this->m_Header->Magic != TEXTURE_COOK_MAGIC || this->m_Header->Version != TEXTURE_COOK_VERSION)
+	{
+		this->Close();
+
+		return false;
+	}
+
+	if (this->m_Header->SourceCRC != crc || this->m_Header->SourceSize != size)
+	{
+		this->Close();
+
+		return false;
+	}
+
+	if (this->m_Header->LevelCount == 0 || this->m_Header->LevelCount > TEXTURE_COOK_MAX_LEVEL)
+	{
+		this->Close();
+
+		return false;
+	}
+
+	bool alpha = (this->m_Header->Format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT);
+
+	this->m_Level = (TEXTURE_COOK_LEVEL*)(data + sizeof(TEXTURE_COOK_HEADER));
+
+	for (DWORD n = 0; n < this->m_Header->LevelCount; n++)
+	{
+		TEXTURE_COOK_LEVEL* lpLevel = &this->m_Level[n];
+
+		if (lpLevel->Size != CBcEncoder::GetImageSize(lpLevel->Width, lpLevel->Height, alpha) || lpLevel->Offset > FileSize || lpLevel->Size > (FileSize - lpLevel->Offset))
+		{
+			this->Close();
+
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void CTextureCookedImage::Close()
+{
+	this->m_File.Close();
+
+	this->m_Header = 0;
+
+	this->m_Level = 0;
+}
+
+DWORD CTextureCookedImage::GetFormat()
+{
+	return ((this->m_Header != 0) ? this->m_Header->Format : 0);
+}
+
+DWORD CTextureCookedImage::GetLevelCount()
+{
+	return ((this->m_Header != 0) ? this->m_Header->LevelCount : 0);
+}
+
+TEXTURE_COOK_LEVEL* CTextureCookedImage::GetLevel(DWORD index)
+{
+	return ((index < this->GetLevelCount()) ? &this->m_Level[index] : 0);
+}
+
+BYTE* CTextureCookedImage::GetLevelData(TEXTURE_COOK_LEVEL* lpLevel)
+{
+	return (this->m_File.GetData() + lpLevel->Offset);
+}
+
+bool CTextureCookedImage::Upload(DWORD FirstLevel)
+{
+	static PFNGLCOMPRESSEDTEXIMAGE2DARBPROC glCompressedTexImage2DARB = (PFNGLCOMPRESSEDTEXIMAGE2DARBPROC)wglGetProcAddress("glCompressedTexImage2DARB");
+
+	if (glCompressedTexImage2DARB == 0 || CTextureCookedImage::IsSupported() == 0 || FirstLevel >= this->GetLevelCount())
+	{
+		return false;
+	}
+
+	// Uploads into the texture bound to GL_TEXTURE_2D straight from the mapped file, lower tiers start further down the chain
+	for (DWORD n = FirstLevel; n < this->GetLevelCount(); n++)
+	{
+		TEXTURE_COOK_LEVEL* lpLevel = this->GetLevel(n);
+
+		glCompressedTexImage2DARB(GL_TEXTURE_2D, (n - FirstLevel), this->GetFormat(), lpLevel->Width, lpLevel->Height, 0, lpLevel->Size, this->GetLevelData(lpLevel));
+	}
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (((this->GetLevelCount() - FirstLevel) > 1) ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR));
+
+	return true;
+}
+
+bool CTextureCookedImage::IsSupported()
+{
+	static int supported = -1;
+
+	if (supported == -1)
+	{
+		char* extensions = (char*)glGetString(GL_EXTENSIONS);
+
+		supported = ((extensions != 0 && strstr(extensions, "GL_EXT_texture_compression_s3tc") != 0) ? 1 : 0);
+	}
+
+	return (supported != 0);
+}
+
+bool CTextureCookedImage::LoadTexture(char* path, CTextureDecoder* lpDecoder, CTextureBufferPool* lpPool)
+{
+	DWORD prefix = 0;
+
+	int type = CTextureDecoder::GetType(path, &prefix);
+
+	CMappedFile file;
+
+	if (type == TEXTURE_TYPE_NONE || file.Open(path) == 0 || file.GetSize() <= prefix)
+	{
+		return false;
+	}
+
+	CCRC32 CRC32;
+
+	DWORD crc = CRC32.FullCRC(file.GetData(), file.GetSize());
+
+	char CookPath[MAX_PATH];
+
+	wsprintf(CookPath, "%s%s", path, TEXTURE_COOK_EXTENSION);
+
+	int quality = gTextureQuality.GetPathQuality(path);
+
+	CTextureCookedImage cooked;
+
+	if (cooked.Open(CookPath, crc, file.GetSize()) != 0)
+	{
+		// The cache always holds the full chain, a lower tier skips the top levels with the same minimum size as the decoder path
+		DWORD FirstLevel = 0;
+
+		while ((int)FirstLevel < quality && (FirstLevel + 1) < cooked.GetLevelCount() && cooked.GetLevel(FirstLevel + 1)->Width >= TEXTURE_QUALITY_MIN_SIZE && cooked.GetLevel(FirstLevel + 1)->Height >= TEXTURE_QUALITY_MIN_SIZE)
+		{
+			FirstLevel++;
+		}
+
+		if (cooked.Upload(FirstLevel) != 0)
+		{
+			return true;
+		}
+	}
+
+	// Missing or stale cache, decode the original file like before
+	TEXTURE_IMAGE image;
+
+	if (lpDecoder->Decode((file.GetData() + prefix), (file.GetSize() - prefix), type, lpPool, &image) == 0)
+	{
+		return false;
+	}
+
+	CTextureQuality::Apply(quality, &image, lpPool);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.Width, image.Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.Data);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+	lpPool->Free(image.Data, image.Capacity);
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "BcEncoder.h"
+#include "CCRC32.H"
+#include "MappedFile.h"
+#include "TextureDecoder.h"
+#include "TextureFilter.h"
+#include "TextureQuality.h"
+
+#define TEXTURE_COOK_MAGIC 0x43545842 // "BXTC"
+#define TEXTURE_COOK_VERSION 2
+#define TEXTURE_COOK_EXTENSION ".btc"
+#define TEXTURE_COOK_ALIGN 16
+#define TEXTURE_COOK_MAX_LEVEL 16
+#define TEXTURE_COOK_ALPHA_REFERENCE 0.5f
+
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+
+typedef void (APIENTRY* PFNGLCOMPRESSEDTEXIMAGE2DARBPROC)(GLenum target, GLint level, GLenum format, GLsizei width, GLsizei height, GLint border, GLsizei size, const GLvoid* data);
+
+struct TEXTURE_COOK_HEADER
+{
+	DWORD Magic;
+	WORD Version;
+	WORD LevelCount;
+	DWORD SourceCRC;
+	DWORD SourceSize;
+	WORD Width;
+	WORD Height;
+	DWORD Format;
+};
+
+struct TEXTURE_COOK_LEVEL
+{
+	WORD Width;
+	WORD Height;
+	DWORD Offset;
+	DWORD Size;
+};
+
+struct TEXTURE_COOK_INFO
+{
+	DWORD SourceCRC;
+	DWORD SourceSize;
+	DWORD CookedSize;
+	DWORD DecodedSize;
+	DWORD Width;
+	DWORD Height;
+	DWORD LevelCount;
+	bool Alpha;
+	BC_ERROR Error;
+};
+
+class CTextureCook
+{
+public:
+
+	static bool CookFile(char* path, CTextureDecoder* lpDecoder, CTextureBufferPool* lpPool, TEXTURE_COOK_INFO* lpInfo);
+
+	static bool Cook(TEXTURE_IMAGE* lpImage, DWORD crc, DWORD size, std::vector<BYTE>& data, TEXTURE_COOK_INFO* lpInfo);
+
+	static bool HasAlpha(TEXTURE_IMAGE* lpImage);
+};
+
+class CTextureCookedImage
+{
+public:
+
+	CTextureCookedImage();
+
+	~CTextureCookedImage();
+
+	bool Open(char* path, DWORD crc, DWORD size);
+
+	void Close();
+
+	DWORD GetFormat();
+
+	DWORD GetLevelCount();
+
+	TEXTURE_COOK_LEVEL* GetLevel(DWORD index);
+
+	BYTE* GetLevelData(TEXTURE_COOK_LEVEL* lpLevel);
+
+	bool Upload(DWORD FirstLevel);
+
+	static bool IsSupported();
+
+	static bool LoadTexture(char* path, CTextureDecoder* lpDecoder, CTextureBufferPool* lpPool);
+
+private:
+
+	CMappedFile m_File;
+
+	TEXTURE_COOK_HEADER* m_Header;
+
+	TEXTURE_COOK_LEVEL* m_Level;
+};
\ No newline at end of file
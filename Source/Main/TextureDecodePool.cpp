@@ -0,0 +1,315 @@
+#include "stdafx.h"
+#include "TextureDecodePool.h"
+#include "TextureQuality.h"
+
+CTextureDecodePool::CTextureDecodePool()
+{
+	memset(this->m_Worker, 0, sizeof(this->m_Worker));
+
+	this->m_ThreadCount = 0;
+
+	this->m_NextWorker = 0;
+
+	this->m_NextIndex = 0;
+
+	this->m_PendingCount = 0;
+
+	this->m_StopEvent = 0;
+
+	this->m_JobSemaphore = 0;
+
+	this->m_ResultSemaphore = 0;
+
+	InitializeCriticalSection(&this->m_ResultLock);
+}
+
+CTextureDecodePool::~CTextureDecodePool()
+{
+	this->Stop();
+
+	DeleteCriticalSection(&this->m_ResultLock);
+}
+
+bool CTextureDecodePool::Start(int ThreadCount)
+{
+	this->Stop();
+
+	if (ThreadCount <= 0)
+	{
+		SYSTEM_INFO info;
+
+		GetSystemInfo(&info);
+
+		ThreadCount = info.dwNumberOfProcessors;
+	}
+
+	ThreadCount = ((ThreadCount > TEXTURE_DECODE_MAX_THREAD) ? TEXTURE_DECODE_MAX_THREAD : ThreadCount);
+
+	this->m_StopEvent = CreateEvent(0, 1, 0, 0);
+
+	this->m_JobSemaphore = CreateSemaphore(0, 0, 0x7FFFFFFF, 0);
+
+	this->m_ResultSemaphore = CreateSemaphore(0, 0, 0x7FFFFFFF, 0);
+
+	if (this->m_StopEvent == 0 || this->m_JobSemaphore == 0 || this->m_ResultSemaphore == 0)
+	{
+		this->Stop();
+		return false;
+	}
+
+	// Only workers with a running thread are counted, so a failed start leaves Stop nothing it did not create
+	for (int n = 0; n < ThreadCount; n++)
+	{
+		TEXTURE_DECODE_WORKER* lpWorker = new TEXTURE_DECODE_WORKER;
+
+		lpWorker->Pool = this;
+
+		lpWorker->Index = n;
+
+		lpWorker->Thread = 0;
+
+		InitializeCriticalSection(&lpWorker->Lock);
+
+		this->m_Worker[n] = lpWorker;
+
+		lpWorker->Thread = CreateThread(0, 0, CTextureDecodePool::WorkerThread, lpWorker, 0, 0);
+
+		if (lpWorker->Thread == 0)
+		{
+			DeleteCriticalSection(&lpWorker->Lock);
+
+			delete lpWorker;
+
+			this->m_Worker[n] = 0;
+
+			this->Stop();
+			return false;
+		}
+
+		this->m_ThreadCount = n + 1;
+	}
+
+	return true;
+}
+
+void CTextureDecodePool::Stop()
+{
+	if (this->m_StopEvent != 0)
+	{
+		SetEvent(this->m_StopEvent);
+	}
+
+	for (int n = 0; n < this->m_ThreadCount; n++)
+	{
+		TEXTURE_DECODE_WORKER* lpWorker = this->m_Worker[n];
+
+		if (lpWorker->Thread != 0)
+		{
+			WaitForSingleObject(lpWorker->Thread, INFINITE);
+
+			CloseHandle(lpWorker->Thread);
+		}
+
+		DeleteCriticalSection(&lpWorker->Lock);
+
+		delete lpWorker;
+
+		this->m_Worker[n] = 0;
+	}
+
+	this->m_ThreadCount = 0;
+
+	TEXTURE_DECODE_RESULT result;
+
+	while (this->GetResult(&result) != 0)
+	{
+		this->FreeResult(&result);
+	}
+
+	if (this->m_StopEvent != 0)
+	{
+		CloseHandle(this->m_StopEvent);
+	}
+
+	if (this->m_JobSemaphore != 0)
+	{
+		CloseHandle(this->m_JobSemaphore);
+	}
+
+	if (this->m_ResultSemaphore != 0)
+	{
+		CloseHandle(this->m_ResultSemaphore);
+	}
+
+	this->m_StopEvent = 0;
+
+	this->m_JobSemaphore = 0;
+
+	this->m_ResultSemaphore = 0;
+
+	this->m_PendingCount = 0;
+
+	this->m_BufferPool.Clear();
+}
+
+DWORD CTextureDecodePool::AddJob(char* path, DWORD param)
+{
+	if (this->m_ThreadCount == 0)
+	{
+		return 0;
+	}
+
+	TEXTURE_DECODE_JOB job;
+
+	job.Index = ++this->m_NextIndex;
+
+	job.Param = param;
+
+	strcpy_s(job.Path, path);
+
+	// Jobs are dealt round robin, idle workers steal from the other queues
+	TEXTURE_DECODE_WORKER* lpWorker = this->m_Worker[this->m_NextWorker];
+
+	this->m_NextWorker = (this->m_NextWorker + 1) % this->m_ThreadCount;
+
+	EnterCriticalSection(&lpWorker->Lock);
+
+	lpWorker->Queue.push_back(job);
+
+	LeaveCriticalSection(&lpWorker->Lock);
+
+	InterlockedIncrement(&this->m_PendingCount);
+
+	ReleaseSemaphore(this->m_JobSemaphore, 1, 0);
+
+	return job.Index;
+}
+
+bool CTextureDecodePool::GetResult(TEXTURE_DECODE_RESULT* lpResult)
+{
+	return this->WaitResult(lpResult, 0);
+}
+
+bool CTextureDecodePool::WaitResult(TEXTURE_DECODE_RESULT* lpResult, DWORD timeout)
+{
+	if (this->m_ResultSemaphore == 0 || WaitForSingleObject(this->m_ResultSemaphore, timeout) != WAIT_OBJECT_0)
+	{
+		return false;
+	}
+
+	EnterCriticalSection(&this->m_ResultLock);
+
+	*lpResult = this->m_Result.front();
+
+	this->m_Result.pop_front();
+
+	LeaveCriticalSection(&this->m_ResultLock);
+
+	InterlockedDecrement(&this->m_PendingCount);
+
+	return true;
+}
+
+void CTextureDecodePool::FreeResult(TEXTURE_DECODE_RESULT* lpResult)
+{
+	this->m_BufferPool.Free(lpResult->Image.Data, lpResult->Image.Capacity);
+
+	lpResult->Image.Data = 0;
+
+	lpResult->Image.Capacity = 0;
+}
+
+DWORD CTextureDecodePool::GetPendingCount()
+{
+	return this->m_PendingCount;
+}
+
+int CTextureDecodePool::GetThreadCount()
+{
+	return this->m_ThreadCount;
+}
+
+DWORD WINAPI CTextureDecodePool::WorkerThread(LPVOID lpParam)
+{
+	TEXTURE_DECODE_WORKER* lpWorker = (TEXTURE_DECODE_WORKER*)lpParam;
+
+	CTextureDecodePool* lpPool = lpWorker->Pool;
+
+	HANDLE handle[2] = { lpPool->m_StopEvent, lpPool->m_JobSemaphore };
+
+	while (WaitForMultipleObjects(2, handle, 0, INFINITE) == (WAIT_OBJECT_0 + 1))
+	{
+		// Every semaphore count stands for one queued job, it is always somewhere in the queues
+		TEXTURE_DECODE_JOB job;
+
+		while (lpPool->PopJob(lpWorker->Index, &job) == 0)
+		{
+			Sleep(0);
+		}
+
+		TEXTURE_DECODE_RESULT result;
+
+		result.Index = job.Index;
+
+		result.Param = job.Param;
+
+		memcpy(result.Path, job.Path, sizeof(result.Path));
+
+		result.Success = lpWorker->Decoder.Decode(job.Path, &lpPool->m_BufferPool, &result.Image);
+
+		if (result.Success != 0)
+		{
+			gTextureQuality.Apply(job.Path, &result.Image, &lpPool->m_BufferPool);
+		}
+
+		lpPool->PushResult(&result);
+	}
+
+	return 0;
+}
+
+bool CTextureDecodePool::PopJob(int index, TEXTURE_DECODE_JOB* lpJob)
+{
+	// The owner takes its newest job, thieves take the oldest one of another queue
+	for (int n = 0; n < this->m_ThreadCount; n++)
+	{
+		TEXTURE_DECODE_WORKER* lpWorker = this->m_Worker[(index + n) % this->m_ThreadCount];
+
+		EnterCriticalSection(&lpWorker->Lock);
+
+		if (lpWorker->Queue.empty() == 0)
+		{
+			if (n == 0)
+			{
+				*lpJob = lpWorker->Queue.back();
+
+				lpWorker->Queue.pop_back();
+			}
+			else
+			{
+				*lpJob = lpWorker->Queue.front();
+
+				lpWorker->Queue.pop_front();
+			}
+
+			LeaveCriticalSection(&lpWorker->Lock);
+
+			return true;
+		}
+
+		LeaveCriticalSection(&lpWorker->Lock);
+	}
+
+	return false;
+}
+
+void CTextureDecodePool::PushResult(TEXTURE_DECODE_RESULT* lpResult)
+{
+	EnterCriticalSection(&this->m_ResultLock);
+
+	this->m_Result.push_back(*lpResult);
+
+	LeaveCriticalSection(&this->m_ResultLock);
+
+	ReleaseSemaphore(this->m_ResultSemaphore, 1, 0);
+}
\ No newline at end of file
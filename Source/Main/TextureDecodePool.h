@@ -0,0 +1,90 @@
+#pragma once
+
+#include "TextureDecoder.h"
+
+#define TEXTURE_DECODE_MAX_THREAD 16
+
+struct TEXTURE_DECODE_JOB
+{
+	DWORD Index;
+	DWORD Param;
+	char Path[MAX_PATH];
+};
+
+struct TEXTURE_DECODE_RESULT
+{
+	DWORD Index;
+	DWORD Param;
+	char Path[MAX_PATH];
+	bool Success;
+	TEXTURE_IMAGE Image;
+};
+
+class CTextureDecodePool;
+
+struct TEXTURE_DECODE_WORKER
+{
+	CTextureDecodePool* Pool;
+	int Index;
+	HANDLE Thread;
+	CRITICAL_SECTION Lock;
+	std::deque<TEXTURE_DECODE_JOB> Queue;
+	CTextureDecoder Decoder;
+};
+
+class CTextureDecodePool
+{
+public:
+
+	CTextureDecodePool();
+
+	~CTextureDecodePool();
+
+	bool Start(int ThreadCount);
+
+	void Stop();
+
+	DWORD AddJob(char* path, DWORD param);
+
+	bool GetResult(TEXTURE_DECODE_RESULT* lpResult);
+
+	bool WaitResult(TEXTURE_DECODE_RESULT* lpResult, DWORD timeout);
+
+	void FreeResult(TEXTURE_DECODE_RESULT* lpResult);
+
+	DWORD GetPendingCount();
+
+	int GetThreadCount();
+
+private:
+
+	static DWORD WINAPI WorkerThread(LPVOID lpParam);
+
+	bool PopJob(int index, TEXTURE_DECODE_JOB* lpJob);
+
+	void PushResult(TEXTURE_DECODE_RESULT* lpResult);
+
+private:
+
+	TEXTURE_DECODE_WORKER* m_Worker[TEXTURE_DECODE_MAX_THREAD];
+
+	int m_ThreadCount;
+
+	int m_NextWorker;
+
+	DWORD m_NextIndex;
+
+	volatile LONG m_PendingCount;
+
+	HANDLE m_StopEvent;
+
+	HANDLE m_JobSemaphore;
+
+	HANDLE m_ResultSemaphore;
+
+	CRITICAL_SECTION m_ResultLock;
+
+	std::deque<TEXTURE_DECODE_RESULT> m_Result;
+
+	CTextureBufferPool m_BufferPool;
+};
\ No newline at end of file
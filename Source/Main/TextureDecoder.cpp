@@ -0,0 +1,254 @@
+#include "stdafx.h"
+#include "TextureDecoder.h"
+#include "MappedFile.h"
+
+#define TEXTURE_POOL_MIN_SIZE 0x1000
+#define TEXTURE_POOL_MAX_FREE 16
+
+CTextureBufferPool::CTextureBufferPool()
+{
+	InitializeCriticalSection(&this->m_Lock);
+}
+
+CTextureBufferPool::~CTextureBufferPool()
+{
+	this->Clear();
+
+	DeleteCriticalSection(&this->m_Lock);
+}
+
+BYTE* CTextureBufferPool::Alloc(DWORD size, DWORD* capacity)
+{
+	// Buffers come in power of two classes so a map change reuses the buffers of the previous one
+	DWORD value = TEXTURE_POOL_MIN_SIZE;
+
+	while (value < size)
+	{
+		value <<= 1;
+	}
+
+	*capacity = value;
+
+	EnterCriticalSection(&this->m_Lock);
+
+	std::map<DWORD, std::vector<BYTE*>>::iterator it = this->m_Free.find(value);
+
+	if (it != this->m_Free.end() && it->second.empty() == 0)
+	{
+		BYTE* data = it->second.back();
+
+		it->second.pop_back();
+
+		LeaveCriticalSection(&this->m_Lock);
+
+		return data;
+	}
+
+	LeaveCriticalSection(&this->m_Lock);
+
+	return new BYTE[value];
+}
+
+void CTextureBufferPool::Free(BYTE* data, DWORD capacity)
+{
+	if (data == 0)
+	{
+		return;
+	}
+
+	EnterCriticalSection(&this->m_Lock);
+
+	std::vector<BYTE*>* lpList = &this->m_Free[capacity];
+
+	if (lpList->size() < TEXTURE_POOL_MAX_FREE)
+	{
+		lpList->push_back(data);
+
+		data = 0;
+	}
+
+	LeaveCriticalSection(&this->m_Lock);
+
+	if (data != 0)
+	{
+		delete[] data;
+	}
+}
+
+void CTextureBufferPool::Clear()
+{
+	EnterCriticalSection(&this->m_Lock);
+
+	for (std::map<DWORD, std::vector<BYTE*>>::iterator it = this->m_Free.begin(); it != this->m_Free.end(); it++)
+	{
+		for (size_t n = 0; n < it->second.size(); n++)
+		{
+			delete[] it->second[n];
+		}
+	}
+
+	this->m_Free.clear();
+
+	LeaveCriticalSection(&this->m_Lock);
+}
+
+CTextureDecoder::CTextureDecoder()
+{
+
+}
+
+CTextureDecoder::~CTextureDecoder()
+{
+
+}
+
+int CTextureDecoder::GetType(char* path, DWORD* prefix)
+{
+	char* ext = strrchr(path, '.');
+
+	if (ext == 0)
+	{
+		return TEXTURE_TYPE_NONE;
+	}
+
+	if (_stricmp(ext, ".ozj") == 0)
+	{
+		*prefix = TEXTURE_OZJ_PREFIX;
+		return TEXTURE_TYPE_JPEG;
+	}
+
+	if (_stricmp(ext, ".ozt") == 0)
+	{
+		*prefix = TEXTURE_OZT_PREFIX;
+		return TEXTURE_TYPE_TGA;
+	}
+
+	if (_stricmp(ext, ".jpg") == 0)
+	{
+		*prefix = 0;
+		return TEXTURE_TYPE_JPEG;
+	}
+
+	if (_stricmp(ext, ".tga") == 0)
+	{
+		*prefix = 0;
+		return TEXTURE_TYPE_TGA;
+	}
+
+	return TEXTURE_TYPE_NONE;
+}
+
+bool CTextureDecoder::Decode(char* path, CTextureBufferPool* lpPool, TEXTURE_IMAGE* lpImage)
+{
+	memset(lpImage, 0, sizeof(TEXTURE_IMAGE));
+
+	DWORD prefix = 0;
+
+	int type = CTextureDecoder::GetType(path, &prefix);
+
+	if (type == TEXTURE_TYPE_NONE)
+	{
+		return false;
+	}
+
+	CMappedFile file;
+
+	if (file.Open(path) == 0 || file.GetSize() <= prefix)
+	{
+		return false;
+	}
+
+	return this->Decode((file.GetData() + prefix), (file.GetSize() - prefix), type, lpPool, lpImage);
+}
+
+bool CTextureDecoder::Decode(BYTE* data, DWORD size, int type, CTextureBufferPool* lpPool, TEXTURE_IMAGE* lpImage)
+{
+	memset(lpImage, 0, sizeof(TEXTURE_IMAGE));
+
+	switch (type)
+	{
+		case TEXTURE_TYPE_JPEG:
+			return this->DecodeJpeg(data, size, lpPool, lpImage);
+		case TEXTURE_TYPE_TGA:
+			return this->DecodeTga(data, size, lpPool, lpImage);
+	}
+
+	return false;
+}
+
+bool CTextureDecoder::DecodeJpeg(BYTE* data, DWORD size, CTextureBufferPool* lpPool, TEXTURE_IMAGE* lpImage)
+{
+	if (this->m_Jpeg.ReadHeader(data, size, &lpImage->Width, &lpImage->Height) == 0)
+	{
+		return false;
+	}
+
+	if (lpImage->Width <= 0 || lpImage->Height <= 0 || lpImage->Width > TEXTURE_MAX_SIZE || lpImage->Height > TEXTURE_MAX_SIZE)
+	{
+		memset(lpImage, 0, sizeof(TEXTURE_IMAGE));
+		return false;
+	}
+
+	lpImage->Data = lpPool->Alloc((DWORD)((QWORD)lpImage->Width * lpImage->Height * 4), &lpImage->Capacity);
+
+	if (this->m_Jpeg.Decode(lpImage->Data) == 0)
+	{
+		lpPool->Free(lpImage->Data, lpImage->Capacity);
+
+		memset(lpImage, 0, sizeof(TEXTURE_IMAGE));
+
+		return false;
+	}
+
+	return true;
+}
+
+bool CTextureDecoder::DecodeTga(BYTE* data, DWORD size, CTextureBufferPool* lpPool, TEXTURE_IMAGE* lpImage)
+{
+	// Only uncompressed true color images are used by the client
+	if (size < 18 || data[1] != 0 || data[2] != 2 || (data[16] != 24 && data[16] != 32))
+	{
+		return false;
+	}
+
+	int width = data[12] | (data[13] << 8);
+
+	int height = data[14] | (data[15] << 8);
+
+	int bytes = data[16] / 8;
+
+	DWORD offset = 18 + data[0];
+
+	// Sizes are checked in 64 bits, a corrupt header must not wrap them into a small buffer
+	if (width == 0 || height == 0 || width > TEXTURE_MAX_SIZE || height > TEXTURE_MAX_SIZE || (offset + ((QWORD)width * height * bytes)) > size)
+	{
+		return false;
+	}
+
+	lpImage->Width = width;
+
+	lpImage->Height = height;
+
+	lpImage->Data = lpPool->Alloc((DWORD)((QWORD)width * height * 4), &lpImage->Capacity);
+
+	bool TopOrigin = ((data[17] & 0x20) != 0);
+
+	for (int y = 0; y < height; y++)
+	{
+		BYTE* in = &data[offset + (((TopOrigin != 0) ? y : (height - 1 - y)) * width * bytes)];
+
+		BYTE* out = &lpImage->Data[y * width * 4];
+
+		for (int x = 0; x < width; x++)
+		{
+			out[0] = in[2];
+			out[1] = in[1];
+			out[2] = in[0];
+			out[3] = ((bytes == 4) ? in[3] : 0xFF);
+			out += 4;
+			in += bytes;
+		}
+	}
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "JpegDecoder.h"
+
+#define TEXTURE_OZJ_PREFIX 24
+#define TEXTURE_OZT_PREFIX 4
+#define TEXTURE_MAX_SIZE 4096
+
+enum eTextureType
+{
+	TEXTURE_TYPE_NONE = 0,
+	TEXTURE_TYPE_JPEG = 1,
+	TEXTURE_TYPE_TGA = 2,
+};
+
+struct TEXTURE_IMAGE
+{
+	int Width;
+	int Height;
+	BYTE* Data; // RGBA, top row first
+	DWORD Capacity;
+};
+
+class CTextureBufferPool
+{
+public:
+
+	CTextureBufferPool();
+
+	~CTextureBufferPool();
+
+	BYTE* Alloc(DWORD size, DWORD* capacity);
+
+	void Free(BYTE* data, DWORD capacity);
+
+	void Clear();
+
+private:
+
+	CRITICAL_SECTION m_Lock;
+
+	std::map<DWORD, std::vector<BYTE*>> m_Free;
+};
+
+class CTextureDecoder
+{
+public:
+
+	CTextureDecoder();
+
+	~CTextureDecoder();
+
+	bool Decode(char* path, CTextureBufferPool* lpPool, TEXTURE_IMAGE* lpImage);
+
+	bool Decode(BYTE* data, DWORD size, int type, CTextureBufferPool* lpPool, TEXTURE_IMAGE* lpImage);
+
+	static int GetType(char* path, DWORD* prefix);
+
+private:
+
+	bool DecodeJpeg(BYTE* data, DWORD size, CTextureBufferPool* lpPool, TEXTURE_IMAGE* lpImage);
+
+	bool DecodeTga(BYTE* data, DWORD size, CTextureBufferPool* lpPool, TEXTURE_IMAGE* lpImage);
+
+private:
+
+	CJpegDecoder m_Jpeg;
+};
\ No newline at end of file
@@ -0,0 +1,595 @@
+#include "stdafx.h"
+#include "TextureFilter.h"
+#include <emmintrin.h>
+
+struct TEXTURE_FILTER_TABLE
+{
+	float Linear[256];
+	BYTE Srgb[TEXTURE_FILTER_SRGB_SIZE];
+
+	TEXTURE_FILTER_TABLE()
+	{
+		for (int n = 0; n < 256; n++)
+		{
+			double value = n / 255.0;
+
+			this->Linear[n] = (float)((value <= 0.04045) ? (value / 12.92) : pow(((value + 0.055) / 1.055), 2.4));
+		}
+
+		for (int n = 0; n < TEXTURE_FILTER_SRGB_SIZE; n++)
+		{
+			double value = n / (double)(TEXTURE_FILTER_SRGB_SIZE - 1);
+
+			value = ((value <= 0.0031308) ? (value * 12.92) : ((1.055 * pow(value, (1.0 / 2.4))) - 0.055));
+
+			this->Srgb[n] = (BYTE)((value * 255.0) + 0.5);
+		}
+	}
+};
+
+struct TEXTURE_FILTER_KERNEL_SET
+{
+	TEXTURE_FILTER_KERNEL Kernel[2];
+
+	TEXTURE_FILTER_KERNEL_SET()
+	{
+		TEXTURE_FILTER_KERNEL* lpBox = &this->Kernel[TEXTURE_FILTER_BOX];
+
+		lpBox->TapCount = 2;
+
+		lpBox->Offset[0] = 0;
+		lpBox->Offset[1] = 1;
+
+		lpBox->Weight[0] = 0.5f;
+		lpBox->Weight[1] = 0.5f;
+
+		// Kaiser windowed sinc over 1.5 destination texels (alpha 4), six source taps around the 2:1 center
+		TEXTURE_FILTER_KERNEL* lpKaiser = &this->Kernel[TEXTURE_FILTER_KAISER];
+
+		lpKaiser->TapCount = 6;
+
+		double weight[6];
+
+		double total = 0.0;
+
+		for (int n = 0; n < 6; n++)
+		{
+			double t = (n - 2.5) / 2.0;
+
+			double sinc = ((t == 0.0) ? 1.0 : (sin(3.14159265358979 * t) / (3.14159265358979 * t)));
+
+			double x = t / 1.5;
+
+			weight[n] = sinc * (this->BesselI0(4.0 * sqrt(1.0 - (x * x))) / this->BesselI0(4.0));
+
+			total += weight[n];
+		}
+
+		for (int n = 0; n < 6; n++)
+		{
+			lpKaiser->Offset[n] = n - 2;
+
+			lpKaiser->Weight[n] = (float)(weight[n] / total);
+		}
+	}
+
+	double BesselI0(double x)
+	{
+		double sum = 1.0;
+
+		double term = 1.0;
+
+		for (int n = 1; n < 32; n++)
+		{
+			term *= (x / (2.0 * n)) * (x / (2.0 * n));
+
+			sum += term;
+		}
+
+		return sum;
+	}
+};
+
+static TEXTURE_FILTER_TABLE* GetFilterTable()
+{
+	static TEXTURE_FILTER_TABLE table;
+
+	return &table;
+}
+
+int CTextureFilter::BuildMipChain(BYTE* rgba, int width, int height, TEXTURE_FILTER_OPTION* lpOption, std::vector<TEXTURE_MIP_LEVEL>& chain)
+{
+	chain.clear();
+
+	if (width <= 0 || height <= 0)
+	{
+		return 0;
+	}
+
+	TEXTURE_FILTER_KERNEL* lpKernel = CTextureFilter::GetKernel(lpOption->Filter);
+
+	// Every level is filtered from the unscaled linear copy of the one above, the coverage scale only touches the stored texels
+	std::vector<float> linear(width * height * 4);
+
+	std::vector<float> temp;
+
+	CTextureFilter::ToLinear(rgba, (width * height), lpOption->Gamma, &linear[0], lpOption->Simd);
+
+	float target = ((lpOption->Coverage > 0.0f) ? CTextureFilter::GetLinearCoverage(&linear[0], (width * height), lpOption->Coverage, lpOption->Simd) : 0.0f);
+
+	chain.resize(1);
+
+	chain[0].Width = width;
+
+	chain[0].Height = height;
+
+	chain[0].Data.assign(rgba, rgba + (width * height * 4));
+
+	while (width > 1 || height > 1)
+	{
+		CTextureFilter::ReduceLevel(linear, &width, &height, lpKernel, temp, lpOption->Simd);
+
+		float scale = ((lpOption->Coverage > 0.0f) ? CTextureFilter::FindAlphaScale(&linear[0], (width * height), lpOption->Coverage, target, lpOption->Simd) : 1.0f);
+
+		chain.resize(chain.size() + 1);
+
+		TEXTURE_MIP_LEVEL* lpLevel = &chain.back();
+
+		lpLevel->Width = width;
+
+		lpLevel->Height = height;
+
+		lpLevel->Data.resize(width * height * 4);
+
+		CTextureFilter::ToColor(&linear[0], (width * height), lpOption->Gamma, scale, &lpLevel->Data[0], lpOption->Simd);
+	}
+
+	if (lpOption->Premultiply != 0)
+	{
+		for (size_t n = 0; n < chain.size(); n++)
+		{
+			CTextureFilter::Premultiply(&chain[n].Data[0], (chain[n].Width * chain[n].Height), lpOption->Simd);
+		}
+	}
+
+	return (int)chain.size();
+}
+
+int CTextureFilter::Downsample(BYTE* rgba, int width, int height, int steps, TEXTURE_FILTER_OPTION* lpOption, std::vector<BYTE>& output, int* OutWidth, int* OutHeight)
+{
+	// Halves the image steps times with the mip filter, returns the number of halvings actually done
+	TEXTURE_FILTER_KERNEL* lpKernel = CTextureFilter::GetKernel(lpOption->Filter);
+
+	std::vector<float> linear(width * height * 4);
+
+	std::vector<float> temp;
+
+	CTextureFilter::ToLinear(rgba, (width * height), lpOption->Gamma, &linear[0], lpOption->Simd);
+
+	float target = ((lpOption->Coverage > 0.0f) ? CTextureFilter::GetLinearCoverage(&linear[0], (width * height), lpOption->Coverage, lpOption->Simd) : 0.0f);
+
+	int count = 0;
+
+	for (; count < steps && (width > 1 || height > 1); count++)
+	{
+		CTextureFilter::ReduceLevel(linear, &width, &height, lpKernel, temp, lpOption->Simd);
+	}
+
+	float scale = ((lpOption->Coverage > 0.0f) ? CTextureFilter::FindAlphaScale(&linear[0], (width * height), lpOption->Coverage, target, lpOption->Simd) : 1.0f);
+
+	output.resize(width * height * 4);
+
+	CTextureFilter::ToColor(&linear[0], (width * height), lpOption->Gamma, scale, &output[0], lpOption->Simd);
+
+	if (lpOption->Premultiply != 0)
+	{
+		CTextureFilter::Premultiply(&output[0], (width * height), lpOption->Simd);
+	}
+
+	*OutWidth = width;
+
+	*OutHeight = height;
+
+	return count;
+}
+
+void CTextureFilter::Premultiply(BYTE* rgba, int count, bool simd)
+{
+	// Color times alpha over 255 in the stored space, (t + (t >> 8)) >> 8 is exact for t = c * a + 128
+	int n = 0;
+
+	if (simd != 0)
+	{
+		__m128i zero = _mm_setzero_si128();
+
+		__m128i round = _mm_set1_epi16(128);
+
+		__m128i mask = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+
+		for (; (n + 4) <= count; n += 4)
+		{
+			__m128i pixel = _mm_loadu_si128((__m128i*)&rgba[n * 4]);
+
+			__m128i lo = _mm_unpacklo_epi8(pixel, zero);
+
+			__m128i hi = _mm_unpackhi_epi8(pixel, zero);
+
+			__m128i al = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+
+			__m128i ah = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+
+			__m128i tl = _mm_add_epi16(_mm_mullo_epi16(lo, al), round);
+
+			__m128i th = _mm_add_epi16(_mm_mullo_epi16(hi, ah), round);
+
+			tl = _mm_srli_epi16(_mm_add_epi16(tl, _mm_srli_epi16(tl, 8)), 8);
+
+			th = _mm_srli_epi16(_mm_add_epi16(th, _mm_srli_epi16(th, 8)), 8);
+
+			tl = _mm_or_si128(_mm_and_si128(mask, lo), _mm_andnot_si128(mask, tl));
+
+			th = _mm_or_si128(_mm_and_si128(mask, hi), _mm_andnot_si128(mask, th));
+
+			_mm_storeu_si128((__m128i*)&rgba[n * 4], _mm_packus_epi16(tl, th));
+		}
+	}
+
+	for (; n < count; n++)
+	{
+		BYTE* pixel = &rgba[n * 4];
+
+		for (int i = 0; i < 3; i++)
+		{
+			int t = (pixel[i] * pixel[3]) + 128;
+
+			pixel[i] = (BYTE)((t + (t >> 8)) >> 8);
+		}
+	}
+}
+
+float CTextureFilter::GetCoverage(BYTE* rgba, int count, float reference)
+{
+	int limit = (int)(reference * 255.0f);
+
+	int covered = 0;
+
+	for (int n = 0; n < count; n++)
+	{
+		covered += ((rgba[(n * 4) + 3] > limit) ? 1 : 0);
+	}
+
+	return ((count > 0) ? ((float)covered / count) : 0.0f);
+}
+
+bool CTextureFilter::IsCutout(BYTE* rgba, int count)
+{
+	// Alpha tested textures are almost entirely fully transparent or fully opaque
+	int binary = 0;
+
+	int opaque = 0;
+
+	for (int n = 0; n < count; n++)
+	{
+		BYTE alpha = rgba[(n * 4) + 3];
+
+		binary += ((alpha == 0 || alpha == 0xFF) ? 1 : 0);
+
+		opaque += ((alpha == 0xFF) ? 1 : 0);
+	}
+
+	return (opaque != count && binary >= (count * TEXTURE_FILTER_CUTOUT_RATIO));
+}
+
+TEXTURE_FILTER_KERNEL* CTextureFilter::GetKernel(int filter)
+{
+	static TEXTURE_FILTER_KERNEL_SET set;
+
+	return &set.Kernel[((filter == TEXTURE_FILTER_KAISER) ? TEXTURE_FILTER_KAISER : TEXTURE_FILTER_BOX)];
+}
+
+void CTextureFilter::ReduceLevel(std::vector<float>& linear, int* width, int* height, TEXTURE_FILTER_KERNEL* lpKernel, std::vector<float>& temp, bool simd)
+{
+	int MipWidth = ((*width > 1) ? (*width / 2) : 1);
+
+	int MipHeight = ((*height > 1) ? (*height / 2) : 1);
+
+	// Rows first into the scratch buffer, then columns back into the linear buffer, a 1 texel side is left alone
+	if (*width > 1)
+	{
+		temp.resize(MipWidth * (*height) * 4);
+
+		CTextureFilter::FilterRows(&linear[0], *width, *height, lpKernel, &temp[0], simd);
+	}
+	else
+	{
+		temp = linear;
+	}
+
+	linear.resize(MipWidth * MipHeight * 4);
+
+	if (*height > 1)
+	{
+		CTextureFilter::FilterColumns(&temp[0], MipWidth, *height, lpKernel, &linear[0], simd);
+	}
+	else
+	{
+		memcpy(&linear[0], &temp[0], (MipWidth * MipHeight * 4 * sizeof(float)));
+	}
+
+	*width = MipWidth;
+
+	*height = MipHeight;
+}
+
+void CTextureFilter::ToLinear(BYTE* rgba, int count, bool gamma, float* output, bool simd)
+{
+	// Linear color weighted by alpha, so transparent texels do not bleed into the mips
+	TEXTURE_FILTER_TABLE* lpTable = GetFilterTable();
+
+	for (int n = 0; n < count; n++)
+	{
+		BYTE* in = &rgba[n * 4];
+
+		float* out = &output[n * 4];
+
+		float alpha = in[3] * (1.0f / 255.0f);
+
+		if (simd != 0)
+		{
+			__m128 color = ((gamma != 0) ? _mm_set_ps(1.0f, lpTable->Linear[in[2]], lpTable->Linear[in[1]], lpTable->Linear[in[0]]) : _mm_mul_ps(_mm_set_ps(255.0f, in[2], in[1], in[0]), _mm_set1_ps(1.0f / 255.0f)));
+
+			_mm_storeu_ps(out, _mm_mul_ps(color, _mm_set1_ps(alpha)));
+
+			out[3] = alpha;
+
+			continue;
+		}
+
+		for (int i = 0; i < 3; i++)
+		{
+			out[i] = ((gamma != 0) ? lpTable->Linear[in[i]] : (in[i] * (1.0f / 255.0f))) * alpha;
+		}
+
+		out[3] = alpha;
+	}
+}
+
+void CTextureFilter::ToColor(float* linear, int count, bool gamma, float AlphaScale, BYTE* output, bool simd)
+{
+	TEXTURE_FILTER_TABLE* lpTable = GetFilterTable();
+
+	float range = ((gamma != 0) ? (float)(TEXTURE_FILTER_SRGB_SIZE - 1) : 255.0f);
+
+	if (simd != 0)
+	{
+		__m128 zero = _mm_setzero_ps();
+
+		__m128 one = _mm_set1_ps(1.0f);
+
+		__m128 scale = _mm_set_ps(255.0f, range, range, range);
+
+		__m128 half = _mm_set1_ps(0.5f);
+
+		__m128 mask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+
+		for (int n = 0; n < count; n++)
+		{
+			__m128 pixel = _mm_loadu_ps(&linear[n * 4]);
+
+			__m128 alpha = _mm_shuffle_ps(pixel, pixel, _MM_SHUFFLE(3, 3, 3, 3));
+
+			__m128 valid = _mm_cmpgt_ps(alpha, zero);
+
+			__m128 color = _mm_and_ps(_mm_div_ps(pixel, _mm_or_ps(_mm_and_ps(valid, alpha), _mm_andnot_ps(valid, one))), valid);
+
+			color = _mm_or_ps(_mm_andnot_ps(mask, color), _mm_and_ps(mask, _mm_mul_ps(alpha, _mm_set1_ps(AlphaScale))));
+
+			color = _mm_min_ps(_mm_max_ps(color, zero), one);
+
+			int value[4];
+
+			_mm_storeu_si128((__m128i*)value, _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(color, scale), half)));
+
+			BYTE* out = &output[n * 4];
+
+			for (int i = 0; i < 3; i++)
+			{
+				out[i] = ((gamma != 0) ? lpTable->Srgb[value[i]] : (BYTE)value[i]);
+			}
+
+			out[3] = (BYTE)value[3];
+		}
+
+		return;
+	}
+
+	for (int n = 0; n < count; n++)
+	{
+		float* in = &linear[n * 4];
+
+		BYTE* out = &output[n * 4];
+
+		float alpha = in[3];
+
+		for (int i = 0; i < 3; i++)
+		{
+			float color = ((alpha > 0.0f) ? (in[i] / alpha) : 0.0f);
+
+			color = ((color < 0.0f) ? 0.0f : ((color > 1.0f) ? 1.0f : color));
+
+			int value = (int)((color * range) + 0.5f);
+
+			out[i] = ((gamma != 0) ? lpTable->Srgb[value] : (BYTE)value);
+		}
+
+		alpha = alpha * AlphaScale;
+
+		alpha = ((alpha < 0.0f) ? 0.0f : ((alpha > 1.0f) ? 1.0f : alpha));
+
+		out[3] = (BYTE)((int)((alpha * 255.0f) + 0.5f));
+	}
+}
+
+void CTextureFilter::FilterRows(float* source, int width, int height, TEXTURE_FILTER_KERNEL* lpKernel, float* output, bool simd)
+{
+	int MipWidth = width / 2;
+
+	for (int y = 0; y < height; y++)
+	{
+		float* row = &source[y * width * 4];
+
+		float* out = &output[y * MipWidth * 4];
+
+		for (int x = 0; x < MipWidth; x++)
+		{
+			if (simd != 0)
+			{
+				__m128 sum = _mm_setzero_ps();
+
+				for (int k = 0; k < lpKernel->TapCount; k++)
+				{
+					int sx = (x * 2) + lpKernel->Offset[k];
+
+					sx = ((sx < 0) ? 0 : ((sx >= width) ? (width - 1) : sx));
+
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&row[sx * 4]), _mm_set1_ps(lpKernel->Weight[k])));
+				}
+
+				_mm_storeu_ps(&out[x * 4], sum);
+
+				continue;
+			}
+
+			for (int i = 0; i < 4; i++)
+			{
+				float sum = 0.0f;
+
+				for (int k = 0; k < lpKernel->TapCount; k++)
+				{
+					int sx = (x * 2) + lpKernel->Offset[k];
+
+					sx = ((sx < 0) ? 0 : ((sx >= width) ? (width - 1) : sx));
+
+					sum = sum + (row[(sx * 4) + i] * lpKernel->Weight[k]);
+				}
+
+				out[(x * 4) + i] = sum;
+			}
+		}
+	}
+}
+
+void CTextureFilter::FilterColumns(float* source, int width, int height, TEXTURE_FILTER_KERNEL* lpKernel, float* output, bool simd)
+{
+	int MipHeight = height / 2;
+
+	float* row[TEXTURE_FILTER_MAX_TAP];
+
+	for (int y = 0; y < MipHeight; y++)
+	{
+		for (int k = 0; k < lpKernel->TapCount; k++)
+		{
+			int sy = (y * 2) + lpKernel->Offset[k];
+
+			sy = ((sy < 0) ? 0 : ((sy >= height) ? (height - 1) : sy));
+
+			row[k] = &source[sy * width * 4];
+		}
+
+		float* out = &output[y * width * 4];
+
+		if (simd != 0)
+		{
+			for (int x = 0; x < (width * 4); x += 4)
+			{
+				__m128 sum = _mm_setzero_ps();
+
+				for (int k = 0; k < lpKernel->TapCount; k++)
+				{
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&row[k][x]), _mm_set1_ps(lpKernel->Weight[k])));
+				}
+
+				_mm_storeu_ps(&out[x], sum);
+			}
+
+			continue;
+		}
+
+		for (int x = 0; x < (width * 4); x++)
+		{
+			float sum = 0.0f;
+
+			for (int k = 0; k < lpKernel->TapCount; k++)
+			{
+				sum = sum + (row[k][x] * lpKernel->Weight[k]);
+			}
+
+			out[x] = sum;
+		}
+	}
+}
+
+float CTextureFilter::GetLinearCoverage(float* linear, int count, float reference, bool simd)
+{
+	int covered = 0;
+
+	int n = 0;
+
+	if (simd != 0)
+	{
+		__m128 limit = _mm_set1_ps(reference);
+
+		__m128i total = _mm_setzero_si128();
+
+		for (; (n + 4) <= count; n += 4)
+		{
+			// Gather the alpha lanes of four texels, a true compare is -1 so the sum counts down
+			__m128 a = _mm_shuffle_ps(_mm_loadu_ps(&linear[n * 4]), _mm_loadu_ps(&linear[(n + 1) * 4]), _MM_SHUFFLE(3, 3, 3, 3));
+
+			__m128 b = _mm_shuffle_ps(_mm_loadu_ps(&linear[(n + 2) * 4]), _mm_loadu_ps(&linear[(n + 3) * 4]), _MM_SHUFFLE(3, 3, 3, 3));
+
+			__m128 alpha = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+
+			total = _mm_sub_epi32(total, _mm_castps_si128(_mm_cmpgt_ps(alpha, limit)));
+		}
+
+		int lane[4];
+
+		_mm_storeu_si128((__m128i*)lane, total);
+
+		covered = lane[0] + lane[1] + lane[2] + lane[3];
+	}
+
+	for (; n < count; n++)
+	{
+		covered += ((linear[(n * 4) + 3] > reference) ? 1 : 0);
+	}
+
+	return ((count > 0) ? ((float)covered / count) : 0.0f);
+}
+
+float CTextureFilter::FindAlphaScale(float* linear, int count, float reference, float target, bool simd)
+{
+	// Search the reference that keeps the top level coverage, the alpha scale maps it back onto the real one
+	float low = 0.0f;
+
+	float high = 1.0f;
+
+	for (int n = 0; n < TEXTURE_FILTER_COVERAGE_STEP; n++)
+	{
+		float middle = (low + high) * 0.5f;
+
+		if (CTextureFilter::GetLinearCoverage(linear, count, middle, simd) > target)
+		{
+			low = middle;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+
+	float value = (low + high) * 0.5f;
+
+	return ((value > 0.0f) ? (reference / value) : 1.0f);
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+
+#define TEXTURE_FILTER_BOX 0
+#define TEXTURE_FILTER_KAISER 1
+#define TEXTURE_FILTER_MAX_TAP 6
+#define TEXTURE_FILTER_SRGB_SIZE 16384
+#define TEXTURE_FILTER_CUTOUT_RATIO 0.9f
+#define TEXTURE_FILTER_COVERAGE_STEP 12
+
+struct TEXTURE_FILTER_OPTION
+{
+	int Filter;
+	bool Gamma; // Filters in linear light, the stored texels are sRGB
+	bool Premultiply;
+	float Coverage; // Alpha test reference kept across the chain, 0 disables
+	bool Simd;
+};
+
+struct TEXTURE_MIP_LEVEL
+{
+	int Width;
+	int Height;
+	std::vector<BYTE> Data; // RGBA
+};
+
+struct TEXTURE_FILTER_KERNEL
+{
+	int TapCount;
+	int Offset[TEXTURE_FILTER_MAX_TAP];
+	float Weight[TEXTURE_FILTER_MAX_TAP];
+};
+
+class CTextureFilter
+{
+public:
+
+	static int BuildMipChain(BYTE* rgba, int width, int height, TEXTURE_FILTER_OPTION* lpOption, std::vector<TEXTURE_MIP_LEVEL>& chain);
+
+	static int Downsample(BYTE* rgba, int width, int height, int steps, TEXTURE_FILTER_OPTION* lpOption, std::vector<BYTE>& output, int* OutWidth, int* OutHeight);
+
+	static void Premultiply(BYTE* rgba, int count, bool simd);
+
+	static float GetCoverage(BYTE* rgba, int count, float reference);
+
+	static bool IsCutout(BYTE* rgba, int count);
+
+private:
+
+	static TEXTURE_FILTER_KERNEL* GetKernel(int filter);
+
+	static void ReduceLevel(std::vector<float>& linear, int* width, int* height, TEXTURE_FILTER_KERNEL* lpKernel, std::vector<float>& temp, bool simd);
+
+	static void ToLinear(BYTE* rgba, int count, bool gamma, float* output, bool simd);
+
+	static void ToColor(float* linear, int count, bool gamma, float AlphaScale, BYTE* output, bool simd);
+
+	static void FilterRows(float* source, int width, int height, TEXTURE_FILTER_KERNEL* lpKernel, float* output, bool simd);
+
+	static void FilterColumns(float* source, int width, int height, TEXTURE_FILTER_KERNEL* lpKernel, float* output, bool simd);
+
+	static float GetLinearCoverage(float* linear, int count, float reference, bool simd);
+
+	static float FindAlphaScale(float* linear, int count, float reference, float target, bool simd);
+};
\ No newline at end of file
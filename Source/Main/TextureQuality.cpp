@@ -0,0 +1,150 @@
+#include "stdafx.h"
+#include "TextureQuality.h"
+#include "TextureCook.h"
+#include "TextureFilter.h"
+
+CTextureQuality gTextureQuality;
+
+CTextureQuality::CTextureQuality()
+{
+	for (int n = 0; n < TEXTURE_CATEGORY_MAX; n++)
+	{
+		this->m_Quality[n] = TEXTURE_QUALITY_FULL;
+	}
+}
+
+CTextureQuality::~CTextureQuality()
+{
+
+}
+
+void CTextureQuality::Load(char* path)
+{
+	// One tier for everything, each category can override it, -1 keeps the global tier
+	int quality = GetPrivateProfileInt("Antilag", "TextureQuality", TEXTURE_QUALITY_FULL, path);
+
+	static char* name[TEXTURE_CATEGORY_MAX] = { 0, "TextureQualityWorld", "TextureQualityPlayer", "TextureQualityItem", "TextureQualityInterface" };
+
+	for (int n = 0; n < TEXTURE_CATEGORY_MAX; n++)
+	{
+		int value = ((name[n] != 0) ? GetPrivateProfileInt("Antilag", name[n], -1, path) : -1);
+
+		this->SetQuality(n, ((value < 0) ? quality : value));
+	}
+}
+
+void CTextureQuality::SetQuality(int category, int quality)
+{
+	if (category < 0 || category >= TEXTURE_CATEGORY_MAX)
+	{
+		return;
+	}
+
+	this->m_Quality[category] = ((quality < TEXTURE_QUALITY_FULL) ? TEXTURE_QUALITY_FULL : ((quality > TEXTURE_QUALITY_QUARTER) ? TEXTURE_QUALITY_QUARTER : quality));
+}
+
+int CTextureQuality::GetQuality(int category)
+{
+	return ((category >= 0 && category < TEXTURE_CATEGORY_MAX) ? this->m_Quality[category] : TEXTURE_QUALITY_FULL);
+}
+
+int CTextureQuality::GetPathQuality(char* path)
+{
+	return this->GetQuality(CTextureQuality::GetCategory(path));
+}
+
+int CTextureQuality::GetCategory(char* path)
+{
+	char name[MAX_PATH];
+
+	int length = 0;
+
+	for (; path[length] != 0 && length < (MAX_PATH - 1); length++)
+	{
+		name[length] = ((path[length] == '/') ? '\\' : (char)tolower((BYTE)path[length]));
+	}
+
+	name[length] = 0;
+
+	// Objects are the map models, they are loaded and dropped together with the world
+	if (strstr(name, "\\world") != 0 || strstr(name, "\\object") != 0)
+	{
+		return TEXTURE_CATEGORY_WORLD;
+	}
+
+	if (strstr(name, "\\player\\") != 0)
+	{
+		return TEXTURE_CATEGORY_PLAYER;
+	}
+
+	if (strstr(name, "\\item\\") != 0)
+	{
+		return TEXTURE_CATEGORY_ITEM;
+	}
+
+	if (strstr(name, "\\interface\\") != 0)
+	{
+		return TEXTURE_CATEGORY_INTERFACE;
+	}
+
+	return TEXTURE_CATEGORY_OTHER;
+}
+
+bool CTextureQuality::Apply(char* path, TEXTURE_IMAGE* lpImage, CTextureBufferPool* lpPool)
+{
+	return CTextureQuality::Apply(this->GetPathQuality(path), lpImage, lpPool);
+}
+
+bool CTextureQuality::Apply(int quality, TEXTURE_IMAGE* lpImage, CTextureBufferPool* lpPool)
+{
+	// Small textures are left alone, halving them only blurs fonts and icons without saving memory
+	int steps = 0;
+
+	while (steps < quality && (lpImage->Width >> (steps + 1)) >= TEXTURE_QUALITY_MIN_SIZE && (lpImage->Height >> (steps + 1)) >= TEXTURE_QUALITY_MIN_SIZE)
+	{
+		steps++;
+	}
+
+	if (steps == 0)
+	{
+		return false;
+	}
+
+	TEXTURE_FILTER_OPTION option;
+
+	option.Filter = TEXTURE_FILTER_KAISER;
+
+	option.Gamma = 1;
+
+	option.Premultiply = 0;
+
+	option.Coverage = ((CTextureFilter::IsCutout(lpImage->Data, (lpImage->Width * lpImage->Height)) != 0) ? TEXTURE_COOK_ALPHA_REFERENCE : 0.0f);
+
+	option.Simd = 1;
+
+	std::vector<BYTE> output;
+
+	int width = 0;
+
+	int height = 0;
+
+	CTextureFilter::Downsample(lpImage->Data, lpImage->Width, lpImage->Height, steps, &option, output, &width, &height);
+
+	DWORD capacity = 0;
+
+	BYTE* data = lpPool->Alloc(output.size(), &capacity);
+
+	memcpy(data, &output[0], output.size());
+
+	lpPool->Free(lpImage->Data, lpImage->Capacity);
+
+	lpImage->Width = width;
+
+	lpImage->Height = height;
+
+	lpImage->Data = data;
+
+	lpImage->Capacity = capacity;
+
+	return true;
+}
\ No newline at end of file
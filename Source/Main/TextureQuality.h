@@ -0,0 +1,51 @@
+#pragma once
+
+#include "TextureDecoder.h"
+
+#define TEXTURE_QUALITY_MIN_SIZE 16
+
+enum eTextureQuality
+{
+	TEXTURE_QUALITY_FULL = 0,
+	TEXTURE_QUALITY_HALF = 1,
+	TEXTURE_QUALITY_QUARTER = 2,
+};
+
+enum eTextureCategory
+{
+	TEXTURE_CATEGORY_OTHER = 0,
+	TEXTURE_CATEGORY_WORLD = 1,
+	TEXTURE_CATEGORY_PLAYER = 2,
+	TEXTURE_CATEGORY_ITEM = 3,
+	TEXTURE_CATEGORY_INTERFACE = 4,
+	TEXTURE_CATEGORY_MAX = 5,
+};
+
+class CTextureQuality
+{
+public:
+
+	CTextureQuality();
+
+	~CTextureQuality();
+
+	void Load(char* path); // [Antilag] TextureQuality keys, for the loader that applies them once the game texture load is hooked
+
+	void SetQuality(int category, int quality);
+
+	int GetQuality(int category);
+
+	int GetPathQuality(char* path);
+
+	static int GetCategory(char* path);
+
+	bool Apply(char* path, TEXTURE_IMAGE* lpImage, CTextureBufferPool* lpPool);
+
+	static bool Apply(int quality, TEXTURE_IMAGE* lpImage, CTextureBufferPool* lpPool);
+
+private:
+
+	int m_Quality[TEXTURE_CATEGORY_MAX];
+};
+
+extern CTextureQuality gTextureQuality;
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "StdAfx.h"
 #include "Window.h"
+#include "FileTrace.h"
 #include "Offset.h"
 #include "Protect.h"
 #include "resource.h"
@@ -157,6 +158,14 @@ LRESULT WINAPI cWindow::MyWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPa
 		{
 			return 0;
 		}
+
+		case WM_DESTROY:
+		{
+			// The game is quitting, the trace is written here and not from DllMain under the loader lock
+			gFileTrace.Stop();
+
+			break;
+		}
 	}
 
 	return CallWindowProc(WndProc, hwnd, msg, wParam, lParam);
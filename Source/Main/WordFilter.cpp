@@ -0,0 +1,344 @@
+#include "stdafx.h"
+#include "WordFilter.h"
+#include "MappedFile.h"
+#include "FileCrypt.h"
+
+CWordFilter::CWordFilter()
+{
+	this->Clear();
+}
+
+CWordFilter::~CWordFilter()
+{
+
+}
+
+void CWordFilter::Clear()
+{
+	this->m_Word.clear();
+
+	this->m_WordList.clear();
+
+	memset(this->m_Class, 0, sizeof(this->m_Class));
+
+	this->m_ClassCount = 1;
+
+	this->m_StateCount = 0;
+
+	this->m_Table.clear();
+
+	this->m_List.clear();
+
+	this->m_StateWord.clear();
+
+	this->m_Output.clear();
+}
+
+bool CWordFilter::Load(char* path, int list)
+{
+	// Filter.bmd and FilterName.bmd: fixed 20 byte records, each FC CF AB encrypted on its own, then a checksum
+	CMappedFile file;
+
+	if (file.Open(path) == 0)
+	{
+		return false;
+	}
+
+	if (file.GetSize() < (WORD_FILTER_RECORD_SIZE * WORD_FILTER_RECORD_COUNT))
+	{
+		return false;
+	}
+
+	for (int n = 0; n < WORD_FILTER_RECORD_COUNT; n++)
+	{
+		char word[WORD_FILTER_RECORD_SIZE + 1];
+
+		memcpy(word, file.GetData() + (n * WORD_FILTER_RECORD_SIZE), WORD_FILTER_RECORD_SIZE);
+
+		BuxConvert((BYTE*)word, WORD_FILTER_RECORD_SIZE);
+
+		word[WORD_FILTER_RECORD_SIZE] = 0;
+
+		if (word[0] != 0)
+		{
+			this->AddWord(word, list);
+		}
+	}
+
+	return true;
+}
+
+void CWordFilter::AddWord(char* word, int list)
+{
+	// The lists spell the same word in several cases, after folding they share one entry
+	std::string folded;
+
+	for (; (*word) != 0; word++)
+	{
+		folded.push_back((char)CWordFilter::Fold((BYTE)(*word)));
+	}
+
+	if (folded.empty() != 0)
+	{
+		return;
+	}
+
+	for (size_t n = 0; n < this->m_Word.size(); n++)
+	{
+		if (this->m_Word[n] == folded)
+		{
+			this->m_WordList[n] |= list;
+			return;
+		}
+	}
+
+	this->m_Word.push_back(folded);
+
+	this->m_WordList.push_back(list);
+}
+
+bool CWordFilter::Build()
+{
+	// Only bytes some word uses get a column, every other byte shares column 0 which always goes back to the root
+	memset(this->m_Class, 0, sizeof(this->m_Class));
+
+	this->m_ClassCount = 1;
+
+	for (size_t n = 0; n < this->m_Word.size(); n++)
+	{
+		for (size_t i = 0; i < this->m_Word[n].size(); i++)
+		{
+			BYTE value = (BYTE)this->m_Word[n][i];
+
+			if (this->m_Class[value] == 0)
+			{
+				this->m_Class[value] = this->m_ClassCount++;
+			}
+		}
+	}
+
+	for (int n = 'A'; n <= 'Z'; n++)
+	{
+		this->m_Class[n] = this->m_Class[n + ('a' - 'A')];
+	}
+
+	// Trie of the folded words
+	std::vector<int> next(this->m_ClassCount, -1);
+
+	this->m_List.assign(1, 0);
+
+	this->m_StateWord.assign(1, -1);
+
+	this->m_StateCount = 1;
+
+	for (size_t n = 0; n < this->m_Word.size(); n++)
+	{
+		int state = 0;
+
+		for (size_t i = 0; i < this->m_Word[n].size(); i++)
+		{
+			int column = this->m_Class[(BYTE)this->m_Word[n][i]];
+
+			if (next[(state * this->m_ClassCount) + column] == -1)
+			{
+				next[(state * this->m_ClassCount) + column] = this->m_StateCount++;
+
+				next.resize((this->m_StateCount * this->m_ClassCount), -1);
+
+				this->m_List.push_back(0);
+
+				this->m_StateWord.push_back(-1);
+			}
+
+			state = next[(state * this->m_ClassCount) + column];
+		}
+
+		this->m_List[state] |= this->m_WordList[n];
+
+		this->m_StateWord[state] = n;
+	}
+
+	if (this->m_StateCount > WORD_FILTER_MAX_STATE)
+	{
+		this->m_StateCount = 0;
+
+		return false;
+	}
+
+	// Breadth first fail links, missing edges are filled with the fail state's edge so the table becomes a DFA
+	std::vector<int> fail(this->m_StateCount, 0);
+
+	std::vector<int> queue;
+
+	this->m_Output.assign(this->m_StateCount, -1);
+
+	for (int column = 0; column < this->m_ClassCount; column++)
+	{
+		if (next[column] == -1)
+		{
+			next[column] = 0;
+		}
+		else
+		{
+			queue.push_back(next[column]);
+		}
+	}
+
+	for (size_t head = 0; head < queue.size(); head++)
+	{
+		int state = queue[head];
+
+		for (int column = 0; column < this->m_ClassCount; column++)
+		{
+			int* lpNext = &next[(state * this->m_ClassCount) + column];
+
+			int target = next[(fail[state] * this->m_ClassCount) + column];
+
+			if ((*lpNext) == -1)
+			{
+				*lpNext = target;
+				continue;
+			}
+
+			fail[*lpNext] = target;
+
+			this->m_List[*lpNext] |= this->m_List[target];
+
+			this->m_Output[*lpNext] = ((this->m_StateWord[target] != -1) ? target : this->m_Output[target]);
+
+			queue.push_back(*lpNext);
+		}
+	}
+
+	this->m_Table.resize(this->m_StateCount * this->m_ClassCount);
+
+	for (size_t n = 0; n < this->m_Table.size(); n++)
+	{
+		this->m_Table[n] = (WORD)(next[n] | ((this->m_List[next[n]] != 0) ? WORD_FILTER_FLAG : 0));
+	}
+
+	return true;
+}
+
+bool CWordFilter::Check(char* text, int list)
+{
+	// One table step per byte, the lists are only looked at when the target state ends a word
+	if (this->m_StateCount == 0)
+	{
+		return false;
+	}
+
+	WORD* table = &this->m_Table[0];
+
+	int ClassCount = this->m_ClassCount;
+
+	int state = 0;
+
+	for (BYTE* p = (BYTE*)text; (*p) != 0; p++)
+	{
+		WORD value = table[(state * ClassCount) + this->m_Class[*p]];
+
+		state = value & WORD_FILTER_MAX_STATE;
+
+		if ((value & WORD_FILTER_FLAG) != 0 && (this->m_List[state] & list) != 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+int CWordFilter::Find(char* text, int list, std::vector<WORD_FILTER_MATCH>& match)
+{
+	match.clear();
+
+	if (this->m_StateCount == 0)
+	{
+		return 0;
+	}
+
+	int state = 0;
+
+	for (int n = 0; text[n] != 0; n++)
+	{
+		WORD value = this->m_Table[(state * this->m_ClassCount) + this->m_Class[(BYTE)text[n]]];
+
+		state = value & WORD_FILTER_MAX_STATE;
+
+		if ((value & WORD_FILTER_FLAG) == 0 || (this->m_List[state] & list) == 0)
+		{
+			continue;
+		}
+
+		for (int output = ((this->m_StateWord[state] != -1) ? state : this->m_Output[state]); output != -1; output = this->m_Output[output])
+		{
+			int word = this->m_StateWord[output];
+
+			if ((this->m_WordList[word] & list) != 0)
+			{
+				WORD_FILTER_MATCH info;
+
+				info.Length = this->m_Word[word].size();
+
+				info.Position = (n + 1) - info.Length;
+
+				info.Word = word;
+
+				match.push_back(info);
+			}
+		}
+	}
+
+	return match.size();
+}
+
+int CWordFilter::Mask(char* text, int list, char replace)
+{
+	std::vector<WORD_FILTER_MATCH> match;
+
+	int count = this->Find(text, list, match);
+
+	for (int n = 0; n < count; n++)
+	{
+		memset(&text[match[n].Position], replace, match[n].Length);
+	}
+
+	return count;
+}
+
+char* CWordFilter::GetWord(int index)
+{
+	return (char*)this->m_Word[index].c_str();
+}
+
+int CWordFilter::GetWordList(int index)
+{
+	return this->m_WordList[index];
+}
+
+int CWordFilter::GetWordCount()
+{
+	return this->m_Word.size();
+}
+
+int CWordFilter::GetStateCount()
+{
+	return this->m_StateCount;
+}
+
+int CWordFilter::GetClassCount()
+{
+	return this->m_ClassCount;
+}
+
+DWORD CWordFilter::GetTableSize()
+{
+	return (this->m_Table.size() * sizeof(WORD)) + this->m_List.size() + sizeof(this->m_Class);
+}
+
+BYTE CWordFilter::Fold(BYTE value)
+{
+	// ASCII only, double byte names are left alone
+	return (((value >= 'A') && (value <= 'Z')) ? (value + ('a' - 'A')) : value);
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#define WORD_FILTER_RECORD_SIZE 20
+#define WORD_FILTER_RECORD_COUNT 1000
+#define WORD_FILTER_CHAT 0x01
+#define WORD_FILTER_NAME 0x02
+#define WORD_FILTER_FLAG 0x8000
+#define WORD_FILTER_MAX_STATE 0x7FFF
+
+struct WORD_FILTER_MATCH
+{
+	int Position;
+	int Length;
+	int Word;
+};
+
+class CWordFilter
+{
+public:
+
+	CWordFilter();
+
+	~CWordFilter();
+
+	void Clear();
+
+	bool Load(char* path, int list);
+
+	void AddWord(char* word, int list);
+
+	bool Build();
+
+	bool Check(char* text, int list);
+
+	int Find(char* text, int list, std::vector<WORD_FILTER_MATCH>& match);
+
+	int Mask(char* text, int list, char replace);
+
+	char* GetWord(int index);
+
+	int GetWordList(int index);
+
+	int GetWordCount();
+
+	int GetStateCount();
+
+	int GetClassCount();
+
+	DWORD GetTableSize();
+
+	static BYTE Fold(BYTE value);
+
+private:
+
+	std::vector<std::string> m_Word; // Folded, one entry per distinct word
+
+	std::vector<int> m_WordList;
+
+	BYTE m_Class[256]; // Folded byte to column, 0 for bytes no word uses
+
+	int m_ClassCount;
+
+	int m_StateCount;
+
+	std::vector<WORD> m_Table; // DFA, m_StateCount rows of m_ClassCount columns, WORD_FILTER_FLAG when the target ends a word
+
+	std::vector<BYTE> m_List; // Lists of every word ending in the state, its suffixes included
+
+	std::vector<int> m_StateWord; // Word ending exactly in the state or -1
+
+	std::vector<int> m_Output; // Next state down the fail chain that ends a word or -1
+};
\ No newline at end of file
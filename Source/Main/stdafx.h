@@ -9,7 +9,9 @@ typedef unsigned __int64 QWORD;
 // System Include
 #include <windows.h>
 #include <iostream>
+#include <deque>
 #include <map>
+#include <vector>
 #include <math.h>
 #include <stdlib.h>
 #include <winsock2.h>